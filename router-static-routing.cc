@@ -18,6 +18,11 @@
  *     Branch: 10.1.2.1, DC: 10.1.2.2
  * - Link HQ-DC (10.1.3.0/30):
  *     HQ: 10.1.3.1, DC: 10.1.3.2
+ *
+ * The triangle is the built-in default; --topology loads any other WAN
+ * with the same per-link /30 address plan. --failure selects what fails at
+ * t=4s and recovers at t=8s, while probes and application monitors measure
+ * the impact. README.md describes every option and --help lists them.
  */
 
 #include "ns3/applications-module.h"
@@ -27,7 +32,42 @@
 #include "ns3/netanim-module.h"
 #include "ns3/network-module.h"
 #include "ns3/point-to-point-module.h"
+
+#include "wan-adaptive-stop.h"
+#include "wan-app-monitor.h"
+#include "wan-availability.h"
+#include "wan-csv-reader.h"
+#include "wan-forwarding-capacity.h"
+#include "wan-gray-failure.h"
+#include "wan-link-monitor.h"
+#include "wan-link-profile.h"
+#include "wan-link-trace.h"
+#include "wan-link-utilization.h"
+#include "wan-node-failure.h"
+#include "wan-outage-probe.h"
+#include "wan-pbr.h"
+#include "wan-queueing-model.h"
+#include "wan-redundancy.h"
+#include "wan-reorder-analyzer.h"
+#include "wan-replication.h"
+#include "wan-results-store.h"
+#include "wan-route-cache.h"
+#include "wan-route-compiler.h"
+#include "wan-sweep.h"
+#include "wan-topology-helper.h"
+#include "wan-topology.h"
+#include "wan-tracing.h"
+#include "wan-verifier.h"
+#include "wan-vrf.h"
+
+#include <algorithm>
+#include <iomanip>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
 
 using namespace ns3;
 using namespace std;
@@ -84,91 +124,15 @@ EnableLink(Ptr<NetDevice> device)
 }
 
 
-int
-main(int argc, char* argv[])
+/**
+ * Hand-written static routes of the built-in triangle.
+ */
+void
+InstallTriangleRoutes(const WanNetwork& network)
 {
-    // Enable logging
-    LogComponentEnable("UdpEchoClientApplication", LOG_LEVEL_INFO);
-    LogComponentEnable("UdpEchoServerApplication", LOG_LEVEL_INFO);
-
-    // Create three nodes: n0 (HQ), n1 (Branch), n2 (DC)
-    NodeContainer nodes;
-    nodes.Create(3);
-
-    Ptr<Node> n0 = nodes.Get(0); // HQ (Headquarters)
-    Ptr<Node> n1 = nodes.Get(1); // Branch Office
-    Ptr<Node> n2 = nodes.Get(2); // Data Center
-
-    // Create point-to-point links
-    PointToPointHelper p2p;
-    p2p.SetDeviceAttribute("DataRate", StringValue("5Mbps"));
-    p2p.SetChannelAttribute("Delay", StringValue("2ms"));
-
-    // Link 1: n0 (HQ) <-> n1 (Branch) - Network 1
-    NodeContainer link1Nodes(n0, n1);
-    NetDeviceContainer link1Devices = p2p.Install(link1Nodes);
-
-    // Link 2: n1 (Branch) <-> n2 (DC) - Network 2
-    NodeContainer link2Nodes(n1, n2);
-    NetDeviceContainer link2Devices = p2p.Install(link2Nodes);
-
-    // Link 3: n0 (HQ) <-> n2 (DC) - Network 3 (REDUNDANT PATH)
-    NodeContainer link3Nodes(n0, n2);
-    NetDeviceContainer link3Devices = p2p.Install(link3Nodes);
-
-    // Install mobility model to keep nodes at fixed positions
-    MobilityHelper mobility;
-    mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
-    mobility.Install(nodes);
-
-    // Set the positions for each node
-    Ptr<MobilityModel> mob0 = n0->GetObject<MobilityModel>();
-    Ptr<MobilityModel> mob1 = n1->GetObject<MobilityModel>();
-    Ptr<MobilityModel> mob2 = n2->GetObject<MobilityModel>();
-
-    // Triangle layout: HQ at top, Branch bottom-left, DC bottom-right
-    mob0->SetPosition(Vector(10.0, 2.0, 0.0));  // HQ at top center
-    mob1->SetPosition(Vector(5.0, 15.0, 0.0));  // Branch at bottom-left
-    mob2->SetPosition(Vector(15.0, 15.0, 0.0)); // DC at bottom-right
-
-    // Install Internet stack on all nodes
-    InternetStackHelper stack;
-    stack.Install(nodes);
-
-    // *** IP Address Assignment ***
-    
-    // Assign IP addresses to Network 1 (10.1.1.0/30) - HQ <-> Branch
-    Ipv4AddressHelper address1;
-    address1.SetBase("10.1.1.0", "255.255.255.252"); // /30 subnet
-    Ipv4InterfaceContainer interfaces1 = address1.Assign(link1Devices);
-    // interfaces1.GetAddress(0) = 10.1.1.1 (n0 - HQ)
-    // interfaces1.GetAddress(1) = 10.1.1.2 (n1 - Branch)
-
-    // Assign IP addresses to Network 2 (10.1.2.0/30) - Branch <-> DC
-    Ipv4AddressHelper address2;
-    address2.SetBase("10.1.2.0", "255.255.255.252"); // /30 subnet
-    Ipv4InterfaceContainer interfaces2 = address2.Assign(link2Devices);
-    // interfaces2.GetAddress(0) = 10.1.2.1 (n1 - Branch)
-    // interfaces2.GetAddress(1) = 10.1.2.2 (n2 - DC)
-
-    // Assign IP addresses to Network 3 (10.1.3.0/30) - HQ <-> DC
-    Ipv4AddressHelper address3;
-    address3.SetBase("10.1.3.0", "255.255.255.252"); // /30 subnet
-    Ipv4InterfaceContainer interfaces3 = address3.Assign(link3Devices);
-    // interfaces3.GetAddress(0) = 10.1.3.1 (n0 - HQ)
-    // interfaces3.GetAddress(1) = 10.1.3.2 (n2 - DC)
-
-    // *** Configure Static Routing ***
-
-    // Enable IP forwarding on ALL nodes (they all act as routers)
-    Ptr<Ipv4> ipv4HQ = n0->GetObject<Ipv4>();
-    ipv4HQ->SetAttribute("IpForward", BooleanValue(true));
-
-    Ptr<Ipv4> ipv4Branch = n1->GetObject<Ipv4>();
-    ipv4Branch->SetAttribute("IpForward", BooleanValue(true));
-
-    Ptr<Ipv4> ipv4DC = n2->GetObject<Ipv4>();
-    ipv4DC->SetAttribute("IpForward", BooleanValue(true));
+    Ptr<Node> n0 = network.nodes.Get(0); // HQ (Headquarters)
+    Ptr<Node> n1 = network.nodes.Get(1); // Branch Office
+    Ptr<Node> n2 = network.nodes.Get(2); // Data Center
 
     // Get static routing protocol helper
     Ipv4StaticRoutingHelper staticRoutingHelper;
@@ -229,11 +193,17 @@ main(int argc, char* argv[])
         Ipv4Address("10.1.3.1"),      // Next hop: HQ's IP on HQ-DC link
         2                             // Interface index: DC's interface to HQ
     );
+}
 
-    // Print routing tables for verification
-    Ptr<OutputStreamWrapper> routingStream =
-        Create<OutputStreamWrapper>("router-static-routing.routes", std::ios::out);
-    staticRoutingHelper.PrintRoutingTableAllAt(Seconds(1.0), routingStream);
+/**
+ * Print the addressing and redundant paths of the built-in triangle.
+ */
+void
+PrintTriangleSummary(const WanNetwork& network)
+{
+    const Ipv4InterfaceContainer& interfaces1 = network.linkInterfaces[0]; // HQ <-> Branch
+    const Ipv4InterfaceContainer& interfaces2 = network.linkInterfaces[1]; // Branch <-> DC
+    const Ipv4InterfaceContainer& interfaces3 = network.linkInterfaces[2]; // HQ <-> DC
 
     // *** Display Network Configuration ***
     
@@ -268,6 +238,79 @@ main(int argc, char* argv[])
     cout << "  Primary: Branch -> DC (direct via 10.1.2.0/30)" << endl;
     cout << "  Backup:  Branch -> HQ -> DC" << endl;
     cout << "========================================\n" << endl;
+}
+
+/**
+ * Print sites and links of an imported topology.
+ */
+void
+PrintTopologySummary(const WanTopology& topology, const WanNetwork& network)
+{
+    cout << "\n========================================" << endl;
+    cout << "Network Configuration Summary" << endl;
+    cout << "========================================\n" << endl;
+    cout << "Sites: " << topology.GetNSites() << ", links: " << topology.GetNLinks() << endl;
+
+    // Listing every link of a large WAN is not useful on the console
+    const uint32_t maxListed = 50;
+    for (uint32_t l = 0; l < topology.GetNLinks() && l < maxListed; ++l)
+    {
+        const WanLink& link = topology.GetLink(l);
+        cout << "  " << topology.GetSite(link.a).name << " (" << network.linkInterfaces[l].GetAddress(0)
+             << ") <-> " << topology.GetSite(link.b).name << " ("
+             << network.linkInterfaces[l].GetAddress(1) << ") " << link.bandwidth << " "
+             << link.delay.GetMilliSeconds() << "ms cost " << link.cost
+             << (link.profile.empty() ? "" : " (" + link.profile + ")") << endl;
+    }
+    if (topology.GetNLinks() > maxListed)
+    {
+        cout << "  ... " << topology.GetNLinks() - maxListed << " more links" << endl;
+    }
+    cout << "========================================\n" << endl;
+}
+
+/**
+ * Print the circuits that use a profile.
+ */
+void
+PrintCircuitProfiles(const WanTopology& topology)
+{
+    bool header = false;
+    for (uint32_t l = 0; l < topology.GetNLinks(); ++l)
+    {
+        const WanLink& link = topology.GetLink(l);
+        if (link.profile.empty())
+        {
+            continue;
+        }
+        if (!header)
+        {
+            cout << "Circuit Profiles:" << endl;
+            header = true;
+        }
+        cout << "  " << topology.GetSite(link.a).name << " <-> " << topology.GetSite(link.b).name
+             << ": " << link.profile << ", " << link.bandwidth << ", "
+             << link.delay.GetMilliSeconds() << "ms, loss " << link.loss * 100 << "%, jitter "
+             << link.jitter.GetMilliSeconds() << "ms" << endl;
+    }
+    if (header)
+    {
+        cout << "========================================\n" << endl;
+    }
+}
+
+/**
+ * Echo servers on Branch and DC, echo clients on HQ and Branch.
+ */
+void
+InstallTriangleApplications(const WanNetwork& network)
+{
+    Ptr<Node> n0 = network.nodes.Get(0); // HQ (Headquarters)
+    Ptr<Node> n1 = network.nodes.Get(1); // Branch Office
+    Ptr<Node> n2 = network.nodes.Get(2); // Data Center
+    const Ipv4InterfaceContainer& interfaces1 = network.linkInterfaces[0]; // HQ <-> Branch
+    const Ipv4InterfaceContainer& interfaces2 = network.linkInterfaces[1]; // Branch <-> DC
+    const Ipv4InterfaceContainer& interfaces3 = network.linkInterfaces[2]; // HQ <-> DC
 
     // *** Application Layer - UDP Echo ***
 
@@ -322,8 +365,15 @@ main(int argc, char* argv[])
     clientApps3.Start(Seconds(4.0));
     clientApps3.Stop(Seconds(11.0));
     cout << "  - Branch -> DC (direct path via 10.1.2.0/30)" << endl;
+}
 
-
+/**
+ * Fail the HQ-DC link at t=4s and restore it at t=8s.
+ */
+void
+ScheduleTriangleFailure(const WanNetwork& network)
+{
+    const NetDeviceContainer& link3Devices = network.linkDevices[2]; // HQ <-> DC
 
     // ============================================
     // SIMULATE LINK FAILURE FOR TESTING BACKUP PATH
@@ -348,45 +398,2235 @@ main(int argc, char* argv[])
     // Schedule link restoration at t=8 seconds (optional - to test recovery)
     Simulator::Schedule(Seconds(8.0), &EnableLink, link3Devices.Get(0)); // HQ's end
     Simulator::Schedule(Seconds(8.0), &EnableLink, link3Devices.Get(1)); // DC's end
+}
+
+/**
+ * Fail the circuits between two sites of a topology at t=4s and restore
+ * them at t=8s.
+ * \param pair the sites, "SiteA-SiteB"
+ * \return the failed links
+ */
+std::vector<uint32_t>
+ScheduleLinkFailure(const WanTopology& topology, const WanNetwork& network, const std::string& pair)
+{
+    std::vector<uint32_t> links;
+    NS_ABORT_MSG_UNLESS(topology.FindLinks(pair, links) && !links.empty(),
+                        "--failLink " << pair << " is no circuit");
+
+    cout << "\n========================================" << endl;
+    cout << "Link Failure Simulation Configuration" << endl;
+    cout << "========================================" << endl;
+    cout << "  t=4s:     " << pair << " link FAILS (" << links.size() << " circuits)" << endl;
+    cout << "  t=8s:     " << pair << " link RESTORED" << endl;
+    cout << "========================================\n" << endl;
 
+    for (uint32_t l : links)
+    {
+        for (uint32_t end = 0; end < 2; ++end)
+        {
+            Simulator::Schedule(Seconds(4.0), &DisableLink, network.linkDevices[l].Get(end));
+            Simulator::Schedule(Seconds(8.0), &EnableLink, network.linkDevices[l].Get(end));
+        }
+    }
+    return links;
+}
 
-    // *** NetAnim Configuration ***
-    AnimationInterface anim("router-static-routing.xml");
+/**
+ * \return an address of a site, on another circuit than avoid if it has one
+ */
+Ipv4Address
+GetSiteAddress(const WanNetwork& network, uint32_t site, uint32_t avoid)
+{
+    const WanGraph& graph = network.graph;
+    uint32_t chosen = graph.Begin(site);
+    for (uint32_t arc = graph.Begin(site); arc < graph.End(site); ++arc)
+    {
+        if (graph.GetLink(arc) != avoid)
+        {
+            chosen = arc;
+            break;
+        }
+    }
+    return network.linkInterfaces[graph.GetLink(chosen)].GetAddress(graph.GetLocalEnd(chosen));
+}
 
-    // Node positions are already set via MobilityModel above
-    // NetAnim will automatically use the mobility model positions
+/**
+ * Let the HQ-DC link go down and up every period from t=4s, and stay up
+ * from t=8s.
+ */
+void
+ScheduleTriangleFlaps(const WanNetwork& network, Time period)
+{
+    NS_ABORT_MSG_UNLESS(period.IsStrictlyPositive(), "--flapPeriod must be positive");
+    const NetDeviceContainer& link3Devices = network.linkDevices[2]; // HQ <-> DC
 
-    // Set node descriptions
-    anim.UpdateNodeDescription(n0, "HQ\n10.1.1.1 | 10.1.3.1");
-    anim.UpdateNodeDescription(n1, "Branch\n10.1.1.2 | 10.1.2.1");
-    anim.UpdateNodeDescription(n2, "DC\n10.1.2.2 | 10.1.3.2");
+    cout << "\n========================================" << endl;
+    cout << "Link Flapping Configuration" << endl;
+    cout << "========================================" << endl;
+    cout << "  t=4-8s:   HQ-DC link down and up every " << period.GetMilliSeconds() << "ms"
+         << endl;
+    cout << "  t=8s:     HQ-DC link stays up" << endl;
+    cout << "========================================\n" << endl;
 
-    // Set node colors
-    anim.UpdateNodeColor(n0, 0, 255, 0);   // Green for HQ
-    anim.UpdateNodeColor(n1, 255, 255, 0); // Yellow for Branch
-    anim.UpdateNodeColor(n2, 0, 0, 255);   // Blue for DC
+    bool down = true;
+    for (Time at = Seconds(4.0); at < Seconds(8.0); at += period, down = !down)
+    {
+        for (uint32_t end = 0; end < 2; ++end)
+        {
+            Simulator::Schedule(at, down ? &DisableLink : &EnableLink, link3Devices.Get(end));
+        }
+    }
+    if (!down)
+    {
+        Simulator::Schedule(Seconds(8.0), &EnableLink, link3Devices.Get(0));
+        Simulator::Schedule(Seconds(8.0), &EnableLink, link3Devices.Get(1));
+    }
+}
 
-    // Enable PCAP tracing on all devices for Wireshark analysis
-    p2p.EnablePcapAll("router-static-routing");
+void
+ScheduleNodeFailure(const WanTopology& topology,
+                    const WanNetwork& network,
+                    WanNodeFailureInjector& injector,
+                    const std::string& site,
+                    Time bootDelay,
+                    Time routeInstallDelay)
+{
+    int64_t index = topology.FindSite(site);
+    NS_ABORT_MSG_IF(index < 0, "Unknown site " << site);
 
     cout << "\n========================================" << endl;
-    cout << "Starting Simulation..." << endl;
+    cout << "Node Failure Simulation Configuration" << endl;
+    cout << "========================================" << endl;
+    cout << "Timeline:" << endl;
+    cout << "  t=0-4s:   Normal operation" << endl;
+    cout << "  t=4s:     " << site << " router FAILS (interfaces down, FIB cleared)" << endl;
+    cout << "  t=8s:     Power restored, " << site << " boots" << endl;
+    cout << "  t=" << (Seconds(8.0) + bootDelay).GetSeconds() << "s:   Interfaces up" << endl;
+    cout << "  t=" << (Seconds(8.0) + bootDelay + routeInstallDelay).GetSeconds()
+         << "s:   Static routes reinstalled" << endl;
     cout << "========================================\n" << endl;
 
-    // Run simulation
-    Simulator::Stop(Seconds(12.0));
-    Simulator::Run();
-    Simulator::Destroy();
+    injector.SetBootDelay(bootDelay);
+    injector.SetRouteInstallDelay(routeInstallDelay);
+    injector.Schedule(network.nodes.Get(index), Seconds(4.0), Seconds(4.0));
+}
 
+void
+PrintOutageReport(const std::vector<std::unique_ptr<WanOutageProbe>>& probes,
+                  Time interval,
+                  Time stop)
+{
     cout << "\n========================================" << endl;
-    cout << "Simulation Complete!" << endl;
+    cout << "Outage Report (probe every " << interval.GetMilliSeconds() << "ms, 1.5-"
+         << stop.GetSeconds() << "s)" << endl;
     cout << "========================================" << endl;
-    cout << "Output files saved in current directory:" << endl;
-    cout << "  - router-static-routing.xml (NetAnim)" << endl;
-    cout << "  - router-static-routing.routes (Routing tables)" << endl;
-    cout << "  - router-static-routing-*.pcap (Packet captures)" << endl;
-    cout << "\nTo visualize:" << endl;
-    cout << "  netanim router-static-routing.xml" << endl;
+    for (const auto& probe : probes)
+    {
+        cout << probe->GetName() << ": " << probe->GetReceived() << "/" << probe->GetSent()
+             << " probes received, longest gap " << probe->GetLongestGap().GetSeconds()
+             << "s, affected " << probe->GetAffectedTime().GetSeconds() << "s, delay mean "
+             << probe->GetMeanDelay().GetMilliSeconds() << "ms max "
+             << probe->GetMaxDelay().GetMilliSeconds() << "ms";
+        if (probe->GetReordered() > 0)
+        {
+            cout << ", " << probe->GetReordered() << " reordered";
+        }
+        cout << endl;
+    }
+    cout << "========================================" << endl;
+}
+
+/**
+ * Application monitors of one run, by application class
+ */
+struct ApplicationMonitors
+{
+    std::vector<std::unique_ptr<WanVoipMonitor>> voip;                //!< VoIP calls
+    std::vector<std::unique_ptr<WanTransactionMonitor>> transactions; //!< Request/response
+    std::vector<std::unique_ptr<WanStreamingMonitor>> streams;        //!< Video streams
+};
+
+/**
+ * Applications between HQ and DC, on the addresses the probes use: a VoIP
+ * call, an ERP client at HQ with its server at DC and a video stream from
+ * DC to HQ, marked EF, AF21 and AF41 respectively.
+ */
+void
+InstallApplicationMonitors(ApplicationMonitors& apps, const WanNetwork& network)
+{
+    Ptr<Node> hq = network.nodes.Get(0);
+    Ptr<Node> dc = network.nodes.Get(2);
+    Ipv4Address hqAddress = network.linkInterfaces[0].GetAddress(0); // HQ on HQ-Branch
+    Ipv4Address dcAddress = network.linkInterfaces[1].GetAddress(1); // DC on Branch-DC
+
+    apps.voip.push_back(std::make_unique<WanVoipMonitor>("HQ->DC", hq, dc, dcAddress, 7010));
+    apps.voip.push_back(std::make_unique<WanVoipMonitor>("DC->HQ", dc, hq, hqAddress, 7011));
+    apps.transactions.push_back(
+        std::make_unique<WanTransactionMonitor>("HQ->DC", hq, dc, hqAddress, dcAddress, 7012));
+    apps.streams.push_back(
+        std::make_unique<WanStreamingMonitor>("DC->HQ", dc, hq, hqAddress, 7013));
+
+    for (auto& voip : apps.voip)
+    {
+        voip->SetDscp(46);
+    }
+    for (auto& transaction : apps.transactions)
+    {
+        transaction->SetDscp(18);
+    }
+    for (auto& stream : apps.streams)
+    {
+        stream->SetDscp(34);
+    }
+    for (auto& voip : apps.voip)
+    {
+        voip->Start(Seconds(1.5), Seconds(11.0));
+    }
+    for (auto& transaction : apps.transactions)
+    {
+        transaction->Start(Seconds(1.5), Seconds(11.0));
+    }
+    for (auto& stream : apps.streams)
+    {
+        stream->Start(Seconds(1.5), Seconds(11.0));
+    }
+}
+
+void
+PrintApplicationReport(const ApplicationMonitors& apps, Time stop)
+{
+    cout << "\n========================================" << endl;
+    cout << "Application Impact (1.5-" << stop.GetSeconds() << "s)" << endl;
+    cout << "========================================" << endl;
+    for (const auto& voip : apps.voip)
+    {
+        cout << "VoIP " << voip->GetName() << ": call MOS " << voip->GetCallMos() << " (R "
+             << voip->GetCallRFactor() << "), worst 1s MOS " << voip->GetWorstMos() << ", "
+             << voip->GetDegradedTime().GetSeconds() << "s below MOS 3.6, loss "
+             << voip->GetLoss() * 100 << "%, mouth-to-ear "
+             << voip->GetMouthToEarDelay().GetMilliSeconds() << "ms" << endl;
+    }
+    for (const auto& transaction : apps.transactions)
+    {
+        cout << "Transactions " << transaction->GetName() << ": " << transaction->GetCompleted()
+             << " completed, " << transaction->GetFailed() << " failed, "
+             << transaction->GetSlaBreaches() << " over the 500ms SLA; completion mean "
+             << transaction->GetMeanCompletionTime().GetMilliSeconds() << "ms p95 "
+             << transaction->GetP95CompletionTime().GetMilliSeconds() << "ms max "
+             << transaction->GetMaxCompletionTime().GetMilliSeconds() << "ms" << endl;
+    }
+    for (const auto& stream : apps.streams)
+    {
+        cout << "Streaming " << stream->GetName() << ": startup "
+             << stream->GetStartupDelay().GetSeconds() << "s, " << stream->GetRebufferEvents()
+             << " stalls, " << stream->GetRebufferTime().GetSeconds() << "s rebuffering ("
+             << stream->GetRebufferRatio() * 100 << "% of viewing), "
+             << stream->GetLostMedia().GetSeconds() << "s of media lost" << endl;
+    }
+    cout << "========================================" << endl;
+}
+
+void
+InstallTriangleFailover(WanLinkMonitor& monitor, const WanNetwork& network)
+{
+    const Ipv4InterfaceContainer& interfaces1 = network.linkInterfaces[0]; // HQ <-> Branch
+    const Ipv4InterfaceContainer& interfaces2 = network.linkInterfaces[1]; // Branch <-> DC
+    const Ipv4InterfaceContainer& interfaces3 = network.linkInterfaces[2]; // HQ <-> DC
+
+    // HQ reaches the Branch-DC network across HQ-DC, or via Branch
+    WanFailoverRoute hq;
+    hq.node = network.nodes.Get(0);
+    hq.network = Ipv4Address("10.1.2.0");
+    hq.mask = Ipv4Mask("255.255.255.252");
+    hq.primaryGateway = interfaces3.GetAddress(1); // DC's IP on HQ-DC link
+    hq.primaryInterface = 2;
+    hq.backupGateway = interfaces1.GetAddress(1); // Branch's IP on HQ-Branch link
+    hq.backupInterface = 1;
+    monitor.AddFailoverRoute(hq);
+
+    // DC reaches the HQ-Branch network across HQ-DC, or via Branch
+    WanFailoverRoute dc;
+    dc.node = network.nodes.Get(2);
+    dc.network = Ipv4Address("10.1.1.0");
+    dc.mask = Ipv4Mask("255.255.255.252");
+    dc.primaryGateway = interfaces3.GetAddress(0); // HQ's IP on HQ-DC link
+    dc.primaryInterface = 2;
+    dc.backupGateway = interfaces2.GetAddress(0); // Branch's IP on Branch-DC link
+    dc.backupInterface = 1;
+    monitor.AddFailoverRoute(dc);
+}
+
+void
+PrintFailoverReport(const WanLinkMonitor& monitor, Time failureStart)
+{
+    cout << "\n========================================" << endl;
+    cout << "Failover Events (HQ-DC monitor)" << endl;
+    cout << "========================================" << endl;
+    if (monitor.GetEvents().empty())
+    {
+        cout << "  none" << endl;
+    }
+    for (const auto& event : monitor.GetEvents())
+    {
+        cout << "  t=" << event.at.GetSeconds() << "s " << monitor.GetSiteName(event.end) << ": "
+             << (event.usable ? "back to primary" : "failed over");
+        if (event.at >= failureStart)
+        {
+            cout << " (" << (event.at - failureStart).GetMilliSeconds() << "ms after failure)";
+        }
+        cout << endl;
+    }
+    cout << "  " << monitor.GetNFlaps() << " flaps, " << monitor.GetNSuppressions()
+         << " damping suppressions, " << monitor.GetNRouteUpdates() << " route updates" << endl;
+    cout << "========================================" << endl;
+}
+
+/**
+ * Start a reorder analysis window on a usability change of a tracked link.
+ */
+void
+MarkFailoverEvent(WanReorderAnalyzer* analyzer,
+                  const WanTopology* topology,
+                  uint32_t link,
+                  uint32_t end,
+                  bool usable)
+{
+    const WanLink& l = topology->GetLink(link);
+    analyzer->MarkEvent(topology->GetSite(end == 0 ? l.a : l.b).name +
+                        (usable ? " back on " : " off ") + topology->GetSite(l.a).name + "-" +
+                        topology->GetSite(l.b).name);
+}
+
+/**
+ * Node failure listener: a failed or rebooted router's end of a probe or
+ * application monitor stops or restarts.
+ */
+template <typename T>
+void
+NotifyNodeState(T* flow, Ptr<Node> node, bool up)
+{
+    flow->SetNodeState(node, up);
+}
+
+/**
+ * Options of one scenario run
+ */
+struct ScenarioConfig
+{
+    /// Built-in triangle with its routes
+    bool triangle{true};
+    /// Link trace, if any
+    std::string linkTraceFile;
+    /// Simulation s per trace s
+    double linkTraceScale{1.0};
+    /// link, node, gray, flap or none
+    std::string failure{"link"};
+    /// Down and up time for --failure=flap
+    Time flapPeriod{MilliSeconds(500)};
+    /// Site for --failure=node
+    std::string failNode{"DC"};
+    /// Circuit for --failure=link outside the triangle, e.g. R1C1-R1C2
+    std::string failLink;
+    /// Spec for --failure=gray
+    std::string grayFailure{"HQ-DC,loss=5%,at=4s,until=8s"};
+    /// static, bfd or sla
+    std::string detection{"static"};
+    /// none, active-standby, active-active or weighted
+    std::string redundancy{"none"};
+    /// Load sharing of the redundancy policy: flow or packet
+    std::string loadSharing{"flow"};
+    /// Weighted shares per link, e.g. HQ-DC=3,HQ-Branch=1
+    std::string linkWeights;
+    /// Health time before routes return to a recovered link
+    Time revertHold;
+    /// Exponential flap damping of link recovery
+    bool damping{false};
+    /// Outage probe interval
+    Time probeInterval{MilliSeconds(50)};
+    /// Node reboot: boot time
+    Time bootDelay{Seconds(1.0)};
+    /// Node reboot: route install time
+    Time routeInstallDelay{Seconds(0.5)};
+    /// Write NetAnim, pcap and route files
+    bool outputs{true};
+    /// Capture pcap files (with outputs)
+    bool pcap{true};
+    /// Write the NetAnim file (with outputs)
+    bool anim{true};
+    /// Collect utilization and reorder statistics
+    bool stats{true};
+    /// Start of the pcap and NetAnim window
+    Time traceStart;
+    /// End of the pcap and NetAnim window; zero for the end of the run
+    Time traceStop;
+    /// Directory of the output files, with trailing '/'; empty for the current one
+    std::string outputDir;
+    /// Threads of the route computation; 0 for one per core
+    uint32_t routeThreads{0};
+    /// Load each router's routes into a bulk FIB instead of static routing
+    bool bulkFib{true};
+    /// Route cache slots per router; 0 for none
+    uint32_t routeCache{0};
+    /// Tenant VPNs, e.g. Sales,Ops=HQ+DC; empty for none
+    std::string tenants;
+    /// Traffic between the sites of every tenant, per direction
+    DataRate tenantLoad{0};
+    /// Policy-based routing rules, e.g. HQ:dscp=BE,dst=DC,via=Branch; empty for none
+    std::string pbr;
+    /// CSV file of policy-based routing rules; empty for none
+    std::string pbrFile;
+    /// Router forwarding limits, e.g. branch:pps=300k,crypto=200Mbps; empty for none
+    std::string routerCapacity;
+    /// End the run once the post-failure measurements are steady
+    bool adaptiveStop{false};
+    /// Earliest adaptive stop after the end of the failure
+    Time stopHorizon{Seconds(1.0)};
+    /// Relative confidence interval half-width of a steady series
+    double stopPrecision{0.05};
+};
+
+/**
+ * Abort unless the options of a scenario are consistent.
+ */
+void
+CheckScenarioConfig(const ScenarioConfig& config)
+{
+    const bool triangle = config.triangle;
+    const std::string& failure = config.failure;
+    const std::string& detection = config.detection;
+    NS_ABORT_MSG_IF(failure != "link" && failure != "node" && failure != "gray" &&
+                        failure != "flap" && failure != "none",
+                    "--failure must be link, node, gray, flap or none");
+    NS_ABORT_MSG_IF(detection != "static" && detection != "bfd" && detection != "sla",
+                    "--detection must be static, bfd or sla");
+    WanPolicyRouting::Mode redundancyMode;
+    NS_ABORT_MSG_UNLESS(config.redundancy == "none" ||
+                            WanRedundancyEngine::ParseMode(config.redundancy, redundancyMode),
+                        "--redundancy must be none, active-standby, active-active or weighted");
+    NS_ABORT_MSG_IF(config.loadSharing != "flow" && config.loadSharing != "packet",
+                    "--loadSharing must be flow or packet");
+    NS_ABORT_MSG_IF(detection != "static" && !triangle && config.redundancy == "none",
+                    "--detection is only defined for the triangle");
+    NS_ABORT_MSG_IF(failure == "flap" && !triangle,
+                    "--failure=flap is only defined for the triangle");
+    NS_ABORT_MSG_IF(failure == "link" && !triangle && config.failLink.empty(),
+                    "--failure=link needs --failLink outside the triangle");
+    NS_ABORT_MSG_IF(triangle && !config.failLink.empty(),
+                    "--failLink is for topology files; the triangle fails HQ-DC");
+    NS_ABORT_MSG_IF(config.adaptiveStop && !triangle,
+                    "--adaptiveStop needs the probes of the triangle");
+    NS_ABORT_MSG_IF(config.adaptiveStop && config.stopPrecision <= 0,
+                    "--stopPrecision must be positive");
+    NS_ABORT_MSG_IF(config.tenantLoad.GetBitRate() > 0 && config.tenants.empty(),
+                    "--tenantLoad needs --tenants");
+}
+
+/**
+ * Set a scenario option by its (lower-case) command-line name, for the
+ * points of a --sweep.
+ */
+void
+SetScenarioOption(ScenarioConfig& config, const std::string& name, const std::string& value)
+{
+    double number;
+    // A plain number is seconds on the command line but milliseconds in the
+    // CSV readers, so sweep times must name their unit
+    auto duration = [&name](const std::string& text) {
+        double plain;
+        NS_ABORT_MSG_IF(WanCsvReader::ParseNumber(text, plain),
+                        "Sweep: " << name << "=" << text << " needs a unit, e.g. " << text << "s");
+        return WanCsvReader::ParseTime(text);
+    };
+    auto flag = [&name](const std::string& text) {
+        const std::string lower = WanCsvReader::ToLower(text);
+        NS_ABORT_MSG_IF(lower != "true" && lower != "false" && lower != "1" && lower != "0",
+                        "Sweep: " << name << " must be true or false");
+        return lower == "true" || lower == "1";
+    };
+    if (name == "failure")
+    {
+        config.failure = value;
+    }
+    else if (name == "flapperiod")
+    {
+        config.flapPeriod = duration(value);
+    }
+    else if (name == "failnode")
+    {
+        config.failNode = value;
+    }
+    else if (name == "faillink")
+    {
+        config.failLink = value;
+    }
+    else if (name == "grayfailure")
+    {
+        config.grayFailure = value;
+    }
+    else if (name == "detection")
+    {
+        config.detection = value;
+    }
+    else if (name == "redundancy")
+    {
+        config.redundancy = value;
+    }
+    else if (name == "loadsharing")
+    {
+        config.loadSharing = value;
+    }
+    else if (name == "linkweight")
+    {
+        config.linkWeights = value;
+    }
+    else if (name == "reverthold")
+    {
+        config.revertHold = duration(value);
+    }
+    else if (name == "damping")
+    {
+        config.damping = flag(value);
+    }
+    else if (name == "probeinterval")
+    {
+        config.probeInterval = duration(value);
+    }
+    else if (name == "bootdelay")
+    {
+        config.bootDelay = duration(value);
+    }
+    else if (name == "routeinstalldelay")
+    {
+        config.routeInstallDelay = duration(value);
+    }
+    else if (name == "linktracescale" && WanCsvReader::ParseNumber(value, number))
+    {
+        config.linkTraceScale = number;
+    }
+    else if (name == "adaptivestop")
+    {
+        config.adaptiveStop = flag(value);
+    }
+    else if (name == "stophorizon")
+    {
+        config.stopHorizon = duration(value);
+    }
+    else if (name == "stopprecision" && WanCsvReader::ParseNumber(value, number))
+    {
+        config.stopPrecision = number;
+    }
+    else if (name == "tenants")
+    {
+        config.tenants = value;
+    }
+    else if (name == "tenantload")
+    {
+        config.tenantLoad = DataRate(value);
+    }
+    else if (name == "pbr")
+    {
+        config.pbr = value;
+    }
+    else if (name == "routercapacity")
+    {
+        config.routerCapacity = value;
+    }
+    else if (name == "pbrfile")
+    {
+        config.pbrFile = value;
+    }
+    else if (name == "routecache" && WanCsvReader::ParseNumber(value, number) && number >= 0 &&
+             number == static_cast<uint32_t>(number))
+    {
+        config.routeCache = number;
+    }
+    else if (name == "bulkfib")
+    {
+        config.bulkFib = flag(value);
+    }
+    else if (name == "routethreads" && WanCsvReader::ParseNumber(value, number) && number >= 0 &&
+             number == static_cast<uint32_t>(number))
+    {
+        config.routeThreads = number;
+    }
+    else
+    {
+        NS_FATAL_ERROR("Sweep: cannot set option " << name << " to '" << value << "'");
+    }
+}
+
+/**
+ * Canonical text of everything that selects the scenario (not the seed):
+ * equal texts, and so equal hashes, mean runs of the same configuration.
+ */
+std::string
+DescribeScenario(const std::string& topologyFile,
+                 const std::string& topologyFormat,
+                 const std::string& profileFile,
+                 const std::string& linkProfiles,
+                 const ScenarioConfig& config)
+{
+    std::ostringstream text;
+    text << "topology=" << topologyFile << ";topologyFormat=" << topologyFormat
+         << ";profileFile=" << profileFile << ";linkProfile=" << linkProfiles
+         << ";linkTrace=" << config.linkTraceFile << ";linkTraceScale=" << config.linkTraceScale
+         << ";failure=" << config.failure;
+    if (config.failure == "node")
+    {
+        text << ";failNode=" << config.failNode << ";bootDelay=" << config.bootDelay.GetSeconds()
+             << "s;routeInstallDelay=" << config.routeInstallDelay.GetSeconds() << "s";
+    }
+    if (config.failure == "gray")
+    {
+        text << ";grayFailure=" << config.grayFailure;
+    }
+    if (!config.failLink.empty())
+    {
+        text << ";failLink=" << config.failLink;
+    }
+    if (config.failure == "flap")
+    {
+        text << ";flapPeriod=" << config.flapPeriod.GetSeconds() << "s";
+    }
+    text << ";detection=" << config.detection;
+    if (!config.revertHold.IsZero() || config.damping)
+    {
+        text << ";revertHold=" << config.revertHold.GetSeconds() << "s;damping=" << config.damping;
+    }
+    if (config.probeInterval != MilliSeconds(50))
+    {
+        text << ";probeInterval=" << config.probeInterval.GetSeconds() << "s";
+    }
+    if (config.redundancy != "none")
+    {
+        text << ";redundancy=" << config.redundancy << ";loadSharing=" << config.loadSharing
+             << ";linkWeight=" << config.linkWeights;
+    }
+    if (config.adaptiveStop)
+    {
+        text << ";stopHorizon=" << config.stopHorizon.GetSeconds()
+             << "s;stopPrecision=" << config.stopPrecision;
+    }
+    if (!config.tenants.empty())
+    {
+        text << ";tenants=" << config.tenants << ";tenantLoad=" << config.tenantLoad;
+    }
+    if (!config.pbr.empty() || !config.pbrFile.empty())
+    {
+        text << ";pbr=" << config.pbr << ";pbrFile=" << config.pbrFile;
+    }
+    if (!config.routerCapacity.empty())
+    {
+        text << ";routerCapacity=" << config.routerCapacity;
+    }
+    return text.str();
+}
+
+/**
+ * Set up the analytic model of a scenario: its routing under failures and
+ * the traffic it offers. The triangle offers what its probes and
+ * application monitors send; other topologies need a demand file.
+ */
+void
+ConfigureQueueingModel(WanQueueingModel& model,
+                       const ScenarioConfig& config,
+                       const std::string& demandsFile)
+{
+    model.SetRouting(config.detection == "static" && config.redundancy == "none"
+                         ? WanQueueingModel::STATIC
+                         : WanQueueingModel::REROUTE);
+    if (!demandsFile.empty())
+    {
+        model.LoadDemands(demandsFile);
+        return;
+    }
+    NS_ABORT_MSG_UNLESS(config.triangle, "The analytic model of a topology file needs --demands");
+
+    // IPv4, UDP and PPP headers on every packet
+    const uint32_t overhead = 30;
+    auto add = [&model, overhead](const std::string& name,
+                                  uint32_t source,
+                                  uint32_t target,
+                                  double packetsPerSecond,
+                                  uint32_t payload) {
+        uint32_t size = payload + overhead;
+        model.AddDemand({name, source, target, packetsPerSecond * 8 * size, size});
+    };
+    const double probes = 1 / config.probeInterval.GetSeconds();
+    add("probe.HQ->Branch", 0, 1, probes, 64);
+    add("probe.Branch->HQ", 1, 0, probes, 64);
+    add("probe.HQ->DC", 0, 2, probes, 64);
+    add("probe.DC->HQ", 2, 0, probes, 64);
+    // G.711 every 20ms; a transaction at most every 200ms think time, its
+    // response in 8 segments; 1Mbps of video in 1200-byte packets
+    add("voip.HQ->DC", 0, 2, 50, 160);
+    add("voip.DC->HQ", 2, 0, 50, 160);
+    add("transaction.HQ->DC", 0, 2, 5, 300);
+    add("transaction.DC->HQ", 2, 0, 5 * 8, 1000);
+    add("streaming.DC->HQ", 2, 0, 1e6 / (8 * 1200), 1200);
+}
+
+/**
+ * Collect the metrics of a finished run.
+ */
+WanMetrics
+CollectMetrics(const std::vector<std::unique_ptr<WanOutageProbe>>& probes,
+               const ApplicationMonitors& apps,
+               const WanLinkMonitor* monitor,
+               const WanLinkUtilization& utilization,
+               const WanReorderAnalyzer& reorder,
+               const WanTopology& topology,
+               const WanGrayFailureInjector& grayFailures,
+               Time failureStart)
+{
+    WanMetrics metrics;
+    for (const auto& probe : probes)
+    {
+        const std::string& name = probe->GetName();
+        double sent = probe->GetSent();
+        metrics.Set(name + ".loss", sent > 0 ? 1.0 - probe->GetReceived() / sent : 0.0);
+        metrics.Set(name + ".delay_mean_ms", probe->GetMeanDelay().GetSeconds() * 1000);
+        metrics.Set(name + ".delay_p95_ms", probe->GetP95Delay().GetSeconds() * 1000);
+        metrics.Set(name + ".delay_max_ms", probe->GetMaxDelay().GetSeconds() * 1000);
+        metrics.Set(name + ".longest_gap_s", probe->GetLongestGap().GetSeconds());
+        metrics.Set(name + ".affected_s", probe->GetAffectedTime().GetSeconds());
+        metrics.Set(name + ".reordered", probe->GetReordered());
+    }
+    for (const auto& voip : apps.voip)
+    {
+        const std::string name = "voip." + voip->GetName();
+        metrics.Set(name + ".mos", voip->GetCallMos());
+        metrics.Set(name + ".mos_worst", voip->GetWorstMos());
+        metrics.Set(name + ".degraded_s", voip->GetDegradedTime().GetSeconds());
+        metrics.Set(name + ".loss", voip->GetLoss());
+        metrics.Set(name + ".mouth_to_ear_ms", voip->GetMouthToEarDelay().GetSeconds() * 1000);
+    }
+    for (const auto& transaction : apps.transactions)
+    {
+        const std::string name = "transaction." + transaction->GetName();
+        metrics.Set(name + ".completed", transaction->GetCompleted());
+        metrics.Set(name + ".failed", transaction->GetFailed());
+        metrics.Set(name + ".sla_breaches", transaction->GetSlaBreaches());
+        metrics.Set(name + ".completion_mean_ms",
+                    transaction->GetMeanCompletionTime().GetSeconds() * 1000);
+        metrics.Set(name + ".completion_p95_ms",
+                    transaction->GetP95CompletionTime().GetSeconds() * 1000);
+        metrics.Set(name + ".completion_max_ms",
+                    transaction->GetMaxCompletionTime().GetSeconds() * 1000);
+    }
+    for (const auto& stream : apps.streams)
+    {
+        const std::string name = "streaming." + stream->GetName();
+        metrics.Set(name + ".startup_s", stream->GetStartupDelay().GetSeconds());
+        metrics.Set(name + ".stalls", stream->GetRebufferEvents());
+        metrics.Set(name + ".rebuffer_s", stream->GetRebufferTime().GetSeconds());
+        metrics.Set(name + ".rebuffer_ratio", stream->GetRebufferRatio());
+        metrics.Set(name + ".media_lost_s", stream->GetLostMedia().GetSeconds());
+    }
+    if (monitor)
+    {
+        uint32_t failovers = 0;
+        for (const auto& event : monitor->GetEvents())
+        {
+            if (!event.usable)
+            {
+                // Convergence: first failover after the failure started
+                if (event.at >= failureStart && !metrics.Has("failover_ms"))
+                {
+                    metrics.Set("failover_ms", (event.at - failureStart).GetSeconds() * 1000);
+                }
+                ++failovers;
+            }
+        }
+        metrics.Set("failovers", failovers);
+        metrics.Set("flaps", monitor->GetNFlaps());
+        metrics.Set("suppressions", monitor->GetNSuppressions());
+        metrics.Set("route_updates", monitor->GetNRouteUpdates());
+    }
+    utilization.AddMetrics(metrics);
+    reorder.AddMetrics(metrics);
+    if (!grayFailures.GetFailures().empty())
+    {
+        uint64_t lost = 0;
+        uint64_t corrupted = 0;
+        for (uint32_t l = 0; l < topology.GetNLinks(); ++l)
+        {
+            lost += grayFailures.GetLostPackets(l);
+            corrupted += grayFailures.GetCorruptedPackets(l);
+        }
+        metrics.Set("gray.lost", lost);
+        metrics.Set("gray.corrupted", corrupted);
+    }
+    return metrics;
+}
+
+/// PBR rules that send unmarked HQ-DC traffic of the triangle via Branch
+const std::string TRIANGLE_PBR_DETOUR = "HQ:dscp=BE,dst=DC,via=Branch;DC:dscp=BE,dst=HQ,via=Branch";
+
+/**
+ * Schedule the forwarding checks of --verify. In the triangle, HQ and DC
+ * reach the far ends of each other's circuits directly, over Branch while
+ * failover routes the HQ-DC failure around, or not at all while nothing
+ * does. Under TRIANGLE_PBR_DETOUR they always go over Branch; under other
+ * PBR rules only reachability is checked. A failed router is neither
+ * reached nor reaches anything until its routes are back. Elsewhere every
+ * site reaches every link address, over the fewest links if all costs are
+ * equal.
+ */
+void
+ScheduleForwardingChecks(WanVerifier& verifier,
+                         const WanTopology& topology,
+                         const WanNetwork& network,
+                         const ScenarioConfig& config)
+{
+    verifier.SetNetwork(topology, network);
+    if (config.triangle)
+    {
+        const Ipv4InterfaceContainer& interfaces1 = network.linkInterfaces[0]; // HQ <-> Branch
+        const Ipv4InterfaceContainer& interfaces2 = network.linkInterfaces[1]; // Branch <-> DC
+        const Ipv4InterfaceContainer& interfaces3 = network.linkInterfaces[2]; // HQ <-> DC
+        const bool failure = config.failure == "link";
+        const bool failover = config.detection != "static" || config.redundancy != "none";
+        // Load sharing policies pick next hops per flow or packet, and PBR
+        // rules by traffic class
+        const bool policy = !config.pbr.empty() || !config.pbrFile.empty();
+        const bool detour = config.pbr == TRIANGLE_PBR_DETOUR && config.pbrFile.empty();
+        const bool nextHops =
+            (config.redundancy == "none" || config.redundancy == "active-standby") &&
+            (!policy || detour);
+        const int64_t failedNode =
+            config.failure == "node" ? topology.FindSite(config.failNode) : -1;
+        for (Time at : {Seconds(3.0), Seconds(6.0), Seconds(10.0)})
+        {
+            const bool during = failure && at == Seconds(6.0);
+            const bool around = (during && failover) || detour;
+            // Whether a site is up, and reaches an address of another site
+            auto up = [&](uint32_t site) { return site != failedNode || at != Seconds(6.0); };
+            auto reaches = [&](uint32_t from, uint32_t to) { return up(from) && up(to); };
+            if (nextHops)
+            {
+                if (up(0))
+                {
+                    verifier.ExpectNextHopAt(at,
+                                             0,
+                                             interfaces2.GetAddress(1),
+                                             around ? interfaces1.GetAddress(1)
+                                                    : interfaces3.GetAddress(1));
+                }
+                if (up(2))
+                {
+                    verifier.ExpectNextHopAt(at,
+                                             2,
+                                             interfaces1.GetAddress(0),
+                                             around ? interfaces2.GetAddress(0)
+                                                    : interfaces3.GetAddress(0));
+                }
+                if (up(1))
+                {
+                    verifier.ExpectNextHopAt(at,
+                                             1,
+                                             interfaces3.GetAddress(0),
+                                             interfaces1.GetAddress(0));
+                }
+            }
+            const uint32_t hops = policy && !detour ? 0 : around ? 2 : 1;
+            verifier.ExpectReachableAt(at,
+                                       0,
+                                       interfaces2.GetAddress(1),
+                                       (!during || failover || detour) && reaches(0, 2),
+                                       hops);
+            verifier.ExpectReachableAt(at,
+                                       2,
+                                       interfaces1.GetAddress(0),
+                                       (!during || failover || detour) && reaches(2, 0),
+                                       hops);
+            verifier.ExpectReachableAt(at, 1, interfaces3.GetAddress(0), reaches(1, 0), 1);
+        }
+        return;
+    }
+
+    // Hop distances over the network's adjacency, which are the shortest
+    // paths if all costs are equal
+    const WanGraph& graph = network.graph;
+    const uint32_t nSites = graph.GetNSites();
+    bool unitCosts = true;
+    for (uint32_t l = 0; l < topology.GetNLinks(); ++l)
+    {
+        unitCosts = unitCosts && topology.GetLink(l).cost == topology.GetLink(0).cost;
+    }
+    std::vector<uint32_t> hops(nSites);
+    std::vector<uint32_t> queue(nSites);
+    for (uint32_t source = 0; source < nSites; ++source)
+    {
+        // Breadth-first: queue[head, tail) is the frontier
+        std::fill(hops.begin(), hops.end(), nSites);
+        hops[source] = 0;
+        queue[0] = source;
+        for (uint32_t head = 0, tail = 1; head < tail; ++head)
+        {
+            const uint32_t u = queue[head];
+            for (uint32_t arc = graph.Begin(u); arc < graph.End(u); ++arc)
+            {
+                const uint32_t v = graph.GetTarget(arc);
+                if (hops[v] == nSites)
+                {
+                    hops[v] = hops[u] + 1;
+                    queue[tail++] = v;
+                }
+            }
+        }
+        for (uint32_t l = 0; l < topology.GetNLinks(); ++l)
+        {
+            const WanLink& link = topology.GetLink(l);
+            for (uint32_t end = 0; end < 2; ++end)
+            {
+                uint32_t owner = end == 0 ? link.a : link.b;
+                verifier.ExpectReachableAt(Seconds(2.0),
+                                           source,
+                                           network.linkInterfaces[l].GetAddress(end),
+                                           hops[owner] < nSites,
+                                           unitCosts ? hops[owner] : 0);
+            }
+        }
+    }
+
+    // The ends of a failed circuit lose each other while it is down, as
+    // shortest-path static routes do not fail over
+    std::vector<uint32_t> failed;
+    if (config.failure == "link" && config.redundancy == "none" &&
+        topology.FindLinks(config.failLink, failed))
+    {
+        const WanLink& link = topology.GetLink(failed[0]);
+        const Ipv4Address address = GetSiteAddress(network, link.b, failed[0]);
+        verifier.ExpectReachableAt(Seconds(6.0), link.a, address, false);
+        verifier.ExpectReachableAt(Seconds(10.0), link.a, address, true, 1);
+    }
+}
+
+/**
+ * Constant-rate UDP traffic of every tenant, from its first site to each
+ * other site and back, sharing the core with the probes and applications.
+ */
+void
+InstallTenantLoad(const WanVrfEngine& vrfs, DataRate rate)
+{
+    uint16_t port = 9100;
+    for (const WanTenant& tenant : vrfs.GetTenants())
+    {
+        for (uint32_t i = 1; i < tenant.sites.size(); ++i)
+        {
+            for (uint32_t from : {0U, i})
+            {
+                const uint32_t to = from == 0 ? i : 0;
+                PacketSinkHelper sink("ns3::UdpSocketFactory",
+                                      InetSocketAddress(Ipv4Address::GetAny(), port));
+                ApplicationContainer sinkApp = sink.Install(tenant.ces.Get(to));
+                sinkApp.Start(Seconds(1.0));
+                OnOffHelper source("ns3::UdpSocketFactory",
+                                   InetSocketAddress(tenant.addresses[to], port));
+                source.SetConstantRate(rate, 1000);
+                ApplicationContainer sourceApp = source.Install(tenant.ces.Get(from));
+                sourceApp.Start(Seconds(1.5));
+                sourceApp.Stop(Seconds(11.0));
+                ++port;
+            }
+        }
+    }
+}
+
+/**
+ * Build the network for a topology, run the simulation and return what
+ * it measured. Leaves the simulator destroyed, so it can run again; the
+ * caller picks the RngRun of each run.
+ * With a verifier, the forwarding checks of --verify run along.
+ */
+WanMetrics
+RunScenario(const WanTopology& topology,
+            const ScenarioConfig& config,
+            WanVerifier* verifier = nullptr)
+{
+    const bool triangle = config.triangle;
+
+    // Streams assigned automatically restart for every run, so two runs of
+    // the same RngRun in one process draw the same numbers
+    RngSeedManager::ResetNextStreamIndex();
+
+    // Nodes, point-to-point links, positions, Internet stack and /30 addressing
+    WanTopologyHelper wanHelper;
+    wanHelper.SetRouteCache(config.routeCache);
+    WanNetwork network = wanHelper.Install(topology);
+    // Fixed streams: circuit jitter, loss and gray failures draw the same
+    // numbers in every run of a seed, whatever else the scenario creates
+    wanHelper.AssignStreams(network, 0);
+
+    // Time-varying capacity and delay, applied one batch per trace tick
+    WanLinkTracePlayer linkTrace(topology, network);
+    if (!config.linkTraceFile.empty())
+    {
+        linkTrace.SetTimeScale(config.linkTraceScale);
+        linkTrace.Load(config.linkTraceFile);
+        linkTrace.Start();
+        cout << "Link trace: " << linkTrace.GetNTicks() << " ticks, " << linkTrace.GetNUpdates()
+             << " link updates" << endl;
+    }
+
+    // *** Configure Static Routing ***
+    if (triangle)
+    {
+        InstallTriangleRoutes(network);
+    }
+    else
+    {
+        wanHelper.SetRouteThreads(config.routeThreads);
+        wanHelper.SetBulkFib(config.bulkFib);
+        wanHelper.InstallShortestPathRoutes(topology, network).Print(cout);
+    }
+
+    // Print routing tables for verification
+    if (config.outputs)
+    {
+        Ipv4StaticRoutingHelper staticRoutingHelper;
+        Ptr<OutputStreamWrapper> routingStream =
+            Create<OutputStreamWrapper>(config.outputDir + "router-static-routing.routes",
+                                        std::ios::out);
+        staticRoutingHelper.PrintRoutingTableAllAt(Seconds(1.0), routingStream);
+    }
+
+    if (triangle)
+    {
+        PrintTriangleSummary(network);
+        PrintCircuitProfiles(topology);
+        InstallTriangleApplications(network);
+    }
+    else
+    {
+        PrintTopologySummary(topology, network);
+    }
+
+    // Tenant VPNs: CEs on VRF-bound interfaces, tagged across the core
+    std::unique_ptr<WanVrfEngine> tenants;
+    if (!config.tenants.empty())
+    {
+        tenants = std::make_unique<WanVrfEngine>(topology, network);
+        tenants->Add(config.tenants);
+        tenants->Install();
+        tenants->Print(cout);
+        if (config.tenantLoad.GetBitRate() > 0)
+        {
+            InstallTenantLoad(*tenants, config.tenantLoad);
+        }
+    }
+
+    // Policy-based routing: traffic classes on their own next hops
+    std::unique_ptr<WanPbrEngine> pbr;
+    if (!config.pbr.empty() || !config.pbrFile.empty())
+    {
+        pbr = std::make_unique<WanPbrEngine>(topology, network);
+        if (!config.pbrFile.empty())
+        {
+            pbr->Load(config.pbrFile);
+        }
+        pbr->Add(config.pbr);
+        pbr->Install();
+        pbr->Print(cout);
+    }
+
+    // *** Failure injection ***
+    WanNodeFailureInjector nodeFailures;
+    std::vector<uint32_t> failedLinks;
+    if (config.failure == "link" && triangle)
+    {
+        ScheduleTriangleFailure(network);
+    }
+    else if (config.failure == "link")
+    {
+        failedLinks = ScheduleLinkFailure(topology, network, config.failLink);
+    }
+    else if (config.failure == "flap")
+    {
+        ScheduleTriangleFlaps(network, config.flapPeriod);
+    }
+    else if (config.failure == "node")
+    {
+        ScheduleNodeFailure(topology,
+                            network,
+                            nodeFailures,
+                            config.failNode,
+                            config.bootDelay,
+                            config.routeInstallDelay);
+    }
+    WanGrayFailureInjector grayFailures(topology, network);
+    Time failureStart = Seconds(4.0);
+    if (config.failure == "gray")
+    {
+        grayFailures.Add(config.grayFailure);
+        for (const auto& gray : grayFailures.GetFailures())
+        {
+            failureStart = std::min(failureStart, gray.at);
+        }
+    }
+
+    // Failure detection and failover on the HQ-DC circuit, or a redundancy
+    // policy over all site pairs that tracks every link it uses
+    std::unique_ptr<WanLinkMonitor> monitor;
+    std::unique_ptr<WanRedundancyEngine> redundancy;
+    WanFlapDamping damping;
+    damping.enabled = config.damping;
+    if (config.redundancy != "none")
+    {
+        WanPolicyRouting::Mode mode;
+        WanRedundancyEngine::ParseMode(config.redundancy, mode);
+        redundancy = std::make_unique<WanRedundancyEngine>(topology, network);
+        redundancy->SetMode(mode);
+        redundancy->SetLoadSharing(config.loadSharing == "packet" ? WanPolicyRouting::PER_PACKET
+                                                                  : WanPolicyRouting::PER_FLOW);
+        redundancy->SetTracking(config.detection == "sla" ? WanLinkMonitor::SLA
+                                                          : WanLinkMonitor::BFD);
+        redundancy->SetLinkWeights(config.linkWeights);
+        redundancy->SetRevertHold(config.revertHold);
+        redundancy->SetDamping(damping);
+        redundancy->SetRouteThreads(config.routeThreads);
+        redundancy->Install();
+        redundancy->Start(Seconds(1.0), Seconds(11.0));
+        cout << "\nRedundancy policy " << config.redundancy << ": "
+             << redundancy->GetNRoutes() << " policy routes" << endl;
+        redundancy->Print(cout);
+    }
+    else if (config.detection != "static")
+    {
+        monitor = std::make_unique<WanLinkMonitor>(topology, network, 2);
+        monitor->SetMode(config.detection == "bfd" ? WanLinkMonitor::BFD : WanLinkMonitor::SLA);
+        monitor->SetRevertHold(config.revertHold);
+        monitor->SetDamping(damping);
+        InstallTriangleFailover(*monitor, network);
+        monitor->Start(Seconds(1.0), Seconds(11.0));
+    }
+    const WanLinkMonitor* failoverMonitor =
+        redundancy && triangle ? redundancy->GetMonitor(2) : monitor.get();
+
+    // Forwarding capacity: input queues in front of the limited routers, once
+    // they have all their interfaces and routing protocols
+    std::unique_ptr<WanForwardingEngine> forwarding;
+    if (!config.routerCapacity.empty())
+    {
+        forwarding = std::make_unique<WanForwardingEngine>(topology, network);
+        forwarding->Add(config.routerCapacity);
+        forwarding->Install();
+        forwarding->Print(cout);
+    }
+
+    // Per-packet trace sinks only for enabled outputs and their windows; the
+    // statistics cover the probe period
+    WanTracingManager tracing;
+    const Time traceStop = config.traceStop.IsZero() ? Seconds(12.0) : config.traceStop;
+    if (config.outputs && config.pcap)
+    {
+        tracing.Enable(WanTracingManager::PCAP, config.traceStart, traceStop);
+    }
+    if (config.outputs && config.anim)
+    {
+        tracing.Enable(WanTracingManager::ANIM, config.traceStart, traceStop);
+    }
+    if (config.stats)
+    {
+        tracing.Enable(WanTracingManager::STATS, Seconds(1.5), Seconds(11.0));
+    }
+
+    // Reordering per failover event: windows start at every usability change
+    // of a tracked link, or at the scheduled failure and recovery
+    WanReorderAnalyzer reorder;
+    if (redundancy)
+    {
+        redundancy->AddStateListener(MakeBoundCallback(&MarkFailoverEvent, &reorder, &topology));
+    }
+    else if (monitor)
+    {
+        monitor->AddStateListener(MakeBoundCallback(&MarkFailoverEvent, &reorder, &topology));
+    }
+    else if (config.failure != "none")
+    {
+        reorder.AddEvent(failureStart, "failure");
+        reorder.AddEvent(Seconds(8.0), "recovery");
+    }
+
+    // Probe flows between the sites that survive the failure
+    std::vector<std::unique_ptr<WanOutageProbe>> probes;
+    if (triangle)
+    {
+        const Ipv4InterfaceContainer& interfaces1 = network.linkInterfaces[0]; // HQ <-> Branch
+        probes.push_back(std::make_unique<WanOutageProbe>("HQ->Branch",
+                                                          network.nodes.Get(0),
+                                                          network.nodes.Get(1),
+                                                          interfaces1.GetAddress(1),
+                                                          7000));
+        probes.push_back(std::make_unique<WanOutageProbe>("Branch->HQ",
+                                                          network.nodes.Get(1),
+                                                          network.nodes.Get(0),
+                                                          interfaces1.GetAddress(0),
+                                                          7001));
+        // Site to site across HQ-DC: addresses that are not on that circuit
+        const Ipv4InterfaceContainer& interfaces2 = network.linkInterfaces[1]; // Branch <-> DC
+        probes.push_back(std::make_unique<WanOutageProbe>("HQ->DC",
+                                                          network.nodes.Get(0),
+                                                          network.nodes.Get(2),
+                                                          interfaces2.GetAddress(1),
+                                                          7002));
+        probes.push_back(std::make_unique<WanOutageProbe>("DC->HQ",
+                                                          network.nodes.Get(2),
+                                                          network.nodes.Get(0),
+                                                          interfaces1.GetAddress(0),
+                                                          7003));
+        for (auto& probe : probes)
+        {
+            probe->SetInterval(config.probeInterval);
+            probe->SetReorderAnalyzer(reorder);
+            probe->Start(Seconds(1.5), Seconds(11.0));
+        }
+        for (uint32_t i = 0; i < network.nodes.GetN(); ++i)
+        {
+            reorder.Install(network.nodes.Get(i), tracing);
+        }
+    }
+    else if (!failedLinks.empty())
+    {
+        // Both ways between the ends of the failed circuit, to addresses off it
+        const WanLink& link = topology.GetLink(failedLinks[0]);
+        uint16_t port = 7000;
+        for (auto [from, to] : {std::make_pair(link.a, link.b), std::make_pair(link.b, link.a)})
+        {
+            probes.push_back(std::make_unique<WanOutageProbe>(
+                topology.GetSite(from).name + "->" + topology.GetSite(to).name,
+                network.nodes.Get(from),
+                network.nodes.Get(to),
+                GetSiteAddress(network, to, failedLinks[0]),
+                port++));
+        }
+        for (auto& probe : probes)
+        {
+            probe->SetInterval(config.probeInterval);
+            probe->Start(Seconds(1.5), Seconds(11.0));
+        }
+    }
+    // Tenant probes from each tenant's first site to every other site and back
+    if (tenants)
+    {
+        const size_t firstTenantProbe = probes.size();
+        uint16_t port = 7100;
+        for (const WanTenant& tenant : tenants->GetTenants())
+        {
+            const std::string& first = topology.GetSite(tenant.sites[0]).name;
+            for (uint32_t i = 1; i < tenant.sites.size(); ++i)
+            {
+                const std::string& other = topology.GetSite(tenant.sites[i]).name;
+                const std::string there = tenant.name + ":" + first + "->" + other;
+                const std::string back = tenant.name + ":" + other + "->" + first;
+                probes.push_back(std::make_unique<WanOutageProbe>(there,
+                                                                  tenant.ces.Get(0),
+                                                                  tenant.ces.Get(i),
+                                                                  tenant.addresses[i],
+                                                                  port++));
+                probes.push_back(std::make_unique<WanOutageProbe>(back,
+                                                                  tenant.ces.Get(i),
+                                                                  tenant.ces.Get(0),
+                                                                  tenant.addresses[0],
+                                                                  port++));
+            }
+        }
+        for (size_t p = firstTenantProbe; p < probes.size(); ++p)
+        {
+            probes[p]->SetInterval(config.probeInterval);
+            probes[p]->Start(Seconds(1.5), Seconds(11.0));
+        }
+    }
+
+    // Where the traffic goes before, during and after the failure
+    WanLinkUtilization utilization(topology, network);
+    utilization.AddPhase("before", Seconds(1.5), Seconds(4.0));
+    utilization.AddPhase("during", Seconds(4.0), Seconds(8.0));
+    utilization.AddPhase("after", Seconds(8.0), Seconds(11.0));
+    for (const auto& probe : probes)
+    {
+        utilization.AddProbe(*probe);
+    }
+    utilization.Install(tracing);
+
+    // What the users of each application class experience
+    ApplicationMonitors apps;
+    if (triangle)
+    {
+        InstallApplicationMonitors(apps, network);
+    }
+
+    // Probes and monitors with an end on a failed router stop with it, lose
+    // their state and restart once its routes are back
+    if (config.failure == "node")
+    {
+        Ptr<Node> failed = network.nodes.Get(topology.FindSite(config.failNode));
+        for (auto& probe : probes)
+        {
+            nodeFailures.AddStateListener(
+                failed,
+                MakeBoundCallback(&NotifyNodeState<WanOutageProbe>, probe.get(), failed));
+        }
+        for (auto& voip : apps.voip)
+        {
+            nodeFailures.AddStateListener(
+                failed,
+                MakeBoundCallback(&NotifyNodeState<WanVoipMonitor>, voip.get(), failed));
+        }
+        for (auto& transaction : apps.transactions)
+        {
+            nodeFailures.AddStateListener(
+                failed,
+                MakeBoundCallback(&NotifyNodeState<WanTransactionMonitor>,
+                                  transaction.get(),
+                                  failed));
+        }
+        for (auto& stream : apps.streams)
+        {
+            nodeFailures.AddStateListener(
+                failed,
+                MakeBoundCallback(&NotifyNodeState<WanStreamingMonitor>, stream.get(), failed));
+        }
+    }
+
+    // Adaptive stop: once the probes are steady after the failure, end every
+    // measurement there instead of at 11s
+    WanAdaptiveStop adaptiveStop;
+    Time measurementStop = Seconds(11.0);
+    if (config.adaptiveStop)
+    {
+        Time failureEnd = Seconds(1.5);
+        if (config.failure == "link" || config.failure == "flap")
+        {
+            failureEnd = Seconds(8.0);
+        }
+        else if (config.failure == "node")
+        {
+            failureEnd = Seconds(8.0) + config.bootDelay + config.routeInstallDelay;
+        }
+        else if (config.failure == "gray")
+        {
+            for (const auto& gray : grayFailures.GetFailures())
+            {
+                failureEnd = std::max(failureEnd, gray.until);
+            }
+        }
+        for (const auto& probe : probes)
+        {
+            const WanOutageProbe* p = probe.get();
+            // Arrivals and mean delay per sampling interval
+            adaptiveStop.AddSeries(p->GetName() + ".received", [p, last = 0U]() mutable {
+                uint32_t received = p->GetReceived();
+                double x = received - last;
+                last = received;
+                return x;
+            });
+            adaptiveStop.AddSeries(p->GetName() + ".delay", [p, last = 0U, sum = 0.0]() mutable {
+                uint32_t received = p->GetReceived();
+                double total = p->GetMeanDelay().GetSeconds() * received;
+                double x = received > last ? (total - sum) / (received - last)
+                                           : std::numeric_limits<double>::quiet_NaN();
+                last = received;
+                sum = total;
+                return x;
+            });
+        }
+        adaptiveStop.AddStopHandler([&](Time stop) {
+            measurementStop = stop;
+            for (auto& probe : probes)
+            {
+                probe->Truncate(stop);
+            }
+            for (auto& voip : apps.voip)
+            {
+                voip->Truncate(stop);
+            }
+            for (auto& transaction : apps.transactions)
+            {
+                transaction->Truncate(stop);
+            }
+            for (auto& stream : apps.streams)
+            {
+                stream->Truncate(stop);
+            }
+            utilization.Truncate(stop);
+        });
+        adaptiveStop.SetPrecision(config.stopPrecision);
+        // A gray failure without an end leaves nothing to converge to
+        if (failureEnd < Seconds(11.0) - config.stopHorizon)
+        {
+            // The batch means must fit in the first half of the window left
+            // after the failure, or the run could never stop early
+            const uint32_t minBatches = 10;
+            const double window = (Seconds(11.0) - failureEnd).GetSeconds();
+            adaptiveStop.SetMinBatches(minBatches);
+            adaptiveStop.SetInterval(
+                Seconds(window / (2 * WanSteadyStateSeries::BATCH * minBatches)));
+            // The drain lets the calls finish half a second after the stop
+            adaptiveStop.Start(failureEnd,
+                               failureEnd + config.stopHorizon,
+                               Seconds(11.0),
+                               MilliSeconds(600));
+        }
+    }
+
+    std::unique_ptr<AnimationInterface> animation;
+    if (tracing.IsEnabled(WanTracingManager::ANIM))
+    {
+        // *** NetAnim Configuration ***
+        animation =
+            std::make_unique<AnimationInterface>(config.outputDir + "router-static-routing.xml");
+        AnimationInterface& anim = *animation;
+        anim.SetStartTime(tracing.GetStart(WanTracingManager::ANIM));
+        anim.SetStopTime(tracing.GetStop(WanTracingManager::ANIM));
+
+        // Node positions are already set via MobilityModel above
+        // NetAnim will automatically use the mobility model positions
+
+        // Set node descriptions: site name and its interface addresses
+        std::vector<std::string> descriptions(topology.GetNSites());
+        for (uint32_t i = 0; i < topology.GetNSites(); ++i)
+        {
+            descriptions[i] = topology.GetSite(i).name + "\n";
+        }
+        for (uint32_t l = 0; l < topology.GetNLinks(); ++l)
+        {
+            const WanLink& link = topology.GetLink(l);
+            for (uint32_t end = 0; end < 2; ++end)
+            {
+                std::string& description = descriptions[end == 0 ? link.a : link.b];
+                std::ostringstream address;
+                address << network.linkInterfaces[l].GetAddress(end);
+                description += (description.back() == '\n' ? "" : " | ") + address.str();
+            }
+        }
+
+        // Set node colors by role
+        for (uint32_t i = 0; i < topology.GetNSites(); ++i)
+        {
+            Ptr<Node> node = network.nodes.Get(i);
+            const std::string& role = topology.GetSite(i).role;
+            anim.UpdateNodeDescription(node, descriptions[i]);
+            if (role == "hq")
+            {
+                anim.UpdateNodeColor(node, 0, 255, 0); // Green for HQ
+            }
+            else if (role == "branch")
+            {
+                anim.UpdateNodeColor(node, 255, 255, 0); // Yellow for Branch
+            }
+            else if (role == "dc")
+            {
+                anim.UpdateNodeColor(node, 0, 0, 255); // Blue for DC
+            }
+        }
+    }
+
+    // PCAP captures of all link devices for Wireshark analysis
+    NetDeviceContainer linkDevices;
+    for (uint32_t l = 0; l < topology.GetNLinks(); ++l)
+    {
+        linkDevices.Add(network.linkDevices[l]);
+    }
+    tracing.InstallPcap(linkDevices, config.outputDir + "router-static-routing");
+    tracing.Start();
+
+    if (verifier)
+    {
+        ScheduleForwardingChecks(*verifier, topology, network, config);
+    }
+
+    cout << "\n========================================" << endl;
+    cout << "Starting Simulation..." << endl;
+    cout << "========================================\n" << endl;
+
+    // Run simulation
+    Simulator::Stop(Seconds(12.0));
+    Simulator::Run();
+    if (!probes.empty())
+    {
+        PrintOutageReport(probes, config.probeInterval, measurementStop);
+    }
+    if (triangle)
+    {
+        PrintApplicationReport(apps, measurementStop);
+    }
+    const std::string policy = redundancy
+                                   ? config.redundancy + ", per " + config.loadSharing
+                                   : "static routes, detection " + config.detection;
+    utilization.Print(cout,
+                      (config.stats ? "Utilization and Loss (" : "Loss (") + policy + ")");
+    if (config.failure == "gray")
+    {
+        for (uint32_t l = 0; l < topology.GetNLinks(); ++l)
+        {
+            uint64_t lost = grayFailures.GetLostPackets(l);
+            uint64_t corrupted = grayFailures.GetCorruptedPackets(l);
+            if (lost + corrupted > 0)
+            {
+                const WanLink& link = topology.GetLink(l);
+                cout << "Gray failure on " << topology.GetSite(link.a).name << "-"
+                     << topology.GetSite(link.b).name << ": " << lost << " packets lost, "
+                     << corrupted << " corrupted" << endl;
+            }
+        }
+    }
+    if (failoverMonitor)
+    {
+        PrintFailoverReport(*failoverMonitor, failureStart);
+    }
+    if (tenants)
+    {
+        tenants->PrintCounters(cout);
+    }
+    if (pbr)
+    {
+        pbr->PrintCounters(cout);
+    }
+    if (forwarding)
+    {
+        forwarding->PrintCounters(cout);
+    }
+    reorder.Finish();
+    if (!probes.empty() && config.stats)
+    {
+        reorder.Print(cout);
+    }
+    tracing.Print(cout);
+    if (config.routeCache > 0)
+    {
+        WanRouteCache::GetStats(network.nodes).Print(cout);
+    }
+    if (config.adaptiveStop)
+    {
+        adaptiveStop.Print(cout);
+    }
+    WanMetrics metrics = CollectMetrics(probes,
+                                        apps,
+                                        failoverMonitor,
+                                        utilization,
+                                        reorder,
+                                        topology,
+                                        grayFailures,
+                                        failureStart);
+    if (config.adaptiveStop)
+    {
+        adaptiveStop.AddMetrics(metrics, Seconds(11.0));
+    }
+    for (uint32_t t = 0; tenants && t < tenants->GetTenants().size(); ++t)
+    {
+        const std::string prefix = "tenant." + tenants->GetTenants()[t].name;
+        WanVrfRouting::Counters counters = tenants->GetCounters(t);
+        metrics.Set(prefix + ".to_core", counters.toCore);
+        metrics.Set(prefix + ".from_core", counters.fromCore);
+        metrics.Set(prefix + ".dropped", counters.dropped);
+    }
+    if (pbr)
+    {
+        WanPbrRouting::Stats stats = pbr->GetStats();
+        metrics.Set("pbr.matched", stats.matched);
+        for (uint32_t rule = 0; rule < pbr->GetNRules(); ++rule)
+        {
+            metrics.Set("pbr.rule" + std::to_string(rule) + ".packets", pbr->GetHits(rule));
+        }
+        metrics.Set("pbr.probes_per_lookup",
+                    stats.lookups > 0 ? double(stats.probes) / stats.lookups : 0.0);
+    }
+    if (config.routeCache > 0)
+    {
+        WanRouteCache::Stats stats = WanRouteCache::GetStats(network.nodes);
+        metrics.Set("route_cache.hits", stats.hits);
+        metrics.Set("route_cache.flushes", stats.flushes);
+    }
+    for (uint32_t site = 0; forwarding && site < topology.GetNSites(); ++site)
+    {
+        WanForwardingCapacity::Counters counters = forwarding->GetCounters(site);
+        if (counters.received > 0)
+        {
+            const std::string prefix = "forwarding." + topology.GetSite(site).name;
+            metrics.Set(prefix + ".dropped", counters.dropped);
+            metrics.Set(prefix + ".busy", counters.busySeconds / Simulator::Now().GetSeconds());
+        }
+    }
+    Simulator::Destroy();
+    return metrics;
+}
+
+/**
+ * --verify: run the verification scenarios and check their forwarding,
+ * golden metrics and runtime.
+ * \param budgetScale factor on every runtime budget, for slow builds
+ * \return the number of failed checks
+ */
+uint32_t
+RunVerification(double budgetScale)
+{
+    /// Golden bounds of one metric
+    struct Bound
+    {
+        std::string metric; //!< Metric name
+        double min;         //!< Lowest accepted value
+        double max;         //!< Highest accepted value
+    };
+
+    /// Further options of a scenario by sweep name (see SetScenarioOption)
+    using Options = std::vector<std::pair<std::string, std::string>>;
+
+    /// One verification scenario
+    struct Case
+    {
+        std::string name;          //!< Report name
+        uint32_t gridSize;         //!< Side of a generated grid; 0 for the triangle
+        std::string detection;     //!< --detection
+        std::string redundancy;    //!< --redundancy
+        std::string failure;       //!< --failure
+        std::vector<Bound> bounds; //!< Golden metric bounds
+        double budget;             //!< Wall-clock seconds
+        Options options{};         //!< Further options
+    };
+
+    // Loss before and after the failure, loss and outage during it with and
+    // without failover, and BFD detection within its 3x100ms interval
+    const std::vector<Bound> unprotected = {{"phase.before.loss", 0, 0.01},
+                                            {"phase.during.loss", 0.3, 0.7},
+                                            {"phase.after.loss", 0, 0.01},
+                                            {"HQ->Branch.loss", 0, 0.01},
+                                            {"HQ->DC.longest_gap_s", 3.5, 4.5}};
+    const std::vector<Bound> protectedByBfd = {{"phase.before.loss", 0, 0.01},
+                                               {"phase.during.loss", 0, 0.1},
+                                               {"phase.after.loss", 0, 0.01},
+                                               {"HQ->DC.longest_gap_s", 0, 0.6},
+                                               {"failover_ms", 100, 500},
+                                               {"failovers", 2, 4},
+                                               {"transaction.HQ->DC.failed", 0, 0}};
+    const std::vector<Case> cases = {
+        {"triangle, link failure, static", 0, "static", "none", "link", unprotected, 10},
+        {"triangle, link failure, bfd", 0, "bfd", "none", "link", protectedByBfd, 10},
+        {"triangle, link failure, active-standby",
+         0,
+         "bfd",
+         "active-standby",
+         "link",
+         protectedByBfd,
+         10},
+        {"grid 4x4, no failure", 4, "static", "none", "none", {}, 5},
+        // Static routes on a grid: the ends of the failed circuit lose each
+        // other for the whole outage and nothing else
+        {"grid 4x4, link failure, static",
+         4,
+         "static",
+         "none",
+         "link",
+         {{"phase.before.loss", 0, 0.01},
+          {"phase.during.loss", 0.9, 1},
+          {"phase.after.loss", 0, 0.01},
+          {"R1C1->R1C2.longest_gap_s", 3.5, 4.5},
+          {"R1C2->R1C1.longest_gap_s", 3.5, 4.5}},
+         10,
+         {{"faillink", "R1C1-R1C2"}}},
+        // DC is down from 4s until its routes are back at 9.5s; HQ and
+        // Branch keep each other
+        {"triangle, node failure, static",
+         0,
+         "static",
+         "none",
+         "node",
+         {{"phase.before.loss", 0, 0.01},
+          {"HQ->Branch.loss", 0, 0.01},
+          {"Branch->HQ.loss", 0, 0.01},
+          {"HQ->DC.longest_gap_s", 4.5, 6.5}},
+         10},
+        // One dead direction: DC->HQ is lost for the whole window, HQ->DC not
+        {"triangle, gray failure, static",
+         0,
+         "static",
+         "none",
+         "gray",
+         {{"phase.before.loss", 0, 0.01},
+          {"phase.after.loss", 0, 0.01},
+          {"HQ->DC.loss", 0, 0.01},
+          {"DC->HQ.longest_gap_s", 3.5, 4.5}},
+         10,
+         {{"grayfailure", "HQ-DC,from=DC,loss=100%,at=4s,until=8s"}}},
+        // The cached run must forward exactly as the uncached one: the same
+        // next hops, reachability and failover, answered from the cache
+        {"triangle, link failure, bfd, route cache",
+         0,
+         "bfd",
+         "none",
+         "link",
+         {{"phase.before.loss", 0, 0.01},
+          {"phase.during.loss", 0, 0.1},
+          {"phase.after.loss", 0, 0.01},
+          {"HQ->DC.longest_gap_s", 0, 0.6},
+          {"failover_ms", 100, 500},
+          {"failovers", 2, 4},
+          {"transaction.HQ->DC.failed", 0, 0},
+          {"route_cache.hits", 1, 1e9}},
+         10,
+         {{"routecache", "64"}}},
+        // Two tenants across the core: BFD moves their tagged traffic onto
+        // HQ-Branch-DC, so each VRF delivers and none drops
+        {"triangle, link failure, bfd, tenants",
+         0,
+         "bfd",
+         "none",
+         "link",
+         {{"phase.before.loss", 0, 0.01},
+          {"phase.after.loss", 0, 0.01},
+          {"Ops:HQ->DC.longest_gap_s", 0, 0.6},
+          {"Ops:DC->HQ.longest_gap_s", 0, 0.6},
+          {"tenant.Sales.from_core", 1, 1e9},
+          {"tenant.Sales.dropped", 0, 0},
+          {"tenant.Ops.from_core", 1, 1e9},
+          {"tenant.Ops.dropped", 0, 0}},
+         10,
+         {{"tenants", "Sales,Ops=HQ+DC"}}},
+        // Unmarked HQ-DC traffic takes Branch before and during the failure,
+        // so static routes lose none of the HQ-DC probes
+        {"triangle, link failure, static, pbr",
+         0,
+         "static",
+         "none",
+         "link",
+         {{"phase.before.loss", 0, 0.01},
+          {"phase.during.loss", 0, 0.01},
+          {"phase.after.loss", 0, 0.01},
+          {"HQ->DC.loss", 0, 0.01},
+          {"DC->HQ.loss", 0, 0.01},
+          {"pbr.rule0.packets", 150, 1e9},
+          {"pbr.rule1.packets", 150, 1e9}},
+         10,
+         {{"pbr", TRIANGLE_PBR_DETOUR}}},
+        // Policy costs only on the PEs of the tenant: Branch carries the
+        // rerouted tenant traffic during the failure but binds no VRF
+        {"triangle, link failure, bfd, router capacity",
+         0,
+         "bfd",
+         "none",
+         "link",
+         {{"phase.before.loss", 0, 0.01},
+          {"phase.after.loss", 0, 0.01},
+          {"forwarding.HQ.busy", 1e-6, 0.5},
+          {"forwarding.HQ.dropped", 0, 0},
+          {"forwarding.Branch.busy", 0, 0},
+          {"forwarding.Branch.dropped", 0, 0}},
+         10,
+         {{"tenants", "Ops=HQ+DC"}, {"routercapacity", "*:policy=10us"}}},
+        // Steady well before the fixed end once the circuit is back at 8s
+        {"triangle, link failure, adaptive stop",
+         0,
+         "static",
+         "none",
+         "link",
+         {{"stop_s", 9.0, 10.9}, {"phase.after.loss", 0, 0.01}},
+         10,
+         {{"adaptivestop", "true"}}},
+    };
+
+    // Golden values belong to one seed, the same for every case
+    RngSeedManager::SetSeed(1);
+    WanVerifier verifier;
+    for (const Case& c : cases)
+    {
+        cout << "\n*** Verifying " << c.name << " ***" << endl;
+        RngSeedManager::SetRun(1);
+        verifier.BeginScenario(c.name);
+        ScenarioConfig config;
+        config.triangle = c.gridSize == 0;
+        config.detection = c.detection;
+        config.redundancy = c.redundancy;
+        config.failure = c.failure;
+        config.outputs = false;
+        for (const auto& [name, value] : c.options)
+        {
+            SetScenarioOption(config, name, value);
+        }
+        CheckScenarioConfig(config);
+        WanTopology topology =
+            config.triangle ? MakeTriangleTopology() : MakeGridTopology(c.gridSize, c.gridSize);
+        WanMetrics metrics = RunScenario(topology, config, &verifier);
+        for (const Bound& bound : c.bounds)
+        {
+            verifier.ExpectMetric(metrics, bound.metric, bound.min, bound.max);
+        }
+        verifier.EndScenario(c.budget * budgetScale);
+    }
+    verifier.Print(cout);
+    return verifier.GetNFailed();
+}
+
+int
+main(int argc, char* argv[])
+{
+    std::string topologyFile;
+    std::string topologyFormat = "auto";
+    std::string profileFile;
+    std::string linkProfiles;
+    ScenarioConfig config;
+    uint32_t replications = 1;
+    uint32_t minReplications = 3;
+    uint32_t jobs = 0;
+    double precision = 0.05;
+    double confidence = 0.95;
+    std::string resultsFile;
+    bool flapTest = false;
+    bool verify = false;
+    std::string sweepFile;
+    std::string sweepOutput = "sweep.tsv";
+    uint64_t masterSeed = 1;
+    double budgetScale = 1.0;
+    uint64_t availabilitySamples = 0;
+    std::string availabilityMethod = "is";
+    double availabilityBias = 0;
+    std::string availabilityPairs;
+    Time mtbf = Hours(4380);
+    Time mttr = Hours(4);
+    bool analytic = false;
+    std::string demandsFile;
+    std::string queueModel = "mm1";
+    double sweepFilter = 0;
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("topology",
+                 "Topology file (GraphML, CSV edge list or CMDB JSON); empty for the triangle",
+                 topologyFile);
+    cmd.AddValue("topologyFormat", "graphml, csv, json or auto (by file extension)", topologyFormat);
+    cmd.AddValue("profileFile", "CSV file with additional circuit profiles", profileFile);
+    cmd.AddValue("linkProfile",
+                 "Circuit profile per link, e.g. HQ-DC=mpls,HQ-Branch=broadband",
+                 linkProfiles);
+    cmd.AddValue("linkTrace",
+                 "CSV time series of link bandwidth/delay changes",
+                 config.linkTraceFile);
+    cmd.AddValue("linkTraceScale",
+                 "Simulation seconds per trace second (1/7200 plays a day in 12s)",
+                 config.linkTraceScale);
+    cmd.AddValue("failure", "What fails at t=4s: link, node, gray, flap or none", config.failure);
+    cmd.AddValue("flapPeriod",
+                 "Down and up time of the HQ-DC link with --failure=flap",
+                 config.flapPeriod);
+    cmd.AddValue("grayFailure",
+                 "Gray failures for --failure=gray, e.g. HQ-DC,from=DC,loss=100%,at=4s,until=8s",
+                 config.grayFailure);
+    cmd.AddValue("detection",
+                 "Reaction on the HQ-DC circuit: static, bfd or sla",
+                 config.detection);
+    cmd.AddValue("redundancy",
+                 "Redundancy policy: none, active-standby, active-active or weighted",
+                 config.redundancy);
+    cmd.AddValue("loadSharing",
+                 "Load sharing of the redundancy policy: flow or packet",
+                 config.loadSharing);
+    cmd.AddValue("linkWeight",
+                 "Weighted shares per link, e.g. HQ-DC=3,HQ-Branch=1",
+                 config.linkWeights);
+    cmd.AddValue("revertHold",
+                 "Time a recovered link must stay healthy before routes return to it",
+                 config.revertHold);
+    cmd.AddValue("damping", "Exponential flap damping of link recovery", config.damping);
+    cmd.AddValue("flapTest", "Run --failure=flap with damping off and on and compare", flapTest);
+    cmd.AddValue("probeInterval", "Outage probe interval", config.probeInterval);
+    cmd.AddValue("pcap", "Capture pcap files (with outputs)", config.pcap);
+    cmd.AddValue("anim", "Write the NetAnim file (with outputs)", config.anim);
+    cmd.AddValue("stats", "Collect utilization and reorder statistics", config.stats);
+    cmd.AddValue("traceStart", "Start of the pcap and NetAnim window", config.traceStart);
+    cmd.AddValue("traceStop",
+                 "End of the pcap and NetAnim window (0: end of the run)",
+                 config.traceStop);
+    cmd.AddValue("adaptiveStop",
+                 "End the run once the post-failure measurements are steady (MSER-5)",
+                 config.adaptiveStop);
+    cmd.AddValue("stopHorizon",
+                 "Earliest adaptive stop after the end of the failure",
+                 config.stopHorizon);
+    cmd.AddValue("stopPrecision",
+                 "Relative CI half-width at which a series is steady",
+                 config.stopPrecision);
+    cmd.AddValue("failNode", "Site whose router fails with --failure=node", config.failNode);
+    cmd.AddValue("failLink",
+                 "Circuit that fails with --failure=link on a topology file, e.g. R1C1-R1C2",
+                 config.failLink);
+    cmd.AddValue("bootDelay", "Router boot time after power returns", config.bootDelay);
+    cmd.AddValue("routeInstallDelay",
+                 "Time from interfaces up until static routes are installed",
+                 config.routeInstallDelay);
+    cmd.AddValue("replications",
+                 "Independent replications (at most); more than 1 reports confidence intervals",
+                 replications);
+    cmd.AddValue("minReplications", "Replications before stopping early", minReplications);
+    cmd.AddValue("jobs", "Replications run in parallel (0: one per hardware thread)", jobs);
+    cmd.AddValue("routeThreads",
+                 "Threads of the shortest-path computation (0: one per hardware thread)",
+                 config.routeThreads);
+    cmd.AddValue("bulkFib",
+                 "Load shortest-path routes into one contiguous FIB per router instead of "
+                 "adding them to static routing one by one",
+                 config.bulkFib);
+    cmd.AddValue("routeCache",
+                 "Slots of the per-destination route cache of every router, e.g. 64 (0: no cache)",
+                 config.routeCache);
+    cmd.AddValue("tenants",
+                 "Tenant VPNs over the WAN, each on all sites or Name=SiteA+SiteB",
+                 config.tenants);
+    cmd.AddValue("tenantLoad",
+                 "Constant-rate traffic between the sites of every tenant, per direction",
+                 config.tenantLoad);
+    cmd.AddValue("pbr",
+                 "Policy-based routing rules: Router:field=value,...,via=Neighbor;...",
+                 config.pbr);
+    cmd.AddValue("pbrFile", "CSV file of policy-based routing rules", config.pbrFile);
+    cmd.AddValue("routerCapacity",
+                 "Router forwarding limits: Router|role|*:pps=,bps=,crypto=,policy=,queue=;...",
+                 config.routerCapacity);
+    cmd.AddValue("precision",
+                 "Stop once every CI half-width is within this fraction of its mean (0: never)",
+                 precision);
+    cmd.AddValue("confidence", "Confidence level of the intervals", confidence);
+    cmd.AddValue("results",
+                 "Results file to append the run to; output files go to runs/<run ID>/ beside it",
+                 resultsFile);
+    cmd.AddValue("sweep",
+                 "CSV file of sweep points: one column per option, one row per point",
+                 sweepFile);
+    cmd.AddValue("sweepOutput", "Results of --sweep, in job order", sweepOutput);
+    cmd.AddValue("masterSeed",
+                 "Seed the random streams of every --sweep job derive from",
+                 masterSeed);
+    cmd.AddValue("verify",
+                 "Run the verification scenarios; exit non-zero if a check fails",
+                 verify);
+    cmd.AddValue("budgetScale", "Factor on the runtime budgets of --verify", budgetScale);
+    cmd.AddValue("availability",
+                 "Estimate site pair availability from this many circuit states instead of "
+                 "simulating",
+                 availabilitySamples);
+    cmd.AddValue("availabilityMethod",
+                 "Sampling of --availability: is (importance sampling) or mc (plain)",
+                 availabilityMethod);
+    cmd.AddValue("availabilityBias",
+                 "Down probability of the importance sampling draws (0: from the smallest cut)",
+                 availabilityBias);
+    cmd.AddValue("availabilityPairs",
+                 "Site pairs of --availability, e.g. HQ-DC,Branch-DC (empty: all pairs)",
+                 availabilityPairs);
+    cmd.AddValue("mtbf", "MTBF of circuits whose profile has none", mtbf);
+    cmd.AddValue("mttr", "MTTR of circuits whose profile has none", mttr);
+    cmd.AddValue("analytic",
+                 "Estimate path delay and loss per failure state with queueing models "
+                 "instead of simulating",
+                 analytic);
+    cmd.AddValue("demands",
+                 "CSV demand matrix for the analytic model (source,target,rate,packet_size)",
+                 demandsFile);
+    cmd.AddValue("queueModel", "Queue of the analytic model: mm1 or md1", queueModel);
+    cmd.AddValue("sweepFilter",
+                 "Simulate only --sweep points the analytic model sees at this utilization "
+                 "(0: all)",
+                 sweepFilter);
+    cmd.Parse(argc, argv);
+    if (verify)
+    {
+        NS_ABORT_MSG_IF(!topologyFile.empty() || replications > 1 || !resultsFile.empty() ||
+                            flapTest,
+                        "--verify runs its own scenarios");
+        return RunVerification(budgetScale) > 0 ? 1 : 0;
+    }
+    config.triangle = topologyFile.empty();
+    if (flapTest)
+    {
+        // Fast probes make reordering visible; something must react to the flaps
+        config.failure = "flap";
+        config.detection = config.detection == "static" ? "bfd" : config.detection;
+        config.probeInterval = MilliSeconds(1);
+        config.outputs = false;
+        NS_ABORT_MSG_IF(replications > 1 || !resultsFile.empty() || !sweepFile.empty(),
+                        "--flapTest cannot be combined with --replications, --results or --sweep");
+    }
+    const bool triangle = config.triangle;
+    CheckScenarioConfig(config);
+
+    // Sites and circuits: n0 (HQ), n1 (Branch), n2 (DC) unless a file is given
+    WanTopology topology =
+        triangle ? MakeTriangleTopology() : LoadTopology(topologyFile, topologyFormat);
+
+    // Per-link circuit profiles: from the topology file, overridden on the command line
+    WanLinkProfileCatalog profiles;
+    if (!profileFile.empty())
+    {
+        profiles.Load(profileFile);
+    }
+    AssignLinkProfiles(topology, linkProfiles);
+    profiles.Apply(topology);
+
+    if (availabilitySamples > 0)
+    {
+        // A failure campaign over circuit states: no packets are simulated
+        NS_ABORT_MSG_IF(replications > 1 || !resultsFile.empty() || !sweepFile.empty() ||
+                            flapTest,
+                        "--availability cannot be combined with --replications, --results, "
+                        "--sweep or --flapTest");
+        WanAvailabilityEstimator::Method method;
+        NS_ABORT_MSG_UNLESS(WanAvailabilityEstimator::ParseMethod(availabilityMethod, method),
+                            "--availabilityMethod must be is or mc");
+        WanAvailabilityEstimator availability(topology);
+        availability.SetDefaultReliability(mtbf, mttr);
+        availability.SetMethod(method);
+        availability.SetBias(availabilityBias);
+        availability.SetConfidence(confidence);
+        availability.SetPairs(availabilityPairs);
+        availability.Run(availabilitySamples);
+        availability.Print(cout);
+        return 0;
+    }
+
+    WanQueueingModel::Queue queue;
+    NS_ABORT_MSG_UNLESS(WanQueueingModel::ParseQueue(queueModel, queue),
+                        "--queueModel must be mm1 or md1");
+    if (analytic)
+    {
+        // Per-link queueing models on the scenario's routes and traffic
+        NS_ABORT_MSG_IF(replications > 1 || !resultsFile.empty() || !sweepFile.empty() ||
+                            flapTest,
+                        "--analytic cannot be combined with --replications, --results, "
+                        "--sweep or --flapTest");
+        WanQueueingModel model(topology);
+        model.SetQueue(queue);
+        ConfigureQueueingModel(model, config, demandsFile);
+        model.Run();
+        model.Print(cout);
+        return 0;
+    }
+
+    // Run ID, config hash, seed and revision, taken before anything runs
+    std::unique_ptr<WanResultsStore> results;
+    WanResultsStore::RunInfo runInfo;
+    if (!resultsFile.empty())
+    {
+        results = std::make_unique<WanResultsStore>(resultsFile);
+        runInfo = WanResultsStore::MakeRunInfo(
+            DescribeScenario(topologyFile, topologyFormat, profileFile, linkProfiles, config),
+            SystemPath::Dirname(__FILE__));
+        cout << "Run " << runInfo.runId << " (config " << runInfo.configHash << ", "
+             << runInfo.gitRev << ")" << endl;
+    }
+
+    if (flapTest)
+    {
+        // The same flapping circuit twice: every flap followed, then damped.
+        // Both runs draw the same random numbers, so only damping differs
+        const uint64_t rngRun = RngSeedManager::GetRun();
+        std::vector<WanMetrics> runs;
+        for (bool damping : {false, true})
+        {
+            RngSeedManager::SetRun(rngRun);
+            ScenarioConfig run = config;
+            run.damping = damping;
+            run.revertHold = damping ? config.revertHold : Time();
+            runs.push_back(RunScenario(topology, run));
+        }
+        auto probeTotal = [](const WanMetrics& metrics, const std::string& suffix) {
+            double total = 0;
+            for (const auto& [name, value] : metrics.GetValues())
+            {
+                if (name.size() > suffix.size() &&
+                    name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0 &&
+                    name.find("->") != std::string::npos && name.find('.') == name.rfind('.'))
+                {
+                    total += value;
+                }
+            }
+            return total;
+        };
+        cout << "\n========================================" << endl;
+        cout << "Flap Test (HQ-DC every " << config.flapPeriod.GetMilliSeconds() << "ms, "
+             << config.detection << ", revert hold " << config.revertHold.GetMilliSeconds()
+             << "ms with damping)" << endl;
+        cout << "========================================" << endl;
+        cout << "                      damping off   damping on" << endl;
+        auto row = [&](const std::string& label, auto get) {
+            cout << "  " << std::left << std::setw(20) << label << std::right;
+            for (const WanMetrics& metrics : runs)
+            {
+                cout << std::setw(12) << get(metrics) << " ";
+            }
+            cout << endl;
+        };
+        row("probe loss % (sum)", [&](const WanMetrics& m) {
+            return probeTotal(m, ".loss") * 100;
+        });
+        row("probes reordered", [&](const WanMetrics& m) { return probeTotal(m, ".reordered"); });
+        row("affected s (sum)", [&](const WanMetrics& m) {
+            return probeTotal(m, ".affected_s");
+        });
+        row("link flaps", [](const WanMetrics& m) { return m.Get("flaps"); });
+        row("failovers", [](const WanMetrics& m) { return m.Get("failovers"); });
+        row("suppressions", [](const WanMetrics& m) { return m.Get("suppressions"); });
+        row("route updates", [](const WanMetrics& m) { return m.Get("route_updates"); });
+        cout << "========================================" << endl;
+        return 0;
+    }
+
+    if (!sweepFile.empty())
+    {
+        // Every job's seed follows from the master seed and its key, and the
+        // replication manager collects results by job index, so the output
+        // is the same for any number of parallel jobs
+        NS_ABORT_MSG_IF(!resultsFile.empty(), "--sweep writes --sweepOutput, not --results");
+        config.outputs = false;
+        if (jobs != 1)
+        {
+            // Parallel jobs already use the cores
+            config.routeThreads = 1;
+        }
+        WanSweep sweep(masterSeed);
+        sweep.Load(sweepFile, replications);
+        std::vector<ScenarioConfig> jobConfigs;
+        for (uint32_t j = 0; j < sweep.GetNJobs(); ++j)
+        {
+            ScenarioConfig job = config;
+            for (const auto& [name, value] : sweep.GetJob(j).options)
+            {
+                SetScenarioOption(job, name, value);
+            }
+            CheckScenarioConfig(job);
+            jobConfigs.push_back(job);
+        }
+        NS_ABORT_MSG_IF(jobConfigs.empty(), sweepFile << ": no sweep points");
+        WanReplicationManager jobRunner;
+        jobRunner.SetMaxReplications(jobConfigs.size());
+        jobRunner.SetPrecision(0);
+        if (jobs > 0)
+        {
+            jobRunner.SetJobs(jobs);
+        }
+        // The analytic model decides which points deserve a simulation: only
+        // those it sees near saturation in some failure state
+        std::vector<WanMetrics> estimates(jobConfigs.size());
+        std::vector<bool> simulate(jobConfigs.size(), true);
+        if (sweepFilter > 0)
+        {
+            uint32_t simulated = 0;
+            for (uint32_t j = 0; j < jobConfigs.size(); ++j)
+            {
+                WanQueueingModel model(topology);
+                model.SetQueue(queue);
+                ConfigureQueueingModel(model, jobConfigs[j], demandsFile);
+                model.Run();
+                model.AddMetrics(estimates[j]);
+                simulate[j] = model.GetMaxUtilization() >= sweepFilter;
+                simulated += simulate[j];
+            }
+            cout << "Analytic filter: " << simulated << " of " << jobConfigs.size()
+                 << " jobs at " << sweepFilter * 100 << "% utilization or more" << endl;
+        }
+        cout << "Running " << jobConfigs.size() << " sweep jobs (master seed " << masterSeed
+             << ")..." << endl;
+        jobRunner.Run([&](uint32_t j) {
+            if (!simulate[j])
+            {
+                WanMetrics metrics = estimates[j];
+                metrics.Set("simulated", 0);
+                return metrics;
+            }
+            RngSeedManager::SetSeed(sweep.GetJob(j).seed);
+            RngSeedManager::SetRun(sweep.GetJob(j).run);
+            WanMetrics metrics = RunScenario(topology, jobConfigs[j]);
+            if (sweepFilter > 0)
+            {
+                for (const auto& [name, value] : estimates[j].GetValues())
+                {
+                    metrics.Set(name, value);
+                }
+                metrics.Set("simulated", 1);
+            }
+            return metrics;
+        });
+        sweep.Write(sweepOutput, jobRunner.GetResults());
+        cout << "Sweep results written to " << sweepOutput << endl;
+        return 0;
+    }
+
+    if (replications > 1)
+    {
+        // Independent replications, each in its own process with its own
+        // RngRun; the topology above is shared, not reloaded
+        config.outputs = false;
+        if (jobs != 1)
+        {
+            config.routeThreads = 1;
+        }
+        uint64_t firstRun = RngSeedManager::GetRun();
+        WanReplicationManager replicationManager;
+        replicationManager.SetMaxReplications(replications);
+        replicationManager.SetMinReplications(minReplications);
+        if (jobs > 0)
+        {
+            replicationManager.SetJobs(jobs);
+        }
+        replicationManager.SetPrecision(precision);
+        replicationManager.SetConfidence(confidence);
+        cout << "Running up to " << replications << " replications (RngRun " << firstRun
+             << " onwards)..." << endl;
+        replicationManager.Run([&](uint32_t replication) {
+            RngSeedManager::SetRun(firstRun + replication);
+            return RunScenario(topology, config);
+        });
+        replicationManager.Print(cout);
+        if (results)
+        {
+            results->AddRun(runInfo, replicationManager.GetResults());
+            cout << "Results appended to " << resultsFile << endl;
+        }
+        return 0;
+    }
+
+    // Enable logging
+    LogComponentEnable("UdpEchoClientApplication", LOG_LEVEL_INFO);
+    LogComponentEnable("UdpEchoServerApplication", LOG_LEVEL_INFO);
+
+    if (results)
+    {
+        runInfo.outputDir = SystemPath::Append(
+            SystemPath::Append(SystemPath::Dirname(resultsFile), "runs"),
+            runInfo.runId);
+        SystemPath::MakeDirectories(runInfo.outputDir);
+        config.outputDir = runInfo.outputDir + "/";
+    }
+
+    WanMetrics metrics = RunScenario(topology, config);
+    if (results)
+    {
+        results->AddRun(runInfo, {metrics});
+    }
+
+    cout << "\n========================================" << endl;
+    cout << "Simulation Complete!" << endl;
+    cout << "========================================" << endl;
+    if (results)
+    {
+        cout << "Results appended to " << resultsFile << endl;
+        cout << "Output files saved in " << runInfo.outputDir << ":" << endl;
+    }
+    else
+    {
+        cout << "Output files saved in current directory:" << endl;
+    }
+    if (config.anim)
+    {
+        cout << "  - router-static-routing.xml (NetAnim)" << endl;
+    }
+    cout << "  - router-static-routing.routes (Routing tables)" << endl;
+    if (config.pcap)
+    {
+        cout << "  - router-static-routing-*.pcap (Packet captures)" << endl;
+    }
+    if (config.anim)
+    {
+        cout << "\nTo visualize:" << endl;
+        cout << "  netanim " << config.outputDir << "router-static-routing.xml" << endl;
+    }
     cout << "========================================\n" << endl;
 
     return 0;
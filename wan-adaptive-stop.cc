@@ -0,0 +1,268 @@
+/*
+ * Adaptive run length: stop once the post-failure measurements are steady
+ */
+
+#include "wan-adaptive-stop.h"
+
+#include "wan-replication.h"
+
+#include "ns3/abort.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("WanAdaptiveStop");
+
+WanSteadyStateSeries::WanSteadyStateSeries(const std::string& name)
+    : m_name(name)
+{
+}
+
+void
+WanSteadyStateSeries::Add(double x)
+{
+    m_batchSum += x;
+    if (++m_batchN == BATCH)
+    {
+        m_batchMeans.push_back(m_batchSum / BATCH);
+        m_batchSum = 0;
+        m_batchN = 0;
+    }
+}
+
+bool
+WanSteadyStateSeries::Update(double precision, double confidence, uint32_t minBatches)
+{
+    uint32_t k = m_batchMeans.size();
+    if (k < std::max(2U, minBatches))
+    {
+        return false;
+    }
+
+    // MSER(d) = SSE(d) / (k - d)^2 over the batch means after d, for every
+    // d that leaves minBatches; suffix sums make this O(k)
+    uint32_t best = 0;
+    double bestMser = std::numeric_limits<double>::infinity();
+    double sum = 0;
+    double sumSquares = 0;
+    std::vector<double> mser(k);
+    for (uint32_t d = k; d-- > 0;)
+    {
+        sum += m_batchMeans[d];
+        sumSquares += m_batchMeans[d] * m_batchMeans[d];
+        double m = k - d;
+        mser[d] = std::max(0.0, sumSquares - sum * sum / m) / (m * m);
+    }
+    for (uint32_t d = 0; d + std::max(2U, minBatches) <= k; ++d)
+    {
+        if (mser[d] < bestMser)
+        {
+            bestMser = mser[d];
+            best = d;
+        }
+    }
+    m_truncation = best;
+
+    uint32_t m = k - best;
+    double mean = 0;
+    for (uint32_t i = best; i < k; ++i)
+    {
+        mean += m_batchMeans[i];
+    }
+    mean /= m;
+    double squares = 0;
+    for (uint32_t i = best; i < k; ++i)
+    {
+        squares += (m_batchMeans[i] - mean) * (m_batchMeans[i] - mean);
+    }
+    m_mean = mean;
+    m_halfWidth = WanReplicationManager::StudentTQuantile((1 + confidence) / 2, m - 1) *
+                  std::sqrt(squares / (m - 1)) / std::sqrt(m);
+
+    // A truncation in the second half means the transient is still running
+    if (2 * best > k)
+    {
+        return false;
+    }
+    return m_halfWidth == 0 || m_halfWidth <= precision * std::abs(m_mean);
+}
+
+const std::string&
+WanSteadyStateSeries::GetName() const
+{
+    return m_name;
+}
+
+uint32_t
+WanSteadyStateSeries::GetTruncation() const
+{
+    return m_truncation * BATCH;
+}
+
+double
+WanSteadyStateSeries::GetMean() const
+{
+    return m_mean;
+}
+
+double
+WanSteadyStateSeries::GetHalfWidth() const
+{
+    return m_halfWidth;
+}
+
+uint32_t
+WanSteadyStateSeries::GetN() const
+{
+    return m_batchMeans.size() * BATCH + m_batchN;
+}
+
+void
+WanAdaptiveStop::SetInterval(Time interval)
+{
+    NS_ABORT_MSG_UNLESS(interval.IsStrictlyPositive(), "Sampling interval must be positive");
+    m_interval = interval;
+}
+
+void
+WanAdaptiveStop::SetPrecision(double precision)
+{
+    NS_ABORT_MSG_IF(precision <= 0, "Stop precision must be positive");
+    m_precision = precision;
+}
+
+void
+WanAdaptiveStop::SetConfidence(double confidence)
+{
+    NS_ABORT_MSG_IF(confidence <= 0 || confidence >= 1, "Confidence must be in (0, 1)");
+    m_confidence = confidence;
+}
+
+void
+WanAdaptiveStop::SetMinBatches(uint32_t batches)
+{
+    m_minBatches = std::max(2U, batches);
+}
+
+void
+WanAdaptiveStop::AddSeries(const std::string& name, Sampler sampler)
+{
+    m_series.push_back({WanSteadyStateSeries(name), sampler});
+}
+
+void
+WanAdaptiveStop::AddStopHandler(StopHandler handler)
+{
+    m_handlers.push_back(handler);
+}
+
+void
+WanAdaptiveStop::Start(Time observeFrom, Time earliest, Time latest, Time drain)
+{
+    NS_ABORT_MSG_IF(m_series.empty(), "Adaptive stop without series");
+    m_observeFrom = observeFrom;
+    m_earliest = earliest;
+    m_latest = latest;
+    m_drain = drain;
+    m_sampleEvent = Simulator::Schedule(m_interval, &WanAdaptiveStop::Sample, this);
+}
+
+void
+WanAdaptiveStop::Sample()
+{
+    // Sample every interval so the samplers' deltas stay per interval, but
+    // count observations only once the failure is over
+    bool observe = Simulator::Now() > m_observeFrom;
+    for (Series& series : m_series)
+    {
+        double x = series.sampler();
+        if (observe && !std::isnan(x))
+        {
+            series.estimate.Add(x);
+        }
+    }
+    if (Simulator::Now() >= m_earliest)
+    {
+        bool steady = true;
+        for (Series& series : m_series)
+        {
+            steady = series.estimate.Update(m_precision, m_confidence, m_minBatches) && steady;
+        }
+        if (steady)
+        {
+            m_stopped = true;
+            m_stopTime = Simulator::Now();
+            NS_LOG_INFO("Steady at " << m_stopTime.As(Time::S) << ", stopping");
+            for (const StopHandler& handler : m_handlers)
+            {
+                handler(m_stopTime);
+            }
+            Simulator::Stop(m_drain);
+            return;
+        }
+    }
+    if (Simulator::Now() + m_interval <= m_latest)
+    {
+        m_sampleEvent = Simulator::Schedule(m_interval, &WanAdaptiveStop::Sample, this);
+    }
+}
+
+bool
+WanAdaptiveStop::HasStopped() const
+{
+    return m_stopped;
+}
+
+Time
+WanAdaptiveStop::GetStopTime() const
+{
+    return m_stopTime;
+}
+
+void
+WanAdaptiveStop::AddMetrics(WanMetrics& metrics, Time scheduledStop) const
+{
+    metrics.Set("stop_s", (m_stopped ? m_stopTime : scheduledStop).GetSeconds());
+}
+
+void
+WanAdaptiveStop::Print(std::ostream& os) const
+{
+    os << "\n========================================" << std::endl;
+    os << "Adaptive Stop (MSER-5 warm-up, " << m_confidence * 100 << "% batch means within "
+       << m_precision * 100 << "%)" << std::endl;
+    os << "========================================" << std::endl;
+    if (m_stopped)
+    {
+        os << "Steady at " << m_stopTime.GetSeconds() << "s (earliest "
+           << m_earliest.GetSeconds() << "s)" << std::endl;
+    }
+    else
+    {
+        os << "Not steady by " << m_latest.GetSeconds() << "s: fixed schedule kept"
+           << std::endl;
+    }
+    std::ios::fmtflags flags = os.flags();
+    os << std::left << std::setw(32) << "series" << std::right << std::setw(6) << "n"
+       << std::setw(8) << "warmup" << std::setw(14) << "mean" << std::setw(14) << "+/-"
+       << std::endl;
+    for (const Series& series : m_series)
+    {
+        const WanSteadyStateSeries& s = series.estimate;
+        os << std::left << std::setw(32) << s.GetName() << std::right << std::setw(6)
+           << s.GetN() << std::setw(8) << s.GetTruncation() << std::setw(14)
+           << std::setprecision(6) << s.GetMean() << std::setw(14) << s.GetHalfWidth()
+           << std::endl;
+    }
+    os.flags(flags);
+    os << "========================================" << std::endl;
+}
+
+} // namespace ns3
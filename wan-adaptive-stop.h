@@ -0,0 +1,174 @@
+/*
+ * Adaptive run length: stop once the post-failure measurements are steady
+ *
+ * A fixed stop time spends most of a sweep's CPU on tails that no longer
+ * change any estimate. The adaptive stop samples output series (e.g.
+ * probe arrivals and delay per interval) from the end of the failure on
+ * and stops the run as soon as every series is steady:
+ *
+ * - warm-up: MSER-5 (White's marginal standard error rule on batch means
+ *   of 5 observations) picks the truncation point d* that minimizes the
+ *   standard error of the remaining batch means. d* in the second half of
+ *   the data means the transient is not over yet;
+ * - stability: the Student-t confidence interval over the batch means
+ *   after d* must be within Precision of their mean, with at least
+ *   MinBatches batches.
+ *
+ * Stopping is allowed only after the post-failure horizon. The stop
+ * handlers end every measurement at the stop time; the simulator then runs
+ * for a short drain so packets in flight still arrive. If the series never
+ * settle, the run keeps its fixed schedule. The scenario sizes the sampling
+ * interval from the time left after the failure, so the needed batches fit
+ * in the first half of it.
+ */
+
+#ifndef WAN_ADAPTIVE_STOP_H
+#define WAN_ADAPTIVE_STOP_H
+
+#include "wan-metrics.h"
+
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * MSER-5 warm-up truncation and batch-means stability of one series.
+ */
+class WanSteadyStateSeries
+{
+  public:
+    /// \param name series name for reports
+    explicit WanSteadyStateSeries(const std::string& name);
+
+    /// Add an observation
+    void Add(double x);
+
+    /**
+     * Find the warm-up truncation and test the remaining batch means.
+     * \param precision target half-width relative to the mean
+     * \param confidence confidence level of the interval
+     * \param minBatches batch means needed after the truncation
+     * \return true if the series is steady and precise enough
+     */
+    bool Update(double precision, double confidence, uint32_t minBatches);
+
+    /// \return the series name
+    const std::string& GetName() const;
+
+    /// \return observations dropped as warm-up by the last Update
+    uint32_t GetTruncation() const;
+
+    /// \return the mean after the truncation, as of the last Update
+    double GetMean() const;
+
+    /// \return the confidence interval half-width, as of the last Update
+    double GetHalfWidth() const;
+
+    /// \return observations added
+    uint32_t GetN() const;
+
+    /// Observations per batch
+    static const uint32_t BATCH = 5;
+
+  private:
+    std::string m_name;               //!< Series name
+    std::vector<double> m_batchMeans; //!< Means of the complete batches
+    double m_batchSum{0};             //!< Sum of the open batch
+    uint32_t m_batchN{0};             //!< Observations in the open batch
+    uint32_t m_truncation{0};         //!< Batches dropped as warm-up
+    double m_mean{0};                 //!< Mean after the truncation
+    double m_halfWidth{0};            //!< Half-width after the truncation
+};
+
+/**
+ * Stops a run once all its series are steady.
+ */
+class WanAdaptiveStop
+{
+  public:
+    /// Returns the observation of the last interval, or NaN if there is none
+    typedef std::function<double()> Sampler;
+
+    /// Ends the measurements at the stop time
+    typedef std::function<void(Time stop)> StopHandler;
+
+    /**
+     * \param interval sampling interval (default 100ms). MinBatches batches
+     *        of BATCH samples must fit between the end of the failure and
+     *        the latest stop, or the run cannot stop early.
+     */
+    void SetInterval(Time interval);
+
+    /// \param precision target half-width relative to the mean (default 0.05)
+    void SetPrecision(double precision);
+
+    /// \param confidence confidence level (default 0.95)
+    void SetConfidence(double confidence);
+
+    /// \param batches batch means needed after the warm-up (default 10)
+    void SetMinBatches(uint32_t batches);
+
+    /// Sample a series every interval
+    void AddSeries(const std::string& name, Sampler sampler);
+
+    /// Call a handler at the stop
+    void AddStopHandler(StopHandler handler);
+
+    /**
+     * Start sampling now.
+     * \param observeFrom first time observations count, e.g. the end of the failure
+     * \param earliest first time the run may stop
+     * \param latest last time to test; later the fixed schedule applies
+     * \param drain time the simulator runs on after the stop
+     */
+    void Start(Time observeFrom, Time earliest, Time latest, Time drain);
+
+    /// \return true if the run was stopped early
+    bool HasStopped() const;
+
+    /// \return the stop time, if stopped
+    Time GetStopTime() const;
+
+    /// Add stop_s, the measurement end (stopped or not)
+    void AddMetrics(WanMetrics& metrics, Time scheduledStop) const;
+
+    /// Print the stop time and the estimate of every series
+    void Print(std::ostream& os) const;
+
+  private:
+    /// A sampled series
+    struct Series
+    {
+        WanSteadyStateSeries estimate; //!< Warm-up and stability
+        Sampler sampler;               //!< Observation source
+    };
+
+    /// Take one sample of every series and test for the stop
+    void Sample();
+
+    Time m_interval{MilliSeconds(100)};  //!< Sampling interval
+    double m_precision{0.05};            //!< Relative half-width target
+    double m_confidence{0.95};           //!< Confidence level
+    uint32_t m_minBatches{10};           //!< Batch means after warm-up
+    std::vector<Series> m_series;        //!< Series in order
+    std::vector<StopHandler> m_handlers; //!< Stop handlers
+    Time m_observeFrom;                  //!< First observation time
+    Time m_earliest;                     //!< First possible stop
+    Time m_latest;                       //!< Last test
+    Time m_drain;                        //!< Run-on after the stop
+    bool m_stopped{false};               //!< Stopped early
+    Time m_stopTime;                     //!< Stop time
+    EventId m_sampleEvent;               //!< Next sample
+};
+
+} // namespace ns3
+
+#endif /* WAN_ADAPTIVE_STOP_H */
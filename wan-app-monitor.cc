@@ -0,0 +1,912 @@
+/*
+ * Application monitors: what an outage means to the users of the WAN
+ */
+
+#include "wan-app-monitor.h"
+
+#include "ns3/abort.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/log.h"
+#include "ns3/packet.h"
+#include "ns3/simulator.h"
+#include "ns3/udp-socket-factory.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("WanAppMonitor");
+
+namespace
+{
+
+/// Write a little-endian integer into a buffer
+void
+PutLe(uint8_t* buffer, uint64_t value, uint32_t bytes)
+{
+    for (uint32_t i = 0; i < bytes; ++i)
+    {
+        buffer[i] = (value >> (8 * i)) & 0xff;
+    }
+}
+
+/// Read a little-endian integer from a buffer
+uint64_t
+GetLe(const uint8_t* buffer, uint32_t bytes)
+{
+    uint64_t value = 0;
+    for (uint32_t i = 0; i < bytes; ++i)
+    {
+        value |= static_cast<uint64_t>(buffer[i]) << (8 * i);
+    }
+    return value;
+}
+
+} // namespace
+
+/*
+ * WanVoipMonitor
+ */
+
+WanVoipMonitor::WanVoipMonitor(const std::string& name,
+                               Ptr<Node> source,
+                               Ptr<Node> sink,
+                               Ipv4Address sinkAddress,
+                               uint16_t port)
+    : m_name(name),
+      m_source(source),
+      m_sink(sink),
+      m_sinkAddress(sinkAddress),
+      m_port(port),
+      m_interval(MilliSeconds(20)),
+      m_payloadSize(160),
+      m_ie(0),
+      m_bpl(25.1),
+      m_minJitterBuffer(MilliSeconds(20)),
+      m_window(Seconds(1.0)),
+      m_mosThreshold(3.6)
+{
+}
+
+void
+WanVoipMonitor::SetCodec(Time interval, uint32_t payloadSize, double ie, double bpl)
+{
+    NS_ABORT_MSG_IF(!interval.IsStrictlyPositive(), "Codec interval must be positive");
+    m_interval = interval;
+    // Sequence number and send time must fit
+    m_payloadSize = std::max(payloadSize, 12U);
+    m_ie = ie;
+    m_bpl = bpl;
+}
+
+void
+WanVoipMonitor::SetJitterBuffer(Time minimum)
+{
+    m_minJitterBuffer = minimum;
+}
+
+void
+WanVoipMonitor::SetWindow(Time window)
+{
+    m_window = window;
+}
+
+void
+WanVoipMonitor::SetMosThreshold(double mos)
+{
+    m_mosThreshold = mos;
+}
+
+void
+WanVoipMonitor::SetDscp(uint8_t dscp)
+{
+    m_dscp = dscp;
+}
+
+void
+WanVoipMonitor::Start(Time start, Time stop)
+{
+    NS_ABORT_MSG_IF(m_window < m_interval ||
+                        m_window.GetNanoSeconds() % m_interval.GetNanoSeconds() != 0,
+                    "VoIP window must be a multiple of the codec interval");
+    m_start = start;
+    m_stop = stop;
+    Simulator::Schedule(start, &WanVoipMonitor::Open, this);
+    // Voice still in flight at stop has half a second to arrive
+    m_finishEvent = Simulator::Schedule(stop + MilliSeconds(500), &WanVoipMonitor::Finish, this);
+}
+
+void
+WanVoipMonitor::Truncate(Time stop)
+{
+    NS_ABORT_MSG_IF(stop < Simulator::Now(), "Call stop " << stop.As(Time::S) << " has passed");
+    if (stop >= m_stop)
+    {
+        return;
+    }
+    m_stop = stop;
+    m_finishEvent.Cancel();
+    m_finishEvent = Simulator::Schedule(stop + MilliSeconds(500) - Simulator::Now(),
+                                        &WanVoipMonitor::Finish,
+                                        this);
+}
+
+void
+WanVoipMonitor::SetNodeState(Ptr<Node> node, bool up)
+{
+    if (!m_opened || Simulator::Now() >= m_stop)
+    {
+        return;
+    }
+    if (node == m_source)
+    {
+        m_sendEvent.Cancel();
+        if (m_sendSocket)
+        {
+            m_sendSocket->Close();
+            m_sendSocket = nullptr;
+        }
+        if (up)
+        {
+            OpenSource();
+        }
+    }
+    if (node == m_sink)
+    {
+        if (m_recvSocket)
+        {
+            m_recvSocket->Close();
+            m_recvSocket = nullptr;
+        }
+        // The rebooted phone estimates the network delay afresh
+        m_estimating = false;
+        if (up)
+        {
+            OpenSink();
+        }
+    }
+}
+
+void
+WanVoipMonitor::Open()
+{
+    m_opened = true;
+    OpenSink();
+    OpenSource();
+}
+
+void
+WanVoipMonitor::OpenSink()
+{
+    m_recvSocket = Socket::CreateSocket(m_sink, UdpSocketFactory::GetTypeId());
+    m_recvSocket->Bind(InetSocketAddress(Ipv4Address::GetAny(), m_port));
+    m_recvSocket->SetRecvCallback(MakeCallback(&WanVoipMonitor::Receive, this));
+}
+
+void
+WanVoipMonitor::OpenSource()
+{
+    m_sendSocket = Socket::CreateSocket(m_source, UdpSocketFactory::GetTypeId());
+    m_sendSocket->SetIpTos(m_dscp << 2);
+    m_sendSocket->Connect(InetSocketAddress(m_sinkAddress, m_port));
+    Send();
+}
+
+void
+WanVoipMonitor::Send()
+{
+    if (Simulator::Now() >= m_stop)
+    {
+        return;
+    }
+    // Sends fail while there is no route; the voice is lost
+    std::vector<uint8_t> payload(m_payloadSize, 0);
+    PutLe(payload.data(), m_sent, 4);
+    PutLe(payload.data() + 4, Simulator::Now().GetNanoSeconds(), 8);
+    m_sendSocket->Send(Create<Packet>(payload.data(), payload.size()));
+    ++m_sent;
+    m_sendEvent = Simulator::Schedule(m_interval, &WanVoipMonitor::Send, this);
+}
+
+void
+WanVoipMonitor::Receive(Ptr<Socket> socket)
+{
+    const uint64_t perWindow = m_window.GetNanoSeconds() / m_interval.GetNanoSeconds();
+    Ptr<Packet> packet;
+    while ((packet = socket->Recv()))
+    {
+        if (m_finished)
+        {
+            continue;
+        }
+        uint8_t header[12];
+        packet->CopyData(header, sizeof(header));
+        uint64_t seq = GetLe(header, 4);
+        double delay = (Simulator::Now() - NanoSeconds(GetLe(header + 4, 8))).GetSeconds();
+
+        uint64_t window = seq / perWindow;
+        if (window > m_window0)
+        {
+            CloseWindows(window);
+        }
+
+        // Adaptive playout: smoothed delay plus four deviations (RFC 3550
+        // gain 1/16), never less than the minimum jitter buffer
+        if (!m_estimating)
+        {
+            m_delayEstimate = delay;
+            m_estimating = true;
+        }
+        double playout = m_delayEstimate + std::max(4 * m_jitterEstimate,
+                                                    m_minJitterBuffer.GetSeconds());
+        m_jitterEstimate += (std::abs(delay - m_delayEstimate) - m_jitterEstimate) / 16;
+        m_delayEstimate += (delay - m_delayEstimate) / 16;
+
+        // Voice of a window already scored, or past its playout time, is lost
+        if (window < m_window0 || delay > playout)
+        {
+            NS_LOG_LOGIC(m_name << ": packet " << seq << " late by " << delay - playout << "s");
+            continue;
+        }
+        double mouthToEar = playout + m_interval.GetSeconds();
+        ++m_played;
+        m_mouthToEarSum += mouthToEar;
+        ++m_windowPlayed;
+        m_windowDelaySum += mouthToEar;
+    }
+}
+
+void
+WanVoipMonitor::CloseWindows(uint64_t window)
+{
+    const uint64_t perWindow = m_window.GetNanoSeconds() / m_interval.GetNanoSeconds();
+    for (; m_window0 < window; ++m_window0)
+    {
+        uint64_t first = m_window0 * perWindow;
+        uint64_t expected = std::min<uint64_t>(perWindow, m_sent > first ? m_sent - first : 0);
+        if (expected == 0)
+        {
+            continue;
+        }
+        if (m_windowPlayed > 0)
+        {
+            m_lastDelay = m_windowDelaySum / m_windowPlayed;
+        }
+        double loss = 100.0 * (expected - std::min(m_windowPlayed, expected)) / expected;
+        // A window without any voice is silence, whatever the E-model says
+        double mos = m_windowPlayed > 0 ? Mos(RFactor(m_lastDelay * 1000, loss, m_ie, m_bpl)) : 1;
+        m_worstMos = std::min(m_worstMos, mos);
+        if (mos < m_mosThreshold)
+        {
+            ++m_degraded;
+            NS_LOG_INFO(m_name << ": MOS " << mos << " in window from "
+                               << (m_start + m_window * m_window0).GetSeconds() << "s");
+        }
+        m_windowPlayed = 0;
+        m_windowDelaySum = 0;
+    }
+}
+
+void
+WanVoipMonitor::Finish()
+{
+    const uint64_t perWindow = m_window.GetNanoSeconds() / m_interval.GetNanoSeconds();
+    CloseWindows((m_sent + perWindow - 1) / perWindow);
+    m_finished = true;
+}
+
+const std::string&
+WanVoipMonitor::GetName() const
+{
+    return m_name;
+}
+
+double
+WanVoipMonitor::GetCallRFactor() const
+{
+    double delayMs = m_played > 0 ? 1000 * m_mouthToEarSum / m_played : 0;
+    return RFactor(delayMs, 100 * GetLoss(), m_ie, m_bpl);
+}
+
+double
+WanVoipMonitor::GetCallMos() const
+{
+    return Mos(GetCallRFactor());
+}
+
+double
+WanVoipMonitor::GetWorstMos() const
+{
+    return m_worstMos;
+}
+
+Time
+WanVoipMonitor::GetDegradedTime() const
+{
+    return m_window * m_degraded;
+}
+
+double
+WanVoipMonitor::GetLoss() const
+{
+    return m_sent > 0 ? 1.0 - static_cast<double>(m_played) / m_sent : 0;
+}
+
+Time
+WanVoipMonitor::GetMouthToEarDelay() const
+{
+    return m_played > 0 ? Seconds(m_mouthToEarSum / m_played) : Time();
+}
+
+double
+WanVoipMonitor::RFactor(double delayMs, double lossPercent, double ie, double bpl)
+{
+    // Delay impairment: 0.024 per ms, plus 0.11 per ms beyond 177.3ms
+    double id = 0.024 * delayMs + (delayMs > 177.3 ? 0.11 * (delayMs - 177.3) : 0);
+    // Effective equipment impairment under random loss (G.107, BurstR = 1)
+    double ieEff = ie + (95 - ie) * lossPercent / (lossPercent + bpl);
+    return 93.2 - id - ieEff;
+}
+
+double
+WanVoipMonitor::Mos(double r)
+{
+    if (r <= 0)
+    {
+        return 1;
+    }
+    if (r >= 100)
+    {
+        return 4.5;
+    }
+    return std::max(1.0, 1 + 0.035 * r + r * (r - 60) * (100 - r) * 7e-6);
+}
+
+/*
+ * WanTransactionMonitor
+ */
+
+WanTransactionMonitor::WanTransactionMonitor(const std::string& name,
+                                             Ptr<Node> client,
+                                             Ptr<Node> server,
+                                             Ipv4Address clientAddress,
+                                             Ipv4Address serverAddress,
+                                             uint16_t port)
+    : m_name(name),
+      m_client(client),
+      m_server(server),
+      m_clientAddress(clientAddress),
+      m_serverAddress(serverAddress),
+      m_port(port),
+      m_thinkTime(MilliSeconds(200)),
+      m_timeout(Seconds(1.0)),
+      m_slaThreshold(MilliSeconds(500)),
+      m_p95Completion(0.95)
+{
+}
+
+void
+WanTransactionMonitor::SetSizes(uint32_t requestSize, uint32_t segments, uint32_t segmentSize)
+{
+    NS_ABORT_MSG_IF(segments == 0 || segments > 64, "Responses have 1 to 64 segments");
+    // Transaction ID and segment index must fit
+    m_requestSize = std::max(requestSize, 4U);
+    m_segments = segments;
+    m_segmentSize = std::max(segmentSize, 5U);
+}
+
+void
+WanTransactionMonitor::SetThinkTime(Time thinkTime)
+{
+    m_thinkTime = thinkTime;
+}
+
+void
+WanTransactionMonitor::SetRetries(Time timeout, uint32_t attempts)
+{
+    NS_ABORT_MSG_IF(attempts == 0, "A request is sent at least once");
+    m_timeout = timeout;
+    m_attempts = attempts;
+}
+
+void
+WanTransactionMonitor::SetSlaThreshold(Time threshold)
+{
+    m_slaThreshold = threshold;
+}
+
+void
+WanTransactionMonitor::SetDscp(uint8_t dscp)
+{
+    m_dscp = dscp;
+}
+
+void
+WanTransactionMonitor::Start(Time start, Time stop)
+{
+    m_stop = stop;
+    Simulator::Schedule(start, &WanTransactionMonitor::Open, this);
+}
+
+void
+WanTransactionMonitor::Truncate(Time stop)
+{
+    m_stop = std::min(m_stop, stop);
+}
+
+void
+WanTransactionMonitor::SetNodeState(Ptr<Node> node, bool up)
+{
+    if (!m_opened || Simulator::Now() >= m_stop)
+    {
+        return;
+    }
+    if (node == m_client)
+    {
+        m_timeoutEvent.Cancel();
+        m_nextEvent.Cancel();
+        if (m_open)
+        {
+            NS_LOG_INFO(m_name << ": transaction " << m_id << " lost with the client");
+            ++m_failed;
+            m_open = false;
+        }
+        if (m_clientSocket)
+        {
+            m_clientSocket->Close();
+            m_clientSocket = nullptr;
+        }
+        if (up)
+        {
+            OpenClient();
+        }
+    }
+    if (node == m_server)
+    {
+        if (m_serverSocket)
+        {
+            m_serverSocket->Close();
+            m_serverSocket = nullptr;
+        }
+        if (up)
+        {
+            OpenServer();
+        }
+    }
+}
+
+void
+WanTransactionMonitor::Open()
+{
+    m_opened = true;
+    OpenServer();
+    OpenClient();
+}
+
+void
+WanTransactionMonitor::OpenServer()
+{
+    m_serverSocket = Socket::CreateSocket(m_server, UdpSocketFactory::GetTypeId());
+    m_serverSocket->Bind(InetSocketAddress(Ipv4Address::GetAny(), m_port));
+    m_serverSocket->SetIpTos(m_dscp << 2);
+    m_serverSocket->SetRecvCallback(MakeCallback(&WanTransactionMonitor::ServerReceive, this));
+}
+
+void
+WanTransactionMonitor::OpenClient()
+{
+    // Bound to the client address so responses come back to it on any path
+    m_clientSocket = Socket::CreateSocket(m_client, UdpSocketFactory::GetTypeId());
+    m_clientSocket->Bind(InetSocketAddress(m_clientAddress, 0));
+    m_clientSocket->SetIpTos(m_dscp << 2);
+    m_clientSocket->Connect(InetSocketAddress(m_serverAddress, m_port));
+    m_clientSocket->SetRecvCallback(MakeCallback(&WanTransactionMonitor::ClientReceive, this));
+    Issue();
+}
+
+void
+WanTransactionMonitor::Issue()
+{
+    if (Simulator::Now() >= m_stop)
+    {
+        return;
+    }
+    ++m_id;
+    m_open = true;
+    m_issued = Simulator::Now();
+    m_attempt = 0;
+    m_received = 0;
+    SendRequest();
+}
+
+void
+WanTransactionMonitor::SendRequest()
+{
+    std::vector<uint8_t> request(m_requestSize, 0);
+    PutLe(request.data(), m_id, 4);
+    m_clientSocket->Send(Create<Packet>(request.data(), request.size()));
+    // Exponential backoff: timeout, 2 x timeout, 4 x timeout, ...
+    m_timeoutEvent = Simulator::Schedule(m_timeout * (1U << std::min(m_attempt, 16U)),
+                                         &WanTransactionMonitor::Timeout,
+                                         this);
+    ++m_attempt;
+}
+
+void
+WanTransactionMonitor::Timeout()
+{
+    if (m_attempt < m_attempts)
+    {
+        NS_LOG_INFO(m_name << ": transaction " << m_id << " retry " << m_attempt);
+        SendRequest();
+        return;
+    }
+    NS_LOG_INFO(m_name << ": transaction " << m_id << " abandoned after "
+                       << (Simulator::Now() - m_issued).GetSeconds() << "s");
+    ++m_failed;
+    m_open = false;
+    Next();
+}
+
+void
+WanTransactionMonitor::ServerReceive(Ptr<Socket> socket)
+{
+    Ptr<Packet> packet;
+    Address from;
+    while ((packet = socket->RecvFrom(from)))
+    {
+        uint8_t id[4];
+        packet->CopyData(id, sizeof(id));
+        std::vector<uint8_t> segment(m_segmentSize, 0);
+        std::copy(id, id + 4, segment.begin());
+        for (uint32_t i = 0; i < m_segments; ++i)
+        {
+            segment[4] = i;
+            socket->SendTo(Create<Packet>(segment.data(), segment.size()), 0, from);
+        }
+    }
+}
+
+void
+WanTransactionMonitor::ClientReceive(Ptr<Socket> socket)
+{
+    const uint64_t all = m_segments == 64 ? ~0ULL : (1ULL << m_segments) - 1;
+    Ptr<Packet> packet;
+    while ((packet = socket->Recv()))
+    {
+        uint8_t header[5];
+        packet->CopyData(header, sizeof(header));
+        // Responses to abandoned or earlier attempts' duplicates are ignored
+        if (!m_open || GetLe(header, 4) != m_id || header[4] >= m_segments)
+        {
+            continue;
+        }
+        m_received |= 1ULL << header[4];
+        if (m_received != all)
+        {
+            continue;
+        }
+        Simulator::Cancel(m_timeoutEvent);
+        m_open = false;
+        Time completion = Simulator::Now() - m_issued;
+        ++m_completed;
+        m_completionSum += completion;
+        m_maxCompletion = std::max(m_maxCompletion, completion);
+        m_p95Completion.Add(completion.GetSeconds());
+        if (completion > m_slaThreshold)
+        {
+            ++m_breaches;
+            NS_LOG_INFO(m_name << ": transaction " << m_id << " took " << completion.GetSeconds()
+                               << "s");
+        }
+        Next();
+    }
+}
+
+void
+WanTransactionMonitor::Next()
+{
+    m_nextEvent = Simulator::Schedule(m_thinkTime, &WanTransactionMonitor::Issue, this);
+}
+
+const std::string&
+WanTransactionMonitor::GetName() const
+{
+    return m_name;
+}
+
+uint32_t
+WanTransactionMonitor::GetCompleted() const
+{
+    return m_completed;
+}
+
+uint32_t
+WanTransactionMonitor::GetFailed() const
+{
+    return m_failed;
+}
+
+uint32_t
+WanTransactionMonitor::GetSlaBreaches() const
+{
+    return m_breaches;
+}
+
+Time
+WanTransactionMonitor::GetMeanCompletionTime() const
+{
+    return m_completed > 0 ? m_completionSum / m_completed : Time();
+}
+
+Time
+WanTransactionMonitor::GetP95CompletionTime() const
+{
+    return Seconds(m_p95Completion.Get());
+}
+
+Time
+WanTransactionMonitor::GetMaxCompletionTime() const
+{
+    return m_maxCompletion;
+}
+
+/*
+ * WanStreamingMonitor
+ */
+
+WanStreamingMonitor::WanStreamingMonitor(const std::string& name,
+                                         Ptr<Node> server,
+                                         Ptr<Node> client,
+                                         Ipv4Address clientAddress,
+                                         uint16_t port)
+    : m_name(name),
+      m_server(server),
+      m_client(client),
+      m_clientAddress(clientAddress),
+      m_port(port),
+      m_bitrate("1Mbps"),
+      m_startupBuffer(Seconds(2.0)),
+      m_resumeBuffer(Seconds(1.0))
+{
+}
+
+void
+WanStreamingMonitor::SetStream(DataRate bitrate, uint32_t packetSize)
+{
+    NS_ABORT_MSG_IF(bitrate.GetBitRate() == 0 || packetSize == 0, "Empty stream");
+    m_bitrate = bitrate;
+    m_packetSize = packetSize;
+}
+
+void
+WanStreamingMonitor::SetBuffer(Time startup, Time resume)
+{
+    m_startupBuffer = startup;
+    m_resumeBuffer = resume;
+}
+
+void
+WanStreamingMonitor::SetDscp(uint8_t dscp)
+{
+    m_dscp = dscp;
+}
+
+void
+WanStreamingMonitor::Start(Time start, Time stop)
+{
+    m_start = start;
+    m_stop = stop;
+    m_updated = start;
+    Simulator::Schedule(start, &WanStreamingMonitor::Open, this);
+    m_finishEvent = Simulator::Schedule(stop, &WanStreamingMonitor::Finish, this);
+}
+
+void
+WanStreamingMonitor::Truncate(Time stop)
+{
+    NS_ABORT_MSG_IF(stop < Simulator::Now(),
+                    "Stream stop " << stop.As(Time::S) << " has passed");
+    if (stop >= m_stop)
+    {
+        return;
+    }
+    m_stop = stop;
+    m_finishEvent.Cancel();
+    m_finishEvent =
+        Simulator::Schedule(stop - Simulator::Now(), &WanStreamingMonitor::Finish, this);
+}
+
+void
+WanStreamingMonitor::SetNodeState(Ptr<Node> node, bool up)
+{
+    if (!m_opened || m_finished)
+    {
+        return;
+    }
+    if (node == m_server)
+    {
+        m_sendEvent.Cancel();
+        if (m_sendSocket)
+        {
+            m_sendSocket->Close();
+            m_sendSocket = nullptr;
+        }
+        if (up)
+        {
+            OpenServer();
+        }
+    }
+    if (node == m_client && !up)
+    {
+        // The buffer dies with the player: playback stalls until it refills
+        const Time now = Simulator::Now();
+        Play(now);
+        if (m_state == PLAYING)
+        {
+            m_state = STALLED;
+            m_stallStart = now;
+            ++m_stalls;
+            NS_LOG_INFO(m_name << ": playback stalls at " << now.GetSeconds()
+                               << "s, client down");
+        }
+        m_level = Time();
+        if (m_recvSocket)
+        {
+            m_recvSocket->Close();
+            m_recvSocket = nullptr;
+        }
+    }
+    else if (node == m_client)
+    {
+        OpenClient();
+    }
+}
+
+void
+WanStreamingMonitor::Open()
+{
+    m_opened = true;
+    OpenClient();
+    OpenServer();
+}
+
+void
+WanStreamingMonitor::OpenClient()
+{
+    m_recvSocket = Socket::CreateSocket(m_client, UdpSocketFactory::GetTypeId());
+    m_recvSocket->Bind(InetSocketAddress(Ipv4Address::GetAny(), m_port));
+    m_recvSocket->SetRecvCallback(MakeCallback(&WanStreamingMonitor::Receive, this));
+}
+
+void
+WanStreamingMonitor::OpenServer()
+{
+    m_sendSocket = Socket::CreateSocket(m_server, UdpSocketFactory::GetTypeId());
+    m_sendSocket->SetIpTos(m_dscp << 2);
+    m_sendSocket->Connect(InetSocketAddress(m_clientAddress, m_port));
+    Send();
+}
+
+void
+WanStreamingMonitor::Send()
+{
+    if (Simulator::Now() >= m_stop)
+    {
+        return;
+    }
+    m_sendSocket->Send(Create<Packet>(m_packetSize));
+    ++m_sent;
+    // Paced at the media bitrate: every packet carries this much playback
+    m_sendEvent = Simulator::Schedule(m_bitrate.CalculateBytesTxTime(m_packetSize),
+                                      &WanStreamingMonitor::Send,
+                                      this);
+}
+
+void
+WanStreamingMonitor::Receive(Ptr<Socket> socket)
+{
+    Ptr<Packet> packet;
+    while ((packet = socket->Recv()))
+    {
+        if (m_finished)
+        {
+            continue;
+        }
+        Time now = Simulator::Now();
+        ++m_received;
+        Play(now);
+        m_level += m_bitrate.CalculateBytesTxTime(m_packetSize);
+        if (m_state == BUFFERING && m_level >= m_startupBuffer)
+        {
+            m_state = PLAYING;
+            m_playStart = now;
+            NS_LOG_INFO(m_name << ": playback starts at " << now.GetSeconds() << "s");
+        }
+        else if (m_state == STALLED && m_level >= m_resumeBuffer)
+        {
+            m_state = PLAYING;
+            m_stalled += now - m_stallStart;
+            NS_LOG_INFO(m_name << ": playback resumes at " << now.GetSeconds() << "s after "
+                               << (now - m_stallStart).GetSeconds() << "s");
+        }
+    }
+}
+
+void
+WanStreamingMonitor::Play(Time now)
+{
+    if (m_state == PLAYING)
+    {
+        Time elapsed = now - m_updated;
+        if (elapsed >= m_level)
+        {
+            m_state = STALLED;
+            m_stallStart = m_updated + m_level;
+            m_level = Time();
+            ++m_stalls;
+            NS_LOG_INFO(m_name << ": playback stalls at " << m_stallStart.GetSeconds() << "s");
+        }
+        else
+        {
+            m_level -= elapsed;
+        }
+    }
+    m_updated = now;
+}
+
+void
+WanStreamingMonitor::Finish()
+{
+    Play(m_stop);
+    if (m_state == STALLED)
+    {
+        m_stalled += m_stop - m_stallStart;
+    }
+    m_finished = true;
+}
+
+const std::string&
+WanStreamingMonitor::GetName() const
+{
+    return m_name;
+}
+
+Time
+WanStreamingMonitor::GetStartupDelay() const
+{
+    return (m_state == BUFFERING ? m_stop : m_playStart) - m_start;
+}
+
+uint32_t
+WanStreamingMonitor::GetRebufferEvents() const
+{
+    return m_stalls;
+}
+
+Time
+WanStreamingMonitor::GetRebufferTime() const
+{
+    return m_stalled;
+}
+
+double
+WanStreamingMonitor::GetRebufferRatio() const
+{
+    if (m_state == BUFFERING || m_stop <= m_playStart)
+    {
+        return 0;
+    }
+    return m_stalled.GetSeconds() / (m_stop - m_playStart).GetSeconds();
+}
+
+Time
+WanStreamingMonitor::GetLostMedia() const
+{
+    return m_bitrate.CalculateBytesTxTime(m_packetSize) * (m_sent - m_received);
+}
+
+} // namespace ns3
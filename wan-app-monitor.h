@@ -0,0 +1,458 @@
+/*
+ * Application monitors: what an outage means to the users of the WAN
+ *
+ * Probes tell whether packets arrive; these monitors tell what a user of
+ * a typical application would have experienced. Each one generates its
+ * application's traffic between two sites and scores it as it arrives,
+ * in constant memory per flow:
+ *
+ * - WanVoipMonitor: a one-way G.711 voice stream (20ms packets) played out
+ *   through an adaptive jitter buffer. Packets that miss their playout
+ *   time count as lost. Quality is the ITU-T G.107 E-model R-factor in the
+ *   simplified form of Cole and Rosenbluth,
+ *     R = 93.2 - Id(d) - Ie,eff(loss),
+ *   with d the mouth-to-ear delay, and MOS is derived from R. The model
+ *   scores the whole call and every window (default 1s). It reports the
+ *   worst window and the time spent below a MOS threshold.
+ * - WanTransactionMonitor: a closed-loop request/response client, e.g. an
+ *   ERP user. A request is answered by a multi-packet response. Requests
+ *   that are not answered in time are retried with exponential backoff,
+ *   as TCP would, until they succeed or are abandoned. It reports the
+ *   completion time (mean, p95, max), failures and SLA breaches.
+ * - WanStreamingMonitor: a constant-bitrate video stream into a playback
+ *   buffer. Playback starts once the startup buffer is filled. When the
+ *   buffer runs dry, playback stalls until the resume level is refilled.
+ *   It reports the startup delay, stalls, rebuffer time and lost media.
+ */
+
+#ifndef WAN_APP_MONITOR_H
+#define WAN_APP_MONITOR_H
+
+#include "wan-metrics.h"
+
+#include "ns3/data-rate.h"
+#include "ns3/event-id.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/node.h"
+#include "ns3/nstime.h"
+#include "ns3/socket.h"
+
+#include <cstdint>
+#include <string>
+
+namespace ns3
+{
+
+/**
+ * One-way VoIP stream scored with the E-model.
+ */
+class WanVoipMonitor
+{
+  public:
+    /**
+     * \param name label for reports, e.g. "HQ->DC"
+     * \param source talking node
+     * \param sink listening node
+     * \param sinkAddress address of the sink to send to
+     * \param port UDP port of the sink
+     */
+    WanVoipMonitor(const std::string& name,
+                   Ptr<Node> source,
+                   Ptr<Node> sink,
+                   Ipv4Address sinkAddress,
+                   uint16_t port);
+
+    /**
+     * Set the codec (default G.711 with packet loss concealment).
+     * \param interval packetization interval (default 20ms)
+     * \param payloadSize voice bytes per packet (default 160)
+     * \param ie equipment impairment factor (default 0)
+     * \param bpl packet-loss robustness factor (default 25.1)
+     */
+    void SetCodec(Time interval, uint32_t payloadSize, double ie, double bpl);
+
+    /// \param minimum smallest jitter buffer delay (default 20ms)
+    void SetJitterBuffer(Time minimum);
+
+    /// \param window scoring window, a multiple of the codec interval (default 1s)
+    void SetWindow(Time window);
+
+    /// \param mos windows below this MOS count as degraded (default 3.6)
+    void SetMosThreshold(double mos);
+
+    /// \param dscp DSCP of the voice packets (default 0, best effort)
+    void SetDscp(uint8_t dscp);
+
+    /// Talk from start until stop
+    void Start(Time start, Time stop);
+
+    /// End the call early, at a stop that has not passed yet
+    void Truncate(Time stop);
+
+    /**
+     * A node failed or came back. A failed talker stops; a failed listener
+     * loses its socket and jitter buffer. Both resume once the node is up.
+     * \param node the node
+     * \param up false when it fails, true once it has rebooted
+     */
+    void SetNodeState(Ptr<Node> node, bool up);
+
+    /// \return the report label
+    const std::string& GetName() const;
+
+    /// \return the MOS of the whole call (mean delay and loss)
+    double GetCallMos() const;
+
+    /// \return the R-factor of the whole call
+    double GetCallRFactor() const;
+
+    /// \return the lowest MOS of a window
+    double GetWorstMos() const;
+
+    /// \return the time in windows below the MOS threshold
+    Time GetDegradedTime() const;
+
+    /// \return the fraction of voice packets lost or late
+    double GetLoss() const;
+
+    /// \return the mean mouth-to-ear delay of played packets
+    Time GetMouthToEarDelay() const;
+
+    /**
+     * Simplified E-model (Cole and Rosenbluth).
+     * \param delayMs one-way mouth-to-ear delay in ms
+     * \param lossPercent packet loss in percent
+     * \param ie equipment impairment factor
+     * \param bpl packet-loss robustness factor
+     * \return the R-factor
+     */
+    static double RFactor(double delayMs, double lossPercent, double ie, double bpl);
+
+    /// \return the MOS of an R-factor (ITU-T G.107 Annex B)
+    static double Mos(double r);
+
+  private:
+    /// Open the sockets and send the first packet
+    void Open();
+
+    /// Open the sink socket
+    void OpenSink();
+
+    /// Open the source socket and send a packet
+    void OpenSource();
+
+    /// Send one voice packet and schedule the next
+    void Send();
+
+    /// Sink receive callback
+    void Receive(Ptr<Socket> socket);
+
+    /// Score windows before the given one
+    void CloseWindows(uint64_t window);
+
+    /// Score the remaining windows at the end of the call
+    void Finish();
+
+    std::string m_name;         //!< Report label
+    Ptr<Node> m_source;         //!< Talking node
+    Ptr<Node> m_sink;           //!< Listening node
+    Ipv4Address m_sinkAddress;  //!< Destination address
+    uint16_t m_port;            //!< Destination port
+    Time m_interval;            //!< Packetization interval
+    uint32_t m_payloadSize;     //!< Voice bytes per packet
+    double m_ie;                //!< Equipment impairment factor
+    double m_bpl;               //!< Packet-loss robustness factor
+    Time m_minJitterBuffer;     //!< Smallest jitter buffer delay
+    Time m_window;              //!< Scoring window
+    double m_mosThreshold;      //!< Degraded below this MOS
+    uint8_t m_dscp{0};          //!< DSCP of the voice packets
+    Time m_start;               //!< First packet
+    Time m_stop;                //!< End of the call
+    Ptr<Socket> m_sendSocket;   //!< Source socket
+    Ptr<Socket> m_recvSocket;   //!< Sink socket
+    EventId m_sendEvent;        //!< Next packet
+    EventId m_finishEvent;      //!< End of the call accounting
+    bool m_opened{false};       //!< Open() ran
+    uint32_t m_sent{0};         //!< Packets sent, also the next sequence number
+    double m_delayEstimate{0};  //!< Smoothed network delay, s
+    double m_jitterEstimate{0}; //!< Smoothed delay deviation, s
+    bool m_estimating{false};   //!< Delay estimate initialized
+    uint64_t m_played{0};       //!< Packets played in time, whole call
+    double m_mouthToEarSum{0};  //!< Sum of mouth-to-ear delays played, s
+    uint64_t m_window0{0};      //!< Window being collected
+    uint64_t m_windowPlayed{0}; //!< Packets played in that window
+    double m_windowDelaySum{0}; //!< Their mouth-to-ear delays, s
+    double m_lastDelay{0};      //!< Mouth-to-ear delay of the last window with voice, s
+    double m_worstMos{4.5};     //!< Lowest window MOS
+    uint64_t m_degraded{0};     //!< Windows below the threshold
+    bool m_finished{false};     //!< Finish() ran
+};
+
+/**
+ * Closed-loop request/response client with retries.
+ */
+class WanTransactionMonitor
+{
+  public:
+    /**
+     * \param name label for reports, e.g. "HQ->DC"
+     * \param client requesting node
+     * \param server responding node
+     * \param clientAddress client address the server answers to
+     * \param serverAddress server address
+     * \param port UDP port of the server
+     */
+    WanTransactionMonitor(const std::string& name,
+                          Ptr<Node> client,
+                          Ptr<Node> server,
+                          Ipv4Address clientAddress,
+                          Ipv4Address serverAddress,
+                          uint16_t port);
+
+    /**
+     * \param requestSize request bytes (default 300)
+     * \param segments response packets, at most 64 (default 8)
+     * \param segmentSize bytes per response packet (default 1000)
+     */
+    void SetSizes(uint32_t requestSize, uint32_t segments, uint32_t segmentSize);
+
+    /// \param thinkTime pause between a completion and the next request (default 200ms)
+    void SetThinkTime(Time thinkTime);
+
+    /**
+     * \param timeout first retry timeout, doubled on every retry (default 1s)
+     * \param attempts sends of a request before it is abandoned (default 5)
+     */
+    void SetRetries(Time timeout, uint32_t attempts);
+
+    /// \param threshold completion time budget of the SLA (default 500ms)
+    void SetSlaThreshold(Time threshold);
+
+    /// \param dscp DSCP of requests and responses (default 0, best effort)
+    void SetDscp(uint8_t dscp);
+
+    /// Issue transactions from start until stop
+    void Start(Time start, Time stop);
+
+    /// Issue no transactions after an earlier stop
+    void Truncate(Time stop);
+
+    /**
+     * A node failed or came back. A failed client abandons its transaction
+     * in progress and a failed server its socket; both resume once the node
+     * is up.
+     * \param node the node
+     * \param up false when it fails, true once it has rebooted
+     */
+    void SetNodeState(Ptr<Node> node, bool up);
+
+    /// \return the report label
+    const std::string& GetName() const;
+
+    /// \return transactions completed
+    uint32_t GetCompleted() const;
+
+    /// \return transactions abandoned after the last retry
+    uint32_t GetFailed() const;
+
+    /// \return completed transactions slower than the SLA threshold
+    uint32_t GetSlaBreaches() const;
+
+    /// \return the mean completion time
+    Time GetMeanCompletionTime() const;
+
+    /// \return the 95th percentile of the completion time (streaming estimate)
+    Time GetP95CompletionTime() const;
+
+    /// \return the highest completion time
+    Time GetMaxCompletionTime() const;
+
+  private:
+    /// Open the sockets and issue the first transaction
+    void Open();
+
+    /// Open the server socket
+    void OpenServer();
+
+    /// Open the client socket and issue a transaction
+    void OpenClient();
+
+    /// Issue a new transaction
+    void Issue();
+
+    /// Send the request of the current transaction
+    void SendRequest();
+
+    /// Retry timeout of the current transaction
+    void Timeout();
+
+    /// Server receive callback: answer with the response segments
+    void ServerReceive(Ptr<Socket> socket);
+
+    /// Client receive callback: collect the response segments
+    void ClientReceive(Ptr<Socket> socket);
+
+    /// Schedule the next transaction after the think time
+    void Next();
+
+    std::string m_name;            //!< Report label
+    Ptr<Node> m_client;            //!< Requesting node
+    Ptr<Node> m_server;            //!< Responding node
+    Ipv4Address m_clientAddress;   //!< Client source address
+    Ipv4Address m_serverAddress;   //!< Server address
+    uint16_t m_port;               //!< Server port
+    uint32_t m_requestSize{300};   //!< Request bytes
+    uint32_t m_segments{8};        //!< Response packets
+    uint32_t m_segmentSize{1000};  //!< Bytes per response packet
+    Time m_thinkTime;              //!< Pause between transactions
+    Time m_timeout;                //!< First retry timeout
+    uint32_t m_attempts{5};        //!< Sends before abandoning
+    Time m_slaThreshold;           //!< Completion time budget
+    uint8_t m_dscp{0};             //!< DSCP of requests and responses
+    Time m_stop;                   //!< No new transactions after this
+    Ptr<Socket> m_clientSocket;    //!< Client socket
+    Ptr<Socket> m_serverSocket;    //!< Server socket
+    EventId m_timeoutEvent;        //!< Retry timeout
+    EventId m_nextEvent;           //!< Next transaction after the think time
+    bool m_opened{false};          //!< Open() ran
+    uint32_t m_id{0};              //!< Current transaction
+    bool m_open{false};            //!< Current transaction in progress
+    Time m_issued;                 //!< Current transaction's first send
+    uint32_t m_attempt{0};         //!< Sends of the current request
+    uint64_t m_received{0};        //!< Bitmask of received response segments
+    uint32_t m_completed{0};       //!< Transactions completed
+    uint32_t m_failed{0};          //!< Transactions abandoned
+    uint32_t m_breaches{0};        //!< Completed over the threshold
+    Time m_completionSum;          //!< Sum of completion times
+    Time m_maxCompletion;          //!< Highest completion time
+    WanP2Quantile m_p95Completion; //!< 95th percentile, in seconds
+};
+
+/**
+ * Constant-bitrate stream into a playback buffer.
+ */
+class WanStreamingMonitor
+{
+  public:
+    /**
+     * \param name label for reports, e.g. "DC->HQ"
+     * \param server streaming node
+     * \param client playing node
+     * \param clientAddress address of the client to send to
+     * \param port UDP port of the client
+     */
+    WanStreamingMonitor(const std::string& name,
+                        Ptr<Node> server,
+                        Ptr<Node> client,
+                        Ipv4Address clientAddress,
+                        uint16_t port);
+
+    /**
+     * \param bitrate media bitrate (default 1Mbps)
+     * \param packetSize bytes per packet (default 1200)
+     */
+    void SetStream(DataRate bitrate, uint32_t packetSize);
+
+    /**
+     * \param startup media buffered before playback starts (default 2s)
+     * \param resume media buffered before playback resumes after a stall (default 1s)
+     */
+    void SetBuffer(Time startup, Time resume);
+
+    /// \param dscp DSCP of the media packets (default 0, best effort)
+    void SetDscp(uint8_t dscp);
+
+    /// Stream from start until stop
+    void Start(Time start, Time stop);
+
+    /// End the stream early, at a stop that has not passed yet
+    void Truncate(Time stop);
+
+    /**
+     * A node failed or came back. A failed server stops streaming; a failed
+     * client loses its buffer, which stalls playback. Both resume once the
+     * node is up.
+     * \param node the node
+     * \param up false when it fails, true once it has rebooted
+     */
+    void SetNodeState(Ptr<Node> node, bool up);
+
+    /// \return the report label
+    const std::string& GetName() const;
+
+    /// \return the time from start until playback began, or until stop if it never did
+    Time GetStartupDelay() const;
+
+    /// \return the number of stalls after playback began
+    uint32_t GetRebufferEvents() const;
+
+    /// \return the total stall time after playback began
+    Time GetRebufferTime() const;
+
+    /// \return stall time over the time since playback began
+    double GetRebufferRatio() const;
+
+    /// \return the media duration of lost packets
+    Time GetLostMedia() const;
+
+  private:
+    enum State
+    {
+        BUFFERING, //!< Before playback starts
+        PLAYING,   //!< Playing from the buffer
+        STALLED,   //!< Buffer ran dry, refilling
+    };
+
+    /// Open the sockets and send the first packet
+    void Open();
+
+    /// Open the client socket
+    void OpenClient();
+
+    /// Open the server socket and send a packet
+    void OpenServer();
+
+    /// Send one packet and schedule the next
+    void Send();
+
+    /// Client receive callback
+    void Receive(Ptr<Socket> socket);
+
+    /// Drain the buffer by playback up to now, noting a stall
+    void Play(Time now);
+
+    /// Close the accounting at stop
+    void Finish();
+
+    std::string m_name;          //!< Report label
+    Ptr<Node> m_server;          //!< Streaming node
+    Ptr<Node> m_client;          //!< Playing node
+    Ipv4Address m_clientAddress; //!< Destination address
+    uint16_t m_port;             //!< Destination port
+    DataRate m_bitrate;          //!< Media bitrate
+    uint32_t m_packetSize{1200}; //!< Bytes per packet
+    Time m_startupBuffer;        //!< Buffer before playback starts
+    Time m_resumeBuffer;         //!< Buffer before playback resumes
+    uint8_t m_dscp{0};           //!< DSCP of the media packets
+    Time m_start;                //!< First packet
+    Time m_stop;                 //!< End of the stream
+    Ptr<Socket> m_sendSocket;    //!< Server socket
+    Ptr<Socket> m_recvSocket;    //!< Client socket
+    EventId m_sendEvent;         //!< Next packet
+    EventId m_finishEvent;       //!< End of the stream accounting
+    bool m_opened{false};        //!< Open() ran
+    uint32_t m_sent{0};          //!< Packets sent
+    uint32_t m_received{0};      //!< Packets received
+    State m_state{BUFFERING};    //!< Player state
+    Time m_level;                //!< Buffered media as of m_updated
+    Time m_updated;              //!< Time of m_level
+    Time m_playStart;            //!< Playback began
+    Time m_stallStart;           //!< Current stall began
+    uint32_t m_stalls{0};        //!< Stalls after playback began
+    Time m_stalled;              //!< Closed stall time
+    bool m_finished{false};      //!< Finish() ran
+};
+
+} // namespace ns3
+
+#endif /* WAN_APP_MONITOR_H */
@@ -0,0 +1,289 @@
+/*
+ * Availability of site pairs under random circuit failures
+ */
+
+#include "wan-availability.h"
+
+#include "wan-replication.h"
+
+#include "ns3/abort.h"
+#include "ns3/log.h"
+#include "ns3/random-variable-stream.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("WanAvailability");
+
+WanAvailabilityEstimator::WanAvailabilityEstimator(const WanTopology& topology)
+    : m_topology(topology),
+      m_graph(topology)
+{
+}
+
+void
+WanAvailabilityEstimator::SetDefaultReliability(Time mtbf, Time mttr)
+{
+    NS_ABORT_MSG_UNLESS(mtbf.IsStrictlyPositive() && mttr.IsStrictlyPositive(),
+                        "MTBF and MTTR must be positive");
+    m_defaultMtbf = mtbf;
+    m_defaultMttr = mttr;
+}
+
+void
+WanAvailabilityEstimator::SetMethod(Method method)
+{
+    m_method = method;
+}
+
+void
+WanAvailabilityEstimator::SetBias(double bias)
+{
+    NS_ABORT_MSG_IF(bias < 0 || bias >= 1, "Failure bias must be in [0, 1)");
+    m_bias = bias;
+}
+
+void
+WanAvailabilityEstimator::SetConfidence(double confidence)
+{
+    NS_ABORT_MSG_IF(confidence <= 0 || confidence >= 1, "Confidence must be in (0, 1)");
+    m_confidence = confidence;
+}
+
+void
+WanAvailabilityEstimator::SetPairs(const std::string& pairs)
+{
+    m_pairs.clear();
+    if (pairs.empty())
+    {
+        for (uint32_t a = 0; a < m_topology.GetNSites(); ++a)
+        {
+            for (uint32_t b = a + 1; b < m_topology.GetNSites(); ++b)
+            {
+                m_pairs.emplace_back(a, b);
+            }
+        }
+        return;
+    }
+    std::istringstream in(pairs);
+    std::string pair;
+    while (std::getline(in, pair, ','))
+    {
+        // Site names may contain '-': try every split until both halves are sites
+        int64_t a = -1;
+        int64_t b = -1;
+        for (size_t dash = pair.find('-'); dash != std::string::npos && (a < 0 || b < 0);
+             dash = pair.find('-', dash + 1))
+        {
+            a = m_topology.FindSite(pair.substr(0, dash));
+            b = m_topology.FindSite(pair.substr(dash + 1));
+        }
+        NS_ABORT_MSG_IF(a < 0 || b < 0 || a == b, "Bad site pair '" << pair << "'");
+        m_pairs.emplace_back(a, b);
+    }
+}
+
+uint32_t
+WanAvailabilityEstimator::Find(uint32_t site)
+{
+    // Path halving
+    while (m_parent[site] != site)
+    {
+        m_parent[site] = m_parent[m_parent[site]];
+        site = m_parent[site];
+    }
+    return site;
+}
+
+void
+WanAvailabilityEstimator::Run(uint64_t samples)
+{
+    NS_ABORT_MSG_IF(samples < 2, "A failure campaign needs at least two samples");
+    const uint32_t nSites = m_topology.GetNSites();
+    const uint32_t nLinks = m_topology.GetNLinks();
+    NS_ABORT_MSG_IF(nLinks == 0, "A failure campaign needs circuits");
+
+    // Down probabilities, real and sampled, and the log likelihood ratio of
+    // a circuit drawn down or up
+    std::vector<double> q(nLinks);
+    std::vector<double> sampled(nLinks);
+    std::vector<double> logDown(nLinks);
+    std::vector<double> logUp(nLinks);
+    std::vector<uint32_t> degree(nSites, 0);
+    for (uint32_t l = 0; l < nLinks; ++l)
+    {
+        const WanLink& link = m_topology.GetLink(l);
+        Time mtbf = link.mtbf.IsStrictlyPositive() ? link.mtbf : m_defaultMtbf;
+        Time mttr = link.mttr.IsStrictlyPositive() ? link.mttr : m_defaultMttr;
+        q[l] = mttr.GetSeconds() / (mtbf + mttr).GetSeconds();
+        ++degree[link.a];
+        ++degree[link.b];
+    }
+    m_sampleBias = 0;
+    if (m_method == IMPORTANCE_SAMPLING)
+    {
+        m_sampleBias = m_bias;
+        if (m_sampleBias == 0)
+        {
+            // As many circuits down on average as the smallest cut around a
+            // monitored site (or any site, for the partition)
+            uint32_t cut = *std::min_element(degree.begin(), degree.end());
+            for (const auto& [a, b] : m_pairs)
+            {
+                cut = std::min({cut, degree[a], degree[b]});
+            }
+            m_sampleBias = std::min(0.5, static_cast<double>(std::max(1U, cut)) / nLinks);
+        }
+    }
+    for (uint32_t l = 0; l < nLinks; ++l)
+    {
+        sampled[l] = std::max(q[l], m_sampleBias);
+        logDown[l] = std::log(q[l] / sampled[l]);
+        logUp[l] = std::log((1 - q[l]) / (1 - sampled[l]));
+    }
+
+    // Welford's update of the weighted indicator per pair and the partition
+    struct Moments
+    {
+        double mean{0};
+        double m2{0};
+    };
+
+    std::vector<Moments> moments(m_pairs.size() + 1);
+    auto add = [](Moments& m, uint64_t n, double x) {
+        double delta = x - m.mean;
+        m.mean += delta / n;
+        m.m2 += delta * (x - m.mean);
+    };
+    Ptr<UniformRandomVariable> uniform = CreateObject<UniformRandomVariable>();
+    m_parent.resize(nSites);
+    for (uint64_t n = 1; n <= samples; ++n)
+    {
+        for (uint32_t s = 0; s < nSites; ++s)
+        {
+            m_parent[s] = s;
+        }
+        double logWeight = 0;
+        uint32_t components = nSites;
+        for (uint32_t l = 0; l < nLinks; ++l)
+        {
+            if (uniform->GetValue() < sampled[l])
+            {
+                logWeight += logDown[l];
+                continue;
+            }
+            logWeight += logUp[l];
+            uint32_t a = Find(m_graph.GetLinkEnd(l, 0));
+            uint32_t b = Find(m_graph.GetLinkEnd(l, 1));
+            if (a != b)
+            {
+                m_parent[a] = b;
+                --components;
+            }
+        }
+        double weight = std::exp(logWeight);
+        for (uint32_t p = 0; p < m_pairs.size(); ++p)
+        {
+            bool cut = Find(m_pairs[p].first) != Find(m_pairs[p].second);
+            add(moments[p], n, cut ? weight : 0.0);
+        }
+        add(moments.back(), n, components > 1 ? weight : 0.0);
+    }
+    m_samples = samples;
+
+    double t = WanReplicationManager::StudentTQuantile((1 + m_confidence) / 2, samples - 1);
+    m_estimates.clear();
+    for (uint32_t p = 0; p <= m_pairs.size(); ++p)
+    {
+        Estimate estimate;
+        estimate.name = p < m_pairs.size() ? m_topology.GetSite(m_pairs[p].first).name + "-" +
+                                                 m_topology.GetSite(m_pairs[p].second).name
+                                           : "partition";
+        double variance = moments[p].m2 / (samples - 1);
+        estimate.unavailability = moments[p].mean;
+        estimate.halfWidth = t * std::sqrt(variance / samples);
+        // A plain sample has the Bernoulli variance u(1 - u)
+        double u = estimate.unavailability;
+        estimate.plainSamples = variance > 0 ? samples * u * (1 - u) / variance : 0.0;
+        m_estimates.push_back(estimate);
+    }
+    NS_LOG_INFO(samples << " samples, bias " << m_sampleBias);
+}
+
+const std::vector<WanAvailabilityEstimator::Estimate>&
+WanAvailabilityEstimator::GetEstimates() const
+{
+    return m_estimates;
+}
+
+void
+WanAvailabilityEstimator::AddMetrics(WanMetrics& metrics) const
+{
+    for (const Estimate& estimate : m_estimates)
+    {
+        const std::string name = "availability." + estimate.name;
+        metrics.Set(name + ".unavailability", estimate.unavailability);
+        metrics.Set(name + ".halfwidth", estimate.halfWidth);
+    }
+}
+
+void
+WanAvailabilityEstimator::Print(std::ostream& os) const
+{
+    const double minutesPerYear = 365.25 * 24 * 60;
+    os << "\n========================================" << std::endl;
+    os << "Availability (" << m_samples << " samples, ";
+    if (m_method == MONTE_CARLO)
+    {
+        os << "plain Monte Carlo";
+    }
+    else
+    {
+        os << "importance sampling, bias " << m_sampleBias;
+    }
+    os << ", " << m_confidence * 100 << "% confidence)" << std::endl;
+    os << "========================================" << std::endl;
+    std::ios::fmtflags flags = os.flags();
+    std::streamsize precision = os.precision();
+    os << std::left << std::setw(24) << "pair" << std::right << std::setw(14) << "availability"
+       << std::setw(14) << "unavail." << std::setw(12) << "+/-" << std::setw(12) << "min/year"
+       << std::setw(12) << "speedup" << std::endl;
+    for (const Estimate& estimate : m_estimates)
+    {
+        os << std::left << std::setw(24) << estimate.name << std::right << std::fixed
+           << std::setprecision(7) << std::setw(14) << 1 - estimate.unavailability
+           << std::scientific << std::setprecision(3) << std::setw(14)
+           << estimate.unavailability << std::setw(12) << estimate.halfWidth << std::fixed
+           << std::setprecision(2) << std::setw(12) << estimate.unavailability * minutesPerYear
+           << std::setprecision(1) << std::setw(11) << estimate.plainSamples / m_samples << "x"
+           << std::endl;
+    }
+    os.flags(flags);
+    os.precision(precision);
+    os << "Speedup: plain Monte Carlo samples for the same interval, per sample drawn"
+       << std::endl;
+    os << "========================================" << std::endl;
+}
+
+bool
+WanAvailabilityEstimator::ParseMethod(const std::string& text, Method& method)
+{
+    if (text == "is")
+    {
+        method = IMPORTANCE_SAMPLING;
+        return true;
+    }
+    if (text == "mc")
+    {
+        method = MONTE_CARLO;
+        return true;
+    }
+    return false;
+}
+
+} // namespace ns3
@@ -0,0 +1,135 @@
+/*
+ * Availability of site pairs under random circuit failures
+ *
+ * Every circuit alternates between up (exponential, mean MTBF) and down
+ * (mean MTTR). At a random instant it is down with probability
+ * q = MTTR / (MTBF + MTTR), independently of the others, so the steady-state
+ * unavailability of a site pair is the probability that the circuits that
+ * are up do not connect it. A failure campaign samples circuit states and
+ * estimates that probability; routing is assumed to use any surviving path
+ * (failover or redundancy, see wan-link-monitor.h and wan-redundancy.h).
+ *
+ * With five nines the interesting states need several circuits down at
+ * once, and plain Monte Carlo sees almost none of them. Importance sampling
+ * draws every circuit down with a biased probability q' >= q instead and
+ * weights each sample by its likelihood ratio
+ *
+ *   w = prod (q / q')^down ((1 - q) / (1 - q'))^up
+ *
+ * which keeps the estimate unbiased. By default q' is the smallest cut
+ * around a monitored site (its degree) over the number of circuits, so a
+ * typical sample has about as many circuits down as it takes to cut a pair
+ * off. The report gives the number of plain Monte Carlo samples that would
+ * reach the same confidence interval.
+ */
+
+#ifndef WAN_AVAILABILITY_H
+#define WAN_AVAILABILITY_H
+
+#include "wan-graph.h"
+#include "wan-metrics.h"
+#include "wan-topology.h"
+
+#include "ns3/nstime.h"
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Failure campaign: steady-state unavailability of site pairs.
+ */
+class WanAvailabilityEstimator
+{
+  public:
+    /// How circuit states are drawn
+    enum Method
+    {
+        MONTE_CARLO,         //!< With the real failure probabilities
+        IMPORTANCE_SAMPLING, //!< With biased ones, reweighted
+    };
+
+    /// Estimate of one site pair (or of a partition of the network)
+    struct Estimate
+    {
+        std::string name;      //!< "A-B", or "partition"
+        double unavailability; //!< Estimated probability of no path
+        double halfWidth;      //!< Confidence interval half-width
+        double plainSamples;   //!< Plain Monte Carlo samples for the same interval
+    };
+
+    /// \param topology circuits with their MTBF and MTTR
+    explicit WanAvailabilityEstimator(const WanTopology& topology);
+
+    /**
+     * Reliability of circuits without an MTBF or MTTR of their own. Each
+     * default applies on its own: a circuit with only an MTBF gets the
+     * default MTTR.
+     * \param mtbf mean time between failures
+     * \param mttr mean time to repair
+     */
+    void SetDefaultReliability(Time mtbf, Time mttr);
+
+    /// \param method sampling method (default IMPORTANCE_SAMPLING)
+    void SetMethod(Method method);
+
+    /**
+     * \param bias down probability of the biased draws; 0 picks it from
+     *        the smallest cut (default)
+     */
+    void SetBias(double bias);
+
+    /// \param confidence confidence level of the intervals (default 0.95)
+    void SetConfidence(double confidence);
+
+    /**
+     * Monitor site pairs.
+     * \param pairs comma separated "SiteA-SiteB" entries; empty for every
+     *        pair of sites
+     */
+    void SetPairs(const std::string& pairs);
+
+    /**
+     * Run the campaign with the current RngRun.
+     * \param samples circuit states to draw
+     */
+    void Run(uint64_t samples);
+
+    /// \return the estimates of the monitored pairs, then "partition"
+    const std::vector<Estimate>& GetEstimates() const;
+
+    /// Add availability.<name>.unavailability and .halfwidth per estimate
+    void AddMetrics(WanMetrics& metrics) const;
+
+    /// Print the estimates as availability and downtime per year
+    void Print(std::ostream& os) const;
+
+    /// Parse "is" or "mc"
+    static bool ParseMethod(const std::string& text, Method& method);
+
+  private:
+    /// \return the representative of a site in the union-find forest
+    uint32_t Find(uint32_t site);
+
+    const WanTopology& m_topology;                      //!< Sites and circuits
+    WanGraph m_graph;                                   //!< Circuit ends, flat
+    Time m_defaultMtbf{Hours(4380)};                    //!< MTBF of circuits without one
+    Time m_defaultMttr{Hours(4)};                       //!< MTTR of circuits without one
+    Method m_method{IMPORTANCE_SAMPLING};               //!< Sampling method
+    double m_bias{0};                                   //!< Biased down probability, 0: auto
+    double m_confidence{0.95};                          //!< Confidence level
+    std::vector<std::pair<uint32_t, uint32_t>> m_pairs; //!< Monitored site pairs
+    std::vector<uint32_t> m_parent;                     //!< Union-find forest of one sample
+    uint64_t m_samples{0};                              //!< Samples of the last run
+    double m_sampleBias{0};                             //!< Bias used by the last run
+    std::vector<Estimate> m_estimates;                  //!< Results of the last run
+};
+
+} // namespace ns3
+
+#endif /* WAN_AVAILABILITY_H */
@@ -0,0 +1,209 @@
+/*
+ * Streaming reader for the CSV inputs of the scenario
+ */
+
+#include "wan-csv-reader.h"
+
+#include "ns3/abort.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+
+namespace ns3
+{
+
+WanCsvReader::WanCsvReader(std::istream& in, const std::string& what)
+    : m_in(in),
+      m_what(what)
+{
+}
+
+bool
+WanCsvReader::ReadHeader()
+{
+    if (!Next())
+    {
+        return false;
+    }
+    m_header.clear();
+    for (const auto& field : m_fields)
+    {
+        m_header.push_back(ToLower(field));
+    }
+    return true;
+}
+
+int
+WanCsvReader::FindColumn(std::initializer_list<const char*> names) const
+{
+    for (const char* name : names)
+    {
+        auto it = std::find(m_header.begin(), m_header.end(), name);
+        if (it != m_header.end())
+        {
+            return it - m_header.begin();
+        }
+    }
+    return -1;
+}
+
+int
+WanCsvReader::RequireColumn(std::initializer_list<const char*> names) const
+{
+    int column = FindColumn(names);
+    NS_ABORT_MSG_IF(column < 0, m_what << ": header needs a '" << *names.begin() << "' column");
+    return column;
+}
+
+int
+WanCsvReader::GetNColumns() const
+{
+    return m_header.size();
+}
+
+const std::string&
+WanCsvReader::GetColumnName(int column) const
+{
+    return m_header.at(column);
+}
+
+bool
+WanCsvReader::Next()
+{
+    while (std::getline(m_in, m_line))
+    {
+        ++m_lineNumber;
+        size_t first = m_line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || m_line[first] == '#')
+        {
+            continue;
+        }
+        Split();
+        return true;
+    }
+    return false;
+}
+
+const std::string&
+WanCsvReader::Get(int column) const
+{
+    static const std::string empty;
+    if (column < 0 || static_cast<size_t>(column) >= m_fields.size())
+    {
+        return empty;
+    }
+    return m_fields[column];
+}
+
+uint64_t
+WanCsvReader::GetLineNumber() const
+{
+    return m_lineNumber;
+}
+
+const std::string&
+WanCsvReader::GetDescription() const
+{
+    return m_what;
+}
+
+void
+WanCsvReader::Split()
+{
+    // Double-quoted fields may contain commas
+    m_fields.clear();
+    std::string field;
+    bool quoted = false;
+    for (char c : m_line)
+    {
+        if (c == '"')
+        {
+            quoted = !quoted;
+        }
+        else if (c == ',' && !quoted)
+        {
+            m_fields.push_back(Trim(field));
+            field.clear();
+        }
+        else
+        {
+            field.push_back(c);
+        }
+    }
+    m_fields.push_back(Trim(field));
+}
+
+std::string
+WanCsvReader::Trim(const std::string& s)
+{
+    size_t begin = s.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos)
+    {
+        return "";
+    }
+    size_t end = s.find_last_not_of(" \t\r\n");
+    return s.substr(begin, end - begin + 1);
+}
+
+std::string
+WanCsvReader::ToLower(std::string s)
+{
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) {
+        return std::tolower(c);
+    });
+    return s;
+}
+
+bool
+WanCsvReader::ParseNumber(const std::string& s, double& value)
+{
+    if (s.empty())
+    {
+        return false;
+    }
+    char* end = nullptr;
+    value = std::strtod(s.c_str(), &end);
+    return end == s.c_str() + s.size();
+}
+
+bool
+WanCsvReader::ParseFraction(const std::string& s, double& value)
+{
+    if (!s.empty() && s.back() == '%')
+    {
+        if (!ParseNumber(s.substr(0, s.size() - 1), value))
+        {
+            return false;
+        }
+        value /= 100.0;
+        return true;
+    }
+    return ParseNumber(s, value);
+}
+
+DataRate
+WanCsvReader::ParseDataRate(const std::string& s)
+{
+    double bps;
+    if (ParseNumber(s, bps))
+    {
+        NS_ABORT_MSG_IF(bps <= 0, "Invalid data rate " << s);
+        return DataRate(static_cast<uint64_t>(bps));
+    }
+    return DataRate(s);
+}
+
+Time
+WanCsvReader::ParseTime(const std::string& s)
+{
+    double ms;
+    if (ParseNumber(s, ms))
+    {
+        NS_ABORT_MSG_IF(ms < 0, "Invalid duration " << s);
+        return Seconds(ms / 1000.0);
+    }
+    return Time(s);
+}
+
+} // namespace ns3
@@ -0,0 +1,124 @@
+/*
+ * Streaming reader for the CSV inputs of the scenario
+ *
+ * Topologies, circuit profiles and the other tabular inputs share one
+ * format: '#' comments, blank lines ignored, a header row naming the
+ * columns, then one record per line. Columns are looked up by name so
+ * files may carry extra columns in any order.
+ */
+
+#ifndef WAN_CSV_READER_H
+#define WAN_CSV_READER_H
+
+#include "ns3/data-rate.h"
+#include "ns3/nstime.h"
+
+#include <cstdint>
+#include <initializer_list>
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Reads a header row and then one record at a time.
+ */
+class WanCsvReader
+{
+  public:
+    /**
+     * \param in input stream
+     * \param what description of the input for error messages
+     */
+    WanCsvReader(std::istream& in, const std::string& what);
+
+    /**
+     * Read the header row.
+     * \return false if the input holds no header
+     */
+    bool ReadHeader();
+
+    /**
+     * \param names accepted (lower case) names of the column
+     * \return the index of the first column matching one of the names, or -1
+     */
+    int FindColumn(std::initializer_list<const char*> names) const;
+
+    /**
+     * Like FindColumn, but aborts if the column is missing.
+     */
+    int RequireColumn(std::initializer_list<const char*> names) const;
+
+    /// \return the number of header columns
+    int GetNColumns() const;
+
+    /// \return the lower-case name of a header column
+    const std::string& GetColumnName(int column) const;
+
+    /**
+     * Advance to the next record.
+     * \return false at end of input
+     */
+    bool Next();
+
+    /**
+     * \param column column index from FindColumn
+     * \return the field of the current record, or "" if absent
+     */
+    const std::string& Get(int column) const;
+
+    /// \return the line number of the current record
+    uint64_t GetLineNumber() const;
+
+    /// \return the description given at construction, for error messages
+    const std::string& GetDescription() const;
+
+    /// \return s without leading and trailing white space
+    static std::string Trim(const std::string& s);
+
+    /// \return s in lower case
+    static std::string ToLower(std::string s);
+
+    /**
+     * \param s text
+     * \param value parsed number
+     * \return true if the whole (non-empty) string is a number
+     */
+    static bool ParseNumber(const std::string& s, double& value);
+
+    /**
+     * \param s a fraction ("0.005") or a percentage ("0.5%")
+     * \param value parsed fraction
+     * \return true if s is a number or a percentage
+     */
+    static bool ParseFraction(const std::string& s, double& value);
+
+    /**
+     * Parse a rate: plain numbers are bits per second, anything else is an
+     * ns-3 DataRate string such as "100Mbps".
+     */
+    static DataRate ParseDataRate(const std::string& s);
+
+    /**
+     * Parse a duration: plain numbers are milliseconds, anything else is an
+     * ns-3 Time string such as "25ms".
+     */
+    static Time ParseTime(const std::string& s);
+
+  private:
+    /// Split m_line into m_fields
+    void Split();
+
+    std::istream& m_in;                //!< Input
+    std::string m_what;                //!< Description for error messages
+    std::string m_line;                //!< Current line
+    std::vector<std::string> m_fields; //!< Fields of the current line
+    std::vector<std::string> m_header; //!< Lower-case column names
+    uint64_t m_lineNumber{0};          //!< Current line number
+};
+
+} // namespace ns3
+
+#endif /* WAN_CSV_READER_H */
@@ -0,0 +1,388 @@
+/*
+ * Bulk-loaded forwarding table: one contiguous array per router
+ */
+
+#include "wan-fib-routing.h"
+
+#include "wan-hash.h"
+#include "wan-route-cache.h"
+
+#include "ns3/abort.h"
+#include "ns3/ipv4-list-routing.h"
+#include "ns3/ipv4-route.h"
+#include "ns3/log.h"
+#include "ns3/node.h"
+#include "ns3/output-stream-wrapper.h"
+#include "ns3/simulator.h"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("WanFibRouting");
+
+NS_OBJECT_ENSURE_REGISTERED(WanFibRouting);
+
+namespace
+{
+
+/// FIB order: longest prefix first, then by network
+bool
+Before(uint32_t lengthA, uint32_t networkA, uint32_t lengthB, uint32_t networkB)
+{
+    return lengthA != lengthB ? lengthA > lengthB : networkA < networkB;
+}
+
+} // namespace
+
+TypeId
+WanFibRouting::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::WanFibRouting")
+                            .SetParent<Ipv4RoutingProtocol>()
+                            .SetGroupName("Internet")
+                            .AddConstructor<WanFibRouting>();
+    return tid;
+}
+
+WanFibRouting::WanFibRouting()
+{
+}
+
+void
+WanFibRouting::Load(const std::vector<Route>& routes)
+{
+    NS_LOG_FUNCTION(this << routes.size());
+    Table table;
+    table.entries.reserve(routes.size());
+    std::vector<uint32_t> gateways;
+    for (const Route& route : routes)
+    {
+        NS_ABORT_MSG_IF(route.interface > std::numeric_limits<uint16_t>::max(),
+                        "FIB route over interface " << route.interface);
+        if (route.interface >= gateways.size())
+        {
+            gateways.resize(route.interface + 1, 0);
+        }
+        uint32_t& gateway = gateways[route.interface];
+        NS_ABORT_MSG_IF(gateway != 0 && gateway != route.gateway.Get(),
+                        "Next hops " << Ipv4Address(gateway) << " and " << route.gateway
+                                     << " on interface " << route.interface);
+        gateway = route.gateway.Get();
+        table.entries.push_back({route.network.CombineMask(route.mask).Get(),
+                                 static_cast<uint16_t>(route.interface),
+                                 static_cast<uint8_t>(route.mask.GetPrefixLength())});
+    }
+    auto before = [](const Entry& a, const Entry& b) {
+        return Before(a.length, a.network, b.length, b.network);
+    };
+    if (!std::is_sorted(table.entries.begin(), table.entries.end(), before))
+    {
+        std::sort(table.entries.begin(), table.entries.end(), before);
+    }
+
+    std::vector<Entry>& entries = table.entries;
+    table.hash = FNV1A_BASIS;
+    for (uint32_t i = 0; i < entries.size(); ++i)
+    {
+        const Entry& entry = entries[i];
+        if (table.groups.empty() || table.groups.back().length != entry.length)
+        {
+            uint32_t mask = entry.length == 0 ? 0 : ~0U << (32 - entry.length);
+            table.groups.push_back({entry.length, mask, i, i});
+        }
+        else
+        {
+            NS_ABORT_MSG_IF(entries[i - 1].network == entry.network,
+                            "Two FIB routes to " << Ipv4Address(entry.network) << "/"
+                                                 << +entry.length);
+        }
+        table.groups.back().end = i + 1;
+        for (uint32_t word : {entry.network, (uint32_t{entry.interface} << 8) | entry.length})
+        {
+            table.hash = Fnv1a(table.hash, word);
+        }
+    }
+
+    m_table = entries.empty() ? nullptr : Intern(std::move(table));
+    m_gateways.swap(gateways);
+    if (m_ipv4)
+    {
+        WanRouteCache::Invalidate(m_ipv4);
+    }
+}
+
+void
+WanFibRouting::Clear()
+{
+    m_table = nullptr;
+    std::vector<uint32_t>().swap(m_gateways);
+    if (m_ipv4)
+    {
+        WanRouteCache::Invalidate(m_ipv4);
+    }
+}
+
+std::vector<WanFibRouting::Route>
+WanFibRouting::GetRoutes() const
+{
+    std::vector<Route> routes;
+    if (!m_table)
+    {
+        return routes;
+    }
+    routes.reserve(m_table->entries.size());
+    for (const Group& group : m_table->groups)
+    {
+        for (uint32_t i = group.begin; i < group.end; ++i)
+        {
+            const Entry& entry = m_table->entries[i];
+            routes.push_back({Ipv4Address(entry.network),
+                              Ipv4Mask(group.mask),
+                              Ipv4Address(m_gateways[entry.interface]),
+                              entry.interface});
+        }
+    }
+    return routes;
+}
+
+uint32_t
+WanFibRouting::GetNRoutes() const
+{
+    return m_table ? m_table->entries.size() : 0;
+}
+
+uint64_t
+WanFibRouting::GetMemoryUsage() const
+{
+    uint64_t bytes = sizeof(*this) + m_gateways.capacity() * sizeof(uint32_t);
+    if (m_table)
+    {
+        bytes += (sizeof(Table) + m_table->entries.capacity() * sizeof(Entry) +
+                  m_table->groups.capacity() * sizeof(Group)) /
+                 m_table.use_count();
+    }
+    return bytes;
+}
+
+uint32_t
+WanFibRouting::GetNSharing() const
+{
+    return m_table.use_count();
+}
+
+WanFibRouting::Pool&
+WanFibRouting::GetPool()
+{
+    static Pool pool;
+    return pool;
+}
+
+std::shared_ptr<const WanFibRouting::Table>
+WanFibRouting::Intern(Table table)
+{
+    Pool& pool = GetPool();
+    auto same = [](const Entry& a, const Entry& b) {
+        return a.network == b.network && a.interface == b.interface && a.length == b.length;
+    };
+    auto range = pool.equal_range(table.hash);
+    for (auto it = range.first; it != range.second;)
+    {
+        std::shared_ptr<const Table> shared = it->second.lock();
+        if (!shared)
+        {
+            // Its last router was cleared or disposed
+            it = pool.erase(it);
+        }
+        else if (std::equal(shared->entries.begin(),
+                            shared->entries.end(),
+                            table.entries.begin(),
+                            table.entries.end(),
+                            same))
+        {
+            return shared;
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    auto shared = std::make_shared<const Table>(std::move(table));
+    pool.emplace(shared->hash, shared);
+    return shared;
+}
+
+uint32_t
+WanFibRouting::GetNTables()
+{
+    Pool& pool = GetPool();
+    for (auto it = pool.begin(); it != pool.end();)
+    {
+        it = it->second.expired() ? pool.erase(it) : std::next(it);
+    }
+    return pool.size();
+}
+
+const WanFibRouting::Entry*
+WanFibRouting::Match(Ipv4Address destination, bool up) const
+{
+    if (!m_table)
+    {
+        return nullptr;
+    }
+    const uint32_t address = destination.Get();
+    const std::vector<Entry>& entries = m_table->entries;
+    auto below = [](const Entry& entry, uint32_t network) { return entry.network < network; };
+    for (const Group& group : m_table->groups)
+    {
+        const uint32_t network = address & group.mask;
+        auto it = std::lower_bound(entries.begin() + group.begin,
+                                   entries.begin() + group.end,
+                                   network,
+                                   below);
+        if (it != entries.begin() + group.end && it->network == network &&
+            (!up || m_ipv4->IsUp(it->interface)))
+        {
+            return &*it;
+        }
+    }
+    return nullptr;
+}
+
+bool
+WanFibRouting::Lookup(Ipv4Address destination, Route& route) const
+{
+    const Entry* entry = Match(destination, false);
+    if (!entry)
+    {
+        return false;
+    }
+    uint32_t mask = entry->length == 0 ? 0 : ~0U << (32 - entry->length);
+    route = {Ipv4Address(entry->network),
+             Ipv4Mask(mask),
+             Ipv4Address(m_gateways[entry->interface]),
+             entry->interface};
+    return true;
+}
+
+Ptr<WanFibRouting>
+WanFibRouting::Find(Ptr<Ipv4> ipv4)
+{
+    Ptr<Ipv4RoutingProtocol> protocol = ipv4->GetRoutingProtocol();
+    Ptr<WanFibRouting> fib = DynamicCast<WanFibRouting>(protocol);
+    if (fib)
+    {
+        return fib;
+    }
+    Ptr<Ipv4ListRouting> list = DynamicCast<Ipv4ListRouting>(protocol);
+    for (uint32_t i = 0; list && i < list->GetNRoutingProtocols(); ++i)
+    {
+        int16_t priority;
+        fib = DynamicCast<WanFibRouting>(list->GetRoutingProtocol(i, priority));
+        if (fib)
+        {
+            return fib;
+        }
+    }
+    return nullptr;
+}
+
+Ptr<Ipv4Route>
+WanFibRouting::MakeRoute(const Entry& entry, Ipv4Address destination) const
+{
+    Ptr<Ipv4Route> route = Create<Ipv4Route>();
+    route->SetDestination(destination);
+    route->SetSource(m_ipv4->GetAddress(entry.interface, 0).GetLocal());
+    route->SetGateway(Ipv4Address(m_gateways[entry.interface]));
+    route->SetOutputDevice(m_ipv4->GetNetDevice(entry.interface));
+    return route;
+}
+
+Ptr<Ipv4Route>
+WanFibRouting::RouteOutput(Ptr<Packet> /* p */,
+                           const Ipv4Header& header,
+                           Ptr<NetDevice> oif,
+                           Socket::SocketErrno& sockerr)
+{
+    const Entry* entry = Match(header.GetDestination(), true);
+    if (!entry || (oif && m_ipv4->GetNetDevice(entry->interface) != oif))
+    {
+        sockerr = Socket::ERROR_NOROUTETOHOST;
+        return nullptr;
+    }
+    sockerr = Socket::ERROR_NOTERROR;
+    return MakeRoute(*entry, header.GetDestination());
+}
+
+bool
+WanFibRouting::RouteInput(Ptr<const Packet> p,
+                          const Ipv4Header& header,
+                          Ptr<const NetDevice> /* idev */,
+                          const UnicastForwardCallback& ucb,
+                          const MulticastForwardCallback& /* mcb */,
+                          const LocalDeliverCallback& /* lcb */,
+                          const ErrorCallback& /* ecb */)
+{
+    // The list routing has already delivered local packets
+    const Entry* entry = Match(header.GetDestination(), true);
+    if (!entry)
+    {
+        return false;
+    }
+    ucb(MakeRoute(*entry, header.GetDestination()), p, header);
+    return true;
+}
+
+void
+WanFibRouting::NotifyInterfaceUp(uint32_t /* interface */)
+{
+}
+
+void
+WanFibRouting::NotifyInterfaceDown(uint32_t /* interface */)
+{
+}
+
+void
+WanFibRouting::NotifyAddAddress(uint32_t /* interface */, Ipv4InterfaceAddress /* address */)
+{
+}
+
+void
+WanFibRouting::NotifyRemoveAddress(uint32_t /* interface */, Ipv4InterfaceAddress /* address */)
+{
+}
+
+void
+WanFibRouting::SetIpv4(Ptr<Ipv4> ipv4)
+{
+    m_ipv4 = ipv4;
+}
+
+void
+WanFibRouting::PrintRoutingTable(Ptr<OutputStreamWrapper> stream, Time::Unit unit) const
+{
+    std::ostream& os = *stream->GetStream();
+    os << "Node: " << m_ipv4->GetObject<Node>()->GetId() << ", Time: " << Simulator::Now().As(unit)
+       << ", WanFibRouting (" << GetNRoutes() << " routes, table shared by " << GetNSharing()
+       << " routers)" << std::endl;
+    for (const Route& route : GetRoutes())
+    {
+        os << "  " << route.network << "/" << route.mask.GetPrefixLength() << " via "
+           << route.gateway << " if" << route.interface
+           << (m_ipv4->IsUp(route.interface) ? "" : " (down)") << std::endl;
+    }
+}
+
+void
+WanFibRouting::DoDispose()
+{
+    m_ipv4 = nullptr;
+    Clear();
+    Ipv4RoutingProtocol::DoDispose();
+}
+
+} // namespace ns3
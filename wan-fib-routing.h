@@ -0,0 +1,186 @@
+/*
+ * Bulk-loaded forwarding table: one contiguous array per router
+ *
+ * Ipv4StaticRouting stores every route as its own heap-allocated
+ * Ipv4RoutingTableEntry in a linked list, and AddNetworkRouteTo adds one at
+ * a time. With tens of thousands of prefixes on thousands of routers that
+ * is hundreds of millions of small allocations, and every lookup walks the
+ * list. A WanFibRouting takes a router's whole FIB in one call: a vector of
+ * (prefix, mask, next hop, interface) is packed into 8-byte entries,
+ * grouped by prefix length (longest first) and sorted by prefix within a
+ * group. A lookup binary-searches each group until one matches.
+ *
+ * Every circuit is point-to-point, so the next hop follows from the
+ * interface: it is kept once per interface, not per entry. What is left,
+ * prefix to interface, is the same on routers in the same position, such as
+ * the spokes of a hub: their tables are interned. A loaded table is
+ * immutable and shared by every router that loads the same entries, so
+ * memory grows with the distinct tables rather than with the routers.
+ * Changing a router's FIB builds and interns a new table; the routers that
+ * shared the old one keep it.
+ *
+ * The FIB sits in the list routing below the static routes, which keep the
+ * connected subnets, and above global routing. Policy routes (see
+ * wan-redundancy.h) come before both. Routes over an interface that is
+ * down are skipped, as if withdrawn; a node failure saves, clears and later
+ * reloads the FIB like the static routes (see wan-node-failure.h).
+ */
+
+#ifndef WAN_FIB_ROUTING_H
+#define WAN_FIB_ROUTING_H
+
+#include "ns3/ipv4-address.h"
+#include "ns3/ipv4-routing-protocol.h"
+#include "ns3/ipv4.h"
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * A router's forwarding table, loaded in bulk.
+ */
+class WanFibRouting : public Ipv4RoutingProtocol
+{
+  public:
+    /// One route as loaded
+    struct Route
+    {
+        Ipv4Address network; //!< Destination network
+        Ipv4Mask mask;       //!< Destination mask
+        Ipv4Address gateway; //!< Next hop
+        uint32_t interface;  //!< Outgoing interface
+    };
+
+    /// Priority in the list routing: below static (0), above global (-10)
+    static const int16_t PRIORITY = -5;
+
+    /// Get the type ID
+    static TypeId GetTypeId();
+
+    WanFibRouting();
+
+    /**
+     * Replace the FIB. Routes sorted by prefix length (longest first), then
+     * network, are packed in one pass; others are sorted first. The table
+     * is shared with any router that loaded the same one.
+     * \param routes the routes; one per destination network and one next
+     *        hop per interface
+     */
+    void Load(const std::vector<Route>& routes);
+
+    /// Remove every route
+    void Clear();
+
+    /// \return the routes, longest prefix first
+    std::vector<Route> GetRoutes() const;
+
+    /// \return the number of routes
+    uint32_t GetNRoutes() const;
+
+    /// \return the bytes the FIB occupies, its table split among the routers sharing it
+    uint64_t GetMemoryUsage() const;
+
+    /// \return the routers sharing this FIB's table, 0 if it is empty
+    uint32_t GetNSharing() const;
+
+    /// \return the distinct tables loaded by the routers of this process
+    static uint32_t GetNTables();
+
+    /**
+     * Longest-prefix match, ignoring interface state.
+     * \param destination the destination address
+     * \param route receives the matching route
+     * \return false if no route matches
+     */
+    bool Lookup(Ipv4Address destination, Route& route) const;
+
+    /**
+     * \param ipv4 a router's IPv4
+     * \return its FIB, or nullptr if it has none
+     */
+    static Ptr<WanFibRouting> Find(Ptr<Ipv4> ipv4);
+
+    // Inherited from Ipv4RoutingProtocol
+    Ptr<Ipv4Route> RouteOutput(Ptr<Packet> p,
+                               const Ipv4Header& header,
+                               Ptr<NetDevice> oif,
+                               Socket::SocketErrno& sockerr) override;
+    bool RouteInput(Ptr<const Packet> p,
+                    const Ipv4Header& header,
+                    Ptr<const NetDevice> idev,
+                    const UnicastForwardCallback& ucb,
+                    const MulticastForwardCallback& mcb,
+                    const LocalDeliverCallback& lcb,
+                    const ErrorCallback& ecb) override;
+    void NotifyInterfaceUp(uint32_t interface) override;
+    void NotifyInterfaceDown(uint32_t interface) override;
+    void NotifyAddAddress(uint32_t interface, Ipv4InterfaceAddress address) override;
+    void NotifyRemoveAddress(uint32_t interface, Ipv4InterfaceAddress address) override;
+    void SetIpv4(Ptr<Ipv4> ipv4) override;
+    void PrintRoutingTable(Ptr<OutputStreamWrapper> stream,
+                           Time::Unit unit = Time::S) const override;
+
+  protected:
+    void DoDispose() override;
+
+  private:
+    /// A packed route; the next hop is that of the interface
+    struct Entry
+    {
+        uint32_t network;   //!< Destination network, host order
+        uint16_t interface; //!< Outgoing interface
+        uint8_t length;     //!< Prefix length
+    };
+
+    /// Entries of one prefix length
+    struct Group
+    {
+        uint32_t length; //!< Prefix length
+        uint32_t mask;   //!< Its mask, host order
+        uint32_t begin;  //!< First entry
+        uint32_t end;    //!< One past the last entry
+    };
+
+    /// An immutable table, shared by the routers that load it
+    struct Table
+    {
+        std::vector<Entry> entries; //!< Entries by prefix length, then network
+        std::vector<Group> groups;  //!< Prefix lengths present, longest first
+        uint64_t hash{0};           //!< Hash of the entries
+    };
+
+    /// Live tables by hash
+    using Pool = std::unordered_multimap<uint64_t, std::weak_ptr<const Table>>;
+
+    /// \return the tables of this process
+    static Pool& GetPool();
+
+    /**
+     * \param table a table just built
+     * \return the live table with the same entries, or the new one
+     */
+    static std::shared_ptr<const Table> Intern(Table table);
+
+    /**
+     * \param destination the destination address
+     * \param up skip routes over interfaces that are down
+     * \return the longest-prefix entry, or nullptr
+     */
+    const Entry* Match(Ipv4Address destination, bool up) const;
+
+    /// \return an ns-3 route over an entry
+    Ptr<Ipv4Route> MakeRoute(const Entry& entry, Ipv4Address destination) const;
+
+    Ptr<Ipv4> m_ipv4;                     //!< IPv4 of the router
+    std::shared_ptr<const Table> m_table; //!< Routes; nullptr if empty
+    std::vector<uint32_t> m_gateways;     //!< Next hop by interface, host order
+};
+
+} // namespace ns3
+
+#endif /* WAN_FIB_ROUTING_H */
@@ -0,0 +1,471 @@
+/*
+ * Router forwarding capacity: per-packet processing cost and input queueing
+ */
+
+#include "wan-forwarding-capacity.h"
+
+#include "wan-csv-reader.h"
+#include "wan-fib-routing.h"
+#include "wan-pbr.h"
+#include "wan-redundancy.h"
+#include "wan-vrf.h"
+
+#include "ns3/abort.h"
+#include "ns3/arp-l3-protocol.h"
+#include "ns3/ipv4-global-routing.h"
+#include "ns3/ipv4-l3-protocol.h"
+#include "ns3/ipv4-list-routing.h"
+#include "ns3/ipv4-static-routing.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/traffic-control-layer.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("WanForwardingCapacity");
+
+NS_OBJECT_ENSURE_REGISTERED(WanForwardingCapacity);
+
+bool
+WanForwardingLimits::IsLimited() const
+{
+    return pps > 0 || bps.GetBitRate() > 0 || crypto.GetBitRate() > 0 || !policy.IsZero();
+}
+
+void
+WanForwardingCapacity::Counters::Add(const Counters& other)
+{
+    received += other.received;
+    processed += other.processed;
+    dropped += other.dropped;
+    peakQueue = std::max(peakQueue, other.peakQueue);
+    busySeconds += other.busySeconds;
+    waitSeconds += other.waitSeconds;
+}
+
+TypeId
+WanForwardingCapacity::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::WanForwardingCapacity")
+                            .SetParent<Object>()
+                            .SetGroupName("Internet")
+                            .AddConstructor<WanForwardingCapacity>();
+    return tid;
+}
+
+WanForwardingCapacity::WanForwardingCapacity()
+{
+}
+
+void
+WanForwardingCapacity::SetLimits(const WanForwardingLimits& limits)
+{
+    m_limits = limits;
+}
+
+const WanForwardingLimits&
+WanForwardingCapacity::GetLimits() const
+{
+    return m_limits;
+}
+
+void
+WanForwardingCapacity::Install(Ptr<Node> node)
+{
+    NS_ABORT_MSG_IF(m_node, "Forwarding capacity installed twice");
+    Ptr<Ipv4L3Protocol> ipv4 = node->GetObject<Ipv4L3Protocol>();
+    NS_ABORT_MSG_UNLESS(ipv4, "Forwarding capacity needs the Internet stack on node "
+                                  << node->GetId());
+    m_node = node;
+    m_ipv4 = ipv4;
+
+    // IPv4 receives through the traffic control layer when there is one
+    Ptr<TrafficControlLayer> tc = node->GetObject<TrafficControlLayer>();
+    if (tc)
+    {
+        m_handler = MakeCallback(&TrafficControlLayer::Receive, tc);
+    }
+    else
+    {
+        m_handler = MakeCallback(&Ipv4L3Protocol::Receive, ipv4);
+    }
+    node->UnregisterProtocolHandler(m_handler);
+    for (uint32_t i = 0; i < node->GetNDevices(); ++i)
+    {
+        Ptr<NetDevice> device = node->GetDevice(i);
+        int32_t interface = ipv4->GetInterfaceForDevice(device);
+        if (interface < 0)
+        {
+            continue;
+        }
+        // The loopback is not an input of the processor
+        if (interface == 0)
+        {
+            node->RegisterProtocolHandler(m_handler, Ipv4L3Protocol::PROT_NUMBER, device);
+        }
+        else
+        {
+            node->RegisterProtocolHandler(MakeCallback(&WanForwardingCapacity::Receive, this),
+                                          Ipv4L3Protocol::PROT_NUMBER,
+                                          device);
+        }
+        if (device->NeedsArp())
+        {
+            node->RegisterProtocolHandler(m_handler, ArpL3Protocol::PROT_NUMBER, device);
+        }
+    }
+}
+
+const WanForwardingCapacity::Counters&
+WanForwardingCapacity::GetCounters() const
+{
+    return m_counters;
+}
+
+void
+WanForwardingCapacity::Receive(Ptr<NetDevice> device,
+                               Ptr<const Packet> packet,
+                               uint16_t protocol,
+                               const Address& from,
+                               const Address& to,
+                               NetDevice::PacketType type)
+{
+    // A down interface drops the packet in IPv4 without costing anything
+    int32_t interface = m_ipv4->GetInterfaceForDevice(device);
+    if (interface < 0 || !m_ipv4->IsUp(interface))
+    {
+        m_handler(device, packet, protocol, from, to, type);
+        return;
+    }
+    ++m_counters.received;
+    // An idle processor takes the packet at once; the limit is on waiting ones
+    uint32_t waiting = m_queue.size() - (m_busy ? 1 : 0);
+    if (m_busy && waiting >= m_limits.queue)
+    {
+        NS_LOG_LOGIC("Node " << m_node->GetId() << ": input queue full, packet dropped");
+        ++m_counters.dropped;
+        return;
+    }
+    m_queue.push_back({device, packet, protocol, from, to, type, Simulator::Now()});
+    if (!m_busy)
+    {
+        Serve();
+        return;
+    }
+    m_counters.peakQueue = std::max(m_counters.peakQueue, waiting + 1);
+}
+
+void
+WanForwardingCapacity::Serve()
+{
+    m_busy = true;
+    const Pending& head = m_queue.front();
+    Time cost = GetCost(head.packet);
+    m_counters.waitSeconds += (Simulator::Now() - head.arrival).GetSeconds();
+    m_counters.busySeconds += cost.GetSeconds();
+    m_event = Simulator::Schedule(cost, &WanForwardingCapacity::Done, this);
+}
+
+void
+WanForwardingCapacity::Done()
+{
+    Pending head = std::move(m_queue.front());
+    m_queue.pop_front();
+    m_busy = false;
+    ++m_counters.processed;
+    m_handler(head.device, head.packet, head.protocol, head.from, head.to, head.type);
+    if (!m_busy && !m_queue.empty())
+    {
+        Serve();
+    }
+}
+
+Time
+WanForwardingCapacity::GetCost(Ptr<const Packet> packet)
+{
+    const double bits = packet->GetSize() * 8.0;
+    double seconds = 0;
+    if (m_limits.pps > 0)
+    {
+        seconds += 1.0 / m_limits.pps;
+    }
+    if (m_limits.bps.GetBitRate() > 0)
+    {
+        seconds += bits / m_limits.bps.GetBitRate();
+    }
+    if (m_limits.crypto.GetBitRate() > 0)
+    {
+        seconds += bits / m_limits.crypto.GetBitRate();
+    }
+    Time cost = Seconds(seconds);
+    if (!m_limits.policy.IsZero())
+    {
+        // Routing protocols are all added before the first packet arrives
+        if (m_policy < 0)
+        {
+            m_policy = HasPolicy() ? 1 : 0;
+        }
+        if (m_policy)
+        {
+            cost += m_limits.policy;
+        }
+    }
+    return cost;
+}
+
+bool
+WanForwardingCapacity::HasPolicy() const
+{
+    Ptr<Ipv4ListRouting> list = DynamicCast<Ipv4ListRouting>(m_ipv4->GetRoutingProtocol());
+    for (uint32_t i = 0; list && i < list->GetNRoutingProtocols(); ++i)
+    {
+        int16_t priority;
+        Ptr<Ipv4RoutingProtocol> protocol = list->GetRoutingProtocol(i, priority);
+        // The policy protocols are installed on every router, so count
+        // them only where they have something to do
+        if (Ptr<WanVrfRouting> vrf = DynamicCast<WanVrfRouting>(protocol))
+        {
+            if (vrf->HasBindings())
+            {
+                return true;
+            }
+        }
+        else if (Ptr<WanPbrRouting> pbr = DynamicCast<WanPbrRouting>(protocol))
+        {
+            if (pbr->GetNRules() > 0)
+            {
+                return true;
+            }
+        }
+        else if (Ptr<WanPolicyRouting> policy = DynamicCast<WanPolicyRouting>(protocol))
+        {
+            if (policy->GetNRoutes() > 0)
+            {
+                return true;
+            }
+        }
+        else if (!DynamicCast<Ipv4StaticRouting>(protocol) &&
+                 !DynamicCast<WanFibRouting>(protocol) && !DynamicCast<Ipv4GlobalRouting>(protocol))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void
+WanForwardingCapacity::DoDispose()
+{
+    m_event.Cancel();
+    m_queue.clear();
+    m_handler = Node::ProtocolHandler();
+    m_ipv4 = nullptr;
+    m_node = nullptr;
+    Object::DoDispose();
+}
+
+WanForwardingEngine::WanForwardingEngine(const WanTopology& topology, const WanNetwork& network)
+    : m_topology(topology),
+      m_network(network),
+      m_limits(topology.GetNSites()),
+      m_capacity(topology.GetNSites())
+{
+}
+
+WanForwardingLimits
+WanForwardingEngine::Parse(const std::string& fields, const std::string& text)
+{
+    WanForwardingLimits limits;
+    std::istringstream items(fields);
+    std::string item;
+    while (std::getline(items, item, ','))
+    {
+        item = WanCsvReader::Trim(item);
+        size_t equals = item.find('=');
+        NS_ABORT_MSG_IF(equals == std::string::npos,
+                        "Forwarding limits '" << text << "': '" << item << "' is not field=value");
+        std::string name = WanCsvReader::ToLower(WanCsvReader::Trim(item.substr(0, equals)));
+        std::string value = WanCsvReader::Trim(item.substr(equals + 1));
+        double number;
+        if (name == "pps")
+        {
+            double scale = 1;
+            if (!value.empty() && (value.back() == 'k' || value.back() == 'K'))
+            {
+                scale = 1e3;
+                value.pop_back();
+            }
+            else if (!value.empty() && value.back() == 'M')
+            {
+                scale = 1e6;
+                value.pop_back();
+            }
+            NS_ABORT_MSG_UNLESS(WanCsvReader::ParseNumber(value, number) && number > 0,
+                                "Forwarding limits '" << text << "': bad pps " << value);
+            limits.pps = number * scale;
+        }
+        else if (name == "bps")
+        {
+            limits.bps = WanCsvReader::ParseDataRate(value);
+        }
+        else if (name == "crypto")
+        {
+            limits.crypto = WanCsvReader::ParseDataRate(value);
+        }
+        else if (name == "policy")
+        {
+            limits.policy = WanCsvReader::ParseTime(value);
+        }
+        else if (name == "queue")
+        {
+            NS_ABORT_MSG_UNLESS(WanCsvReader::ParseNumber(value, number) && number >= 0,
+                                "Forwarding limits '" << text << "': bad queue " << value);
+            limits.queue = static_cast<uint32_t>(number);
+        }
+        else
+        {
+            NS_FATAL_ERROR("Forwarding limits '" << text << "': unknown field " << name);
+        }
+    }
+    return limits;
+}
+
+void
+WanForwardingEngine::Add(const std::string& limits)
+{
+    std::istringstream list(limits);
+    std::string entry;
+    while (std::getline(list, entry, ';'))
+    {
+        entry = WanCsvReader::Trim(entry);
+        if (entry.empty())
+        {
+            continue;
+        }
+        size_t colon = entry.find(':');
+        NS_ABORT_MSG_IF(colon == std::string::npos,
+                        "Forwarding limits '" << entry << "' are not Router:field=value,...");
+        WanForwardingLimits parsed = Parse(entry.substr(colon + 1), entry);
+
+        // A site name, else a role, else every router
+        const std::string router = WanCsvReader::Trim(entry.substr(0, colon));
+        int64_t site = m_topology.FindSite(router);
+        bool found = false;
+        for (uint32_t s = 0; s < m_topology.GetNSites(); ++s)
+        {
+            if (router == "*" || (site >= 0 && s == site) ||
+                (site < 0 && WanCsvReader::ToLower(m_topology.GetSite(s).role) ==
+                                 WanCsvReader::ToLower(router)))
+            {
+                m_limits[s] = parsed;
+                found = true;
+            }
+        }
+        NS_ABORT_MSG_UNLESS(found,
+                            "Forwarding limits '" << entry << "': no site or role " << router);
+    }
+}
+
+void
+WanForwardingEngine::Install()
+{
+    for (uint32_t site = 0; site < m_topology.GetNSites(); ++site)
+    {
+        if (!m_limits[site].IsLimited() || m_capacity[site])
+        {
+            continue;
+        }
+        Ptr<WanForwardingCapacity> capacity = CreateObject<WanForwardingCapacity>();
+        capacity->SetLimits(m_limits[site]);
+        capacity->Install(m_network.nodes.Get(site));
+        m_capacity[site] = capacity;
+    }
+}
+
+WanForwardingCapacity::Counters
+WanForwardingEngine::GetCounters(uint32_t site) const
+{
+    return m_capacity[site] ? m_capacity[site]->GetCounters() : WanForwardingCapacity::Counters();
+}
+
+WanForwardingCapacity::Counters
+WanForwardingEngine::GetCounters() const
+{
+    WanForwardingCapacity::Counters total;
+    for (uint32_t site = 0; site < m_capacity.size(); ++site)
+    {
+        total.Add(GetCounters(site));
+    }
+    return total;
+}
+
+void
+WanForwardingEngine::Print(std::ostream& os) const
+{
+    uint32_t routers = 0;
+    for (const WanForwardingLimits& limits : m_limits)
+    {
+        routers += limits.IsLimited() ? 1 : 0;
+    }
+    os << "\nForwarding capacity: " << routers << " of " << m_topology.GetNSites()
+       << " routers limited" << std::endl;
+    for (uint32_t site = 0; site < m_topology.GetNSites(); ++site)
+    {
+        const WanForwardingLimits& limits = m_limits[site];
+        if (!limits.IsLimited())
+        {
+            continue;
+        }
+        os << "  " << m_topology.GetSite(site).name << ":";
+        if (limits.pps > 0)
+        {
+            os << " " << limits.pps << " pps";
+        }
+        if (limits.bps.GetBitRate() > 0)
+        {
+            os << " " << limits.bps;
+        }
+        if (limits.crypto.GetBitRate() > 0)
+        {
+            os << " crypto " << limits.crypto;
+        }
+        if (!limits.policy.IsZero())
+        {
+            os << " policy " << limits.policy.As(Time::US);
+        }
+        os << " queue " << limits.queue << std::endl;
+    }
+}
+
+void
+WanForwardingEngine::PrintCounters(std::ostream& os) const
+{
+    const std::ios::fmtflags flags = os.flags();
+    const std::streamsize precision = os.precision();
+    const double elapsed = Simulator::Now().GetSeconds();
+    os << std::fixed << std::setprecision(2);
+    for (uint32_t site = 0; site < m_capacity.size(); ++site)
+    {
+        if (!m_capacity[site])
+        {
+            continue;
+        }
+        const WanForwardingCapacity::Counters& counters = m_capacity[site]->GetCounters();
+        os << "Forwarding " << m_topology.GetSite(site).name << ": " << counters.received
+           << " packets, " << counters.dropped << " dropped ("
+           << (counters.received > 0 ? 100.0 * counters.dropped / counters.received : 0.0)
+           << "%), peak queue " << counters.peakQueue << ", busy "
+           << (elapsed > 0 ? 100.0 * counters.busySeconds / elapsed : 0.0) << "%, mean wait "
+           << (counters.processed > 0 ? 1e3 * counters.waitSeconds / counters.processed : 0.0)
+           << "ms" << std::endl;
+    }
+    os.flags(flags);
+    os.precision(precision);
+}
+
+} // namespace ns3
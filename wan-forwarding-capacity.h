@@ -0,0 +1,214 @@
+/*
+ * Router forwarding capacity: per-packet processing cost and input queueing
+ *
+ * ns-3 nodes forward at infinite speed; only the circuits limit throughput.
+ * Real branch routers run out of CPU at a few hundred thousand packets per
+ * second, and of crypto throughput well before that. A router with limits
+ * gets one input queue in front of IPv4 for all its interfaces, served by
+ * one processor. A packet costs
+ *
+ *   1 / pps + bits / bps + bits / crypto + policy
+ *
+ * where pps is the per-packet forwarding rate, bps the per-bit rate (memory
+ * and bus), crypto the IPsec throughput and policy a fixed cost charged on
+ * routers that have policy to apply: PBR rules (see wan-pbr.h), interfaces
+ * of a tenant VRF (see wan-vrf.h) or redundancy policy routes (see
+ * wan-redundancy.h). Those protocols are on every router once configured,
+ * so a transit router without rules or tenants is not charged. An unset
+ * limit costs nothing. A packet that finds the
+ * input queue full is dropped, so a branch router that takes the rerouted
+ * traffic of a failed circuit loses packets even when its circuits do not.
+ *
+ * Limits are given per router, by site name or role, or '*' for all:
+ *
+ *   branch:pps=300k,crypto=200Mbps,queue=500;HQ:pps=2M,policy=2us
+ *
+ * A later entry for a router replaces an earlier one. Packets the router
+ * sends itself are not charged.
+ */
+
+#ifndef WAN_FORWARDING_CAPACITY_H
+#define WAN_FORWARDING_CAPACITY_H
+
+#include "wan-topology-helper.h"
+#include "wan-topology.h"
+
+#include "ns3/address.h"
+#include "ns3/data-rate.h"
+#include "ns3/event-id.h"
+#include "ns3/ipv4.h"
+#include "ns3/net-device.h"
+#include "ns3/node.h"
+#include "ns3/nstime.h"
+#include "ns3/object.h"
+#include "ns3/packet.h"
+
+#include <cstdint>
+#include <deque>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Forwarding limits of one router. Zero means unlimited.
+ */
+struct WanForwardingLimits
+{
+    double pps{0};       //!< Packets per second
+    DataRate bps{0};     //!< Bits per second
+    DataRate crypto{0};  //!< Encryption throughput
+    Time policy;         //!< Extra cost per packet with policy routing
+    uint32_t queue{256}; //!< Input queue, packets waiting; 0: none beyond the one in service
+
+    /// \return true if any limit is set
+    bool IsLimited() const;
+};
+
+/**
+ * The input queue and processor of one router.
+ */
+class WanForwardingCapacity : public Object
+{
+  public:
+    /// Packet counters of one or more routers
+    struct Counters
+    {
+        uint64_t received{0};  //!< Packets offered to the processor
+        uint64_t processed{0}; //!< Packets passed on to IPv4
+        uint64_t dropped{0};   //!< Packets that found the input queue full
+        uint32_t peakQueue{0}; //!< Most packets waiting at once
+        double busySeconds{0}; //!< Processing time
+        double waitSeconds{0}; //!< Time the processed packets waited in the queue
+
+        /// Add the counters of another router
+        void Add(const Counters& other);
+    };
+
+    /// Get the type ID
+    static TypeId GetTypeId();
+
+    WanForwardingCapacity();
+
+    /// \param limits the router's limits
+    void SetLimits(const WanForwardingLimits& limits);
+
+    /// \return the router's limits
+    const WanForwardingLimits& GetLimits() const;
+
+    /**
+     * Put the input queue between a router's interfaces and its IPv4 stack.
+     * Call once the router has all its interfaces.
+     * \param node the router
+     */
+    void Install(Ptr<Node> node);
+
+    /// \return the packet counters
+    const Counters& GetCounters() const;
+
+  protected:
+    void DoDispose() override;
+
+  private:
+    /// A received packet waiting for the processor
+    struct Pending
+    {
+        Ptr<NetDevice> device;      //!< Receiving device
+        Ptr<const Packet> packet;   //!< The packet
+        uint16_t protocol;          //!< Protocol number
+        Address from;               //!< Sender
+        Address to;                 //!< Receiver
+        NetDevice::PacketType type; //!< Packet type
+        Time arrival;               //!< Time it was received
+    };
+
+    /// Protocol handler of the interfaces: queue a packet
+    void Receive(Ptr<NetDevice> device,
+                 Ptr<const Packet> packet,
+                 uint16_t protocol,
+                 const Address& from,
+                 const Address& to,
+                 NetDevice::PacketType type);
+
+    /// Start processing the packet at the head of the queue
+    void Serve();
+
+    /// The packet at the head of the queue is processed: pass it to IPv4
+    void Done();
+
+    /// \return the processing time of a packet
+    Time GetCost(Ptr<const Packet> packet);
+
+    /**
+     * \return true if the router has policy to apply: interfaces bound to a
+     *         tenant VRF, PBR rules, redundancy policy routes, or a protocol
+     *         not routing by destination only
+     */
+    bool HasPolicy() const;
+
+    WanForwardingLimits m_limits;    //!< Limits
+    Ptr<Node> m_node;                //!< The router
+    Ptr<Ipv4> m_ipv4;                //!< IPv4 of the router
+    Node::ProtocolHandler m_handler; //!< IPv4's handler, fed by the processor
+    std::deque<Pending> m_queue;     //!< Waiting packets; the head in service
+    bool m_busy{false};              //!< The processor works on the head
+    int m_policy{-1};                //!< HasPolicy() once known; -1 before the first packet
+    EventId m_event;                 //!< End of the packet in service
+    Counters m_counters;             //!< Counters
+};
+
+/**
+ * Gives routers of a network their forwarding limits.
+ */
+class WanForwardingEngine
+{
+  public:
+    /**
+     * \param topology the topology the network was built from
+     * \param network the network
+     */
+    WanForwardingEngine(const WanTopology& topology, const WanNetwork& network);
+
+    /**
+     * Add limits.
+     * \param limits e.g. "branch:pps=300k,crypto=200Mbps": entries separated
+     *        by ';', each a site name, role or '*', ':' and comma-separated
+     *        fields pps (k and M suffixes), bps, crypto, policy and queue
+     */
+    void Add(const std::string& limits);
+
+    /// Install the input queues of the routers with limits
+    void Install();
+
+    /// \return the counters of a site's router; zero without limits
+    WanForwardingCapacity::Counters GetCounters(uint32_t site) const;
+
+    /// \return the counters of all routers
+    WanForwardingCapacity::Counters GetCounters() const;
+
+    /// Print the limits of every router
+    void Print(std::ostream& os) const;
+
+    /// Print the packets processed and dropped by every router with limits
+    void PrintCounters(std::ostream& os) const;
+
+  private:
+    /**
+     * Parse the fields of one entry.
+     * \param fields comma-separated field=value pairs
+     * \param text the entry, for errors
+     * \return the limits
+     */
+    static WanForwardingLimits Parse(const std::string& fields, const std::string& text);
+
+    const WanTopology& m_topology;                      //!< Topology
+    const WanNetwork& m_network;                        //!< Network
+    std::vector<WanForwardingLimits> m_limits;          //!< Limits by site
+    std::vector<Ptr<WanForwardingCapacity>> m_capacity; //!< By site; nullptr without limits
+};
+
+} // namespace ns3
+
+#endif /* WAN_FORWARDING_CAPACITY_H */
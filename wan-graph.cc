@@ -0,0 +1,186 @@
+/*
+ * Flat adjacency of a WanTopology for graph algorithms
+ */
+
+#include "wan-graph.h"
+
+#include "ns3/abort.h"
+#include "ns3/log.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("WanGraph");
+
+WanGraph::WanGraph(const WanTopology& topology)
+{
+    const uint32_t nSites = topology.GetNSites();
+    const uint32_t nLinks = topology.GetNLinks();
+
+    // Counting sort of the arcs by source site; a stable pass over the
+    // circuits keeps each site's arcs in circuit order
+    m_offsets.assign(nSites + 1, 0);
+    m_linkEnds.resize(2 * nLinks);
+    for (uint32_t l = 0; l < nLinks; ++l)
+    {
+        const WanLink& link = topology.GetLink(l);
+        m_linkEnds[2 * l] = link.a;
+        m_linkEnds[2 * l + 1] = link.b;
+        ++m_offsets[link.a + 1];
+        ++m_offsets[link.b + 1];
+    }
+    for (uint32_t s = 0; s < nSites; ++s)
+    {
+        m_offsets[s + 1] += m_offsets[s];
+    }
+    m_targets.resize(2 * nLinks);
+    m_links.resize(2 * nLinks);
+    m_costs.resize(2 * nLinks);
+    m_localEnds.resize(2 * nLinks);
+    m_interfaces.assign(2 * nLinks, 0);
+    std::vector<uint32_t> fill(m_offsets.begin(), m_offsets.end() - 1);
+    for (uint32_t l = 0; l < nLinks; ++l)
+    {
+        const WanLink& link = topology.GetLink(l);
+        for (uint32_t end = 0; end < 2; ++end)
+        {
+            uint32_t arc = fill[end == 0 ? link.a : link.b]++;
+            m_targets[arc] = end == 0 ? link.b : link.a;
+            m_links[arc] = l;
+            m_costs[arc] = link.cost;
+            m_localEnds[arc] = end;
+        }
+    }
+    NS_LOG_INFO(nSites << " sites, " << 2 * nLinks << " arcs");
+}
+
+void
+WanGraph::SetInterfaces(const std::vector<Ipv4InterfaceContainer>& linkInterfaces)
+{
+    NS_ABORT_MSG_UNLESS(linkInterfaces.size() == GetNLinks(),
+                        "Interfaces for " << linkInterfaces.size() << " of " << GetNLinks()
+                                          << " circuits");
+    for (uint32_t arc = 0; arc < m_links.size(); ++arc)
+    {
+        m_interfaces[arc] = linkInterfaces[m_links[arc]].Get(m_localEnds[arc]).second;
+    }
+}
+
+uint32_t
+WanGraph::GetNSites() const
+{
+    return m_offsets.empty() ? 0 : m_offsets.size() - 1;
+}
+
+uint32_t
+WanGraph::GetNLinks() const
+{
+    return m_linkEnds.size() / 2;
+}
+
+uint32_t
+WanGraph::Begin(uint32_t site) const
+{
+    return m_offsets[site];
+}
+
+uint32_t
+WanGraph::End(uint32_t site) const
+{
+    return m_offsets[site + 1];
+}
+
+uint32_t
+WanGraph::GetTarget(uint32_t arc) const
+{
+    return m_targets[arc];
+}
+
+uint32_t
+WanGraph::GetLink(uint32_t arc) const
+{
+    return m_links[arc];
+}
+
+double
+WanGraph::GetCost(uint32_t arc) const
+{
+    return m_costs[arc];
+}
+
+uint32_t
+WanGraph::GetLocalEnd(uint32_t arc) const
+{
+    return m_localEnds[arc];
+}
+
+uint32_t
+WanGraph::GetInterface(uint32_t arc) const
+{
+    return m_interfaces[arc];
+}
+
+uint32_t
+WanGraph::GetLinkEnd(uint32_t link, uint32_t end) const
+{
+    return m_linkEnds[2 * link + end];
+}
+
+int64_t
+WanGraph::FindArc(uint32_t site, uint32_t interface) const
+{
+    for (uint32_t arc = Begin(site); arc < End(site); ++arc)
+    {
+        if (m_interfaces[arc] == interface)
+        {
+            return arc;
+        }
+    }
+    return -1;
+}
+
+void
+WanGraph::ShortestPaths(uint32_t source,
+                        std::vector<double>& distance,
+                        std::vector<int32_t>& firstArc,
+                        const std::vector<bool>& up) const
+{
+    const double infinity = std::numeric_limits<double>::infinity();
+    distance.assign(GetNSites(), infinity);
+    firstArc.assign(GetNSites(), -1);
+    distance[source] = 0;
+    using Entry = std::pair<double, uint32_t>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<>> queue;
+    queue.emplace(0.0, source);
+    while (!queue.empty())
+    {
+        auto [d, u] = queue.top();
+        queue.pop();
+        if (d > distance[u])
+        {
+            continue;
+        }
+        for (uint32_t arc = m_offsets[u]; arc < m_offsets[u + 1]; ++arc)
+        {
+            if (!up.empty() && !up[m_links[arc]])
+            {
+                continue;
+            }
+            uint32_t v = m_targets[arc];
+            double candidate = d + m_costs[arc];
+            if (candidate < distance[v])
+            {
+                distance[v] = candidate;
+                firstArc[v] = (u == source) ? static_cast<int32_t>(arc) : firstArc[u];
+                queue.emplace(candidate, v);
+            }
+        }
+    }
+}
+
+} // namespace ns3
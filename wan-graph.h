@@ -0,0 +1,113 @@
+/*
+ * Flat adjacency of a WanTopology for graph algorithms
+ *
+ * WanTopology keeps circuits as a list of WanLink records with profile
+ * strings and times, and the ns-3 objects hang off nodes and devices
+ * behind pointers. Neither is a good shape for a shortest-path run over
+ * 100k circuits. A WanGraph is the compressed sparse row (CSR) form built
+ * once from the topology: every circuit is two arcs, one per direction,
+ * and the arcs leaving a site are contiguous. Per arc it stores the far
+ * site, the circuit, its cost, the near end (0: a, 1: b) and, once the
+ * network is built, the near interface index.
+ *
+ * The arcs of a site are in circuit order, so scans and shortest paths
+ * break ties toward the lower circuit index exactly as the installed
+ * static routes always have.
+ */
+
+#ifndef WAN_GRAPH_H
+#define WAN_GRAPH_H
+
+#include "wan-topology.h"
+
+#include "ns3/ipv4-interface-container.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Compressed sparse row adjacency of sites and circuits.
+ */
+class WanGraph
+{
+  public:
+    WanGraph() = default;
+
+    /// \param topology sites and circuits; costs are copied
+    explicit WanGraph(const WanTopology& topology);
+
+    /**
+     * Record the interface index of the near end of every arc.
+     * \param linkInterfaces addresses per circuit, a end first
+     */
+    void SetInterfaces(const std::vector<Ipv4InterfaceContainer>& linkInterfaces);
+
+    /// \return the number of sites
+    uint32_t GetNSites() const;
+
+    /// \return the number of circuits
+    uint32_t GetNLinks() const;
+
+    /// \return the first arc leaving a site
+    uint32_t Begin(uint32_t site) const;
+
+    /// \return one past the last arc leaving a site
+    uint32_t End(uint32_t site) const;
+
+    /// \return the site an arc leads to
+    uint32_t GetTarget(uint32_t arc) const;
+
+    /// \return the circuit of an arc
+    uint32_t GetLink(uint32_t arc) const;
+
+    /// \return the routing cost of an arc
+    double GetCost(uint32_t arc) const;
+
+    /// \return the circuit end an arc leaves from: 0 for a, 1 for b
+    uint32_t GetLocalEnd(uint32_t arc) const;
+
+    /// \return the interface index an arc leaves from (see SetInterfaces)
+    uint32_t GetInterface(uint32_t arc) const;
+
+    /**
+     * \param link circuit index
+     * \param end 0 for a, 1 for b
+     * \return the site at that end
+     */
+    uint32_t GetLinkEnd(uint32_t link, uint32_t end) const;
+
+    /**
+     * Find the arc leaving a site through an interface.
+     * \return the arc, or -1 if no circuit uses that interface
+     */
+    int64_t FindArc(uint32_t site, uint32_t interface) const;
+
+    /**
+     * Least-cost paths from one site (Dijkstra).
+     * \param source the source site
+     * \param distance receives the cost to every site, infinity if unreachable
+     * \param firstArc receives the arc leaving source on the path to every
+     *        site, -1 for the source and unreachable sites
+     * \param up circuits that may be used, by circuit index; empty for all
+     */
+    void ShortestPaths(uint32_t source,
+                       std::vector<double>& distance,
+                       std::vector<int32_t>& firstArc,
+                       const std::vector<bool>& up = {}) const;
+
+  private:
+    std::vector<uint32_t> m_offsets;    //!< First arc per site, plus the total
+    std::vector<uint32_t> m_targets;    //!< Far site per arc
+    std::vector<uint32_t> m_links;      //!< Circuit per arc
+    std::vector<double> m_costs;        //!< Cost per arc
+    std::vector<uint8_t> m_localEnds;   //!< Near circuit end per arc
+    std::vector<uint32_t> m_interfaces; //!< Near interface index per arc
+    std::vector<uint32_t> m_linkEnds;   //!< Sites a and b per circuit, interleaved
+};
+
+} // namespace ns3
+
+#endif /* WAN_GRAPH_H */
@@ -0,0 +1,214 @@
+/*
+ * Gray failures: partial loss, one-way failures and latency spikes
+ */
+
+#include "wan-gray-failure.h"
+
+#include "wan-csv-reader.h"
+
+#include "ns3/abort.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+
+#include <iostream>
+#include <sstream>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("WanGrayFailure");
+
+WanGrayFailureInjector::WanGrayFailureInjector(const WanTopology& topology,
+                                               const WanNetwork& network)
+    : m_topology(topology)
+{
+    m_channels.reserve(network.linkDevices.size());
+    for (const auto& devices : network.linkDevices)
+    {
+        m_channels.push_back(DynamicCast<WanPointToPointChannel>(devices.Get(0)->GetChannel()));
+    }
+}
+
+void
+WanGrayFailureInjector::Add(const std::string& spec)
+{
+    std::istringstream failures(spec);
+    std::string text;
+    while (std::getline(failures, text, ';'))
+    {
+        text = WanCsvReader::Trim(text);
+        if (text.empty())
+        {
+            continue;
+        }
+        std::istringstream fields(text);
+        std::string field;
+        std::getline(fields, field, ',');
+        field = WanCsvReader::Trim(field);
+
+        std::vector<uint32_t> links;
+        double index;
+        if (!field.empty() && field[0] == '#')
+        {
+            NS_ABORT_MSG_UNLESS(WanCsvReader::ParseNumber(field.substr(1), index) && index >= 0 &&
+                                    index < m_topology.GetNLinks(),
+                                "Gray failure: no link " << field);
+            links.push_back(static_cast<uint32_t>(index));
+        }
+        else
+        {
+            NS_ABORT_MSG_UNLESS(m_topology.FindLinks(field, links) && !links.empty(),
+                                "Gray failure: no link " << field);
+        }
+
+        WanGrayFailure failure;
+        while (std::getline(fields, field, ','))
+        {
+            size_t equals = field.find('=');
+            NS_ABORT_MSG_IF(equals == std::string::npos,
+                            "Gray failure '" << text << "': expected key=value, got " << field);
+            std::string key = WanCsvReader::ToLower(WanCsvReader::Trim(field.substr(0, equals)));
+            std::string value = WanCsvReader::Trim(field.substr(equals + 1));
+            if (key == "from")
+            {
+                failure.from = m_topology.FindSite(value);
+                NS_ABORT_MSG_IF(failure.from < 0, "Gray failure: unknown site " << value);
+            }
+            else if (key == "loss")
+            {
+                NS_ABORT_MSG_UNLESS(WanCsvReader::ParseFraction(value, failure.loss) &&
+                                        failure.loss >= 0 && failure.loss <= 1,
+                                    "Gray failure: bad loss " << value);
+            }
+            else if (key == "corrupt" || key == "corruption")
+            {
+                NS_ABORT_MSG_UNLESS(WanCsvReader::ParseFraction(value, failure.corruption) &&
+                                        failure.corruption >= 0 && failure.corruption <= 1,
+                                    "Gray failure: bad corruption " << value);
+            }
+            else if (key == "delay")
+            {
+                failure.extraDelay = WanCsvReader::ParseTime(value);
+            }
+            else if (key == "at")
+            {
+                failure.at = WanCsvReader::ParseTime(value);
+            }
+            else if (key == "until")
+            {
+                failure.until = WanCsvReader::ParseTime(value);
+            }
+            else
+            {
+                NS_FATAL_ERROR("Gray failure: unknown field " << key);
+            }
+        }
+        NS_ABORT_MSG_IF(failure.until <= failure.at,
+                        "Gray failure '" << text << "' ends before it starts");
+
+        for (uint32_t l : links)
+        {
+            failure.link = l;
+            Schedule(failure);
+        }
+    }
+}
+
+void
+WanGrayFailureInjector::Schedule(const WanGrayFailure& failure)
+{
+    const WanLink& link = m_topology.GetLink(failure.link);
+    NS_ABORT_MSG_IF(failure.from >= 0 && failure.from != link.a && failure.from != link.b,
+                    "Gray failure: site " << m_topology.GetSite(failure.from).name
+                                          << " is not on link " << m_topology.GetSite(link.a).name
+                                          << "-" << m_topology.GetSite(link.b).name);
+    uint32_t index = m_failures.size();
+    m_failures.push_back(failure);
+    Simulator::Schedule(failure.at, &WanGrayFailureInjector::Apply, this, index, true);
+    if (failure.until != Time::Max())
+    {
+        Simulator::Schedule(failure.until, &WanGrayFailureInjector::Apply, this, index, false);
+    }
+}
+
+void
+WanGrayFailureInjector::Apply(uint32_t index, bool start)
+{
+    const WanGrayFailure& failure = m_failures[index];
+    const WanLink& link = m_topology.GetLink(failure.link);
+    Ptr<WanPointToPointChannel> channel = m_channels[failure.link];
+    for (uint32_t wire = 0; wire < 2; ++wire)
+    {
+        // Direction 0 carries the packets sent by the link's a end
+        if (failure.from >= 0 && failure.from != (wire == 0 ? link.a : link.b))
+        {
+            continue;
+        }
+        if (start)
+        {
+            channel->SetGrayFailure(wire, failure.loss, failure.extraDelay, failure.corruption);
+        }
+        else
+        {
+            channel->ClearGrayFailure(wire);
+        }
+    }
+
+    if (start)
+    {
+        std::cout << "\n!!! GRAY FAILURE at " << Simulator::Now().GetSeconds()
+                  << "s: " << Describe(failure) << " !!!\n"
+                  << std::endl;
+    }
+    else
+    {
+        std::cout << "\n*** GRAY FAILURE CLEARED at " << Simulator::Now().GetSeconds()
+                  << "s: " << Describe(failure) << " ***\n"
+                  << std::endl;
+    }
+}
+
+std::string
+WanGrayFailureInjector::Describe(const WanGrayFailure& failure) const
+{
+    const WanLink& link = m_topology.GetLink(failure.link);
+    std::ostringstream text;
+    text << m_topology.GetSite(link.a).name << "-" << m_topology.GetSite(link.b).name;
+    if (failure.from >= 0)
+    {
+        text << " from " << m_topology.GetSite(failure.from).name;
+    }
+    if (failure.loss > 0)
+    {
+        text << ", " << failure.loss * 100 << "% loss";
+    }
+    if (failure.extraDelay.IsStrictlyPositive())
+    {
+        text << ", +" << failure.extraDelay.GetMilliSeconds() << "ms";
+    }
+    if (failure.corruption > 0)
+    {
+        text << ", " << failure.corruption * 100 << "% corrupted";
+    }
+    return text.str();
+}
+
+const std::vector<WanGrayFailure>&
+WanGrayFailureInjector::GetFailures() const
+{
+    return m_failures;
+}
+
+uint64_t
+WanGrayFailureInjector::GetLostPackets(uint32_t link) const
+{
+    return m_channels[link]->GetLostPackets(0) + m_channels[link]->GetLostPackets(1);
+}
+
+uint64_t
+WanGrayFailureInjector::GetCorruptedPackets(uint32_t link) const
+{
+    return m_channels[link]->GetCorruptedPackets(0) + m_channels[link]->GetCorruptedPackets(1);
+}
+
+} // namespace ns3
@@ -0,0 +1,96 @@
+/*
+ * Gray failures: partial loss, one-way failures and latency spikes
+ *
+ * Real circuits rarely fail as cleanly as DisableLink. A gray failure
+ * degrades one or both directions of a link for a time window:
+ *
+ *   HQ-DC,loss=5%,at=4s,until=8s
+ *   HQ-DC,from=DC,loss=100%,at=4s,until=8s        (one direction dead)
+ *   Branch-DC,delay=200ms,corrupt=1%,at=5s,until=6s
+ *
+ * Fields after the link ("SiteA-SiteB" or "#<link index>"):
+ * - from: sending site of the degraded direction; both if omitted
+ * - loss: fraction or percentage of packets that silently disappear
+ * - delay: one-way delay added to every packet
+ * - corrupt: fraction or percentage of packets failing the frame check
+ * - at, until: window (default: 4s until the end of the run)
+ *
+ * Several failures are separated by ';'. A later failure on the same
+ * direction replaces an earlier one while both windows are open.
+ */
+
+#ifndef WAN_GRAY_FAILURE_H
+#define WAN_GRAY_FAILURE_H
+
+#include "wan-point-to-point-channel.h"
+#include "wan-topology-helper.h"
+#include "wan-topology.h"
+
+#include "ns3/nstime.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * One gray failure of one link.
+ */
+struct WanGrayFailure
+{
+    uint32_t link{0};        //!< Link index
+    int64_t from{-1};        //!< Sending site of the degraded direction, -1 for both
+    double loss{0};          //!< Loss probability
+    Time extraDelay;         //!< Added one-way delay
+    double corruption{0};    //!< Corruption probability
+    Time at{Seconds(4)};     //!< Start of the failure
+    Time until{Time::Max()}; //!< End of the failure
+};
+
+/**
+ * Schedules gray failures on the channels of a WanNetwork.
+ */
+class WanGrayFailureInjector
+{
+  public:
+    /**
+     * \param topology the topology the network was built from
+     * \param network the network to degrade
+     */
+    WanGrayFailureInjector(const WanTopology& topology, const WanNetwork& network);
+
+    /**
+     * Parse and schedule failures.
+     * \param spec ';'-separated failures, see above
+     */
+    void Add(const std::string& spec);
+
+    /// Schedule one failure
+    void Schedule(const WanGrayFailure& failure);
+
+    /// \return the scheduled failures
+    const std::vector<WanGrayFailure>& GetFailures() const;
+
+    /// \return packets lost on a link, both directions
+    uint64_t GetLostPackets(uint32_t link) const;
+
+    /// \return packets corrupted on a link, both directions
+    uint64_t GetCorruptedPackets(uint32_t link) const;
+
+  private:
+    /// Start or end a failure
+    void Apply(uint32_t index, bool start);
+
+    /// \return a human-readable description of a failure
+    std::string Describe(const WanGrayFailure& failure) const;
+
+    const WanTopology& m_topology;                       //!< Site and link names
+    std::vector<Ptr<WanPointToPointChannel>> m_channels; //!< Channel per link
+    std::vector<WanGrayFailure> m_failures;              //!< Scheduled failures
+};
+
+} // namespace ns3
+
+#endif /* WAN_GRAY_FAILURE_H */
@@ -0,0 +1,59 @@
+/*
+ * Non-cryptographic hashes shared by the WAN modules
+ *
+ * FNV-1a hashes text and word sequences into 64 bits: configuration
+ * hashes, sweep job keys and FIB table identities. SplitMix64 is a 64-bit
+ * finalizer in which every input bit affects every output bit: seeds,
+ * flow hashes and hash table keys. Both are fixed functions, so a hash is
+ * the same on every platform and in every run.
+ */
+
+#ifndef WAN_HASH_H
+#define WAN_HASH_H
+
+#include <cstdint>
+#include <string>
+
+namespace ns3
+{
+
+/// FNV-1a offset basis: the 64-bit FNV-1a hash of nothing
+const uint64_t FNV1A_BASIS = 14695981039346656037ULL;
+
+/**
+ * Continue a 64-bit FNV-1a hash.
+ * \param hash the hash so far, FNV1A_BASIS to start
+ * \param value the next byte or word
+ * \return the hash including value
+ */
+inline uint64_t
+Fnv1a(uint64_t hash, uint64_t value)
+{
+    return (hash ^ value) * 1099511628211ULL;
+}
+
+/// \return the 64-bit FNV-1a hash of the bytes of text
+inline uint64_t
+Fnv1a(const std::string& text)
+{
+    uint64_t hash = FNV1A_BASIS;
+    for (unsigned char c : text)
+    {
+        hash = Fnv1a(hash, c);
+    }
+    return hash;
+}
+
+/// \return the SplitMix64 finalizer of x: every input bit affects every output bit
+inline uint64_t
+SplitMix64(uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+} // namespace ns3
+
+#endif /* WAN_HASH_H */
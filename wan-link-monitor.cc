@@ -0,0 +1,450 @@
+/*
+ * Link monitoring and failover: BFD-style liveness and SD-WAN SLA steering
+ */
+
+#include "wan-link-monitor.h"
+
+#include "wan-route-cache.h"
+
+#include "ns3/abort.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/ipv4-static-routing-helper.h"
+#include "ns3/log.h"
+#include "ns3/packet.h"
+#include "ns3/simulator.h"
+#include "ns3/udp-socket-factory.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("WanLinkMonitor");
+
+namespace
+{
+
+/// Hello port (BFD single-hop control)
+const uint16_t HELLO_PORT = 3784;
+
+/// Hello payload: sequence number, transmit time in ns, state or verdict
+const uint32_t HELLO_SIZE = 13;
+
+} // namespace
+
+WanLinkMonitor::WanLinkMonitor(const WanTopology& topology,
+                               const WanNetwork& network,
+                               uint32_t link)
+    : m_link(link),
+      m_interval(MilliSeconds(100)),
+      m_slaWindow(Seconds(1)),
+      m_slaDelay(MilliSeconds(100))
+{
+    const WanLink& l = topology.GetLink(link);
+    m_name = topology.GetSite(l.a).name + "-" + topology.GetSite(l.b).name;
+    for (uint32_t e = 0; e < 2; ++e)
+    {
+        End& end = m_ends[e];
+        end.site = topology.GetSite(e == 0 ? l.a : l.b).name;
+        end.node = network.nodes.Get(e == 0 ? l.a : l.b);
+        end.local = network.linkInterfaces[link].GetAddress(e);
+        end.peer = network.linkInterfaces[link].GetAddress(1 - e);
+    }
+}
+
+void
+WanLinkMonitor::SetMode(Mode mode)
+{
+    m_mode = mode;
+}
+
+void
+WanLinkMonitor::SetInterval(Time interval)
+{
+    m_interval = interval;
+}
+
+void
+WanLinkMonitor::SetDetectMultiplier(uint32_t multiplier)
+{
+    NS_ABORT_MSG_IF(multiplier == 0, "Detect multiplier must be positive");
+    m_multiplier = multiplier;
+}
+
+void
+WanLinkMonitor::SetSlaWindow(Time window)
+{
+    m_slaWindow = window;
+}
+
+void
+WanLinkMonitor::SetSlaThresholds(double loss, Time delay)
+{
+    m_slaLoss = loss;
+    m_slaDelay = delay;
+}
+
+void
+WanLinkMonitor::SetRevertHold(Time hold)
+{
+    NS_ABORT_MSG_IF(hold.IsStrictlyNegative(), "Revert hold must not be negative");
+    m_revertHold = hold;
+}
+
+void
+WanLinkMonitor::SetDamping(const WanFlapDamping& damping)
+{
+    NS_ABORT_MSG_IF(damping.enabled && (damping.halfLife.IsZero() || damping.penalty <= 0 ||
+                                        damping.reuse <= 0 || damping.suppress < damping.reuse),
+                    "Flap damping needs a half-life, a penalty and reuse <= suppress");
+    m_damping = damping;
+}
+
+void
+WanLinkMonitor::AddFailoverRoute(const WanFailoverRoute& route)
+{
+    for (End& end : m_ends)
+    {
+        if (end.node == route.node)
+        {
+            end.routes.push_back(route);
+            return;
+        }
+    }
+    NS_FATAL_ERROR("Failover route on node " << route.node->GetId() << ", not on link " << m_name);
+}
+
+void
+WanLinkMonitor::AddStateListener(StateCallback callback)
+{
+    m_listeners.push_back(callback);
+}
+
+void
+WanLinkMonitor::Start(Time start, Time stop)
+{
+    m_stop = stop;
+    Simulator::Schedule(start, &WanLinkMonitor::Open, this);
+}
+
+void
+WanLinkMonitor::Open()
+{
+    for (uint32_t e = 0; e < 2; ++e)
+    {
+        End& end = m_ends[e];
+        end.socket = Socket::CreateSocket(end.node, UdpSocketFactory::GetTypeId());
+        end.socket->Bind(InetSocketAddress(end.local, HELLO_PORT));
+        end.socket->Connect(InetSocketAddress(end.peer, HELLO_PORT));
+        end.socket->SetRecvCallback(MakeCallback(&WanLinkMonitor::Receive, this));
+        end.detectTimer = Simulator::Schedule(m_interval * m_multiplier,
+                                              &WanLinkMonitor::DetectTimeout,
+                                              this,
+                                              e);
+        Send(e);
+    }
+    if (m_mode == SLA)
+    {
+        Simulator::Schedule(m_slaWindow, &WanLinkMonitor::EvaluateWindow, this);
+    }
+}
+
+void
+WanLinkMonitor::Send(uint32_t e)
+{
+    if (Simulator::Now() >= m_stop)
+    {
+        return;
+    }
+    End& end = m_ends[e];
+    uint8_t hello[HELLO_SIZE];
+    uint64_t now = Simulator::Now().GetNanoSeconds();
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        hello[i] = (end.txSeq >> (8 * i)) & 0xff;
+    }
+    for (uint32_t i = 0; i < 8; ++i)
+    {
+        hello[4 + i] = (now >> (8 * i)) & 0xff;
+    }
+    hello[12] = (m_mode == BFD) ? static_cast<uint8_t>(end.state) : end.rxGood;
+    ++end.txSeq;
+    end.socket->Send(Create<Packet>(hello, HELLO_SIZE));
+    Simulator::Schedule(m_interval, &WanLinkMonitor::Send, this, e);
+}
+
+void
+WanLinkMonitor::Receive(Ptr<Socket> socket)
+{
+    uint32_t e = (socket == m_ends[0].socket) ? 0 : 1;
+    End& end = m_ends[e];
+    Ptr<Packet> packet;
+    while ((packet = socket->Recv()))
+    {
+        if (packet->GetSize() != HELLO_SIZE)
+        {
+            continue;
+        }
+        uint8_t hello[HELLO_SIZE];
+        packet->CopyData(hello, HELLO_SIZE);
+        uint64_t txNs = 0;
+        for (uint32_t i = 0; i < 8; ++i)
+        {
+            txNs |= static_cast<uint64_t>(hello[4 + i]) << (8 * i);
+        }
+
+        end.detectTimer.Cancel();
+        end.detectTimer = Simulator::Schedule(m_interval * m_multiplier,
+                                              &WanLinkMonitor::DetectTimeout,
+                                              this,
+                                              e);
+        if (m_mode == BFD)
+        {
+            // RFC 5880 section 6.8.6, without AdminDown
+            State remote = static_cast<State>(hello[12]);
+            if (end.state == DOWN)
+            {
+                end.state = (remote == DOWN) ? INIT : (remote == INIT ? UP : DOWN);
+            }
+            else if (end.state == INIT)
+            {
+                end.state = (remote == DOWN) ? INIT : UP;
+            }
+            else if (remote == DOWN)
+            {
+                end.state = DOWN;
+            }
+        }
+        else
+        {
+            ++end.windowRx;
+            end.windowDelay += Simulator::Now() - NanoSeconds(txNs);
+            end.peerRxGood = hello[12] != 0;
+        }
+        Update(e);
+    }
+}
+
+void
+WanLinkMonitor::DetectTimeout(uint32_t e)
+{
+    if (Simulator::Now() >= m_stop)
+    {
+        return;
+    }
+    End& end = m_ends[e];
+    NS_LOG_INFO(m_name << " at " << end.site << ": no hello for " << m_multiplier << " intervals");
+    end.state = DOWN;
+    end.rxGood = false;
+    Update(e);
+}
+
+void
+WanLinkMonitor::EvaluateWindow()
+{
+    double expected = m_slaWindow.GetSeconds() / m_interval.GetSeconds();
+    for (uint32_t e = 0; e < 2; ++e)
+    {
+        End& end = m_ends[e];
+        double loss = 1.0 - std::min<double>(end.windowRx, expected) / expected;
+        Time delay = end.windowRx > 0 ? end.windowDelay / end.windowRx : Time::Max();
+        end.rxGood = loss <= m_slaLoss && delay <= m_slaDelay;
+        NS_LOG_INFO(m_name << " at " << end.site << ": window loss " << loss * 100
+                           << "%, delay " << delay.GetMilliSeconds() << "ms");
+        end.windowRx = 0;
+        end.windowDelay = Time();
+        Update(e);
+    }
+    if (Simulator::Now() + m_slaWindow <= m_stop)
+    {
+        Simulator::Schedule(m_slaWindow, &WanLinkMonitor::EvaluateWindow, this);
+    }
+}
+
+void
+WanLinkMonitor::Update(uint32_t e)
+{
+    End& end = m_ends[e];
+    bool healthy;
+    if (m_mode == BFD)
+    {
+        // A session that has never been up does not take routes away
+        end.wasUp = end.wasUp || end.state == UP;
+        healthy = end.state == UP || !end.wasUp;
+    }
+    else
+    {
+        healthy = end.rxGood && end.peerRxGood;
+    }
+    if (healthy != end.healthy)
+    {
+        end.healthy = healthy;
+        if (!healthy)
+        {
+            ++m_flaps;
+            if (m_damping.enabled)
+            {
+                // Every flap counts, also while suppressed, up to the ceiling
+                // from which the penalty decays to reuse in MaxSuppress
+                double ceiling =
+                    m_damping.reuse * std::exp2(m_damping.maxSuppress.GetSeconds() /
+                                                m_damping.halfLife.GetSeconds());
+                end.penalty = std::min(GetPenalty(end) + m_damping.penalty, ceiling);
+                end.penaltyAt = Simulator::Now();
+                if (!end.suppressed && end.penalty > m_damping.suppress)
+                {
+                    end.suppressed = true;
+                    ++m_suppressions;
+                    std::cout << "~~~ " << m_name << " at " << end.site << " damped at "
+                              << Simulator::Now().GetSeconds() << "s (penalty "
+                              << static_cast<uint32_t>(end.penalty) << ") ~~~" << std::endl;
+                }
+            }
+        }
+    }
+
+    // Fail over at once; return only after the hold and any suppression
+    if (!healthy)
+    {
+        end.revertTimer.Cancel();
+        SetUsable(e, false);
+    }
+    else if (!end.usable && end.revertTimer.IsExpired())
+    {
+        if (m_revertHold.IsZero() && !end.suppressed)
+        {
+            SetUsable(e, true);
+        }
+        else
+        {
+            end.revertTimer = Simulator::Schedule(m_revertHold, &WanLinkMonitor::Revert, this, e);
+        }
+    }
+}
+
+void
+WanLinkMonitor::Revert(uint32_t e)
+{
+    End& end = m_ends[e];
+    if (!end.healthy || Simulator::Now() >= m_stop)
+    {
+        return;
+    }
+    if (end.suppressed)
+    {
+        double penalty = GetPenalty(end);
+        if (penalty > m_damping.reuse)
+        {
+            Time wait =
+                Seconds(m_damping.halfLife.GetSeconds() * std::log2(penalty / m_damping.reuse));
+            end.revertTimer = Simulator::Schedule(wait + NanoSeconds(1),
+                                                  &WanLinkMonitor::Revert,
+                                                  this,
+                                                  e);
+            return;
+        }
+        end.suppressed = false;
+    }
+    SetUsable(e, true);
+}
+
+void
+WanLinkMonitor::SetUsable(uint32_t e, bool usable)
+{
+    End& end = m_ends[e];
+    if (usable == end.usable)
+    {
+        return;
+    }
+
+    end.usable = usable;
+    m_events.push_back({Simulator::Now(), e, usable});
+    for (const auto& route : end.routes)
+    {
+        SwitchRoute(route, !usable);
+    }
+    m_routeUpdates += end.routes.size() + m_listeners.size();
+    std::cout << (usable ? "*** " : "!!! ") << (m_mode == BFD ? "BFD" : "SLA") << " at "
+              << Simulator::Now().GetSeconds() << "s: " << m_name << " "
+              << (usable ? "usable" : "UNUSABLE") << " at " << end.site;
+    if (!end.routes.empty())
+    {
+        std::cout << ", " << end.routes.size() << " routes moved to "
+                  << (usable ? "primary" : "backup");
+    }
+    std::cout << (usable ? " ***" : " !!!") << std::endl;
+    for (const auto& listener : m_listeners)
+    {
+        listener(m_link, e, usable);
+    }
+}
+
+double
+WanLinkMonitor::GetPenalty(const End& end) const
+{
+    if (end.penalty == 0)
+    {
+        return 0;
+    }
+    double halfLives =
+        (Simulator::Now() - end.penaltyAt).GetSeconds() / m_damping.halfLife.GetSeconds();
+    return end.penalty * std::exp2(-halfLives);
+}
+
+void
+WanLinkMonitor::SwitchRoute(const WanFailoverRoute& route, bool toBackup)
+{
+    Ipv4StaticRoutingHelper staticRoutingHelper;
+    Ptr<Ipv4StaticRouting> routing =
+        staticRoutingHelper.GetStaticRouting(route.node->GetObject<Ipv4>());
+    Ipv4Address fromGateway = toBackup ? route.primaryGateway : route.backupGateway;
+    Ipv4Address toGateway = toBackup ? route.backupGateway : route.primaryGateway;
+    uint32_t toInterface = toBackup ? route.backupInterface : route.primaryInterface;
+
+    for (uint32_t i = 0; i < routing->GetNRoutes(); ++i)
+    {
+        Ipv4RoutingTableEntry entry = routing->GetRoute(i);
+        if (entry.GetDestNetwork() == route.network &&
+            entry.GetDestNetworkMask() == route.mask && entry.GetGateway() == fromGateway)
+        {
+            routing->RemoveRoute(i);
+            break;
+        }
+    }
+    routing->AddNetworkRouteTo(route.network, route.mask, toGateway, toInterface);
+    WanRouteCache::Invalidate(route.node->GetObject<Ipv4>());
+}
+
+const std::vector<WanLinkMonitor::Event>&
+WanLinkMonitor::GetEvents() const
+{
+    return m_events;
+}
+
+const std::string&
+WanLinkMonitor::GetSiteName(uint32_t end) const
+{
+    return m_ends[end].site;
+}
+
+uint32_t
+WanLinkMonitor::GetNFlaps() const
+{
+    return m_flaps;
+}
+
+uint32_t
+WanLinkMonitor::GetNSuppressions() const
+{
+    return m_suppressions;
+}
+
+uint32_t
+WanLinkMonitor::GetNRouteUpdates() const
+{
+    return m_routeUpdates;
+}
+
+} // namespace ns3
@@ -0,0 +1,249 @@
+/*
+ * Link monitoring and failover: BFD-style liveness and SD-WAN SLA steering
+ *
+ * Static routes never notice a failing circuit. A WanLinkMonitor runs a
+ * hello session across one link (UDP port 3784 between the two link
+ * addresses, every Interval) and moves the failover routes of each end to
+ * their backup next hop while the link is unusable:
+ *
+ * - BFD: a simplified RFC 5880 session (Down, Init, Up). An end declares
+ *   the session down after DetectMultiplier intervals without a hello, or
+ *   when the peer reports Down; one dead direction brings down both ends.
+ *   Loss and delay below that threshold go unnoticed.
+ * - SLA: SD-WAN style path measurement. Each end measures loss and one-way
+ *   delay of the hellos it receives per SlaWindow and reports its verdict
+ *   in its own hellos; the link is unusable at an end if either direction
+ *   misses the loss or delay threshold, or no hello arrived for
+ *   DetectMultiplier intervals.
+ *
+ * Besides moving its own failover routes, the monitor tells state listeners
+ * about every change, so other route policies can track the link.
+ *
+ * By default the link is used again as soon as it looks healthy. A flapping
+ * circuit then moves the routes back and forth on every flap, and each
+ * move reorders the packets in flight on the two paths. Two mechanisms
+ * hold reverts back:
+ *
+ * - Revert hold (preemption delay): an end returns to the primary only
+ *   after the link has looked healthy for the whole hold time. Failing
+ *   over is never delayed.
+ * - Flap damping (RFC 2439 style): every flap adds a penalty that decays
+ *   exponentially with a half-life. Above the suppress threshold the end
+ *   stays on the backup until the penalty has decayed to the reuse
+ *   threshold; the penalty is capped so that suppression ends at most
+ *   MaxSuppress after the last flap.
+ */
+
+#ifndef WAN_LINK_MONITOR_H
+#define WAN_LINK_MONITOR_H
+
+#include "wan-topology-helper.h"
+#include "wan-topology.h"
+
+#include "ns3/callback.h"
+#include "ns3/event-id.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/node.h"
+#include "ns3/nstime.h"
+#include "ns3/socket.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * A route that a monitored link's end moves to a backup next hop while the
+ * link is unusable.
+ */
+struct WanFailoverRoute
+{
+    Ptr<Node> node;               //!< Router owning the route, one end of the link
+    Ipv4Address network;          //!< Destination network
+    Ipv4Mask mask;                //!< Destination mask
+    Ipv4Address primaryGateway;   //!< Next hop across the monitored link
+    uint32_t primaryInterface{0}; //!< Interface to the monitored link
+    Ipv4Address backupGateway;    //!< Next hop while the link is unusable
+    uint32_t backupInterface{0};  //!< Interface to the backup next hop
+};
+
+/**
+ * Exponential flap damping parameters (penalties are unitless).
+ */
+struct WanFlapDamping
+{
+    bool enabled{false};          //!< Damp flaps at all
+    double penalty{1000};         //!< Added per flap
+    double suppress{2000};        //!< Suppress above this penalty
+    double reuse{750};            //!< Reuse at or below this penalty
+    Time halfLife{Seconds(2)};    //!< Penalty half-life
+    Time maxSuppress{Seconds(4)}; //!< Longest suppression after the last flap
+};
+
+/**
+ * Hello session on one link driving failover routes.
+ */
+class WanLinkMonitor
+{
+  public:
+    /// Detection method
+    enum Mode
+    {
+        BFD, //!< Liveness only
+        SLA  //!< Loss and delay thresholds
+    };
+
+    /// A change of usability at one end
+    struct Event
+    {
+        Time at;      //!< Simulation time
+        uint32_t end; //!< 0 for the link's a end, 1 for the b end
+        bool usable;  //!< New state
+    };
+
+    /// Usability change: link index, end (0 = a, 1 = b), new state
+    typedef Callback<void, uint32_t, uint32_t, bool> StateCallback;
+
+    /**
+     * \param topology the topology the network was built from
+     * \param network the network
+     * \param link index of the link to monitor
+     */
+    WanLinkMonitor(const WanTopology& topology, const WanNetwork& network, uint32_t link);
+
+    /// \param mode detection method (default BFD)
+    void SetMode(Mode mode);
+
+    /// \param interval hello interval (default 100ms)
+    void SetInterval(Time interval);
+
+    /// \param multiplier missed hellos until the link is declared down (default 3)
+    void SetDetectMultiplier(uint32_t multiplier);
+
+    /// \param window SLA measurement window (default 1s)
+    void SetSlaWindow(Time window);
+
+    /**
+     * \param loss highest acceptable loss per window (default 2%)
+     * \param delay highest acceptable mean one-way delay per window (default 100ms)
+     */
+    void SetSlaThresholds(double loss, Time delay);
+
+    /// \param hold time the link must look healthy before reverting (default 0)
+    void SetRevertHold(Time hold);
+
+    /// \param damping flap damping (default disabled)
+    void SetDamping(const WanFlapDamping& damping);
+
+    /// Register a route to fail over; its node must be one end of the link
+    void AddFailoverRoute(const WanFailoverRoute& route);
+
+    /// Call back on every usability change of either end
+    void AddStateListener(StateCallback callback);
+
+    /// Run the session from start until stop
+    void Start(Time start, Time stop);
+
+    /// \return the usability changes so far
+    const std::vector<Event>& GetEvents() const;
+
+    /// \return the site name of one end
+    const std::string& GetSiteName(uint32_t end) const;
+
+    /// \return transitions of either end from healthy to failing
+    uint32_t GetNFlaps() const;
+
+    /// \return times an end became suppressed by flap damping
+    uint32_t GetNSuppressions() const;
+
+    /// \return route updates (failover routes moved, listeners told) of both ends
+    uint32_t GetNRouteUpdates() const;
+
+  private:
+    /// Session state of one end (BFD)
+    enum State : uint8_t
+    {
+        DOWN,
+        INIT,
+        UP
+    };
+
+    /// One end of the session
+    struct End
+    {
+        std::string site;                     //!< Site name
+        Ptr<Node> node;                       //!< Router
+        Ipv4Address local;                    //!< Address on the link
+        Ipv4Address peer;                     //!< Peer's address on the link
+        Ptr<Socket> socket;                   //!< Hello socket
+        uint32_t txSeq{0};                    //!< Next hello sequence number
+        EventId detectTimer;                  //!< Fires when hellos stop
+        State state{DOWN};                    //!< BFD session state
+        bool wasUp{false};                    //!< BFD session has been up
+        bool rxGood{true};                    //!< SLA verdict on the received direction
+        bool peerRxGood{true};                //!< Peer's verdict on our direction
+        uint32_t windowRx{0};                 //!< Hellos received this window
+        Time windowDelay;                     //!< Sum of their one-way delays
+        bool healthy{true};                   //!< Session verdict, before hold and damping
+        bool usable{true};                    //!< Failover routes on the primary
+        EventId revertTimer;                  //!< Pending return to the primary
+        double penalty{0};                    //!< Flap penalty at penaltyAt
+        Time penaltyAt;                       //!< Time of the last penalty update
+        bool suppressed{false};               //!< Held on the backup by damping
+        std::vector<WanFailoverRoute> routes; //!< Failover routes of this end
+    };
+
+    /// Open the sockets and start sending
+    void Open();
+
+    /// Send one hello from an end and schedule the next
+    void Send(uint32_t e);
+
+    /// Receive hellos at the end owning the socket
+    void Receive(Ptr<Socket> socket);
+
+    /// No hello for DetectMultiplier intervals
+    void DetectTimeout(uint32_t e);
+
+    /// Close an SLA window at both ends
+    void EvaluateWindow();
+
+    /// Recompute the health of an end and fail over or schedule the revert
+    void Update(uint32_t e);
+
+    /// Revert hold or suppression over: return to the primary if still healthy
+    void Revert(uint32_t e);
+
+    /// Set the usability of an end, moving its routes and telling the listeners
+    void SetUsable(uint32_t e, bool usable);
+
+    /// \return the decayed flap penalty of an end now
+    double GetPenalty(const End& end) const;
+
+    /// Move one route between primary and backup next hop
+    void SwitchRoute(const WanFailoverRoute& route, bool toBackup);
+
+    std::string m_name;                     //!< Link name for reports
+    uint32_t m_link;                        //!< Link index in the topology
+    std::vector<StateCallback> m_listeners; //!< Usability listeners
+    End m_ends[2];                          //!< a end, b end
+    Mode m_mode{BFD};                       //!< Detection method
+    Time m_interval;                        //!< Hello interval
+    uint32_t m_multiplier{3};               //!< Detect multiplier
+    Time m_slaWindow;                       //!< SLA window
+    double m_slaLoss{0.02};                 //!< SLA loss threshold
+    Time m_slaDelay;                        //!< SLA delay threshold
+    Time m_stop;                            //!< End of the session
+    Time m_revertHold;                      //!< Health time before reverting
+    WanFlapDamping m_damping;               //!< Flap damping
+    std::vector<Event> m_events;            //!< Usability changes
+    uint32_t m_flaps{0};                    //!< Healthy to failing transitions
+    uint32_t m_suppressions{0};             //!< Damping suppressions
+    uint32_t m_routeUpdates{0};             //!< Route updates
+};
+
+} // namespace ns3
+
+#endif /* WAN_LINK_MONITOR_H */
@@ -0,0 +1,198 @@
+/*
+ * Circuit profiles: bandwidth, delay, loss, jitter and reliability per circuit type
+ */
+
+#include "wan-link-profile.h"
+
+#include "wan-csv-reader.h"
+
+#include "ns3/abort.h"
+#include "ns3/log.h"
+
+#include <fstream>
+#include <sstream>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("WanLinkProfile");
+
+namespace
+{
+
+WanLinkProfile
+MakeProfile(const std::string& name,
+            const std::string& bandwidth,
+            Time delay,
+            double loss,
+            Time jitter,
+            const std::string& jitterModel)
+{
+    WanLinkProfile profile;
+    profile.name = name;
+    profile.bandwidth = DataRate(bandwidth);
+    profile.delay = delay;
+    profile.loss = loss;
+    profile.jitter = jitter;
+    profile.jitterModel = jitterModel;
+    return profile;
+}
+
+} // namespace
+
+WanLinkProfileCatalog::WanLinkProfileCatalog()
+{
+    Add(MakeProfile("legacy", "5Mbps", MilliSeconds(2), 0.0, Time(), "uniform"));
+    WanLinkProfile mpls = MakeProfile("mpls", "100Mbps", MilliSeconds(10), 0.0, Time(), "uniform");
+    mpls.mtbf = Hours(8760);
+    mpls.mttr = Hours(4);
+    Add(mpls);
+    WanLinkProfile broadband =
+        MakeProfile("broadband", "50Mbps", MilliSeconds(25), 0.005, MilliSeconds(2), "uniform");
+    broadband.lossBurst = 3.0;
+    broadband.mtbf = Hours(2190);
+    broadband.mttr = Hours(12);
+    Add(broadband);
+    WanLinkProfile lte =
+        MakeProfile("lte", "20Mbps", MilliSeconds(35), 0.002, MilliSeconds(10), "pareto");
+    lte.mtbf = Hours(1460);
+    lte.mttr = Hours(1);
+    Add(lte);
+}
+
+void
+WanLinkProfileCatalog::Add(const WanLinkProfile& profile)
+{
+    NS_ABORT_MSG_IF(profile.loss < 0 || profile.loss >= 1,
+                    "Profile " << profile.name << ": loss must be in [0, 1)");
+    NS_ABORT_MSG_IF(profile.lossBurst < 1,
+                    "Profile " << profile.name << ": loss burst must be at least 1");
+    NS_ABORT_MSG_IF(profile.jitterModel != "uniform" && profile.jitterModel != "normal" &&
+                        profile.jitterModel != "pareto",
+                    "Profile " << profile.name << ": unknown jitter model "
+                               << profile.jitterModel);
+    NS_ABORT_MSG_IF(profile.mtbf.IsNegative() || profile.mttr.IsNegative() ||
+                        (profile.mtbf.IsStrictlyPositive() && !profile.mttr.IsStrictlyPositive()),
+                    "Profile " << profile.name << ": a failing circuit needs MTBF and MTTR");
+    m_profiles[profile.name] = profile;
+}
+
+void
+WanLinkProfileCatalog::Load(const std::string& path)
+{
+    std::ifstream in(path);
+    NS_ABORT_MSG_UNLESS(in.is_open(), "Cannot open link profile file " << path);
+    WanCsvReader reader(in, path);
+    if (!reader.ReadHeader())
+    {
+        return;
+    }
+
+    int name = reader.RequireColumn({"name", "profile"});
+    int bandwidth = reader.RequireColumn({"bandwidth", "rate"});
+    int delay = reader.RequireColumn({"delay", "latency"});
+    int loss = reader.FindColumn({"loss"});
+    int lossBurst = reader.FindColumn({"loss_burst", "burst"});
+    int jitter = reader.FindColumn({"jitter"});
+    int jitterModel = reader.FindColumn({"jitter_model"});
+    int mtbf = reader.FindColumn({"mtbf"});
+    int mttr = reader.FindColumn({"mttr"});
+
+    while (reader.Next())
+    {
+        WanLinkProfile profile;
+        profile.name = reader.Get(name);
+        profile.bandwidth = WanCsvReader::ParseDataRate(reader.Get(bandwidth));
+        profile.delay = WanCsvReader::ParseTime(reader.Get(delay));
+        // Loss is a fraction ("0.005") or a percentage ("0.5%")
+        if (!reader.Get(loss).empty())
+        {
+            NS_ABORT_MSG_UNLESS(WanCsvReader::ParseFraction(reader.Get(loss), profile.loss),
+                                path << ":" << reader.GetLineNumber() << ": bad loss");
+        }
+        if (!reader.Get(lossBurst).empty())
+        {
+            NS_ABORT_MSG_UNLESS(WanCsvReader::ParseNumber(reader.Get(lossBurst), profile.lossBurst),
+                                path << ":" << reader.GetLineNumber() << ": bad loss burst");
+        }
+        if (!reader.Get(jitter).empty())
+        {
+            profile.jitter = WanCsvReader::ParseTime(reader.Get(jitter));
+        }
+        if (!reader.Get(jitterModel).empty())
+        {
+            profile.jitterModel = WanCsvReader::ToLower(reader.Get(jitterModel));
+        }
+        if (!reader.Get(mtbf).empty())
+        {
+            profile.mtbf = WanCsvReader::ParseTime(reader.Get(mtbf));
+        }
+        if (!reader.Get(mttr).empty())
+        {
+            profile.mttr = WanCsvReader::ParseTime(reader.Get(mttr));
+        }
+        Add(profile);
+    }
+}
+
+const WanLinkProfile*
+WanLinkProfileCatalog::Find(const std::string& name) const
+{
+    auto it = m_profiles.find(name);
+    return it == m_profiles.end() ? nullptr : &it->second;
+}
+
+void
+WanLinkProfileCatalog::Apply(WanTopology& topology) const
+{
+    for (uint32_t l = 0; l < topology.GetNLinks(); ++l)
+    {
+        WanLink& link = topology.GetLink(l);
+        if (link.profile.empty())
+        {
+            continue;
+        }
+        const WanLinkProfile* profile = Find(link.profile);
+        NS_ABORT_MSG_IF(!profile,
+                        "Unknown link profile '" << link.profile << "' on "
+                                                 << topology.GetSite(link.a).name << "-"
+                                                 << topology.GetSite(link.b).name);
+        link.bandwidth = profile->bandwidth;
+        link.delay = profile->delay;
+        link.loss = profile->loss;
+        link.lossBurst = profile->lossBurst;
+        link.jitter = profile->jitter;
+        link.jitterModel = profile->jitterModel;
+        link.mtbf = profile->mtbf;
+        link.mttr = profile->mttr;
+        NS_LOG_INFO("Link " << l << " uses profile " << link.profile);
+    }
+}
+
+void
+AssignLinkProfiles(WanTopology& topology, const std::string& assignments)
+{
+    std::istringstream list(assignments);
+    std::string entry;
+    while (std::getline(list, entry, ','))
+    {
+        entry = WanCsvReader::Trim(entry);
+        if (entry.empty())
+        {
+            continue;
+        }
+        size_t equals = entry.find('=');
+        NS_ABORT_MSG_IF(equals == std::string::npos,
+                        "Link profile assignment '" << entry << "' is not SiteA-SiteB=profile");
+        std::string sites = entry.substr(0, equals);
+        std::vector<uint32_t> links;
+        NS_ABORT_MSG_UNLESS(topology.FindLinks(sites, links) && !links.empty(),
+                            "Link profile assignment: no link " << sites);
+        for (uint32_t l : links)
+        {
+            topology.GetLink(l).profile = entry.substr(equals + 1);
+        }
+    }
+}
+
+} // namespace ns3
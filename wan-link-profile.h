@@ -0,0 +1,92 @@
+/*
+ * Circuit profiles: bandwidth, delay, loss, jitter and reliability per circuit type
+ *
+ * Real WAN circuits differ (MPLS, broadband, LTE backup). A profile names
+ * one circuit type; links of a WanTopology refer to it by name, either in
+ * the topology file ("profile" column/attribute) or through a per-link
+ * assignment such as "HQ-DC=mpls,HQ-Branch=broadband,Branch-DC=lte".
+ */
+
+#ifndef WAN_LINK_PROFILE_H
+#define WAN_LINK_PROFILE_H
+
+#include "wan-topology.h"
+
+#include "ns3/data-rate.h"
+#include "ns3/nstime.h"
+
+#include <map>
+#include <string>
+
+namespace ns3
+{
+
+/**
+ * Characteristics of one circuit type.
+ */
+struct WanLinkProfile
+{
+    std::string name;                    //!< Profile name, e.g. "mpls"
+    DataRate bandwidth;                  //!< Circuit bandwidth
+    Time delay;                          //!< One-way propagation delay
+    double loss{0.0};                    //!< Packet loss probability per direction
+    double lossBurst{1.0};               //!< Mean loss burst length in packets
+    Time jitter;                         //!< Mean extra delay per packet
+    std::string jitterModel{"uniform"};  //!< "uniform", "normal" or "pareto"
+    Time mtbf;                           //!< Mean time between failures (none if zero)
+    Time mttr;                           //!< Mean time to repair
+};
+
+/**
+ * Named circuit profiles. The built-in ones are:
+ *
+ * | name      | bandwidth | delay | loss | jitter        | MTBF  | MTTR |
+ * |-----------|-----------|-------|------|---------------|-------|------|
+ * | legacy    | 5Mbps     | 2ms   | -    | -             | -     | -    |
+ * | mpls      | 100Mbps   | 10ms  | -    | -             | 8760h | 4h   |
+ * | broadband | 50Mbps    | 25ms  | 0.5% | 2ms uniform   | 2190h | 12h  |
+ * | lte       | 20Mbps    | 35ms  | 0.2% | 10ms pareto   | 1460h | 1h   |
+ */
+class WanLinkProfileCatalog
+{
+  public:
+    /// Create a catalog holding the built-in profiles
+    WanLinkProfileCatalog();
+
+    /// Add or replace a profile
+    void Add(const WanLinkProfile& profile);
+
+    /**
+     * Add profiles from a CSV file with a header row naming the columns
+     * name, bandwidth, delay, loss, loss_burst, jitter, jitter_model, mtbf,
+     * mttr.
+     */
+    void Load(const std::string& path);
+
+    /**
+     * \param name profile name
+     * \return the profile, or nullptr if unknown
+     */
+    const WanLinkProfile* Find(const std::string& name) const;
+
+    /**
+     * Copy the profile characteristics onto every link of the topology
+     * that names a profile. Aborts on unknown profile names.
+     */
+    void Apply(WanTopology& topology) const;
+
+  private:
+    std::map<std::string, WanLinkProfile> m_profiles; //!< Profiles by name
+};
+
+/**
+ * Set the profile of individual links.
+ * \param topology topology to update
+ * \param assignments comma separated "SiteA-SiteB=profile" entries; every
+ *        link between the two sites gets the profile
+ */
+void AssignLinkProfiles(WanTopology& topology, const std::string& assignments);
+
+} // namespace ns3
+
+#endif /* WAN_LINK_PROFILE_H */
@@ -0,0 +1,211 @@
+/*
+ * Trace-driven link dynamics
+ */
+
+#include "wan-link-trace.h"
+
+#include "wan-csv-reader.h"
+
+#include "ns3/abort.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+
+#include <fstream>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("WanLinkTrace");
+
+WanLinkTracePlayer::WanLinkTracePlayer(const WanTopology& topology, const WanNetwork& network)
+    : m_topology(topology)
+{
+    m_devices.reserve(2 * network.linkDevices.size());
+    m_channels.reserve(network.linkDevices.size());
+    for (const auto& devices : network.linkDevices)
+    {
+        Ptr<PointToPointNetDevice> a = DynamicCast<PointToPointNetDevice>(devices.Get(0));
+        Ptr<PointToPointNetDevice> b = DynamicCast<PointToPointNetDevice>(devices.Get(1));
+        m_devices.push_back(a);
+        m_devices.push_back(b);
+        m_channels.push_back(DynamicCast<PointToPointChannel>(a->GetChannel()));
+    }
+}
+
+void
+WanLinkTracePlayer::SetTimeScale(double scale)
+{
+    NS_ABORT_MSG_IF(scale <= 0, "Link trace time scale must be positive");
+    m_timeScale = scale;
+}
+
+void
+WanLinkTracePlayer::SelectLinks(const std::string& selector, std::vector<uint32_t>& links) const
+{
+    links.clear();
+    if (selector.rfind("profile:", 0) == 0)
+    {
+        std::string profile = selector.substr(8);
+        for (uint32_t l = 0; l < m_topology.GetNLinks(); ++l)
+        {
+            if (m_topology.GetLink(l).profile == profile)
+            {
+                links.push_back(l);
+            }
+        }
+        return;
+    }
+    if (!selector.empty() && selector[0] == '#')
+    {
+        double index;
+        NS_ABORT_MSG_UNLESS(WanCsvReader::ParseNumber(selector.substr(1), index) && index >= 0 &&
+                                index < m_topology.GetNLinks(),
+                            "Link trace: no link " << selector);
+        links.push_back(static_cast<uint32_t>(index));
+        return;
+    }
+    NS_ABORT_MSG_UNLESS(m_topology.FindLinks(selector, links) && !links.empty(),
+                        "Link trace: no link " << selector);
+}
+
+void
+WanLinkTracePlayer::Load(const std::string& path)
+{
+    NS_LOG_FUNCTION(this << path);
+    std::ifstream in(path);
+    NS_ABORT_MSG_UNLESS(in.is_open(), "Cannot open link trace " << path);
+    WanCsvReader reader(in, path);
+    if (!reader.ReadHeader())
+    {
+        return;
+    }
+
+    int timeColumn = reader.RequireColumn({"time"});
+    int linkColumn = reader.RequireColumn({"link"});
+    int bandwidthColumn = reader.FindColumn({"bandwidth", "rate"});
+    int delayColumn = reader.FindColumn({"delay"});
+    int fromColumn = reader.FindColumn({"from"});
+
+    std::vector<uint32_t> links;
+    while (reader.Next())
+    {
+        Time at = WanCsvReader::ParseTime(reader.Get(timeColumn));
+        NS_ABORT_MSG_IF(!m_ticks.empty() && at < m_ticks.back().at,
+                        path << ":" << reader.GetLineNumber() << ": rows are not in time order");
+        if (m_ticks.empty() || at != m_ticks.back().at)
+        {
+            m_ticks.push_back({at, static_cast<uint32_t>(m_updates.size()), 0});
+        }
+
+        const std::string& bandwidth = reader.Get(bandwidthColumn);
+        bool relative = !bandwidth.empty() && bandwidth.back() == '%';
+        double percent = 0;
+        uint64_t rateBps = 0;
+        if (relative)
+        {
+            NS_ABORT_MSG_UNLESS(
+                WanCsvReader::ParseNumber(bandwidth.substr(0, bandwidth.size() - 1), percent) &&
+                    percent > 0,
+                path << ":" << reader.GetLineNumber() << ": bad bandwidth " << bandwidth);
+        }
+        else if (!bandwidth.empty())
+        {
+            rateBps = WanCsvReader::ParseDataRate(bandwidth).GetBitRate();
+        }
+        const std::string& delay = reader.Get(delayColumn);
+        int64_t delayNs = delay.empty() ? -1 : WanCsvReader::ParseTime(delay).GetNanoSeconds();
+
+        int64_t from = -1;
+        if (!reader.Get(fromColumn).empty())
+        {
+            from = m_topology.FindSite(reader.Get(fromColumn));
+            NS_ABORT_MSG_IF(from < 0,
+                            path << ":" << reader.GetLineNumber() << ": unknown site "
+                                 << reader.Get(fromColumn));
+        }
+
+        SelectLinks(reader.Get(linkColumn), links);
+        for (uint32_t l : links)
+        {
+            const WanLink& link = m_topology.GetLink(l);
+            Update update;
+            update.link = l;
+            update.ends = (from < 0) ? 3 : (from == link.a ? 1 : (from == link.b ? 2 : 0));
+            NS_ABORT_MSG_IF(update.ends == 0,
+                            path << ":" << reader.GetLineNumber() << ": site "
+                                 << reader.Get(fromColumn) << " is not on link "
+                                 << reader.Get(linkColumn));
+            update.rateBps =
+                relative ? static_cast<uint64_t>(link.bandwidth.GetBitRate() * percent / 100.0)
+                         : rateBps;
+            update.delayNs = delayNs;
+            m_updates.push_back(update);
+            ++m_ticks.back().count;
+        }
+    }
+    NS_LOG_INFO("Link trace " << path << ": " << m_ticks.size() << " ticks, " << m_updates.size()
+                              << " updates");
+}
+
+void
+WanLinkTracePlayer::Start()
+{
+    if (!m_ticks.empty())
+    {
+        Simulator::Schedule(Seconds(m_ticks[0].at.GetSeconds() * m_timeScale),
+                            &WanLinkTracePlayer::ApplyTick,
+                            this,
+                            0);
+    }
+}
+
+void
+WanLinkTracePlayer::ApplyTick(uint32_t i)
+{
+    const Tick& tick = m_ticks[i];
+    NS_LOG_INFO("Link trace tick " << i << " at " << Simulator::Now().GetSeconds() << "s: "
+                                   << tick.count << " updates");
+    for (uint32_t u = tick.first; u < tick.first + tick.count; ++u)
+    {
+        const Update& update = m_updates[u];
+        if (update.rateBps > 0)
+        {
+            DataRate rate(update.rateBps);
+            if (update.ends & 1)
+            {
+                m_devices[2 * update.link]->SetDataRate(rate);
+            }
+            if (update.ends & 2)
+            {
+                m_devices[2 * update.link + 1]->SetDataRate(rate);
+            }
+        }
+        if (update.delayNs >= 0)
+        {
+            m_channels[update.link]->SetAttribute("Delay", TimeValue(NanoSeconds(update.delayNs)));
+        }
+    }
+
+    // Only the next tick is ever pending
+    if (i + 1 < m_ticks.size())
+    {
+        Simulator::Schedule(Seconds((m_ticks[i + 1].at - tick.at).GetSeconds() * m_timeScale),
+                            &WanLinkTracePlayer::ApplyTick,
+                            this,
+                            i + 1);
+    }
+}
+
+uint32_t
+WanLinkTracePlayer::GetNTicks() const
+{
+    return m_ticks.size();
+}
+
+uint64_t
+WanLinkTracePlayer::GetNUpdates() const
+{
+    return m_updates.size();
+}
+
+} // namespace ns3
@@ -0,0 +1,107 @@
+/*
+ * Trace-driven link dynamics
+ *
+ * Backup circuits (LTE, broadband) change capacity and delay over the
+ * day. A link trace is a CSV time series
+ *
+ *   time,link,bandwidth,delay[,from]
+ *   0s,HQ-Branch,50Mbps,25ms
+ *   3600s,profile:lte,40%,
+ *
+ * - time: ns-3 time string ("3600s", "1.5h"); plain numbers are ms
+ * - link: "SiteA-SiteB", "#<link index>" or "profile:<name>" for every
+ *   link of a circuit profile
+ * - bandwidth: absolute ("20Mbps") or a percentage of the link's nominal
+ *   bandwidth ("40%"); empty leaves it unchanged
+ * - delay: new one-way delay; empty leaves it unchanged
+ * - from: optional sending site, to change one direction's rate only
+ *
+ * Rows must be in time order. Rows with the same time form one tick and
+ * are applied by a single simulator event, and only the next tick is ever
+ * scheduled, so thousands of link changes cost one event per tick.
+ */
+
+#ifndef WAN_LINK_TRACE_H
+#define WAN_LINK_TRACE_H
+
+#include "wan-topology-helper.h"
+#include "wan-topology.h"
+
+#include "ns3/point-to-point-channel.h"
+#include "ns3/point-to-point-net-device.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Replays a link trace onto the devices and channels of a WanNetwork.
+ */
+class WanLinkTracePlayer
+{
+  public:
+    /**
+     * \param topology the topology the network was built from
+     * \param network the network to drive
+     */
+    WanLinkTracePlayer(const WanTopology& topology, const WanNetwork& network);
+
+    /**
+     * Read a trace file. May be called several times as long as the rows
+     * of all files together stay in time order.
+     */
+    void Load(const std::string& path);
+
+    /**
+     * Compress or stretch trace time, e.g. 1/7200 plays a day in 12s.
+     * \param scale simulation seconds per trace second
+     */
+    void SetTimeScale(double scale);
+
+    /// Schedule the first tick. Call before Simulator::Run().
+    void Start();
+
+    /// \return the number of ticks loaded
+    uint32_t GetNTicks() const;
+
+    /// \return the number of per-link updates loaded
+    uint64_t GetNUpdates() const;
+
+  private:
+    /// One change of one link (or one direction of it)
+    struct Update
+    {
+        uint32_t link;     //!< Link index
+        uint8_t ends;      //!< Bit 0: a end transmits, bit 1: b end transmits
+        uint64_t rateBps;  //!< New rate, 0 to keep
+        int64_t delayNs;   //!< New delay, negative to keep
+    };
+
+    /// The updates of one trace time
+    struct Tick
+    {
+        Time at;        //!< Trace time of the tick
+        uint32_t first; //!< Index of the first update
+        uint32_t count; //!< Number of updates
+    };
+
+    /// Resolve a link selector to link indices
+    void SelectLinks(const std::string& selector, std::vector<uint32_t>& links) const;
+
+    /// Apply tick i and schedule tick i + 1
+    void ApplyTick(uint32_t i);
+
+    const WanTopology& m_topology;                      //!< Link names and profiles
+    std::vector<Ptr<PointToPointNetDevice>> m_devices;  //!< Two devices per link (a, b)
+    std::vector<Ptr<PointToPointChannel>> m_channels;   //!< Channel per link
+    std::vector<Update> m_updates;                      //!< All updates, tick order
+    std::vector<Tick> m_ticks;                          //!< Ticks, time order
+    double m_timeScale{1.0};                            //!< Simulation s per trace s
+};
+
+} // namespace ns3
+
+#endif /* WAN_LINK_TRACE_H */
@@ -0,0 +1,222 @@
+/*
+ * Link utilization and probe loss per phase of a run
+ */
+
+#include "wan-link-utilization.h"
+
+#include "ns3/abort.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("WanLinkUtilization");
+
+WanLinkUtilization::WanLinkUtilization(const WanTopology& topology, const WanNetwork& network)
+    : m_topology(topology),
+      m_network(network)
+{
+}
+
+void
+WanLinkUtilization::AddPhase(const std::string& name, Time start, Time stop)
+{
+    NS_ABORT_MSG_UNLESS(stop > start, "Phase " << name << " ends before it starts");
+    Phase phase;
+    phase.name = name;
+    phase.start = start;
+    phase.stop = stop;
+    phase.bytes.assign(2 * m_topology.GetNLinks(), 0);
+    m_phases.push_back(phase);
+}
+
+void
+WanLinkUtilization::AddProbe(const WanOutageProbe& probe)
+{
+    m_probes.push_back(&probe);
+}
+
+void
+WanLinkUtilization::Install(WanTracingManager& tracing)
+{
+    NS_LOG_FUNCTION(this);
+    m_tracing = &tracing;
+    for (uint32_t l = 0; l < m_topology.GetNLinks(); ++l)
+    {
+        for (uint32_t end = 0; end < 2; ++end)
+        {
+            tracing.Connect(WanTracingManager::STATS,
+                            m_network.linkDevices[l].Get(end),
+                            "PhyTxEnd",
+                            MakeBoundCallback(&WanLinkUtilization::TxEnd, this, 2 * l + end));
+        }
+    }
+    if (!m_probes.empty())
+    {
+        for (uint32_t i = 0; i < m_phases.size(); ++i)
+        {
+            Phase& phase = m_phases[i];
+            phase.startSample =
+                Simulator::Schedule(phase.start, &WanLinkUtilization::SampleProbes, this, i, -1);
+            phase.stopSample =
+                Simulator::Schedule(phase.stop, &WanLinkUtilization::SampleProbes, this, i, 1);
+        }
+    }
+}
+
+void
+WanLinkUtilization::Truncate(Time stop)
+{
+    Time now = Simulator::Now();
+    NS_ABORT_MSG_IF(stop < now, "Utilization stop " << stop.As(Time::S) << " has passed");
+    for (uint32_t i = 0; i < m_phases.size(); ++i)
+    {
+        Phase& phase = m_phases[i];
+        if (stop >= phase.stop)
+        {
+            continue;
+        }
+        if (stop <= phase.start)
+        {
+            // Not started: nothing sent, no capacity
+            phase.startSample.Cancel();
+            phase.stopSample.Cancel();
+            phase.stop = phase.start;
+            continue;
+        }
+        phase.stop = stop;
+        if (phase.stopSample.IsRunning())
+        {
+            phase.stopSample.Cancel();
+            phase.stopSample =
+                Simulator::Schedule(stop - now, &WanLinkUtilization::SampleProbes, this, i, 1);
+        }
+    }
+}
+
+void
+WanLinkUtilization::TxEnd(WanLinkUtilization* utilization,
+                          uint32_t index,
+                          Ptr<const Packet> packet)
+{
+    utilization->m_tracing->Count(WanTracingManager::STATS);
+    Time now = Simulator::Now();
+    for (Phase& phase : utilization->m_phases)
+    {
+        if (now >= phase.start && now < phase.stop)
+        {
+            phase.bytes[index] += packet->GetSize();
+        }
+    }
+}
+
+void
+WanLinkUtilization::SampleProbes(uint32_t phase, int sign)
+{
+    // Counters only grow: end minus start is what the phase saw
+    for (const WanOutageProbe* probe : m_probes)
+    {
+        m_phases[phase].sent += sign * static_cast<int64_t>(probe->GetSent());
+        m_phases[phase].received += sign * static_cast<int64_t>(probe->GetReceived());
+    }
+}
+
+double
+WanLinkUtilization::GetUtilization(uint32_t phase, uint32_t link, uint32_t end) const
+{
+    const Phase& p = m_phases.at(phase);
+    double capacity =
+        m_topology.GetLink(link).bandwidth.GetBitRate() * (p.stop - p.start).GetSeconds() / 8;
+    return capacity > 0 ? p.bytes.at(2 * link + end) / capacity : 0.0;
+}
+
+double
+WanLinkUtilization::GetLoss(uint32_t phase) const
+{
+    const Phase& p = m_phases.at(phase);
+    return p.sent > 0 ? 1.0 - static_cast<double>(p.received) / p.sent : 0.0;
+}
+
+void
+WanLinkUtilization::AddMetrics(WanMetrics& metrics) const
+{
+    const bool measured = m_tracing && m_tracing->IsEnabled(WanTracingManager::STATS);
+    for (uint32_t i = 0; i < m_phases.size(); ++i)
+    {
+        const std::string prefix = "phase." + m_phases[i].name;
+        double maximum = 0;
+        for (uint32_t l = 0; measured && l < m_topology.GetNLinks(); ++l)
+        {
+            const WanLink& link = m_topology.GetLink(l);
+            for (uint32_t end = 0; end < 2; ++end)
+            {
+                const std::string& from = m_topology.GetSite(end == 0 ? link.a : link.b).name;
+                const std::string& to = m_topology.GetSite(end == 0 ? link.b : link.a).name;
+                double utilization = GetUtilization(i, l, end);
+                metrics.Set(prefix + ".util." + from + "->" + to, utilization);
+                maximum = std::max(maximum, utilization);
+            }
+        }
+        if (measured)
+        {
+            metrics.Set(prefix + ".util_max", maximum);
+        }
+        if (!m_probes.empty())
+        {
+            metrics.Set(prefix + ".loss", GetLoss(i));
+        }
+    }
+}
+
+void
+WanLinkUtilization::Print(std::ostream& os, const std::string& title) const
+{
+    os << "\n========================================" << std::endl;
+    os << title << std::endl;
+    os << "========================================" << std::endl;
+    os << std::left << std::setw(20) << "Utilization a>b/b>a";
+    for (const Phase& phase : m_phases)
+    {
+        std::ostringstream column;
+        column << phase.name << " " << phase.start.GetSeconds() << "-" << phase.stop.GetSeconds()
+               << "s";
+        os << std::setw(16) << column.str();
+    }
+    os << std::endl;
+    const bool measured = m_tracing && m_tracing->IsEnabled(WanTracingManager::STATS);
+    for (uint32_t l = 0; measured && l < m_topology.GetNLinks(); ++l)
+    {
+        const WanLink& link = m_topology.GetLink(l);
+        const std::string name =
+            m_topology.GetSite(link.a).name + "-" + m_topology.GetSite(link.b).name;
+        os << std::setw(20) << name;
+        for (uint32_t i = 0; i < m_phases.size(); ++i)
+        {
+            std::ostringstream cell;
+            cell << std::fixed << std::setprecision(1) << GetUtilization(i, l, 0) * 100 << "%/"
+                 << GetUtilization(i, l, 1) * 100 << "%";
+            os << std::setw(16) << cell.str();
+        }
+        os << std::endl;
+    }
+    if (!m_probes.empty())
+    {
+        os << std::setw(20) << "Probe loss";
+        for (uint32_t i = 0; i < m_phases.size(); ++i)
+        {
+            std::ostringstream cell;
+            cell << std::fixed << std::setprecision(1) << GetLoss(i) * 100 << "% ("
+                 << m_phases[i].sent - m_phases[i].received << "/" << m_phases[i].sent << ")";
+            os << std::setw(16) << cell.str();
+        }
+        os << std::endl;
+    }
+    os << std::right << "========================================" << std::endl;
+}
+
+} // namespace ns3
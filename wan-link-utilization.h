@@ -0,0 +1,120 @@
+/*
+ * Link utilization and probe loss per phase of a run
+ *
+ * How a redundancy design behaves shows in where the traffic goes before,
+ * during and after a failure. A WanLinkUtilization counts the bytes every
+ * link end transmits (PhyTxEnd of its device) in named time phases and
+ * reports them as a share of the link's nominal bandwidth, one value per
+ * direction. Outage probes added to it are sampled at the phase
+ * boundaries, which gives the probe loss of every phase as well. Its
+ * sinks are statistics sinks of the tracing manager: connected only from
+ * the first phase start to the last phase end, and only if STATS is
+ * enabled.
+ */
+
+#ifndef WAN_LINK_UTILIZATION_H
+#define WAN_LINK_UTILIZATION_H
+
+#include "wan-metrics.h"
+#include "wan-outage-probe.h"
+#include "wan-topology-helper.h"
+#include "wan-topology.h"
+#include "wan-tracing.h"
+
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
+#include "ns3/packet.h"
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Per-phase transmit utilization of every link direction.
+ */
+class WanLinkUtilization
+{
+  public:
+    /**
+     * \param topology the topology the network was built from
+     * \param network the network to measure
+     */
+    WanLinkUtilization(const WanTopology& topology, const WanNetwork& network);
+
+    /**
+     * Add a phase to report. Phases may overlap.
+     * \param name column label and metric prefix, e.g. "during"
+     * \param start phase start
+     * \param stop phase end
+     */
+    void AddPhase(const std::string& name, Time start, Time stop);
+
+    /// Report the loss of a probe per phase; the probe must outlive the run
+    void AddProbe(const WanOutageProbe& probe);
+
+    /**
+     * Connect to the devices and schedule the probe samples.
+     * \param tracing the tracing manager, with STATS enabled for the phases
+     */
+    void Install(WanTracingManager& tracing);
+
+    /**
+     * Clip the phases at an earlier stop that has not passed yet; phases
+     * that start later stay empty.
+     */
+    void Truncate(Time stop);
+
+    /**
+     * \param phase phase index, in order of AddPhase
+     * \param link link index
+     * \param end transmitting end: 0 for a->b, 1 for b->a
+     * \return bytes sent over the nominal capacity of the phase
+     */
+    double GetUtilization(uint32_t phase, uint32_t link, uint32_t end) const;
+
+    /// \return the probe loss of a phase over all probes, 0 without probes
+    double GetLoss(uint32_t phase) const;
+
+    /**
+     * Add phase.<name>.util_max and phase.<name>.util.<A>-><B> if STATS is
+     * enabled and, with probes, phase.<name>.loss.
+     */
+    void AddMetrics(WanMetrics& metrics) const;
+
+    /// Print one row per link and one column per phase
+    void Print(std::ostream& os, const std::string& title) const;
+
+  private:
+    /// A time phase with its counters
+    struct Phase
+    {
+        std::string name;            //!< Label
+        Time start;                  //!< Start
+        Time stop;                   //!< End
+        std::vector<uint64_t> bytes; //!< Bytes sent, 2 * link + end
+        uint64_t sent{0};            //!< Probes sent during the phase
+        uint64_t received{0};        //!< Probes received during the phase
+        EventId startSample;         //!< Probe sample at the start
+        EventId stopSample;          //!< Probe sample at the end
+    };
+
+    /// PhyTxEnd of a device; index is 2 * link + end
+    static void TxEnd(WanLinkUtilization* utilization, uint32_t index, Ptr<const Packet> packet);
+
+    /// Take the probe counters at the start (sign -1) or end (+1) of a phase
+    void SampleProbes(uint32_t phase, int sign);
+
+    const WanTopology& m_topology;               //!< Topology
+    const WanNetwork& m_network;                 //!< Network
+    std::vector<Phase> m_phases;                 //!< Phases in order of AddPhase
+    std::vector<const WanOutageProbe*> m_probes; //!< Sampled probes
+    WanTracingManager* m_tracing{nullptr};       //!< Owner of the sinks
+};
+
+} // namespace ns3
+
+#endif /* WAN_LINK_UTILIZATION_H */
@@ -0,0 +1,179 @@
+/*
+ * Run metrics: named scalar results of one simulation run
+ */
+
+#include "wan-metrics.h"
+
+#include "ns3/abort.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+namespace ns3
+{
+
+void
+WanMetrics::Set(const std::string& name, double value)
+{
+    m_values[name] = value;
+}
+
+bool
+WanMetrics::Has(const std::string& name) const
+{
+    return m_values.count(name) != 0;
+}
+
+double
+WanMetrics::Get(const std::string& name) const
+{
+    auto it = m_values.find(name);
+    NS_ABORT_MSG_IF(it == m_values.end(), "No metric " << name);
+    return it->second;
+}
+
+const std::map<std::string, double>&
+WanMetrics::GetValues() const
+{
+    return m_values;
+}
+
+std::string
+WanMetrics::Serialize() const
+{
+    std::ostringstream text;
+    text << std::setprecision(std::numeric_limits<double>::max_digits10);
+    for (const auto& [name, value] : m_values)
+    {
+        text << name << '\t' << value << '\n';
+    }
+    return text.str();
+}
+
+WanMetrics
+WanMetrics::Deserialize(const std::string& text)
+{
+    WanMetrics metrics;
+    std::istringstream lines(text);
+    std::string line;
+    while (std::getline(lines, line))
+    {
+        size_t tab = line.find('\t');
+        NS_ABORT_MSG_IF(tab == std::string::npos, "Bad metric line '" << line << "'");
+        metrics.Set(line.substr(0, tab), std::stod(line.substr(tab + 1)));
+    }
+    return metrics;
+}
+
+WanP2Quantile::WanP2Quantile(double p)
+    : m_p(p)
+{
+    NS_ABORT_MSG_IF(p <= 0 || p >= 1, "Quantile must be in (0, 1)");
+    m_dn[0] = 0;
+    m_dn[1] = p / 2;
+    m_dn[2] = p;
+    m_dn[3] = (1 + p) / 2;
+    m_dn[4] = 1;
+}
+
+void
+WanP2Quantile::Add(double x)
+{
+    if (m_count < 5)
+    {
+        m_q[m_count++] = x;
+        if (m_count == 5)
+        {
+            std::sort(m_q, m_q + 5);
+            for (uint32_t i = 0; i < 5; ++i)
+            {
+                m_n[i] = i;
+                m_np[i] = 4 * m_dn[i];
+            }
+        }
+        return;
+    }
+    ++m_count;
+
+    // Cell of the new observation; extremes move the end markers
+    uint32_t k;
+    if (x < m_q[0])
+    {
+        m_q[0] = x;
+        k = 0;
+    }
+    else if (x >= m_q[4])
+    {
+        m_q[4] = x;
+        k = 3;
+    }
+    else
+    {
+        k = 0;
+        while (x >= m_q[k + 1])
+        {
+            ++k;
+        }
+    }
+    for (uint32_t i = k + 1; i < 5; ++i)
+    {
+        m_n[i] += 1;
+    }
+    for (uint32_t i = 0; i < 5; ++i)
+    {
+        m_np[i] += m_dn[i];
+    }
+
+    // Move the middle markers towards their desired positions
+    for (uint32_t i = 1; i < 4; ++i)
+    {
+        double d = m_np[i] - m_n[i];
+        if ((d >= 1 && m_n[i + 1] - m_n[i] > 1) || (d <= -1 && m_n[i - 1] - m_n[i] < -1))
+        {
+            double s = d > 0 ? 1 : -1;
+            double parabolic =
+                m_q[i] + s / (m_n[i + 1] - m_n[i - 1]) *
+                             ((m_n[i] - m_n[i - 1] + s) * (m_q[i + 1] - m_q[i]) /
+                                  (m_n[i + 1] - m_n[i]) +
+                              (m_n[i + 1] - m_n[i] - s) * (m_q[i] - m_q[i - 1]) /
+                                  (m_n[i] - m_n[i - 1]));
+            if (m_q[i - 1] < parabolic && parabolic < m_q[i + 1])
+            {
+                m_q[i] = parabolic;
+            }
+            else
+            {
+                uint32_t j = s > 0 ? i + 1 : i - 1;
+                m_q[i] += s * (m_q[j] - m_q[i]) / (m_n[j] - m_n[i]);
+            }
+            m_n[i] += s;
+        }
+    }
+}
+
+double
+WanP2Quantile::Get() const
+{
+    if (m_count == 0)
+    {
+        return 0;
+    }
+    if (m_count < 5)
+    {
+        double sorted[5];
+        std::copy(m_q, m_q + m_count, sorted);
+        std::sort(sorted, sorted + m_count);
+        return sorted[static_cast<uint32_t>(m_p * (m_count - 1) + 0.5)];
+    }
+    return m_q[2];
+}
+
+uint64_t
+WanP2Quantile::GetCount() const
+{
+    return m_count;
+}
+
+} // namespace ns3
@@ -0,0 +1,78 @@
+/*
+ * Run metrics: named scalar results of one simulation run
+ *
+ * A scenario run reports what it measured (loss, delay percentiles, outage
+ * and failover times) as a flat set of named numbers. The set can be
+ * serialized to text so runs executed in other processes can report back.
+ */
+
+#ifndef WAN_METRICS_H
+#define WAN_METRICS_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace ns3
+{
+
+/**
+ * Named scalar metrics of one run, ordered by name.
+ */
+class WanMetrics
+{
+  public:
+    /// Set a metric, replacing an earlier value
+    void Set(const std::string& name, double value);
+
+    /// \return true if the metric was set
+    bool Has(const std::string& name) const;
+
+    /// \return the metric's value; aborts if it was not set
+    double Get(const std::string& name) const;
+
+    /// \return all metrics by name
+    const std::map<std::string, double>& GetValues() const;
+
+    /// \return one "name<TAB>value" line per metric, full precision
+    std::string Serialize() const;
+
+    /// \return the metrics of a Serialize() text
+    static WanMetrics Deserialize(const std::string& text);
+
+  private:
+    std::map<std::string, double> m_values; //!< Metrics by name
+};
+
+/**
+ * Streaming quantile estimate in constant memory (the P-square algorithm
+ * of Jain and Chlamtac): five markers track the minimum, the quantile, the
+ * maximum and two points in between.
+ */
+class WanP2Quantile
+{
+  public:
+    /// \param p the quantile to track, in (0, 1)
+    explicit WanP2Quantile(double p);
+
+    /// Add an observation
+    void Add(double x);
+
+    /// \return the current estimate; exact below five observations, 0 if none
+    double Get() const;
+
+    /// \return the number of observations
+    uint64_t GetCount() const;
+
+  private:
+    double m_p;          //!< Tracked quantile
+    uint64_t m_count{0}; //!< Observations so far
+    double m_q[5];       //!< Marker heights
+    double m_n[5];       //!< Marker positions
+    double m_np[5];      //!< Desired marker positions
+    double m_dn[5];      //!< Desired position increments
+};
+
+} // namespace ns3
+
+#endif /* WAN_METRICS_H */
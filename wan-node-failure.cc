@@ -0,0 +1,223 @@
+/*
+ * Node-level failure injection: site loss and router reboot
+ */
+
+#include "wan-node-failure.h"
+
+#include "wan-route-cache.h"
+
+#include "ns3/ipv4-static-routing-helper.h"
+#include "ns3/ipv4.h"
+#include "ns3/log.h"
+#include "ns3/point-to-point-net-device.h"
+#include "ns3/queue-disc.h"
+#include "ns3/queue.h"
+#include "ns3/simulator.h"
+#include "ns3/traffic-control-layer.h"
+
+#include <iostream>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("WanNodeFailure");
+
+WanNodeFailureInjector::WanNodeFailureInjector()
+    : m_bootDelay(Seconds(1.0)),
+      m_routeInstallDelay(Seconds(0.5))
+{
+}
+
+void
+WanNodeFailureInjector::SetBootDelay(Time delay)
+{
+    m_bootDelay = delay;
+}
+
+void
+WanNodeFailureInjector::SetRouteInstallDelay(Time delay)
+{
+    m_routeInstallDelay = delay;
+}
+
+void
+WanNodeFailureInjector::Schedule(Ptr<Node> node, Time at, Time downtime)
+{
+    Simulator::Schedule(at, &WanNodeFailureInjector::Fail, this, node);
+    Simulator::Schedule(at + downtime, &WanNodeFailureInjector::PowerOn, this, node);
+}
+
+void
+WanNodeFailureInjector::AddStateListener(Ptr<Node> node, StateCallback callback)
+{
+    m_nodes[node->GetId()].listeners.push_back(callback);
+}
+
+bool
+WanNodeFailureInjector::IsDown(Ptr<Node> node) const
+{
+    auto it = m_nodes.find(node->GetId());
+    return it != m_nodes.end() && it->second.down;
+}
+
+void
+WanNodeFailureInjector::Fail(Ptr<Node> node)
+{
+    NS_LOG_FUNCTION(this << node->GetId());
+    NodeState& state = m_nodes[node->GetId()];
+    state.bootEvent.Cancel();
+    state.routeEvent.Cancel();
+
+    Ptr<Ipv4> ipv4 = node->GetObject<Ipv4>();
+    Ipv4StaticRoutingHelper staticRoutingHelper;
+    Ptr<Ipv4StaticRouting> routing = staticRoutingHelper.GetStaticRouting(ipv4);
+    Ptr<WanFibRouting> fib = WanFibRouting::Find(ipv4);
+
+    // The startup configuration is what the router had before its first
+    // failure; a crash during boot must not overwrite it with a partial FIB
+    if (!state.routesSaved)
+    {
+        state.routes.clear();
+        for (uint32_t i = 0; i < routing->GetNRoutes(); ++i)
+        {
+            Ipv4RoutingTableEntry route = routing->GetRoute(i);
+            if (route.IsGateway())
+            {
+                state.routes.push_back({route, routing->GetMetric(i)});
+            }
+        }
+        state.fib = fib ? fib->GetRoutes() : std::vector<WanFibRouting::Route>();
+        state.routesSaved = true;
+    }
+
+    // All interfaces down; static routing withdraws the routes through them
+    for (uint32_t i = 1; i < ipv4->GetNInterfaces(); ++i)
+    {
+        ipv4->SetDown(i);
+    }
+
+    // Clear whatever is left of the FIB, keeping loopback
+    for (uint32_t i = routing->GetNRoutes(); i-- > 0;)
+    {
+        if (routing->GetRoute(i).GetInterface() != 0)
+        {
+            routing->RemoveRoute(i);
+        }
+    }
+    if (fib)
+    {
+        fib->Clear();
+    }
+    WanRouteCache::Invalidate(ipv4);
+
+    // Packets waiting for transmission die with the router, in the device
+    // queues and in the queue discs of the traffic control layer in front
+    Ptr<TrafficControlLayer> tc = node->GetObject<TrafficControlLayer>();
+    for (uint32_t d = 0; d < node->GetNDevices(); ++d)
+    {
+        Ptr<QueueDisc> queueDisc = tc ? tc->GetRootQueueDiscOnDevice(node->GetDevice(d)) : nullptr;
+        while (queueDisc && queueDisc->Dequeue())
+        {
+        }
+        Ptr<PointToPointNetDevice> device = DynamicCast<PointToPointNetDevice>(node->GetDevice(d));
+        if (device)
+        {
+            device->GetQueue()->Flush();
+        }
+    }
+
+    std::cout << "\n!!! NODE FAILURE at " << Simulator::Now().GetSeconds() << "s: node "
+              << node->GetId() << " is DOWN !!!\n"
+              << std::endl;
+
+    state.down = true;
+    for (const auto& listener : state.listeners)
+    {
+        listener(false);
+    }
+}
+
+void
+WanNodeFailureInjector::PowerOn(Ptr<Node> node)
+{
+    NS_LOG_FUNCTION(this << node->GetId());
+    NodeState& state = m_nodes[node->GetId()];
+    if (!state.down || state.bootEvent.IsRunning() || state.routeEvent.IsRunning())
+    {
+        return;
+    }
+    state.bootEvent =
+        Simulator::Schedule(m_bootDelay, &WanNodeFailureInjector::InterfacesUp, this, node);
+}
+
+void
+WanNodeFailureInjector::InterfacesUp(Ptr<Node> node)
+{
+    NS_LOG_FUNCTION(this << node->GetId());
+    // Connected routes come back with the interfaces
+    Ptr<Ipv4> ipv4 = node->GetObject<Ipv4>();
+    for (uint32_t i = 1; i < ipv4->GetNInterfaces(); ++i)
+    {
+        ipv4->SetUp(i);
+    }
+    NS_LOG_INFO("Node " << node->GetId() << " booted, interfaces up");
+    m_nodes[node->GetId()].routeEvent = Simulator::Schedule(m_routeInstallDelay,
+                                                            &WanNodeFailureInjector::InstallRoutes,
+                                                            this,
+                                                            node);
+}
+
+void
+WanNodeFailureInjector::InstallRoutes(Ptr<Node> node)
+{
+    NS_LOG_FUNCTION(this << node->GetId());
+    NodeState& state = m_nodes[node->GetId()];
+    Ipv4StaticRoutingHelper staticRoutingHelper;
+    Ptr<Ipv4StaticRouting> routing =
+        staticRoutingHelper.GetStaticRouting(node->GetObject<Ipv4>());
+
+    for (const auto& route : state.routes)
+    {
+        const Ipv4RoutingTableEntry& entry = route.entry;
+        if (entry.IsDefault())
+        {
+            routing->SetDefaultRoute(entry.GetGateway(), entry.GetInterface(), route.metric);
+        }
+        else if (entry.IsHost())
+        {
+            routing->AddHostRouteTo(entry.GetDest(),
+                                    entry.GetGateway(),
+                                    entry.GetInterface(),
+                                    route.metric);
+        }
+        else
+        {
+            routing->AddNetworkRouteTo(entry.GetDestNetwork(),
+                                       entry.GetDestNetworkMask(),
+                                       entry.GetGateway(),
+                                       entry.GetInterface(),
+                                       route.metric);
+        }
+    }
+
+    Ptr<WanFibRouting> fib = WanFibRouting::Find(node->GetObject<Ipv4>());
+    if (fib)
+    {
+        fib->Load(state.fib);
+    }
+    WanRouteCache::Invalidate(node->GetObject<Ipv4>());
+
+    std::cout << "\n*** NODE RESTORED at " << Simulator::Now().GetSeconds() << "s: node "
+              << node->GetId() << " reinstalled " << state.routes.size() + state.fib.size()
+              << " routes ***\n"
+              << std::endl;
+
+    state.down = false;
+    state.routesSaved = false;
+    for (const auto& listener : state.listeners)
+    {
+        listener(true);
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,112 @@
+/*
+ * Node-level failure injection: site loss and router reboot
+ *
+ * DisableLink/EnableLink only fail a channel. A failed node instead loses
+ * everything at once:
+ *   - all interfaces go down (Ipv4StaticRouting withdraws their routes),
+ *   - the rest of the FIB is cleared, except loopback, and so is a bulk
+ *     FIB (see wan-fib-routing.h),
+ *   - packets waiting in its queue discs and device queues are dropped,
+ *   - registered state listeners (applications, other FIBs) are told to
+ *     drop their state.
+ *
+ * Recovery follows a router's boot sequence: when power returns the node
+ * boots for BootDelay, then brings its interfaces up (connected routes
+ * return), then after RouteInstallDelay reinstalls the static routes and the
+ * bulk FIB of its startup configuration and notifies the listeners.
+ */
+
+#ifndef WAN_NODE_FAILURE_H
+#define WAN_NODE_FAILURE_H
+
+#include "wan-fib-routing.h"
+
+#include "ns3/callback.h"
+#include "ns3/event-id.h"
+#include "ns3/ipv4-routing-table-entry.h"
+#include "ns3/node.h"
+#include "ns3/nstime.h"
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Schedules node failures and models the reboot of the failed routers.
+ */
+class WanNodeFailureInjector
+{
+  public:
+    /**
+     * Called with false when the node fails and with true once it has
+     * rebooted and reinstalled its routes.
+     */
+    typedef Callback<void, bool> StateCallback;
+
+    WanNodeFailureInjector();
+
+    /// \param delay time from power-on until the interfaces come up
+    void SetBootDelay(Time delay);
+
+    /// \param delay time from interfaces up until the static routes are installed
+    void SetRouteInstallDelay(Time delay);
+
+    /**
+     * Fail a node at a given time.
+     * \param node the node
+     * \param at failure time
+     * \param downtime time until power returns; zero for a plain reboot
+     */
+    void Schedule(Ptr<Node> node, Time at, Time downtime);
+
+    /**
+     * Register a listener for the state of one node.
+     */
+    void AddStateListener(Ptr<Node> node, StateCallback callback);
+
+    /// Fail a node now
+    void Fail(Ptr<Node> node);
+
+    /// Start the boot sequence of a failed node now
+    void PowerOn(Ptr<Node> node);
+
+    /// \return true from failure until the routes are reinstalled
+    bool IsDown(Ptr<Node> node) const;
+
+  private:
+    /// A route of the startup configuration
+    struct SavedRoute
+    {
+        Ipv4RoutingTableEntry entry; //!< Destination, gateway and interface
+        uint32_t metric;             //!< Route metric
+    };
+
+    /// Per-node failure state
+    struct NodeState
+    {
+        bool down{false};                       //!< Failed or still booting
+        bool routesSaved{false};                //!< routes holds the startup configuration
+        std::vector<SavedRoute> routes;         //!< Static routes to reinstall
+        std::vector<WanFibRouting::Route> fib;  //!< Bulk FIB to reload
+        std::vector<StateCallback> listeners;   //!< State listeners
+        EventId bootEvent;                      //!< Pending interfaces-up event
+        EventId routeEvent;                     //!< Pending route install event
+    };
+
+    /// Boot finished: bring the interfaces up
+    void InterfacesUp(Ptr<Node> node);
+
+    /// Reinstall the saved static routes and notify the listeners
+    void InstallRoutes(Ptr<Node> node);
+
+    Time m_bootDelay;                      //!< Power-on to interfaces up
+    Time m_routeInstallDelay;              //!< Interfaces up to routes installed
+    std::map<uint32_t, NodeState> m_nodes; //!< State by node id
+};
+
+} // namespace ns3
+
+#endif /* WAN_NODE_FAILURE_H */
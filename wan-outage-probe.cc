@@ -0,0 +1,249 @@
+/*
+ * Outage probe: how long is traffic between two sites interrupted?
+ */
+
+#include "wan-outage-probe.h"
+
+#include "ns3/abort.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/log.h"
+#include "ns3/packet.h"
+#include "ns3/simulator.h"
+#include "ns3/udp-socket-factory.h"
+
+#include <algorithm>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("WanOutageProbe");
+
+WanOutageProbe::WanOutageProbe(const std::string& name,
+                               Ptr<Node> source,
+                               Ptr<Node> sink,
+                               Ipv4Address sinkAddress,
+                               uint16_t port)
+    : m_name(name),
+      m_source(source),
+      m_sink(sink),
+      m_sinkAddress(sinkAddress),
+      m_port(port),
+      m_interval(MilliSeconds(50)),
+      m_p95Delay(0.95)
+{
+}
+
+void
+WanOutageProbe::SetInterval(Time interval)
+{
+    m_interval = interval;
+}
+
+void
+WanOutageProbe::SetReorderAnalyzer(WanReorderAnalyzer& analyzer)
+{
+    m_analyzer = &analyzer;
+    m_flow = analyzer.AddFlow(m_name);
+}
+
+void
+WanOutageProbe::Start(Time start, Time stop)
+{
+    m_start = start;
+    m_stop = stop;
+    m_lastArrival = start;
+    Simulator::Schedule(start, &WanOutageProbe::Open, this);
+}
+
+void
+WanOutageProbe::Truncate(Time stop)
+{
+    NS_ABORT_MSG_IF(stop < Simulator::Now(), "Probe stop " << stop.As(Time::S) << " has passed");
+    m_stop = std::min(m_stop, stop);
+}
+
+void
+WanOutageProbe::SetNodeState(Ptr<Node> node, bool up)
+{
+    if (!m_opened || Simulator::Now() >= m_stop)
+    {
+        return;
+    }
+    if (node == m_source)
+    {
+        m_sendEvent.Cancel();
+        if (m_sendSocket)
+        {
+            m_sendSocket->Close();
+            m_sendSocket = nullptr;
+        }
+        if (up)
+        {
+            OpenSource();
+        }
+    }
+    if (node == m_sink)
+    {
+        if (m_recvSocket)
+        {
+            m_recvSocket->Close();
+            m_recvSocket = nullptr;
+        }
+        if (up)
+        {
+            OpenSink();
+        }
+    }
+}
+
+void
+WanOutageProbe::Open()
+{
+    m_opened = true;
+    OpenSink();
+    OpenSource();
+}
+
+void
+WanOutageProbe::OpenSink()
+{
+    m_recvSocket = Socket::CreateSocket(m_sink, UdpSocketFactory::GetTypeId());
+    m_recvSocket->Bind(InetSocketAddress(Ipv4Address::GetAny(), m_port));
+    m_recvSocket->SetRecvCallback(MakeCallback(&WanOutageProbe::Receive, this));
+}
+
+void
+WanOutageProbe::OpenSource()
+{
+    m_sendSocket = Socket::CreateSocket(m_source, UdpSocketFactory::GetTypeId());
+    m_sendSocket->Connect(InetSocketAddress(m_sinkAddress, m_port));
+    Send();
+}
+
+void
+WanOutageProbe::Send()
+{
+    if (Simulator::Now() >= m_stop)
+    {
+        return;
+    }
+    // Sends fail while there is no route; the probe counts as lost
+    uint8_t payload[64] = {};
+    uint64_t now = Simulator::Now().GetNanoSeconds();
+    for (uint32_t i = 0; i < 8; ++i)
+    {
+        payload[i] = (now >> (8 * i)) & 0xff;
+    }
+    Ptr<Packet> packet = Create<Packet>(payload, sizeof(payload));
+    if (m_analyzer)
+    {
+        m_analyzer->TagPacket(m_flow, packet);
+    }
+    m_sendSocket->Send(packet);
+    ++m_sent;
+    m_sendEvent = Simulator::Schedule(m_interval, &WanOutageProbe::Send, this);
+}
+
+void
+WanOutageProbe::Receive(Ptr<Socket> socket)
+{
+    Ptr<Packet> packet;
+    while ((packet = socket->Recv()))
+    {
+        if (Simulator::Now() > m_stop)
+        {
+            continue;
+        }
+        uint8_t stamp[8];
+        packet->CopyData(stamp, sizeof(stamp));
+        uint64_t sentNs = 0;
+        for (uint32_t i = 0; i < 8; ++i)
+        {
+            sentNs |= static_cast<uint64_t>(stamp[i]) << (8 * i);
+        }
+        if (NanoSeconds(sentNs) < m_latestSent)
+        {
+            ++m_reordered;
+        }
+        m_latestSent = std::max(m_latestSent, NanoSeconds(sentNs));
+        Time delay = Simulator::Now() - NanoSeconds(sentNs);
+        m_delaySum += delay;
+        m_maxDelay = std::max(m_maxDelay, delay);
+        m_p95Delay.Add(delay.GetSeconds());
+
+        ++m_received;
+        CloseGap(Simulator::Now());
+        m_lastArrival = Simulator::Now();
+    }
+}
+
+void
+WanOutageProbe::CloseGap(Time now)
+{
+    Time gap = now - m_lastArrival;
+    m_longestGap = std::max(m_longestGap, gap);
+    if (gap > m_interval * 3 / 2)
+    {
+        m_affected += gap - m_interval;
+        NS_LOG_INFO(m_name << ": no arrivals from " << m_lastArrival.GetSeconds() << "s to "
+                           << now.GetSeconds() << "s");
+    }
+}
+
+const std::string&
+WanOutageProbe::GetName() const
+{
+    return m_name;
+}
+
+uint32_t
+WanOutageProbe::GetSent() const
+{
+    return m_sent;
+}
+
+uint32_t
+WanOutageProbe::GetReceived() const
+{
+    return m_received;
+}
+
+uint32_t
+WanOutageProbe::GetReordered() const
+{
+    return m_reordered;
+}
+
+Time
+WanOutageProbe::GetLongestGap() const
+{
+    Time tail = std::min(Simulator::Now(), m_stop) - m_lastArrival;
+    return std::max(m_longestGap, tail);
+}
+
+Time
+WanOutageProbe::GetAffectedTime() const
+{
+    Time tail = std::min(Simulator::Now(), m_stop) - m_lastArrival;
+    return tail > m_interval * 3 / 2 ? m_affected + tail - m_interval : m_affected;
+}
+
+Time
+WanOutageProbe::GetMeanDelay() const
+{
+    return m_received > 0 ? m_delaySum / m_received : Time();
+}
+
+Time
+WanOutageProbe::GetMaxDelay() const
+{
+    return m_maxDelay;
+}
+
+Time
+WanOutageProbe::GetP95Delay() const
+{
+    return Seconds(m_p95Delay.Get());
+}
+
+} // namespace ns3
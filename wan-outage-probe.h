@@ -0,0 +1,144 @@
+/*
+ * Outage probe: how long is traffic between two sites interrupted?
+ *
+ * A probe sends small UDP packets at a fixed interval from one node to
+ * another and watches the arrivals. A silence longer than 1.5 intervals is
+ * an interruption; it contributes its length minus one interval (the
+ * spacing a healthy flow has anyway) to the affected time. Probes carry
+ * their send time, so one-way delay is measured too, and so is reordering:
+ * a probe sent before one that already arrived is counted as reordered. Memory is constant:
+ * only the previous arrival and running delay sums are kept.
+ */
+
+#ifndef WAN_OUTAGE_PROBE_H
+#define WAN_OUTAGE_PROBE_H
+
+#include "wan-metrics.h"
+#include "wan-reorder-analyzer.h"
+
+#include "ns3/event-id.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/node.h"
+#include "ns3/nstime.h"
+#include "ns3/socket.h"
+
+#include <cstdint>
+#include <string>
+
+namespace ns3
+{
+
+/**
+ * One-way constant-rate probe flow with gap measurement.
+ */
+class WanOutageProbe
+{
+  public:
+    /**
+     * \param name label for reports, e.g. "HQ->Branch"
+     * \param source sending node
+     * \param sink receiving node
+     * \param sinkAddress address of the sink to send to
+     * \param port UDP port of the sink
+     */
+    WanOutageProbe(const std::string& name,
+                   Ptr<Node> source,
+                   Ptr<Node> sink,
+                   Ipv4Address sinkAddress,
+                   uint16_t port);
+
+    /// \param interval time between probe packets (default 50ms)
+    void SetInterval(Time interval);
+
+    /// Tag the probes with sequence numbers of a flow of the analyzer
+    void SetReorderAnalyzer(WanReorderAnalyzer& analyzer);
+
+    /// Send probes from start until stop
+    void Start(Time start, Time stop);
+
+    /// End the measurement early, at a stop that has not passed yet
+    void Truncate(Time stop);
+
+    /**
+     * A node failed or came back: its end of the flow loses its socket and
+     * stops, and restarts once the node is up. The measurement goes on.
+     * \param node the node
+     * \param up false when it fails, true once it has rebooted
+     */
+    void SetNodeState(Ptr<Node> node, bool up);
+
+    /// \return the report label
+    const std::string& GetName() const;
+
+    /// \return probes sent
+    uint32_t GetSent() const;
+
+    /// \return probes received
+    uint32_t GetReceived() const;
+
+    /// \return probes that arrived after a probe sent later
+    uint32_t GetReordered() const;
+
+    /// \return the longest time without an arrival, including the tail up to stop
+    Time GetLongestGap() const;
+
+    /// \return the total interruption time, see above
+    Time GetAffectedTime() const;
+
+    /// \return the mean one-way delay of received probes
+    Time GetMeanDelay() const;
+
+    /// \return the highest one-way delay of received probes
+    Time GetMaxDelay() const;
+
+    /// \return the 95th percentile of the one-way delay (streaming estimate)
+    Time GetP95Delay() const;
+
+  private:
+    /// Open the sockets and send the first probe
+    void Open();
+
+    /// Open the sink socket
+    void OpenSink();
+
+    /// Open the source socket and send a probe
+    void OpenSource();
+
+    /// Send one probe and schedule the next
+    void Send();
+
+    /// Sink receive callback
+    void Receive(Ptr<Socket> socket);
+
+    /// Account for a silence from the previous arrival until now
+    void CloseGap(Time now);
+
+    std::string m_name;                      //!< Report label
+    Ptr<Node> m_source;                      //!< Sending node
+    Ptr<Node> m_sink;                        //!< Receiving node
+    Ipv4Address m_sinkAddress;               //!< Destination address
+    uint16_t m_port;                         //!< Destination port
+    Time m_interval;                         //!< Probe interval
+    Time m_start;                            //!< First probe
+    Time m_stop;                             //!< End of the measurement
+    Ptr<Socket> m_sendSocket;                //!< Source socket
+    Ptr<Socket> m_recvSocket;                //!< Sink socket
+    WanReorderAnalyzer* m_analyzer{nullptr}; //!< Sequence tagging, if any
+    uint32_t m_flow{0};                      //!< Flow index in the analyzer
+    EventId m_sendEvent;                     //!< Next probe
+    bool m_opened{false};                    //!< Open() ran
+    uint32_t m_sent{0};                      //!< Probes sent
+    uint32_t m_received{0};                  //!< Probes received
+    uint32_t m_reordered{0};                 //!< Probes received out of order
+    Time m_latestSent;                       //!< Latest send time received so far
+    Time m_lastArrival;                      //!< Previous arrival, or m_start
+    Time m_longestGap;                       //!< Longest closed gap
+    Time m_affected;                         //!< Sum of closed gaps
+    Time m_delaySum;                         //!< Sum of one-way delays
+    Time m_maxDelay;                         //!< Highest one-way delay
+    WanP2Quantile m_p95Delay;                //!< 95th percentile of the delay, in seconds
+};
+
+} // namespace ns3
+
+#endif /* WAN_OUTAGE_PROBE_H */
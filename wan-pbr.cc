@@ -0,0 +1,772 @@
+/*
+ * Policy-based routing: traffic classes steered onto their own paths
+ */
+
+#include "wan-pbr.h"
+
+#include "wan-csv-reader.h"
+#include "wan-hash.h"
+
+#include "ns3/abort.h"
+#include "ns3/ipv4-list-routing.h"
+#include "ns3/ipv4-route.h"
+#include "ns3/log.h"
+#include "ns3/node.h"
+#include "ns3/output-stream-wrapper.h"
+#include "ns3/simulator.h"
+#include "ns3/socket.h"
+#include "ns3/tcp-header.h"
+#include "ns3/udp-header.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <tuple>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("WanPbr");
+
+NS_OBJECT_ENSURE_REGISTERED(WanPbrRouting);
+
+namespace
+{
+
+const uint8_t PROTOCOL_ICMP = 1; //!< ICMP
+const uint8_t PROTOCOL_TCP = 6;  //!< TCP
+const uint8_t PROTOCOL_UDP = 17; //!< UDP
+
+const uint8_t FIELD_PROTOCOL = 1;         //!< Tuple names the protocol
+const uint8_t FIELD_DSCP = 2;             //!< Tuple names the DSCP
+const uint8_t FIELD_SOURCE_PORT = 4;      //!< Tuple names the source port
+const uint8_t FIELD_DESTINATION_PORT = 8; //!< Tuple names the destination port
+
+/// \return the mask of a prefix length, host order
+uint32_t
+Mask(uint8_t length)
+{
+    return length == 0 ? 0 : ~0U << (32 - length);
+}
+
+/// \return the fields a rule names, FIELD_* bits
+uint8_t
+NamedFields(const WanPbrRouting::Rule& rule)
+{
+    return (rule.protocol >= 0 ? FIELD_PROTOCOL : 0) | (rule.dscp >= 0 ? FIELD_DSCP : 0) |
+           (rule.sourcePort >= 0 ? FIELD_SOURCE_PORT : 0) |
+           (rule.destinationPort >= 0 ? FIELD_DESTINATION_PORT : 0);
+}
+
+} // namespace
+
+/*
+ * WanPbrRouting
+ */
+
+void
+WanPbrRouting::Stats::Add(const Stats& other)
+{
+    lookups += other.lookups;
+    matched += other.matched;
+    probes += other.probes;
+}
+
+bool
+WanPbrRouting::Key::operator==(const Key& other) const
+{
+    return addresses == other.addresses && rest == other.rest;
+}
+
+size_t
+WanPbrRouting::KeyHash::operator()(const Key& key) const
+{
+    return SplitMix64(key.addresses ^ SplitMix64(key.rest));
+}
+
+TypeId
+WanPbrRouting::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::WanPbrRouting")
+                            .SetParent<Ipv4RoutingProtocol>()
+                            .SetGroupName("Internet")
+                            .AddConstructor<WanPbrRouting>();
+    return tid;
+}
+
+WanPbrRouting::WanPbrRouting()
+{
+}
+
+uint32_t
+WanPbrRouting::AddRule(const Rule& rule)
+{
+    NS_LOG_FUNCTION(this << rule.destination << +rule.destinationLength << rule.gateway);
+    NS_ABORT_MSG_IF(rule.sourceLength > 32 || rule.destinationLength > 32,
+                    "PBR prefix longer than 32 bits");
+    const uint32_t r = m_rules.size();
+    m_rules.push_back(rule);
+    m_hits.push_back(0);
+
+    // Rules come in order, so a new tuple's first rule is its earliest
+    const uint8_t named = NamedFields(rule);
+    auto [it, added] = m_tupleIndex.emplace(
+        std::make_tuple(rule.sourceLength, rule.destinationLength, named),
+        m_tuples.size());
+    if (added)
+    {
+        m_tuples.push_back({Mask(rule.sourceLength), Mask(rule.destinationLength), named, r, {}});
+    }
+    Tuple& tuple = m_tuples[it->second];
+    Fields fields{rule.source.Get(),
+                  rule.destination.Get(),
+                  static_cast<uint8_t>(std::max<int16_t>(rule.protocol, 0)),
+                  static_cast<uint8_t>(std::max<int16_t>(rule.dscp, 0)),
+                  static_cast<uint16_t>(std::max(rule.sourcePort, 0)),
+                  static_cast<uint16_t>(std::max(rule.destinationPort, 0)),
+                  true,
+                  true};
+    // Rules of an equal key are tried in order while their next hops are down
+    tuple.keys[MakeKey(fields, tuple.sourceMask, tuple.destinationMask, named)].push_back(r);
+    return r;
+}
+
+uint32_t
+WanPbrRouting::GetNRules() const
+{
+    return m_rules.size();
+}
+
+uint32_t
+WanPbrRouting::GetNTuples() const
+{
+    return m_tuples.size();
+}
+
+uint64_t
+WanPbrRouting::GetHits(uint32_t rule) const
+{
+    return m_hits.at(rule);
+}
+
+const WanPbrRouting::Stats&
+WanPbrRouting::GetStats() const
+{
+    return m_stats;
+}
+
+WanPbrRouting::Key
+WanPbrRouting::MakeKey(const Fields& fields,
+                       uint32_t sourceMask,
+                       uint32_t destinationMask,
+                       uint8_t named)
+{
+    Key key;
+    key.addresses = static_cast<uint64_t>(fields.source & sourceMask) << 32 |
+                    (fields.destination & destinationMask);
+    key.rest = static_cast<uint64_t>(named & FIELD_PROTOCOL ? fields.protocol : 0) << 40 |
+               static_cast<uint64_t>(named & FIELD_DSCP ? fields.dscp : 0) << 32 |
+               static_cast<uint64_t>(named & FIELD_SOURCE_PORT ? fields.sourcePort : 0) << 16 |
+               (named & FIELD_DESTINATION_PORT ? fields.destinationPort : 0);
+    return key;
+}
+
+void
+WanPbrRouting::Probe(const Tuple& tuple, const Fields& fields, int32_t interface, uint32_t& best)
+{
+    ++m_stats.probes;
+    auto it =
+        tuple.keys.find(MakeKey(fields, tuple.sourceMask, tuple.destinationMask, tuple.fields));
+    if (it == tuple.keys.end())
+    {
+        return;
+    }
+    for (uint32_t r : it->second)
+    {
+        if (r >= best)
+        {
+            return;
+        }
+        const Rule& rule = m_rules[r];
+        if (m_ipv4->IsUp(rule.interface) &&
+            (interface < 0 || rule.interface == static_cast<uint32_t>(interface)))
+        {
+            best = r;
+            return;
+        }
+    }
+}
+
+const WanPbrRouting::Rule*
+WanPbrRouting::Classify(const Fields& fields, int32_t interface)
+{
+    ++m_stats.lookups;
+    uint32_t best = std::numeric_limits<uint32_t>::max();
+    for (const Tuple& tuple : m_tuples)
+    {
+        if (tuple.first >= best)
+        {
+            break; // no earlier rule in this or any later tuple
+        }
+        if (!fields.ports && tuple.fields & (FIELD_SOURCE_PORT | FIELD_DESTINATION_PORT))
+        {
+            continue;
+        }
+        if (fields.sourceKnown || tuple.sourceMask == 0)
+        {
+            Probe(tuple, fields, interface, best);
+            continue;
+        }
+        // The source will be the address of the interface the rule sends
+        // by: probe with each interface's address for its own rules only
+        for (uint32_t i = 1; i < m_ipv4->GetNInterfaces(); ++i)
+        {
+            if ((interface >= 0 && i != static_cast<uint32_t>(interface)) ||
+                !m_ipv4->IsUp(i) || m_ipv4->GetNAddresses(i) == 0)
+            {
+                continue;
+            }
+            Fields own = fields;
+            own.source = m_ipv4->GetAddress(i, 0).GetLocal().Get();
+            Probe(tuple, own, i, best);
+        }
+    }
+    if (best == std::numeric_limits<uint32_t>::max())
+    {
+        return nullptr;
+    }
+    ++m_stats.matched;
+    ++m_hits[best];
+    return &m_rules[best];
+}
+
+Ptr<Ipv4Route>
+WanPbrRouting::MakeRoute(const Rule& rule, Ipv4Address destination) const
+{
+    Ptr<Ipv4Route> route = Create<Ipv4Route>();
+    route->SetDestination(destination);
+    route->SetSource(m_ipv4->GetAddress(rule.interface, 0).GetLocal());
+    route->SetGateway(rule.gateway);
+    route->SetOutputDevice(m_ipv4->GetNetDevice(rule.interface));
+    return route;
+}
+
+Ptr<Ipv4Route>
+WanPbrRouting::RouteOutput(Ptr<Packet> p,
+                           const Ipv4Header& header,
+                           Ptr<NetDevice> oif,
+                           Socket::SocketErrno& sockerr)
+{
+    sockerr = Socket::ERROR_NOROUTETOHOST;
+    if (m_rules.empty() || header.GetDestination().IsMulticast())
+    {
+        return nullptr;
+    }
+    // Not yet built: no transport header, and the socket's TOS is in a tag
+    uint8_t tos = header.GetTos();
+    SocketIpTosTag tosTag;
+    if (p && p->PeekPacketTag(tosTag))
+    {
+        tos = tosTag.GetTos();
+    }
+    // An unbound socket's source is left to the route
+    Fields fields{header.GetSource().Get(),
+                  header.GetDestination().Get(),
+                  header.GetProtocol(),
+                  static_cast<uint8_t>(tos >> 2),
+                  0,
+                  0,
+                  false,
+                  m_ipv4->GetInterfaceForAddress(header.GetSource()) >= 0};
+    const Rule* rule = Classify(fields, oif ? m_ipv4->GetInterfaceForDevice(oif) : -1);
+    if (!rule)
+    {
+        return nullptr;
+    }
+    sockerr = Socket::ERROR_NOTERROR;
+    return MakeRoute(*rule, header.GetDestination());
+}
+
+bool
+WanPbrRouting::RouteInput(Ptr<const Packet> p,
+                          const Ipv4Header& header,
+                          Ptr<const NetDevice> /* idev */,
+                          const UnicastForwardCallback& ucb,
+                          const MulticastForwardCallback& /* mcb */,
+                          const LocalDeliverCallback& /* lcb */,
+                          const ErrorCallback& /* ecb */)
+{
+    // The list routing has already delivered local packets
+    if (m_rules.empty() || header.GetDestination().IsMulticast())
+    {
+        return false;
+    }
+    Fields fields{header.GetSource().Get(),
+                  header.GetDestination().Get(),
+                  header.GetProtocol(),
+                  static_cast<uint8_t>(header.GetTos() >> 2),
+                  0,
+                  0,
+                  false,
+                  true};
+    if (header.GetProtocol() == PROTOCOL_UDP && p->GetSize() >= 8)
+    {
+        UdpHeader udp;
+        p->PeekHeader(udp);
+        fields.sourcePort = udp.GetSourcePort();
+        fields.destinationPort = udp.GetDestinationPort();
+        fields.ports = true;
+    }
+    else if (header.GetProtocol() == PROTOCOL_TCP && p->GetSize() >= 20)
+    {
+        TcpHeader tcp;
+        p->PeekHeader(tcp);
+        fields.sourcePort = tcp.GetSourcePort();
+        fields.destinationPort = tcp.GetDestinationPort();
+        fields.ports = true;
+    }
+    const Rule* rule = Classify(fields);
+    if (!rule)
+    {
+        return false;
+    }
+    ucb(MakeRoute(*rule, header.GetDestination()), p, header);
+    return true;
+}
+
+void
+WanPbrRouting::NotifyInterfaceUp(uint32_t /* interface */)
+{
+}
+
+void
+WanPbrRouting::NotifyInterfaceDown(uint32_t /* interface */)
+{
+}
+
+void
+WanPbrRouting::NotifyAddAddress(uint32_t /* interface */, Ipv4InterfaceAddress /* address */)
+{
+}
+
+void
+WanPbrRouting::NotifyRemoveAddress(uint32_t /* interface */, Ipv4InterfaceAddress /* address */)
+{
+}
+
+void
+WanPbrRouting::SetIpv4(Ptr<Ipv4> ipv4)
+{
+    m_ipv4 = ipv4;
+}
+
+void
+WanPbrRouting::PrintRoutingTable(Ptr<OutputStreamWrapper> stream, Time::Unit unit) const
+{
+    std::ostream& os = *stream->GetStream();
+    os << "Node: " << m_ipv4->GetObject<Node>()->GetId() << ", Time: " << Simulator::Now().As(unit)
+       << ", WanPbrRouting (" << GetNRules() << " rules in " << GetNTuples() << " tuples)"
+       << std::endl;
+    for (uint32_t r = 0; r < m_rules.size(); ++r)
+    {
+        const Rule& rule = m_rules[r];
+        os << "  " << r << ": src " << rule.source << "/" << +rule.sourceLength << " dst "
+           << rule.destination << "/" << +rule.destinationLength;
+        if (rule.protocol >= 0)
+        {
+            os << " proto " << rule.protocol;
+        }
+        if (rule.dscp >= 0)
+        {
+            os << " dscp " << rule.dscp;
+        }
+        if (rule.sourcePort >= 0)
+        {
+            os << " sport " << rule.sourcePort;
+        }
+        if (rule.destinationPort >= 0)
+        {
+            os << " dport " << rule.destinationPort;
+        }
+        os << " via " << rule.gateway << " if" << rule.interface
+           << (m_ipv4->IsUp(rule.interface) ? "" : " (down)") << std::endl;
+    }
+}
+
+void
+WanPbrRouting::DoDispose()
+{
+    m_ipv4 = nullptr;
+    m_tuples.clear();
+    m_tupleIndex.clear();
+    Ipv4RoutingProtocol::DoDispose();
+}
+
+/*
+ * WanPbrEngine
+ */
+
+WanPbrEngine::WanPbrEngine(const WanTopology& topology, const WanNetwork& network)
+    : m_topology(topology),
+      m_network(network)
+{
+}
+
+bool
+WanPbrEngine::ParseDscp(const std::string& name, uint8_t& dscp)
+{
+    const std::string n = WanCsvReader::ToLower(WanCsvReader::Trim(name));
+    double number;
+    if (WanCsvReader::ParseNumber(n, number))
+    {
+        if (number < 0 || number > 63 || number != static_cast<uint8_t>(number))
+        {
+            return false;
+        }
+        dscp = number;
+        return true;
+    }
+    if (n == "be" || n == "default")
+    {
+        dscp = 0;
+        return true;
+    }
+    if (n == "ef")
+    {
+        dscp = 46;
+        return true;
+    }
+    if (n.size() == 3 && n.compare(0, 2, "cs") == 0 && n[2] >= '0' && n[2] <= '7')
+    {
+        dscp = 8 * (n[2] - '0');
+        return true;
+    }
+    if (n.size() == 4 && n.compare(0, 2, "af") == 0 && n[2] >= '1' && n[2] <= '4' &&
+        n[3] >= '1' && n[3] <= '3')
+    {
+        dscp = 8 * (n[2] - '0') + 2 * (n[3] - '0');
+        return true;
+    }
+    return false;
+}
+
+std::vector<std::pair<Ipv4Address, uint8_t>>
+WanPbrEngine::ParsePrefixes(const std::string& value, const std::string& text) const
+{
+    if (value.empty() || WanCsvReader::ToLower(value) == "any")
+    {
+        return {{Ipv4Address(), 0}};
+    }
+    int64_t site = m_topology.FindSite(value);
+    if (site >= 0)
+    {
+        // Every address of the site, one /32 each
+        std::vector<std::pair<Ipv4Address, uint8_t>> prefixes;
+        const WanGraph& graph = m_network.graph;
+        for (uint32_t arc = graph.Begin(site); arc < graph.End(site); ++arc)
+        {
+            prefixes.emplace_back(
+                m_network.linkInterfaces[graph.GetLink(arc)].GetAddress(graph.GetLocalEnd(arc)),
+                32);
+        }
+        NS_ABORT_MSG_IF(prefixes.empty(),
+                        "PBR rule '" << text << "': " << value << " has no address");
+        return prefixes;
+    }
+    size_t slash = value.find('/');
+    std::string address = value.substr(0, slash);
+    double length = 32;
+    NS_ABORT_MSG_UNLESS(!address.empty() &&
+                            address.find_first_not_of("0123456789.") == std::string::npos &&
+                            std::count(address.begin(), address.end(), '.') == 3,
+                        "PBR rule '" << text << "': " << value
+                                     << " is no prefix, address or site");
+    NS_ABORT_MSG_UNLESS(slash == std::string::npos ||
+                            (WanCsvReader::ParseNumber(value.substr(slash + 1), length) &&
+                             length >= 0 && length <= 32 && length == static_cast<int>(length)),
+                        "PBR rule '" << text << "': bad prefix length in " << value);
+    return {{Ipv4Address(address.c_str()).CombineMask(Ipv4Mask(Mask(length))),
+             static_cast<uint8_t>(length)}};
+}
+
+void
+WanPbrEngine::AddRule(const std::string& router,
+                      const std::vector<std::pair<std::string, std::string>>& fields,
+                      const std::string& text)
+{
+    Spec spec;
+    spec.text = text;
+    int64_t site = m_topology.FindSite(router);
+    NS_ABORT_MSG_IF(site < 0, "PBR rule '" << text << "': no router " << router);
+    spec.router = site;
+
+    WanPbrRouting::Rule rule;
+    std::string source;
+    std::string destination;
+    bool via = false;
+    auto port = [&text](const std::string& value) {
+        double number;
+        NS_ABORT_MSG_UNLESS(WanCsvReader::ParseNumber(value, number) && number >= 0 &&
+                                number <= 65535 && number == static_cast<int32_t>(number),
+                            "PBR rule '" << text << "': bad port " << value);
+        return static_cast<int32_t>(number);
+    };
+    for (const auto& [name, value] : fields)
+    {
+        if (value.empty())
+        {
+            continue;
+        }
+        if (name == "src" || name == "source")
+        {
+            source = value;
+        }
+        else if (name == "dst" || name == "destination")
+        {
+            destination = value;
+        }
+        else if (name == "proto" || name == "protocol")
+        {
+            const std::string protocol = WanCsvReader::ToLower(value);
+            double number;
+            if (protocol == "udp")
+            {
+                rule.protocol = PROTOCOL_UDP;
+            }
+            else if (protocol == "tcp")
+            {
+                rule.protocol = PROTOCOL_TCP;
+            }
+            else if (protocol == "icmp")
+            {
+                rule.protocol = PROTOCOL_ICMP;
+            }
+            else
+            {
+                NS_ABORT_MSG_UNLESS(WanCsvReader::ParseNumber(protocol, number) && number >= 0 &&
+                                        number <= 255 && number == static_cast<int>(number),
+                                    "PBR rule '" << text << "': bad protocol " << value);
+                rule.protocol = number;
+            }
+        }
+        else if (name == "dscp")
+        {
+            uint8_t dscp;
+            NS_ABORT_MSG_UNLESS(ParseDscp(value, dscp),
+                                "PBR rule '" << text << "': bad DSCP " << value);
+            rule.dscp = dscp;
+        }
+        else if (name == "sport")
+        {
+            rule.sourcePort = port(value);
+        }
+        else if (name == "dport")
+        {
+            rule.destinationPort = port(value);
+        }
+        else if (name == "via")
+        {
+            int64_t neighbor = m_topology.FindSite(value);
+            NS_ABORT_MSG_IF(neighbor < 0, "PBR rule '" << text << "': no site " << value);
+            const WanGraph& graph = m_network.graph;
+            for (uint32_t arc = graph.Begin(site); arc < graph.End(site) && !via; ++arc)
+            {
+                if (graph.GetTarget(arc) == neighbor)
+                {
+                    uint32_t link = graph.GetLink(arc);
+                    rule.gateway =
+                        m_network.linkInterfaces[link].GetAddress(1 - graph.GetLocalEnd(arc));
+                    rule.interface = graph.GetInterface(arc);
+                    via = true;
+                }
+            }
+            NS_ABORT_MSG_UNLESS(via,
+                                "PBR rule '" << text << "': " << value << " is not a neighbor of "
+                                             << router);
+        }
+        else
+        {
+            NS_FATAL_ERROR("PBR rule '" << text << "': unknown field " << name);
+        }
+    }
+    NS_ABORT_MSG_UNLESS(via, "PBR rule '" << text << "' has no via");
+    for (const auto& [sourceNetwork, sourceLength] : ParsePrefixes(source, text))
+    {
+        for (const auto& [destinationNetwork, destinationLength] :
+             ParsePrefixes(destination, text))
+        {
+            rule.source = sourceNetwork;
+            rule.sourceLength = sourceLength;
+            rule.destination = destinationNetwork;
+            rule.destinationLength = destinationLength;
+            spec.rules.push_back(rule);
+        }
+    }
+    m_specs.push_back(spec);
+}
+
+void
+WanPbrEngine::Add(const std::string& rules)
+{
+    std::istringstream list(rules);
+    std::string entry;
+    while (std::getline(list, entry, ';'))
+    {
+        entry = WanCsvReader::Trim(entry);
+        if (entry.empty())
+        {
+            continue;
+        }
+        size_t colon = entry.find(':');
+        NS_ABORT_MSG_IF(colon == std::string::npos,
+                        "PBR rule '" << entry << "' is not Router:field=value,...");
+        std::vector<std::pair<std::string, std::string>> fields;
+        std::istringstream items(entry.substr(colon + 1));
+        std::string item;
+        while (std::getline(items, item, ','))
+        {
+            item = WanCsvReader::Trim(item);
+            size_t equals = item.find('=');
+            NS_ABORT_MSG_IF(equals == std::string::npos,
+                            "PBR rule '" << entry << "': '" << item << "' is not field=value");
+            fields.emplace_back(WanCsvReader::ToLower(WanCsvReader::Trim(item.substr(0, equals))),
+                                WanCsvReader::Trim(item.substr(equals + 1)));
+        }
+        AddRule(WanCsvReader::Trim(entry.substr(0, colon)), fields, entry);
+    }
+}
+
+void
+WanPbrEngine::Load(const std::string& path)
+{
+    std::ifstream in(path);
+    NS_ABORT_MSG_UNLESS(in.is_open(), "Cannot open PBR rule file " << path);
+    WanCsvReader reader(in, path);
+    if (!reader.ReadHeader())
+    {
+        return;
+    }
+    int router = reader.RequireColumn({"router", "site"});
+    reader.RequireColumn({"via"});
+    std::vector<std::pair<std::string, int>> columns;
+    for (const char* name : {"src", "dst", "proto", "dscp", "sport", "dport", "via"})
+    {
+        columns.emplace_back(name, reader.FindColumn({name}));
+    }
+    while (reader.Next())
+    {
+        std::vector<std::pair<std::string, std::string>> fields;
+        for (const auto& [name, column] : columns)
+        {
+            if (column >= 0)
+            {
+                fields.emplace_back(name, reader.Get(column));
+            }
+        }
+        std::ostringstream text;
+        text << path << ":" << reader.GetLineNumber();
+        AddRule(reader.Get(router), fields, text.str());
+    }
+}
+
+void
+WanPbrEngine::Install()
+{
+    NS_LOG_FUNCTION(this);
+    m_routing.assign(m_topology.GetNSites(), nullptr);
+    for (Spec& spec : m_specs)
+    {
+        Ptr<WanPbrRouting>& routing = m_routing[spec.router];
+        if (!routing)
+        {
+            Ptr<Ipv4> ipv4 = m_network.nodes.Get(spec.router)->GetObject<Ipv4>();
+            Ptr<Ipv4ListRouting> list = DynamicCast<Ipv4ListRouting>(ipv4->GetRoutingProtocol());
+            NS_ABORT_MSG_UNLESS(list, "PBR needs list routing on " << spec.router);
+            routing = CreateObject<WanPbrRouting>();
+            list->AddRoutingProtocol(routing, WanPbrRouting::PRIORITY);
+        }
+        spec.first = routing->GetNRules();
+        for (const WanPbrRouting::Rule& rule : spec.rules)
+        {
+            routing->AddRule(rule);
+        }
+    }
+}
+
+uint32_t
+WanPbrEngine::GetNRules() const
+{
+    return m_specs.size();
+}
+
+uint64_t
+WanPbrEngine::GetHits(uint32_t rule) const
+{
+    const Spec& spec = m_specs.at(rule);
+    uint64_t hits = 0;
+    for (uint32_t r = spec.first; r < spec.first + spec.rules.size(); ++r)
+    {
+        hits += m_routing[spec.router]->GetHits(r);
+    }
+    return hits;
+}
+
+WanPbrRouting::Stats
+WanPbrEngine::GetStats() const
+{
+    WanPbrRouting::Stats stats;
+    for (const Ptr<WanPbrRouting>& routing : m_routing)
+    {
+        if (routing)
+        {
+            stats.Add(routing->GetStats());
+        }
+    }
+    return stats;
+}
+
+void
+WanPbrEngine::Print(std::ostream& os) const
+{
+    uint32_t routers = 0;
+    uint32_t rules = 0;
+    uint32_t tuples = 0;
+    for (const Ptr<WanPbrRouting>& routing : m_routing)
+    {
+        if (routing)
+        {
+            ++routers;
+            rules += routing->GetNRules();
+            tuples += routing->GetNTuples();
+        }
+    }
+    os << "\nPolicy-based routing: " << m_specs.size() << " rules (" << rules
+       << " compiled) in " << tuples << " tuples on " << routers << " routers" << std::endl;
+    for (const Spec& spec : m_specs)
+    {
+        os << "  " << spec.text << std::endl;
+    }
+}
+
+void
+WanPbrEngine::PrintCounters(std::ostream& os) const
+{
+    std::ios::fmtflags flags = os.flags();
+    std::streamsize precision = os.precision();
+    for (uint32_t rule = 0; rule < m_specs.size(); ++rule)
+    {
+        os << "PBR " << m_specs[rule].text << ": " << GetHits(rule) << " packets" << std::endl;
+    }
+    WanPbrRouting::Stats stats = GetStats();
+    os << "PBR classification: " << stats.lookups << " lookups, " << stats.matched
+       << " matched, " << std::fixed << std::setprecision(2)
+       << (stats.lookups > 0 ? static_cast<double>(stats.probes) / stats.lookups : 0.0)
+       << " tuples probed per lookup" << std::endl;
+    os.flags(flags);
+    os.precision(precision);
+}
+
+} // namespace ns3
@@ -0,0 +1,314 @@
+/*
+ * Policy-based routing: traffic classes steered onto their own paths
+ *
+ * Static and FIB routes send everything to a destination over one path,
+ * whatever its type. Policy-based routing (PBR) matches packets on
+ * source and destination prefixes, IP protocol, DSCP and ports, and sends
+ * the first matching rule's class to that rule's next hop, e.g. backup
+ * traffic from HQ to DC via Branch while voice keeps the direct circuit.
+ *
+ * Rules are kept in order and the first match whose next hop is up wins,
+ * as in a router's route map. Testing hundreds of rules one by one per packet is what
+ * makes PBR slow in software routers, so the rules are compiled for tuple
+ * space search: rules that specify the same fields (the same prefix
+ * lengths, and which of protocol, DSCP and ports they name) form a tuple.
+ * Within a tuple the masked fields of a packet are one hash key. A lookup
+ * probes one hash table per tuple, tuples in order of their first rule,
+ * and stops at the first tuple that cannot hold an earlier rule than the
+ * best match so far. Real rule sets have few tuples, so a lookup costs a
+ * handful of probes whatever the number of rules.
+ *
+ * Forwarded packets are classified on their IP header and, for UDP and
+ * TCP, their ports. A router's own packets are routed before they have a
+ * transport header: rules that name ports do not match them, and their
+ * DSCP comes from the socket. A packet of an unbound socket has no source
+ * yet: it takes the address of the interface it leaves by, so a rule with
+ * a source prefix matches it if its own interface's address is in the
+ * prefix. When no matching rule's next hop is up, the packet follows the
+ * other protocols. PBR sits above the redundancy
+ * policy routes (see wan-redundancy.h) and below tenant VRFs (see
+ * wan-vrf.h). It does not route by destination only, so the route cache
+ * (see wan-route-cache.h) passes the lookups of a router with rules
+ * through.
+ */
+
+#ifndef WAN_PBR_H
+#define WAN_PBR_H
+
+#include "wan-topology-helper.h"
+#include "wan-topology.h"
+
+#include "ns3/ipv4-address.h"
+#include "ns3/ipv4-routing-protocol.h"
+#include "ns3/ipv4.h"
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Ordered classification rules of one router, compiled for tuple space search.
+ */
+class WanPbrRouting : public Ipv4RoutingProtocol
+{
+  public:
+    /// A match and the next hop of its class
+    struct Rule
+    {
+        Ipv4Address source;           //!< Source network
+        uint8_t sourceLength{0};      //!< Source prefix length; 0: any
+        Ipv4Address destination;      //!< Destination network
+        uint8_t destinationLength{0}; //!< Destination prefix length; 0: any
+        int16_t protocol{-1};         //!< IP protocol; -1: any
+        int16_t dscp{-1};             //!< DSCP; -1: any
+        int32_t sourcePort{-1};       //!< UDP/TCP source port; -1: any
+        int32_t destinationPort{-1};  //!< UDP/TCP destination port; -1: any
+        Ipv4Address gateway;          //!< Next hop
+        uint32_t interface{0};        //!< Outgoing interface
+    };
+
+    /// Classification counters of one or more routers
+    struct Stats
+    {
+        uint64_t lookups{0}; //!< Packets classified
+        uint64_t matched{0}; //!< Packets sent to a rule's next hop
+        uint64_t probes{0};  //!< Hash tables probed
+
+        /// Add the counters of another router
+        void Add(const Stats& other);
+    };
+
+    /// Priority in the list routing: above policy routes (10), below VRFs (20)
+    static const int16_t PRIORITY = 15;
+
+    /// Get the type ID
+    static TypeId GetTypeId();
+
+    WanPbrRouting();
+
+    /**
+     * Append a rule; earlier rules win.
+     * \param rule the rule
+     * \return its index
+     */
+    uint32_t AddRule(const Rule& rule);
+
+    /// \return the number of rules
+    uint32_t GetNRules() const;
+
+    /// \return the number of tuples the rules compile to
+    uint32_t GetNTuples() const;
+
+    /// \return the packets routed by a rule
+    uint64_t GetHits(uint32_t rule) const;
+
+    /// \return the classification counters
+    const Stats& GetStats() const;
+
+    // Inherited from Ipv4RoutingProtocol
+    Ptr<Ipv4Route> RouteOutput(Ptr<Packet> p,
+                               const Ipv4Header& header,
+                               Ptr<NetDevice> oif,
+                               Socket::SocketErrno& sockerr) override;
+    bool RouteInput(Ptr<const Packet> p,
+                    const Ipv4Header& header,
+                    Ptr<const NetDevice> idev,
+                    const UnicastForwardCallback& ucb,
+                    const MulticastForwardCallback& mcb,
+                    const LocalDeliverCallback& lcb,
+                    const ErrorCallback& ecb) override;
+    void NotifyInterfaceUp(uint32_t interface) override;
+    void NotifyInterfaceDown(uint32_t interface) override;
+    void NotifyAddAddress(uint32_t interface, Ipv4InterfaceAddress address) override;
+    void NotifyRemoveAddress(uint32_t interface, Ipv4InterfaceAddress address) override;
+    void SetIpv4(Ptr<Ipv4> ipv4) override;
+    void PrintRoutingTable(Ptr<OutputStreamWrapper> stream,
+                           Time::Unit unit = Time::S) const override;
+
+  protected:
+    void DoDispose() override;
+
+  private:
+    /// The classified fields of a packet
+    struct Fields
+    {
+        uint32_t source;          //!< Source address, host order
+        uint32_t destination;     //!< Destination address, host order
+        uint8_t protocol;         //!< IP protocol
+        uint8_t dscp;             //!< DSCP
+        uint16_t sourcePort;      //!< Source port, if known
+        uint16_t destinationPort; //!< Destination port, if known
+        bool ports;               //!< Ports known
+        bool sourceKnown;         //!< Source known; else that of the outgoing interface
+    };
+
+    /// Masked fields: the hash key of a rule or packet within a tuple
+    struct Key
+    {
+        uint64_t addresses; //!< Source and destination
+        uint64_t rest;      //!< Protocol, DSCP and ports
+
+        /// \return true if the keys are equal
+        bool operator==(const Key& other) const;
+    };
+
+    /// Hash of a key
+    struct KeyHash
+    {
+        /// \return the hash of a key
+        size_t operator()(const Key& key) const;
+    };
+
+    /// Rules of one key in a tuple, in order
+    using RuleList = std::vector<uint32_t>;
+
+    /// Rules that specify the same fields
+    struct Tuple
+    {
+        uint32_t sourceMask;                             //!< Source mask, host order
+        uint32_t destinationMask;                        //!< Destination mask, host order
+        uint8_t fields;                                  //!< Named fields, FIELD_* bits
+        uint32_t first;                                  //!< Earliest rule
+        std::unordered_map<Key, RuleList, KeyHash> keys; //!< Rules by key
+    };
+
+    /// \return the key of a packet's fields in a tuple
+    static Key MakeKey(const Fields& fields,
+                       uint32_t sourceMask,
+                       uint32_t destinationMask,
+                       uint8_t named);
+
+    /**
+     * \param fields the packet's fields
+     * \param interface the outgoing interface the rule must use; -1: any
+     * \return the earliest matching rule whose next hop is up, or nullptr
+     */
+    const Rule* Classify(const Fields& fields, int32_t interface = -1);
+
+    /**
+     * Look a packet up in one tuple.
+     * \param tuple the tuple
+     * \param fields the packet's fields
+     * \param interface the outgoing interface the rule must use; -1: any
+     * \param best the earliest usable rule so far, lowered on a better match
+     */
+    void Probe(const Tuple& tuple, const Fields& fields, int32_t interface, uint32_t& best);
+
+    /// \return an ns-3 route over a rule's next hop
+    Ptr<Ipv4Route> MakeRoute(const Rule& rule, Ipv4Address destination) const;
+
+    /// Tuple of a (source length, destination length, named fields)
+    using TupleIndex = std::map<std::tuple<uint8_t, uint8_t, uint8_t>, uint32_t>;
+
+    Ptr<Ipv4> m_ipv4;             //!< IPv4 of the router
+    std::vector<Rule> m_rules;    //!< Rules in order
+    std::vector<uint64_t> m_hits; //!< Packets routed by rule
+    std::vector<Tuple> m_tuples;  //!< Tuples by earliest rule
+    TupleIndex m_tupleIndex;      //!< Tuple index by what its rules specify
+    Stats m_stats;                //!< Counters
+};
+
+/**
+ * Builds the PBR rules of every router from rule specs.
+ */
+class WanPbrEngine
+{
+  public:
+    /**
+     * \param topology the topology the network was built from
+     * \param network the network
+     */
+    WanPbrEngine(const WanTopology& topology, const WanNetwork& network);
+
+    /**
+     * Add rules.
+     * \param rules e.g. "HQ:dscp=CS1,dst=DC,via=Branch;DC:dscp=CS1,dst=HQ,via=Branch":
+     *        rules separated by ';', each the router, ':' and comma-separated
+     *        fields src, dst (prefix, address or site), proto (udp, tcp,
+     *        icmp or a number), dscp (number, EF, AFxy or CSx), sport,
+     *        dport and, required, via (a neighbor site)
+     */
+    void Add(const std::string& rules);
+
+    /**
+     * Add rules from a CSV file with columns router and via, and optionally
+     * src, dst, proto, dscp, sport and dport, one rule per row.
+     * \param path file name
+     */
+    void Load(const std::string& path);
+
+    /// Add the rules to their routers
+    void Install();
+
+    /// \return the number of rules as given
+    uint32_t GetNRules() const;
+
+    /**
+     * \param rule index of a rule as given, below GetNRules()
+     * \return the packets routed by the rule on its router
+     */
+    uint64_t GetHits(uint32_t rule) const;
+
+    /// \return the classification counters of all routers
+    WanPbrRouting::Stats GetStats() const;
+
+    /// Print the rules and the tuples they compile to
+    void Print(std::ostream& os) const;
+
+    /// Print the packets routed by every rule and the classification cost
+    void PrintCounters(std::ostream& os) const;
+
+    /**
+     * Parse a DSCP.
+     * \param name a number, EF, AFxy, CSx or BE
+     * \param dscp the DSCP
+     * \return false if the name is unknown
+     */
+    static bool ParseDscp(const std::string& name, uint8_t& dscp);
+
+  private:
+    /// A rule as given: one router, one or more compiled rules
+    struct Spec
+    {
+        std::string text;                       //!< The rule as given
+        uint32_t router;                        //!< Router site
+        std::vector<WanPbrRouting::Rule> rules; //!< Compiled rules, one per address pair
+        uint32_t first{0};                      //!< Index of the first in the router
+    };
+
+    /**
+     * Add one rule.
+     * \param router router site name
+     * \param fields (name, value) pairs
+     * \param text the rule as given, for reports and errors
+     */
+    void AddRule(const std::string& router,
+                 const std::vector<std::pair<std::string, std::string>>& fields,
+                 const std::string& text);
+
+    /**
+     * Parse a src or dst value.
+     * \param value prefix, address, site name, or "any"
+     * \param text the rule, for errors
+     * \return (network, prefix length) pairs: one, or one per address of a site
+     */
+    std::vector<std::pair<Ipv4Address, uint8_t>> ParsePrefixes(const std::string& value,
+                                                               const std::string& text) const;
+
+    const WanTopology& m_topology;             //!< Topology
+    const WanNetwork& m_network;               //!< Network
+    std::vector<Spec> m_specs;                 //!< Rules as given, in order
+    std::vector<Ptr<WanPbrRouting>> m_routing; //!< PBR by site; nullptr without rules
+};
+
+} // namespace ns3
+
+#endif /* WAN_PBR_H */
@@ -0,0 +1,143 @@
+/*
+ * Point-to-point channel with delay variation and gray failures
+ */
+
+#include "wan-point-to-point-channel.h"
+
+#include "ns3/abort.h"
+#include "ns3/log.h"
+#include "ns3/pointer.h"
+#include "ns3/simulator.h"
+
+#include <algorithm>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("WanPointToPointChannel");
+
+NS_OBJECT_ENSURE_REGISTERED(WanPointToPointChannel);
+
+TypeId
+WanPointToPointChannel::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("ns3::WanPointToPointChannel")
+            .SetParent<PointToPointChannel>()
+            .SetGroupName("PointToPoint")
+            .AddConstructor<WanPointToPointChannel>()
+            .AddAttribute("Jitter",
+                          "Extra delay per packet, in seconds (none if unset)",
+                          PointerValue(),
+                          MakePointerAccessor(&WanPointToPointChannel::m_jitter),
+                          MakePointerChecker<RandomVariableStream>());
+    return tid;
+}
+
+WanPointToPointChannel::WanPointToPointChannel()
+    : m_grayRng(CreateObject<UniformRandomVariable>())
+{
+    NS_LOG_FUNCTION(this);
+}
+
+void
+WanPointToPointChannel::SetJitter(Ptr<RandomVariableStream> jitter)
+{
+    m_jitter = jitter;
+}
+
+int64_t
+WanPointToPointChannel::AssignStreams(int64_t stream)
+{
+    m_grayRng->SetStream(stream);
+    if (!m_jitter)
+    {
+        return 1;
+    }
+    m_jitter->SetStream(stream + 1);
+    return 2;
+}
+
+void
+WanPointToPointChannel::SetGrayFailure(uint32_t wire,
+                                       double loss,
+                                       Time extraDelay,
+                                       double corruption)
+{
+    NS_LOG_FUNCTION(this << wire << loss << extraDelay << corruption);
+    NS_ABORT_MSG_IF(wire > 1, "Channel direction must be 0 or 1");
+    m_gray[wire].loss = loss;
+    m_gray[wire].extraDelay = extraDelay;
+    m_gray[wire].corruption = corruption;
+    m_grayActive[wire] = loss > 0 || corruption > 0 || extraDelay.IsStrictlyPositive();
+}
+
+void
+WanPointToPointChannel::ClearGrayFailure(uint32_t wire)
+{
+    SetGrayFailure(wire, 0, Time(), 0);
+}
+
+uint64_t
+WanPointToPointChannel::GetLostPackets(uint32_t wire) const
+{
+    return m_gray[wire].lost;
+}
+
+uint64_t
+WanPointToPointChannel::GetCorruptedPackets(uint32_t wire) const
+{
+    return m_gray[wire].corrupted;
+}
+
+bool
+WanPointToPointChannel::TransmitStart(Ptr<const Packet> p,
+                                      Ptr<PointToPointNetDevice> src,
+                                      Time txTime)
+{
+    NS_LOG_FUNCTION(this << p << src << txTime);
+    uint32_t wire = (src == GetSource(0)) ? 0 : 1;
+    if (!m_jitter && !m_grayActive[wire])
+    {
+        return PointToPointChannel::TransmitStart(p, src, txTime);
+    }
+
+    // The sender spends txTime on the wire either way; the frame just
+    // never makes it to the receiver's upper layers
+    GrayFailure& gray = m_gray[wire];
+    if (gray.loss > 0 && m_grayRng->GetValue() < gray.loss)
+    {
+        ++gray.lost;
+        return true;
+    }
+    if (gray.corruption > 0 && m_grayRng->GetValue() < gray.corruption)
+    {
+        ++gray.corrupted;
+        return true;
+    }
+
+    Time delay = GetDelay();
+    Time extra = gray.extraDelay;
+    if (m_jitter)
+    {
+        extra += Seconds(std::max(0.0, m_jitter->GetValue()));
+    }
+
+    // Never overtake the previous packet in this direction
+    Time arrival = Simulator::Now() + txTime + delay + extra;
+    if (arrival < m_lastArrival[wire])
+    {
+        extra += m_lastArrival[wire] - arrival;
+        arrival = m_lastArrival[wire];
+    }
+    m_lastArrival[wire] = arrival;
+
+    // The base class schedules the reception and fires TxRxPointToPoint
+    // (which NetAnim listens to); lend it this packet's delay for the call.
+    SetAttribute("Delay", TimeValue(delay + extra));
+    bool sent = PointToPointChannel::TransmitStart(p, src, txTime);
+    SetAttribute("Delay", TimeValue(delay));
+    return sent;
+}
+
+} // namespace ns3
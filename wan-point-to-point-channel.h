@@ -0,0 +1,88 @@
+/*
+ * Point-to-point channel with delay variation and gray failures
+ */
+
+#ifndef WAN_POINT_TO_POINT_CHANNEL_H
+#define WAN_POINT_TO_POINT_CHANNEL_H
+
+#include "ns3/point-to-point-channel.h"
+#include "ns3/random-variable-stream.h"
+
+namespace ns3
+{
+
+/**
+ * A PointToPointChannel whose packets get an extra, random delay on top of
+ * the channel Delay (jitter of LTE or broadband circuits). Jitter never
+ * reorders packets within one direction: a packet that would overtake its
+ * predecessor is held back until the predecessor has arrived.
+ *
+ * Each direction can also suffer a gray failure: random loss, extra delay
+ * and corruption. Corrupted frames cross the wire but fail the receiver's
+ * frame check, so unlike lost frames they show up as input errors.
+ */
+class WanPointToPointChannel : public PointToPointChannel
+{
+  public:
+    /**
+     * \brief Get the TypeId
+     * \return The TypeId for this class
+     */
+    static TypeId GetTypeId();
+
+    WanPointToPointChannel();
+
+    /**
+     * \param jitter extra delay per packet, in seconds; nullptr disables jitter
+     */
+    void SetJitter(Ptr<RandomVariableStream> jitter);
+
+    /**
+     * Assign fixed random variable stream numbers to the gray failure and
+     * jitter variables.
+     * \param stream first stream index to use
+     * \return the number of stream indices assigned
+     */
+    int64_t AssignStreams(int64_t stream);
+
+    /**
+     * Degrade one direction of the channel.
+     * \param wire direction: 0 for packets sent by device 0, 1 for device 1
+     * \param loss probability that a packet silently disappears
+     * \param extraDelay delay added to every packet
+     * \param corruption probability that a packet fails the frame check
+     */
+    void SetGrayFailure(uint32_t wire, double loss, Time extraDelay, double corruption);
+
+    /// Remove the gray failure of one direction
+    void ClearGrayFailure(uint32_t wire);
+
+    /// \return packets lost in one direction
+    uint64_t GetLostPackets(uint32_t wire) const;
+
+    /// \return packets corrupted in one direction
+    uint64_t GetCorruptedPackets(uint32_t wire) const;
+
+    bool TransmitStart(Ptr<const Packet> p, Ptr<PointToPointNetDevice> src, Time txTime) override;
+
+  private:
+    /// Gray failure state of one direction
+    struct GrayFailure
+    {
+        double loss{0};        //!< Loss probability
+        Time extraDelay;       //!< Added delay
+        double corruption{0};  //!< Corruption probability
+        uint64_t lost{0};      //!< Packets lost
+        uint64_t corrupted{0}; //!< Packets corrupted
+    };
+
+    Ptr<RandomVariableStream> m_jitter;   //!< Extra delay per packet, in seconds
+    Ptr<UniformRandomVariable> m_grayRng; //!< Loss and corruption draws
+    Time m_lastArrival[2];                //!< Latest scheduled arrival per direction
+    GrayFailure m_gray[2];                //!< Gray failure per direction
+    bool m_grayActive[2]{false, false};   //!< Direction has a gray failure
+};
+
+} // namespace ns3
+
+#endif /* WAN_POINT_TO_POINT_CHANNEL_H */
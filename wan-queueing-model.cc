@@ -0,0 +1,365 @@
+/*
+ * Analytical queueing estimates: per-path delay and loss without packets
+ */
+
+#include "wan-queueing-model.h"
+
+#include "wan-csv-reader.h"
+
+#include "ns3/abort.h"
+#include "ns3/log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("WanQueueingModel");
+
+WanQueueingModel::WanQueueingModel(const WanTopology& topology)
+    : m_topology(topology),
+      m_graph(topology)
+{
+}
+
+void
+WanQueueingModel::SetQueue(Queue queue)
+{
+    m_queue = queue;
+}
+
+void
+WanQueueingModel::SetRouting(Routing routing)
+{
+    m_routing = routing;
+}
+
+void
+WanQueueingModel::SetQueueSize(uint32_t packets)
+{
+    NS_ABORT_MSG_IF(packets == 0, "Queue size must be positive");
+    m_queueSize = packets;
+}
+
+void
+WanQueueingModel::AddDemand(const WanDemand& demand)
+{
+    NS_ABORT_MSG_IF(demand.source >= m_topology.GetNSites() ||
+                        demand.target >= m_topology.GetNSites() || demand.source == demand.target,
+                    "Demand " << demand.name << ": bad sites");
+    NS_ABORT_MSG_IF(demand.rate < 0 || demand.packetSize == 0,
+                    "Demand " << demand.name << ": bad rate or packet size");
+    m_demands.push_back(demand);
+}
+
+void
+WanQueueingModel::LoadDemands(const std::string& path)
+{
+    std::ifstream in(path);
+    NS_ABORT_MSG_UNLESS(in.is_open(), "Cannot open demand file " << path);
+    WanCsvReader reader(in, path);
+    if (!reader.ReadHeader())
+    {
+        return;
+    }
+    int source = reader.RequireColumn({"source", "from"});
+    int target = reader.RequireColumn({"target", "to"});
+    int rate = reader.RequireColumn({"rate", "bandwidth"});
+    int packetSize = reader.FindColumn({"packet_size", "size"});
+    int name = reader.FindColumn({"name"});
+    while (reader.Next())
+    {
+        int64_t a = m_topology.FindSite(reader.Get(source));
+        int64_t b = m_topology.FindSite(reader.Get(target));
+        NS_ABORT_MSG_IF(a < 0 || b < 0,
+                        path << ":" << reader.GetLineNumber() << ": unknown site");
+        WanDemand demand;
+        demand.source = a;
+        demand.target = b;
+        demand.rate = WanCsvReader::ParseDataRate(reader.Get(rate)).GetBitRate();
+        demand.packetSize = 1000;
+        double number;
+        if (!reader.Get(packetSize).empty())
+        {
+            NS_ABORT_MSG_UNLESS(WanCsvReader::ParseNumber(reader.Get(packetSize), number) &&
+                                    number >= 1,
+                                path << ":" << reader.GetLineNumber() << ": bad packet size");
+            demand.packetSize = number;
+        }
+        demand.name = reader.Get(name).empty() ? reader.Get(source) + "->" + reader.Get(target)
+                                               : reader.Get(name);
+        AddDemand(demand);
+    }
+}
+
+const std::vector<WanDemand>&
+WanQueueingModel::GetDemands() const
+{
+    return m_demands;
+}
+
+std::vector<std::vector<int32_t>>
+WanQueueingModel::ComputeRoutes(const std::vector<bool>& up) const
+{
+    const uint32_t nSites = m_graph.GetNSites();
+    std::vector<std::vector<int32_t>> next(nSites, std::vector<int32_t>(nSites, -1));
+    std::vector<double> distance;
+    std::vector<int32_t> firstArc;
+    for (uint32_t source = 0; source < nSites; ++source)
+    {
+        m_graph.ShortestPaths(source, distance, firstArc, up);
+        for (uint32_t target = 0; target < nSites; ++target)
+        {
+            if (firstArc[target] >= 0)
+            {
+                next[source][target] = m_graph.GetLink(firstArc[target]);
+            }
+        }
+    }
+    return next;
+}
+
+WanQueueingModel::StateEstimate
+WanQueueingModel::Estimate(int32_t failed, const std::vector<std::vector<int32_t>>& intact) const
+{
+    const uint32_t nSites = m_topology.GetNSites();
+    const uint32_t nLinks = m_topology.GetNLinks();
+    std::vector<bool> up(nLinks, true);
+    StateEstimate state;
+    state.name = "intact";
+    if (failed >= 0)
+    {
+        up[failed] = false;
+        const WanLink& link = m_topology.GetLink(failed);
+        state.name = m_topology.GetSite(link.a).name + "-" + m_topology.GetSite(link.b).name;
+    }
+    std::vector<std::vector<int32_t>> rerouted;
+    if (failed >= 0 && m_routing == REROUTE)
+    {
+        rerouted = ComputeRoutes(up);
+    }
+    const std::vector<std::vector<int32_t>>& next = rerouted.empty() ? intact : rerouted;
+
+    // Walk every demand hop by hop; directions are 2 * link + (0: a->b, 1: b->a)
+    std::vector<std::vector<uint32_t>> paths(m_demands.size());
+    std::vector<double> bits(2 * nLinks, 0);
+    std::vector<double> packets(2 * nLinks, 0);
+    state.paths.assign(m_demands.size(), {false, 0, Time(), 1.0});
+    for (uint32_t d = 0; d < m_demands.size(); ++d)
+    {
+        const WanDemand& demand = m_demands[d];
+        uint32_t site = demand.source;
+        std::vector<uint32_t> path;
+        while (site != demand.target && path.size() < nSites)
+        {
+            int32_t l = next[site][demand.target];
+            if (l < 0 || !up[l])
+            {
+                break;
+            }
+            uint32_t end = m_graph.GetLinkEnd(l, 0) == site ? 0 : 1;
+            path.push_back(2 * l + end);
+            site = m_graph.GetLinkEnd(l, 1 - end);
+        }
+        if (site != demand.target)
+        {
+            continue;
+        }
+        state.paths[d].reachable = true;
+        state.paths[d].hops = path.size();
+        for (uint32_t direction : path)
+        {
+            bits[direction] += demand.rate;
+            packets[direction] += demand.rate / (8.0 * demand.packetSize);
+        }
+        paths[d] = path;
+    }
+
+    // Sojourn time and drop probability per direction
+    std::vector<double> sojourn(2 * nLinks, 0);
+    std::vector<double> drop(2 * nLinks, 0);
+    const double k = m_queueSize;
+    state.maxUtilization = 0;
+    for (uint32_t direction = 0; direction < 2 * nLinks; ++direction)
+    {
+        if (packets[direction] == 0)
+        {
+            continue;
+        }
+        const WanLink& link = m_topology.GetLink(direction / 2);
+        double capacity = link.bandwidth.GetBitRate();
+        double rho = bits[direction] / capacity;
+        double mu = capacity * packets[direction] / bits[direction];
+        if (rho > state.maxUtilization)
+        {
+            state.maxUtilization = rho;
+            uint32_t from = direction % 2 == 0 ? link.a : link.b;
+            uint32_t to = direction % 2 == 0 ? link.b : link.a;
+            state.busiest = m_topology.GetSite(from).name + "->" + m_topology.GetSite(to).name;
+        }
+        // Pollaczek-Khinchine waiting time, at most a full queue
+        double full = (k + 1) / mu;
+        double waiting = rho < 1 ? (m_queue == MM1 ? 1.0 : 0.5) * rho / (mu * (1 - rho)) : full;
+        sojourn[direction] = std::min(waiting + 1 / mu, full);
+        // M/M/1/K blocking, written in 1/rho above saturation to stay finite
+        if (rho < 1)
+        {
+            drop[direction] = (1 - rho) * std::pow(rho, k) / (1 - std::pow(rho, k + 1));
+        }
+        else if (rho == 1)
+        {
+            drop[direction] = 1 / (k + 1);
+        }
+        else
+        {
+            double r = 1 / rho;
+            drop[direction] = (1 - r) / (1 - std::pow(r, k + 1));
+        }
+    }
+
+    for (uint32_t d = 0; d < m_demands.size(); ++d)
+    {
+        PathEstimate& estimate = state.paths[d];
+        if (!estimate.reachable)
+        {
+            continue;
+        }
+        double delay = 0;
+        double delivered = 1;
+        for (uint32_t direction : paths[d])
+        {
+            const WanLink& link = m_topology.GetLink(direction / 2);
+            delay += link.delay.GetSeconds() + link.jitter.GetSeconds() + sojourn[direction];
+            delivered *= (1 - drop[direction]) * (1 - link.loss);
+        }
+        estimate.delay = Seconds(delay);
+        estimate.loss = 1 - delivered;
+    }
+    return state;
+}
+
+void
+WanQueueingModel::Run()
+{
+    auto started = std::chrono::steady_clock::now();
+    std::vector<bool> up(m_topology.GetNLinks(), true);
+    std::vector<std::vector<int32_t>> intact = ComputeRoutes(up);
+    m_states.clear();
+    m_states.push_back(Estimate(-1, intact));
+    for (uint32_t l = 0; l < m_topology.GetNLinks(); ++l)
+    {
+        m_states.push_back(Estimate(l, intact));
+    }
+    m_runtime =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    NS_LOG_INFO(m_states.size() << " failure states in " << m_runtime * 1e6 << "us");
+}
+
+const std::vector<WanQueueingModel::StateEstimate>&
+WanQueueingModel::GetStates() const
+{
+    return m_states;
+}
+
+double
+WanQueueingModel::GetMaxUtilization() const
+{
+    double maximum = 0;
+    for (const StateEstimate& state : m_states)
+    {
+        maximum = std::max(maximum, state.maxUtilization);
+    }
+    return maximum;
+}
+
+void
+WanQueueingModel::AddMetrics(WanMetrics& metrics) const
+{
+    metrics.Set("analytic.max_util", GetMaxUtilization());
+    for (const StateEstimate& state : m_states)
+    {
+        for (uint32_t d = 0; d < m_demands.size(); ++d)
+        {
+            const std::string name = "analytic." + state.name + "." + m_demands[d].name;
+            const PathEstimate& estimate = state.paths[d];
+            if (estimate.reachable)
+            {
+                metrics.Set(name + ".delay_ms", estimate.delay.GetSeconds() * 1000);
+            }
+            metrics.Set(name + ".loss", estimate.loss);
+        }
+    }
+}
+
+void
+WanQueueingModel::Print(std::ostream& os) const
+{
+    std::ios::fmtflags flags = os.flags();
+    std::streamsize precision = os.precision();
+    os << "\n========================================" << std::endl;
+    os << "Analytic Estimate (" << (m_queue == MM1 ? "M/M/1" : "M/D/1") << ", "
+       << (m_routing == STATIC ? "static routes" : "rerouting") << ", " << m_states.size()
+       << " failure states in " << std::fixed << std::setprecision(0) << m_runtime * 1e6
+       << "us)" << std::endl;
+    os << "========================================" << std::endl;
+    // Failure states list only the demands that fare differently than intact
+    for (const StateEstimate& state : m_states)
+    {
+        bool header = false;
+        for (uint32_t d = 0; d < m_demands.size(); ++d)
+        {
+            const PathEstimate& estimate = state.paths[d];
+            const PathEstimate& intact = m_states.front().paths[d];
+            if (&state != &m_states.front() && estimate.reachable == intact.reachable &&
+                estimate.hops == intact.hops &&
+                std::abs((estimate.delay - intact.delay).GetSeconds()) < 1e-6 &&
+                std::abs(estimate.loss - intact.loss) < 1e-9)
+            {
+                continue;
+            }
+            if (!header)
+            {
+                os << (&state == &m_states.front() ? "Intact" : state.name + " down")
+                   << ": max utilization " << std::setprecision(1)
+                   << state.maxUtilization * 100 << "%"
+                   << (state.busiest.empty() ? "" : " on " + state.busiest) << std::endl;
+                header = true;
+            }
+            os << "  " << std::left << std::setw(24) << m_demands[d].name << std::right;
+            if (!estimate.reachable)
+            {
+                os << "  unreachable" << std::endl;
+                continue;
+            }
+            os << std::setw(3) << estimate.hops << " hops" << std::setprecision(2)
+               << std::setw(10) << estimate.delay.GetSeconds() * 1000 << "ms"
+               << std::setprecision(3) << std::setw(10) << estimate.loss * 100 << "% loss"
+               << std::endl;
+        }
+    }
+    os.flags(flags);
+    os.precision(precision);
+    os << "========================================" << std::endl;
+}
+
+bool
+WanQueueingModel::ParseQueue(const std::string& text, Queue& queue)
+{
+    if (text == "mm1")
+    {
+        queue = MM1;
+        return true;
+    }
+    if (text == "md1")
+    {
+        queue = MD1;
+        return true;
+    }
+    return false;
+}
+
+} // namespace ns3
@@ -0,0 +1,168 @@
+/*
+ * Analytical queueing estimates: per-path delay and loss without packets
+ *
+ * A what-if answer in microseconds instead of a simulation run. Every
+ * circuit direction is a single-server queue fed by the demands routed
+ * over it:
+ *
+ * - arrivals are Poisson; service is exponential (M/M/1) or deterministic
+ *   (M/D/1) with the mean packet size of the traffic on the circuit;
+ * - the mean sojourn is the Pollaczek-Khinchine waiting time plus the
+ *   transmission time; propagation delay and mean jitter are added per hop;
+ * - loss is the blocking probability of the drop-tail queue (M/M/1/K, also
+ *   used for M/D/1 as a bound) combined with the circuit's random loss. An
+ *   overloaded circuit drops the excess, 1 - 1/rho.
+ *
+ * Routes are those the scenario installs: hop by hop along shortest paths
+ * by circuit cost, ties to the lower circuit index (see
+ * WanTopologyHelper::InstallShortestPathRoutes). The intact network and
+ * every single-circuit failure are estimated. With STATIC routing the
+ * routes stay those of the intact network and a demand whose path crosses
+ * the failed circuit is lost; with REROUTE (failover, redundancy policies)
+ * they follow the surviving circuits.
+ *
+ * Loads are offered loads: loss upstream does not thin the traffic
+ * downstream, which errs on the safe side.
+ */
+
+#ifndef WAN_QUEUEING_MODEL_H
+#define WAN_QUEUEING_MODEL_H
+
+#include "wan-graph.h"
+#include "wan-metrics.h"
+#include "wan-topology.h"
+
+#include "ns3/nstime.h"
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Traffic offered from one site to another.
+ */
+struct WanDemand
+{
+    std::string name;    //!< Report label, e.g. "voip.HQ->DC"
+    uint32_t source;     //!< Sending site
+    uint32_t target;     //!< Receiving site
+    double rate;         //!< Offered load on the wire, bit/s
+    uint32_t packetSize; //!< Bytes per packet on the wire
+};
+
+/**
+ * Per-circuit queueing model of a topology and its demands.
+ */
+class WanQueueingModel
+{
+  public:
+    /// Service time distribution of a circuit
+    enum Queue
+    {
+        MM1, //!< Exponential
+        MD1, //!< Deterministic
+    };
+
+    /// What the routes do when a circuit fails
+    enum Routing
+    {
+        STATIC,  //!< Keep the routes of the intact network
+        REROUTE, //!< Follow the shortest paths over the surviving circuits
+    };
+
+    /// Estimate of one demand in one failure state
+    struct PathEstimate
+    {
+        bool reachable; //!< A route leads to the target
+        uint32_t hops;  //!< Circuits on the path
+        Time delay;     //!< Mean one-way delay
+        double loss;    //!< Packet loss probability, 1 if unreachable
+    };
+
+    /// Estimates of one failure state
+    struct StateEstimate
+    {
+        std::string name;                //!< "intact" or "<A>-<B>" (the failed circuit)
+        std::vector<PathEstimate> paths; //!< Per demand, in order of AddDemand
+        double maxUtilization;           //!< Highest offered load over capacity
+        std::string busiest;             //!< Circuit direction of that load, "A->B"
+    };
+
+    /// \param topology circuits with bandwidth, delay, jitter, loss and cost
+    explicit WanQueueingModel(const WanTopology& topology);
+
+    /// \param queue service time model (default MM1)
+    void SetQueue(Queue queue);
+
+    /// \param routing route behaviour under failures (default STATIC)
+    void SetRouting(Routing routing);
+
+    /// \param packets drop-tail queue size of every device (default 100)
+    void SetQueueSize(uint32_t packets);
+
+    /// Add a demand
+    void AddDemand(const WanDemand& demand);
+
+    /**
+     * Add demands from a CSV file with a header row naming the columns
+     * source, target, rate and, optionally, packet_size (default 1000
+     * bytes) and name.
+     */
+    void LoadDemands(const std::string& path);
+
+    /// \return the demands in order
+    const std::vector<WanDemand>& GetDemands() const;
+
+    /// Estimate the intact network and every single-circuit failure
+    void Run();
+
+    /// \return the failure states of the last run, intact first
+    const std::vector<StateEstimate>& GetStates() const;
+
+    /// \return the highest utilization over all states of the last run
+    double GetMaxUtilization() const;
+
+    /**
+     * Add analytic.max_util and analytic.<state>.<demand>.delay_ms and
+     * .loss per state and demand.
+     */
+    void AddMetrics(WanMetrics& metrics) const;
+
+    /// Print one table per failure state
+    void Print(std::ostream& os) const;
+
+    /// Parse "mm1" or "md1"
+    static bool ParseQueue(const std::string& text, Queue& queue);
+
+  private:
+    /**
+     * Shortest-path next hops over the circuits that are up.
+     * \param up per circuit
+     * \return the next circuit from every site toward every site, -1 if none
+     */
+    std::vector<std::vector<int32_t>> ComputeRoutes(const std::vector<bool>& up) const;
+
+    /**
+     * Estimate one failure state.
+     * \param failed the failed circuit, or -1
+     * \param intact routes of the intact network
+     */
+    StateEstimate Estimate(int32_t failed, const std::vector<std::vector<int32_t>>& intact) const;
+
+    const WanTopology& m_topology;       //!< Sites and circuits
+    WanGraph m_graph;                    //!< Adjacency of the topology
+    Queue m_queue{MM1};                  //!< Service time model
+    Routing m_routing{STATIC};           //!< Routes under failures
+    uint32_t m_queueSize{100};           //!< Drop-tail queue size in packets
+    std::vector<WanDemand> m_demands;    //!< Demands in order
+    std::vector<StateEstimate> m_states; //!< Results of the last run
+    double m_runtime{0};                 //!< Wall-clock seconds of the last run
+};
+
+} // namespace ns3
+
+#endif /* WAN_QUEUEING_MODEL_H */
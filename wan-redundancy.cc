@@ -0,0 +1,649 @@
+/*
+ * Redundancy policies: active/standby, active/active and weighted paths
+ */
+
+#include "wan-redundancy.h"
+
+#include "ns3/abort.h"
+#include "ns3/ipv4-list-routing.h"
+#include "ns3/ipv4-route.h"
+#include "ns3/ipv4-static-routing-helper.h"
+#include "ns3/log.h"
+#include "ns3/node.h"
+#include "ns3/output-stream-wrapper.h"
+#include "ns3/simulator.h"
+#include "ns3/tcp-header.h"
+#include "ns3/udp-header.h"
+
+#include "wan-csv-reader.h"
+#include "wan-fib-routing.h"
+#include "wan-hash.h"
+#include "wan-route-compiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("WanRedundancy");
+
+NS_OBJECT_ENSURE_REGISTERED(WanPolicyRouting);
+
+namespace
+{
+
+/// Priority of the policy routes in the list routing (static routes have 0)
+const int16_t POLICY_PRIORITY = 10;
+
+/// Protocol numbers whose ports take part in the flow hash
+const uint8_t PROTOCOL_TCP = 6;
+const uint8_t PROTOCOL_UDP = 17; //!< UDP
+
+} // namespace
+
+/*
+ * WanPolicyRouting
+ */
+
+TypeId
+WanPolicyRouting::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::WanPolicyRouting")
+                            .SetParent<Ipv4RoutingProtocol>()
+                            .SetGroupName("Internet")
+                            .AddConstructor<WanPolicyRouting>();
+    return tid;
+}
+
+WanPolicyRouting::WanPolicyRouting()
+{
+}
+
+void
+WanPolicyRouting::SetMode(Mode mode)
+{
+    m_mode = mode;
+}
+
+void
+WanPolicyRouting::SetLoadSharing(LoadSharing loadSharing)
+{
+    m_loadSharing = loadSharing;
+}
+
+void
+WanPolicyRouting::AddRoute(Ipv4Address network,
+                           Ipv4Mask mask,
+                           const std::vector<NextHop>& nextHops)
+{
+    NS_ABORT_MSG_IF(nextHops.empty(), "Policy route to " << network << " without next hops");
+    m_routes.push_back({network, mask, nextHops});
+}
+
+void
+WanPolicyRouting::SetLinkUsable(uint32_t link, bool usable)
+{
+    m_linkUsable[link] = usable;
+}
+
+uint32_t
+WanPolicyRouting::GetNRoutes() const
+{
+    return m_routes.size();
+}
+
+WanPolicyRouting::Route*
+WanPolicyRouting::Lookup(Ipv4Address destination)
+{
+    Route* best = nullptr;
+    for (Route& route : m_routes)
+    {
+        if (route.mask.IsMatch(destination, route.network) &&
+            (!best || route.mask.GetPrefixLength() > best->mask.GetPrefixLength()))
+        {
+            best = &route;
+        }
+    }
+    return best;
+}
+
+bool
+WanPolicyRouting::IsUsable(const NextHop& nextHop) const
+{
+    auto it = m_linkUsable.find(nextHop.link);
+    return (it == m_linkUsable.end() || it->second) && m_ipv4->IsUp(nextHop.interface);
+}
+
+WanPolicyRouting::NextHop*
+WanPolicyRouting::Select(Route& route, const Ipv4Header& header, Ptr<const Packet> p)
+{
+    if (m_mode == ACTIVE_STANDBY)
+    {
+        for (NextHop& nextHop : route.nextHops)
+        {
+            if (IsUsable(nextHop))
+            {
+                return &nextHop;
+            }
+        }
+        return nullptr;
+    }
+
+    NextHop* best = nullptr;
+    if (m_loadSharing == PER_PACKET)
+    {
+        // Smooth weighted round robin: every usable next hop earns its weight,
+        // the richest is chosen and pays the total
+        double total = 0;
+        for (NextHop& nextHop : route.nextHops)
+        {
+            if (!IsUsable(nextHop))
+            {
+                continue;
+            }
+            double weight = m_mode == WEIGHTED ? nextHop.weight : 1;
+            nextHop.credit += weight;
+            total += weight;
+            if (!best || nextHop.credit > best->credit)
+            {
+                best = &nextHop;
+            }
+        }
+        if (best)
+        {
+            best->credit -= total;
+        }
+        return best;
+    }
+
+    // Weighted rendezvous hash: the next hop with the highest weight / -ln(u)
+    // wins, u uniform per (flow, next hop), so removing a next hop only moves
+    // its own flows
+    uint64_t flow = SplitMix64(header.GetSource().Get());
+    flow = SplitMix64(flow ^ header.GetDestination().Get());
+    flow = SplitMix64(flow ^ header.GetProtocol());
+    if (p && header.GetProtocol() == PROTOCOL_UDP && p->GetSize() >= 8)
+    {
+        UdpHeader udp;
+        p->PeekHeader(udp);
+        flow = SplitMix64(flow ^ (static_cast<uint64_t>(udp.GetSourcePort()) << 16 |
+                                  udp.GetDestinationPort()));
+    }
+    else if (p && header.GetProtocol() == PROTOCOL_TCP && p->GetSize() >= 20)
+    {
+        TcpHeader tcp;
+        p->PeekHeader(tcp);
+        flow = SplitMix64(flow ^ (static_cast<uint64_t>(tcp.GetSourcePort()) << 16 |
+                                  tcp.GetDestinationPort()));
+    }
+    double bestScore = -1;
+    for (NextHop& nextHop : route.nextHops)
+    {
+        if (!IsUsable(nextHop))
+        {
+            continue;
+        }
+        double u = ((SplitMix64(flow ^ nextHop.gateway.Get()) >> 11) + 0.5) / 9007199254740992.0;
+        double score = (m_mode == WEIGHTED ? nextHop.weight : 1) / -std::log(u);
+        if (score > bestScore)
+        {
+            bestScore = score;
+            best = &nextHop;
+        }
+    }
+    return best;
+}
+
+Ptr<Ipv4Route>
+WanPolicyRouting::MakeRoute(const NextHop& nextHop, Ipv4Address destination) const
+{
+    Ptr<Ipv4Route> route = Create<Ipv4Route>();
+    route->SetDestination(destination);
+    route->SetSource(m_ipv4->GetAddress(nextHop.interface, 0).GetLocal());
+    route->SetGateway(nextHop.gateway);
+    route->SetOutputDevice(m_ipv4->GetNetDevice(nextHop.interface));
+    return route;
+}
+
+Ptr<Ipv4Route>
+WanPolicyRouting::RouteOutput(Ptr<Packet> /* p */,
+                              const Ipv4Header& header,
+                              Ptr<NetDevice> oif,
+                              Socket::SocketErrno& sockerr)
+{
+    // Sockets bound to a device are left to the static routes
+    Route* route = oif ? nullptr : Lookup(header.GetDestination());
+    // Locally generated packets have no transport header yet: hash addresses only
+    NextHop* nextHop = route ? Select(*route, header, nullptr) : nullptr;
+    if (!nextHop)
+    {
+        sockerr = Socket::ERROR_NOROUTETOHOST;
+        return nullptr;
+    }
+    ++nextHop->selected;
+    sockerr = Socket::ERROR_NOTERROR;
+    return MakeRoute(*nextHop, header.GetDestination());
+}
+
+bool
+WanPolicyRouting::RouteInput(Ptr<const Packet> p,
+                             const Ipv4Header& header,
+                             Ptr<const NetDevice> /* idev */,
+                             const UnicastForwardCallback& ucb,
+                             const MulticastForwardCallback& /* mcb */,
+                             const LocalDeliverCallback& /* lcb */,
+                             const ErrorCallback& /* ecb */)
+{
+    // The list routing has already delivered local packets
+    Route* route = Lookup(header.GetDestination());
+    NextHop* nextHop = route ? Select(*route, header, p) : nullptr;
+    if (!nextHop)
+    {
+        return false;
+    }
+    ++nextHop->selected;
+    ucb(MakeRoute(*nextHop, header.GetDestination()), p, header);
+    return true;
+}
+
+void
+WanPolicyRouting::NotifyInterfaceUp(uint32_t /* interface */)
+{
+}
+
+void
+WanPolicyRouting::NotifyInterfaceDown(uint32_t /* interface */)
+{
+}
+
+void
+WanPolicyRouting::NotifyAddAddress(uint32_t /* interface */, Ipv4InterfaceAddress /* address */)
+{
+}
+
+void
+WanPolicyRouting::NotifyRemoveAddress(uint32_t /* interface */, Ipv4InterfaceAddress /* address */)
+{
+}
+
+void
+WanPolicyRouting::SetIpv4(Ptr<Ipv4> ipv4)
+{
+    m_ipv4 = ipv4;
+}
+
+void
+WanPolicyRouting::PrintRoutingTable(Ptr<OutputStreamWrapper> stream, Time::Unit unit) const
+{
+    static const char* modes[] = {"active/standby", "active/active", "weighted"};
+    std::ostream& os = *stream->GetStream();
+    os << "Node: " << m_ipv4->GetObject<Node>()->GetId() << ", Time: " << Simulator::Now().As(unit)
+       << ", WanPolicyRouting (" << modes[m_mode]
+       << (m_mode != ACTIVE_STANDBY && m_loadSharing == PER_PACKET ? ", per packet" : "")
+       << ")" << std::endl;
+    for (const Route& route : m_routes)
+    {
+        os << "  " << route.network << "/" << route.mask.GetPrefixLength() << ":";
+        for (uint32_t i = 0; i < route.nextHops.size(); ++i)
+        {
+            const NextHop& nextHop = route.nextHops[i];
+            os << " " << nextHop.gateway << " if" << nextHop.interface;
+            if (m_mode == WEIGHTED)
+            {
+                os << " w" << nextHop.weight;
+            }
+            os << (i == 0 ? " (primary)" : "") << (IsUsable(nextHop) ? "" : " (unusable)") << " "
+               << nextHop.selected << " pkts" << (i + 1 < route.nextHops.size() ? "," : "");
+        }
+        os << std::endl;
+    }
+}
+
+void
+WanPolicyRouting::DoDispose()
+{
+    m_ipv4 = nullptr;
+    m_routes.clear();
+    Ipv4RoutingProtocol::DoDispose();
+}
+
+/*
+ * WanRedundancyEngine
+ */
+
+WanRedundancyEngine::WanRedundancyEngine(const WanTopology& topology, const WanNetwork& network)
+    : m_topology(topology),
+      m_network(network),
+      m_mode(WanPolicyRouting::ACTIVE_STANDBY),
+      m_loadSharing(WanPolicyRouting::PER_FLOW),
+      m_tracking(WanLinkMonitor::BFD)
+{
+}
+
+void
+WanRedundancyEngine::SetMode(WanPolicyRouting::Mode mode)
+{
+    m_mode = mode;
+}
+
+void
+WanRedundancyEngine::SetLoadSharing(WanPolicyRouting::LoadSharing loadSharing)
+{
+    m_loadSharing = loadSharing;
+}
+
+void
+WanRedundancyEngine::SetTracking(WanLinkMonitor::Mode tracking)
+{
+    m_tracking = tracking;
+}
+
+void
+WanRedundancyEngine::SetRevertHold(Time hold)
+{
+    m_revertHold = hold;
+}
+
+void
+WanRedundancyEngine::SetDamping(const WanFlapDamping& damping)
+{
+    m_damping = damping;
+}
+
+void
+WanRedundancyEngine::SetPreferenceWeights(double primary, double alternate)
+{
+    NS_ABORT_MSG_IF(primary <= 0 || alternate <= 0, "Weights must be positive");
+    m_primaryWeight = primary;
+    m_alternateWeight = alternate;
+}
+
+void
+WanRedundancyEngine::SetLinkWeights(const std::string& weights)
+{
+    std::istringstream list(weights);
+    std::string entry;
+    while (std::getline(list, entry, ','))
+    {
+        entry = WanCsvReader::Trim(entry);
+        if (entry.empty())
+        {
+            continue;
+        }
+        size_t equals = entry.find('=');
+        NS_ABORT_MSG_IF(equals == std::string::npos,
+                        "Link weight '" << entry << "' is not SiteA-SiteB=weight");
+        std::string sites = entry.substr(0, equals);
+        std::vector<uint32_t> links;
+        NS_ABORT_MSG_UNLESS(m_topology.FindLinks(sites, links) && !links.empty(),
+                            "Link weight: no link " << sites);
+        double weight;
+        NS_ABORT_MSG_UNLESS(WanCsvReader::ParseNumber(entry.substr(equals + 1), weight) &&
+                                weight > 0,
+                            "Link weight of " << sites << " must be a positive number");
+        for (uint32_t l : links)
+        {
+            m_linkWeights[l] = weight;
+        }
+    }
+}
+
+void
+WanRedundancyEngine::SetRouteThreads(uint32_t threads)
+{
+    m_routeThreads = threads;
+}
+
+void
+WanRedundancyEngine::Install()
+{
+    NS_LOG_FUNCTION(this);
+    const uint32_t nSites = m_topology.GetNSites();
+    const double infinity = std::numeric_limits<double>::infinity();
+
+    // Least costs between all sites, one row per worker-computed source
+    const WanGraph& graph = m_network.graph;
+    std::vector<std::vector<double>> distance(nSites);
+    WanRouteCompiler compiler(graph);
+    compiler.SetThreads(m_routeThreads);
+    compiler.Run([&distance](uint32_t source,
+                             const std::vector<double>& d,
+                             const std::vector<int32_t>&) { distance[source] = d; });
+
+    Ipv4StaticRoutingHelper staticRoutingHelper;
+    std::vector<bool> tracked(m_topology.GetNLinks(), false);
+    m_routing.clear();
+    for (uint32_t s = 0; s < nSites; ++s)
+    {
+        Ptr<Ipv4> ipv4 = m_network.nodes.Get(s)->GetObject<Ipv4>();
+        Ptr<Ipv4ListRouting> list = DynamicCast<Ipv4ListRouting>(ipv4->GetRoutingProtocol());
+        NS_ABORT_MSG_UNLESS(list, "Redundancy policies need list routing on " << s);
+        Ptr<Ipv4StaticRouting> staticRouting = staticRoutingHelper.GetStaticRouting(ipv4);
+        Ptr<WanFibRouting> fib = WanFibRouting::Find(ipv4);
+        Ptr<WanPolicyRouting> routing = CreateObject<WanPolicyRouting>();
+        routing->SetMode(m_mode);
+        routing->SetLoadSharing(m_loadSharing);
+        list->AddRoutingProtocol(routing, POLICY_PRIORITY);
+        m_routing.push_back(routing);
+
+        for (uint32_t l = 0; l < m_topology.GetNLinks(); ++l)
+        {
+            const WanLink& link = m_topology.GetLink(l);
+            if (link.a == s || link.b == s)
+            {
+                continue; // connected route
+            }
+            auto [linkIpv4, linkInterface] = m_network.linkInterfaces[l].Get(0);
+            Ipv4Mask mask = linkIpv4->GetAddress(linkInterface, 0).GetMask();
+            Ipv4Address network = m_network.linkInterfaces[l].GetAddress(0).CombineMask(mask);
+            auto toLink = [&](uint32_t site) {
+                return std::min(distance[site][link.a], distance[site][link.b]);
+            };
+            double here = toLink(s);
+            if (here == infinity)
+            {
+                continue;
+            }
+
+            // The next hop of the static or FIB route is the tracked primary
+            Ipv4Address primaryGateway;
+            for (uint32_t i = 0; i < staticRouting->GetNRoutes(); ++i)
+            {
+                Ipv4RoutingTableEntry entry = staticRouting->GetRoute(i);
+                if (entry.IsGateway() && entry.GetDestNetwork() == network &&
+                    entry.GetDestNetworkMask() == mask)
+                {
+                    primaryGateway = entry.GetGateway();
+                    break;
+                }
+            }
+            WanFibRouting::Route fibRoute;
+            if (fib && fib->Lookup(network, fibRoute) && fibRoute.mask == mask)
+            {
+                primaryGateway = fibRoute.gateway;
+            }
+
+            struct Candidate
+            {
+                WanPolicyRouting::NextHop nextHop;
+                double cost;
+                bool loopFree;
+            };
+
+            std::vector<Candidate> candidates;
+            for (uint32_t arc = graph.Begin(s); arc < graph.End(s); ++arc)
+            {
+                uint32_t n = graph.GetTarget(arc);
+                double there = toLink(n);
+                if (there == infinity)
+                {
+                    continue;
+                }
+                uint32_t k = graph.GetLink(arc);
+                WanPolicyRouting::NextHop nextHop;
+                nextHop.gateway =
+                    m_network.linkInterfaces[k].GetAddress(1 - graph.GetLocalEnd(arc));
+                nextHop.interface = graph.GetInterface(arc);
+                nextHop.link = k;
+                // Standby: loop-free alternate; sharing: strictly downstream
+                bool loopFree = m_mode == WanPolicyRouting::ACTIVE_STANDBY
+                                    ? there < distance[n][s] + here
+                                    : there < here;
+                candidates.push_back({nextHop, graph.GetCost(arc) + there, loopFree});
+            }
+            if (candidates.empty())
+            {
+                continue;
+            }
+
+            // Primary first, then loop-free alternates by cost (stable: link order)
+            auto primary = std::find_if(candidates.begin(), candidates.end(), [&](const auto& c) {
+                return c.nextHop.gateway == primaryGateway;
+            });
+            if (primary == candidates.end())
+            {
+                primary = std::min_element(candidates.begin(),
+                                           candidates.end(),
+                                           [](const auto& x, const auto& y) {
+                                               return x.cost < y.cost;
+                                           });
+            }
+            std::vector<WanPolicyRouting::NextHop> nextHops{primary->nextHop};
+            candidates.erase(primary);
+            std::stable_sort(candidates.begin(),
+                             candidates.end(),
+                             [](const auto& x, const auto& y) { return x.cost < y.cost; });
+            for (const Candidate& c : candidates)
+            {
+                if (c.loopFree)
+                {
+                    nextHops.push_back(c.nextHop);
+                }
+            }
+            if (nextHops.size() < 2)
+            {
+                continue; // nothing to choose: the static route does the same
+            }
+
+            for (uint32_t i = 0; i < nextHops.size(); ++i)
+            {
+                auto it = m_linkWeights.find(nextHops[i].link);
+                nextHops[i].weight = it != m_linkWeights.end()
+                                         ? it->second
+                                         : (i == 0 ? m_primaryWeight : m_alternateWeight);
+                tracked[nextHops[i].link] = true;
+            }
+            routing->AddRoute(network, mask, nextHops);
+        }
+    }
+
+    m_monitors.clear();
+    for (uint32_t l = 0; l < m_topology.GetNLinks(); ++l)
+    {
+        if (tracked[l])
+        {
+            auto monitor = std::make_unique<WanLinkMonitor>(m_topology, m_network, l);
+            monitor->SetMode(m_tracking);
+            monitor->SetRevertHold(m_revertHold);
+            monitor->SetDamping(m_damping);
+            monitor->AddStateListener(MakeCallback(&WanRedundancyEngine::LinkStateChanged, this));
+            m_monitors[l] = std::move(monitor);
+        }
+    }
+    NS_LOG_INFO("Installed " << GetNRoutes() << " " << GetModeName(m_mode)
+                             << " policy routes, tracking " << m_monitors.size() << " links");
+}
+
+void
+WanRedundancyEngine::AddStateListener(WanLinkMonitor::StateCallback callback)
+{
+    for (auto& [l, monitor] : m_monitors)
+    {
+        monitor->AddStateListener(callback);
+    }
+}
+
+void
+WanRedundancyEngine::Start(Time start, Time stop)
+{
+    for (auto& [l, monitor] : m_monitors)
+    {
+        monitor->Start(start, stop);
+    }
+}
+
+void
+WanRedundancyEngine::LinkStateChanged(uint32_t link, uint32_t end, bool usable)
+{
+    const WanLink& l = m_topology.GetLink(link);
+    m_routing[end == 0 ? l.a : l.b]->SetLinkUsable(link, usable);
+}
+
+uint32_t
+WanRedundancyEngine::GetNRoutes() const
+{
+    uint32_t n = 0;
+    for (const auto& routing : m_routing)
+    {
+        n += routing->GetNRoutes();
+    }
+    return n;
+}
+
+const WanLinkMonitor*
+WanRedundancyEngine::GetMonitor(uint32_t link) const
+{
+    auto it = m_monitors.find(link);
+    return it != m_monitors.end() ? it->second.get() : nullptr;
+}
+
+void
+WanRedundancyEngine::Print(std::ostream& os) const
+{
+    Ptr<OutputStreamWrapper> stream = Create<OutputStreamWrapper>(&os);
+    for (uint32_t s = 0; s < m_routing.size(); ++s)
+    {
+        if (m_routing[s]->GetNRoutes() > 0)
+        {
+            os << m_topology.GetSite(s).name << " ";
+            m_routing[s]->PrintRoutingTable(stream);
+        }
+    }
+}
+
+std::string
+WanRedundancyEngine::GetModeName(WanPolicyRouting::Mode mode)
+{
+    switch (mode)
+    {
+    case WanPolicyRouting::ACTIVE_STANDBY:
+        return "active-standby";
+    case WanPolicyRouting::ACTIVE_ACTIVE:
+        return "active-active";
+    case WanPolicyRouting::WEIGHTED:
+        return "weighted";
+    }
+    return "unknown";
+}
+
+bool
+WanRedundancyEngine::ParseMode(const std::string& name, WanPolicyRouting::Mode& mode)
+{
+    for (auto candidate : {WanPolicyRouting::ACTIVE_STANDBY,
+                           WanPolicyRouting::ACTIVE_ACTIVE,
+                           WanPolicyRouting::WEIGHTED})
+    {
+        if (name == GetModeName(candidate))
+        {
+            mode = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace ns3
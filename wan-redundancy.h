@@ -0,0 +1,264 @@
+/*
+ * Redundancy policies: active/standby, active/active and weighted paths
+ *
+ * Static routes give each destination exactly one next hop, so the
+ * redundancy design of the WAN (which circuit carries traffic, which one
+ * waits) stays implicit. The redundancy engine makes it explicit. For
+ * every site and every remote link subnet it builds a policy route from
+ * the site's static route (the tracked primary) and the loop-free
+ * alternates the topology offers. It then applies one policy to all site
+ * pairs:
+ *
+ * - ACTIVE_STANDBY: the primary carries everything. The first usable
+ *   alternate takes over while the primary's link is unusable. Alternates
+ *   are loop-free alternates (RFC 5286: the neighbor's own path to the
+ *   destination does not come back through this site).
+ * - ACTIVE_ACTIVE: traffic is shared equally over the primary and all
+ *   downstream alternates (neighbors strictly closer to the destination,
+ *   so sharing at every site cannot loop).
+ * - WEIGHTED: like ACTIVE_ACTIVE, in proportion to weights: the primary
+ *   weighs 3 and alternates 1 unless a link weight is set.
+ *
+ * Sharing is per flow by default. A weighted rendezvous hash of addresses,
+ * protocol and, when visible, ports picks the path, so a failure moves only
+ * the flows of the failed path. Sharing can also be per packet (smooth
+ * weighted round robin), which balances even a single flow but reorders it.
+ *
+ * Ipv4StaticRouting cannot hold several next hops per prefix. So the policy
+ * routes live in a WanPolicyRouting protocol that the engine adds to each
+ * node's list routing above the static routes. Destinations without a
+ * policy route (connected subnets, sites without alternates) fall through
+ * to the static routes unchanged. Link usability is tracked per end with a
+ * WanLinkMonitor hello session (BFD by default) on every link that a policy
+ * route uses.
+ */
+
+#ifndef WAN_REDUNDANCY_H
+#define WAN_REDUNDANCY_H
+
+#include "wan-link-monitor.h"
+#include "wan-topology-helper.h"
+#include "wan-topology.h"
+
+#include "ns3/ipv4-address.h"
+#include "ns3/ipv4-routing-protocol.h"
+#include "ns3/ipv4.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Policy routes of one router, consulted before its static routes.
+ */
+class WanPolicyRouting : public Ipv4RoutingProtocol
+{
+  public:
+    /// How a policy route uses its next hops
+    enum Mode
+    {
+        ACTIVE_STANDBY, //!< First usable next hop only
+        ACTIVE_ACTIVE,  //!< All usable next hops, equal shares
+        WEIGHTED        //!< All usable next hops, weighted shares
+    };
+
+    /// Granularity of load sharing
+    enum LoadSharing
+    {
+        PER_FLOW,  //!< Weighted rendezvous hash of the flow
+        PER_PACKET //!< Smooth weighted round robin
+    };
+
+    /// One next hop of a policy route
+    struct NextHop
+    {
+        Ipv4Address gateway;  //!< Neighbor address
+        uint32_t interface;   //!< Outgoing interface
+        uint32_t link;        //!< Topology link of the interface
+        double weight{1};     //!< Share under WEIGHTED
+        double credit{0};     //!< Round-robin credit under PER_PACKET
+        uint64_t selected{0}; //!< Packets routed over this next hop
+    };
+
+    /// Get the type ID
+    static TypeId GetTypeId();
+
+    WanPolicyRouting();
+
+    /// \param mode how policy routes use their next hops
+    void SetMode(Mode mode);
+
+    /// \param loadSharing granularity of load sharing
+    void SetLoadSharing(LoadSharing loadSharing);
+
+    /**
+     * Add a policy route.
+     * \param network destination network
+     * \param mask destination mask
+     * \param nextHops next hops, the primary first, then in order of preference
+     */
+    void AddRoute(Ipv4Address network, Ipv4Mask mask, const std::vector<NextHop>& nextHops);
+
+    /// Mark the next hops over a link usable or not
+    void SetLinkUsable(uint32_t link, bool usable);
+
+    /// \return the number of policy routes
+    uint32_t GetNRoutes() const;
+
+    // Inherited from Ipv4RoutingProtocol
+    Ptr<Ipv4Route> RouteOutput(Ptr<Packet> p,
+                               const Ipv4Header& header,
+                               Ptr<NetDevice> oif,
+                               Socket::SocketErrno& sockerr) override;
+    bool RouteInput(Ptr<const Packet> p,
+                    const Ipv4Header& header,
+                    Ptr<const NetDevice> idev,
+                    const UnicastForwardCallback& ucb,
+                    const MulticastForwardCallback& mcb,
+                    const LocalDeliverCallback& lcb,
+                    const ErrorCallback& ecb) override;
+    void NotifyInterfaceUp(uint32_t interface) override;
+    void NotifyInterfaceDown(uint32_t interface) override;
+    void NotifyAddAddress(uint32_t interface, Ipv4InterfaceAddress address) override;
+    void NotifyRemoveAddress(uint32_t interface, Ipv4InterfaceAddress address) override;
+    void SetIpv4(Ptr<Ipv4> ipv4) override;
+    void PrintRoutingTable(Ptr<OutputStreamWrapper> stream,
+                           Time::Unit unit = Time::S) const override;
+
+  protected:
+    void DoDispose() override;
+
+  private:
+    /// A destination with its next hops
+    struct Route
+    {
+        Ipv4Address network;           //!< Destination network
+        Ipv4Mask mask;                 //!< Destination mask
+        std::vector<NextHop> nextHops; //!< Primary first
+    };
+
+    /// \return the longest-prefix policy route for a destination, or nullptr
+    Route* Lookup(Ipv4Address destination);
+
+    /**
+     * Choose a next hop by the policy.
+     * \param route the policy route
+     * \param header header of the packet
+     * \param p the packet, starting at the transport header; nullptr if not yet built
+     * \return the next hop, or nullptr if none is usable
+     */
+    NextHop* Select(Route& route, const Ipv4Header& header, Ptr<const Packet> p);
+
+    /// \return true if a next hop may be used
+    bool IsUsable(const NextHop& nextHop) const;
+
+    /// \return an ns-3 route over a next hop
+    Ptr<Ipv4Route> MakeRoute(const NextHop& nextHop, Ipv4Address destination) const;
+
+    Ptr<Ipv4> m_ipv4;                      //!< IPv4 of the router
+    Mode m_mode{ACTIVE_STANDBY};           //!< Policy
+    LoadSharing m_loadSharing{PER_FLOW};   //!< Sharing granularity
+    std::vector<Route> m_routes;           //!< Policy routes
+    std::map<uint32_t, bool> m_linkUsable; //!< Tracked links by index, usable or not
+};
+
+/**
+ * Builds and applies a redundancy policy over all site pairs.
+ */
+class WanRedundancyEngine
+{
+  public:
+    /**
+     * \param topology the topology the network was built from
+     * \param network the network, with its static routes installed
+     */
+    WanRedundancyEngine(const WanTopology& topology, const WanNetwork& network);
+
+    /// \param mode the policy (default ACTIVE_STANDBY)
+    void SetMode(WanPolicyRouting::Mode mode);
+
+    /// \param loadSharing granularity of load sharing (default PER_FLOW)
+    void SetLoadSharing(WanPolicyRouting::LoadSharing loadSharing);
+
+    /// \param tracking how link usability is detected (default BFD)
+    void SetTracking(WanLinkMonitor::Mode tracking);
+
+    /// \param hold revert hold of every tracked link (default 0)
+    void SetRevertHold(Time hold);
+
+    /// \param damping flap damping of every tracked link (default disabled)
+    void SetDamping(const WanFlapDamping& damping);
+
+    /**
+     * \param primary WEIGHTED share of a primary next hop (default 3)
+     * \param alternate WEIGHTED share of an alternate next hop (default 1)
+     */
+    void SetPreferenceWeights(double primary, double alternate);
+
+    /**
+     * Set WEIGHTED shares per link, overriding the preference weights of
+     * next hops over those links.
+     * \param weights e.g. "HQ-DC=3,HQ-Branch=1"
+     */
+    void SetLinkWeights(const std::string& weights);
+
+    /// \param threads workers of the all-pairs costs; 0 for one per core (default)
+    void SetRouteThreads(uint32_t threads);
+
+    /// Compute the policy routes and add them to every router
+    void Install();
+
+    /// Call back on every usability change of a tracked link; call after Install
+    void AddStateListener(WanLinkMonitor::StateCallback callback);
+
+    /// Track the links used by policy routes from start until stop
+    void Start(Time start, Time stop);
+
+    /// \return the total number of policy routes
+    uint32_t GetNRoutes() const;
+
+    /// \return the tracking session of a link, or nullptr if it is not tracked
+    const WanLinkMonitor* GetMonitor(uint32_t link) const;
+
+    /// Print the policy routes of every router
+    void Print(std::ostream& os) const;
+
+    /// \return the name of a mode: active-standby, active-active or weighted
+    static std::string GetModeName(WanPolicyRouting::Mode mode);
+
+    /**
+     * Parse a mode name.
+     * \param name active-standby, active-active or weighted
+     * \param mode the mode
+     * \return false if the name is unknown
+     */
+    static bool ParseMode(const std::string& name, WanPolicyRouting::Mode& mode);
+
+  private:
+    /// Usability change of a tracked link at one end
+    void LinkStateChanged(uint32_t link, uint32_t end, bool usable);
+
+    const WanTopology& m_topology;                                  //!< Topology
+    const WanNetwork& m_network;                                    //!< Network
+    WanPolicyRouting::Mode m_mode;                                  //!< Policy
+    WanPolicyRouting::LoadSharing m_loadSharing;                    //!< Sharing granularity
+    WanLinkMonitor::Mode m_tracking;                                //!< Link tracking
+    Time m_revertHold;                                              //!< Revert hold of tracking
+    WanFlapDamping m_damping;                                       //!< Flap damping of tracking
+    double m_primaryWeight{3};                                      //!< WEIGHTED primary share
+    double m_alternateWeight{1};                                    //!< WEIGHTED alternate share
+    std::map<uint32_t, double> m_linkWeights;                       //!< WEIGHTED shares by link
+    uint32_t m_routeThreads{0};                                     //!< All-pairs workers, 0: cores
+    std::vector<Ptr<WanPolicyRouting>> m_routing;                   //!< Policy routing by site
+    std::map<uint32_t, std::unique_ptr<WanLinkMonitor>> m_monitors; //!< Tracking by link
+};
+
+} // namespace ns3
+
+#endif /* WAN_REDUNDANCY_H */
@@ -0,0 +1,355 @@
+/*
+ * Reordering, duplicate and gap analysis of sequence-tagged flows
+ */
+
+#include "wan-reorder-analyzer.h"
+
+#include "ns3/abort.h"
+#include "ns3/ipv4-l3-protocol.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+
+#include <algorithm>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("WanReorderAnalyzer");
+
+NS_OBJECT_ENSURE_REGISTERED(WanSequenceTag);
+
+namespace
+{
+
+/// Event windows kept per flow; later events extend the last window
+const uint32_t MAX_EVENT_WINDOWS = 64;
+
+} // namespace
+
+/*
+ * WanSequenceTag
+ */
+
+TypeId
+WanSequenceTag::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::WanSequenceTag")
+                            .SetParent<Tag>()
+                            .SetGroupName("Network")
+                            .AddConstructor<WanSequenceTag>();
+    return tid;
+}
+
+WanSequenceTag::WanSequenceTag()
+{
+}
+
+WanSequenceTag::WanSequenceTag(uint32_t flow, uint64_t sequence)
+    : m_flow(flow),
+      m_sequence(sequence)
+{
+}
+
+uint32_t
+WanSequenceTag::GetFlow() const
+{
+    return m_flow;
+}
+
+uint64_t
+WanSequenceTag::GetSequence() const
+{
+    return m_sequence;
+}
+
+TypeId
+WanSequenceTag::GetInstanceTypeId() const
+{
+    return GetTypeId();
+}
+
+uint32_t
+WanSequenceTag::GetSerializedSize() const
+{
+    return 12;
+}
+
+void
+WanSequenceTag::Serialize(TagBuffer buffer) const
+{
+    buffer.WriteU32(m_flow);
+    buffer.WriteU64(m_sequence);
+}
+
+void
+WanSequenceTag::Deserialize(TagBuffer buffer)
+{
+    m_flow = buffer.ReadU32();
+    m_sequence = buffer.ReadU64();
+}
+
+void
+WanSequenceTag::Print(std::ostream& os) const
+{
+    os << "flow=" << m_flow << " seq=" << m_sequence;
+}
+
+/*
+ * WanReorderAnalyzer
+ */
+
+WanReorderAnalyzer::WanReorderAnalyzer(uint32_t window)
+    : m_window((window + 63) / 64 * 64)
+{
+    NS_ABORT_MSG_IF(window == 0, "Reorder window must not be empty");
+}
+
+uint32_t
+WanReorderAnalyzer::AddFlow(const std::string& name)
+{
+    Flow flow;
+    flow.name = name;
+    flow.bitmap.assign(m_window / 64, 0);
+    m_flows.push_back(flow);
+    return m_flows.size() - 1;
+}
+
+void
+WanReorderAnalyzer::TagPacket(uint32_t flow, Ptr<Packet> packet)
+{
+    packet->AddPacketTag(WanSequenceTag(flow, m_flows.at(flow).txNext++));
+}
+
+void
+WanReorderAnalyzer::Install(Ptr<Node> node, WanTracingManager& tracing)
+{
+    Ptr<Ipv4L3Protocol> ipv4 = node->GetObject<Ipv4L3Protocol>();
+    NS_ABORT_MSG_UNLESS(ipv4, "Reorder analysis needs IPv4 on node " << node->GetId());
+    m_tracing = &tracing;
+    tracing.Connect(WanTracingManager::STATS,
+                    ipv4,
+                    "LocalDeliver",
+                    MakeBoundCallback(&WanReorderAnalyzer::LocalDeliver, this));
+}
+
+void
+WanReorderAnalyzer::MarkEvent(const std::string& label)
+{
+    if (m_events.size() + 1 >= MAX_EVENT_WINDOWS)
+    {
+        NS_LOG_WARN("Too many events, " << label << " extends the last window");
+        return;
+    }
+    m_events.push_back({Simulator::Now(), label});
+}
+
+void
+WanReorderAnalyzer::AddEvent(Time at, const std::string& label)
+{
+    Simulator::Schedule(at, &WanReorderAnalyzer::MarkEvent, this, label);
+}
+
+void
+WanReorderAnalyzer::LocalDeliver(WanReorderAnalyzer* analyzer,
+                                 const Ipv4Header& /* header */,
+                                 Ptr<const Packet> packet,
+                                 uint32_t /* interface */)
+{
+    analyzer->m_tracing->Count(WanTracingManager::STATS);
+    WanSequenceTag tag;
+    if (packet->PeekPacketTag(tag) && tag.GetFlow() < analyzer->m_flows.size())
+    {
+        analyzer->Receive(analyzer->m_flows[tag.GetFlow()],
+                          static_cast<int64_t>(tag.GetSequence()));
+    }
+}
+
+WanReorderAnalyzer::Stats&
+WanReorderAnalyzer::Current(Flow& flow)
+{
+    flow.windows.resize(m_events.size() + 1);
+    return flow.windows.back();
+}
+
+bool
+WanReorderAnalyzer::IsSet(const Flow& flow, int64_t sequence) const
+{
+    uint64_t slot = static_cast<uint64_t>(sequence) % m_window;
+    return (flow.bitmap[slot / 64] >> (slot % 64)) & 1;
+}
+
+void
+WanReorderAnalyzer::SetBit(Flow& flow, int64_t sequence, bool value)
+{
+    uint64_t slot = static_cast<uint64_t>(sequence) % m_window;
+    uint64_t mask = uint64_t{1} << (slot % 64);
+    flow.bitmap[slot / 64] = value ? flow.bitmap[slot / 64] | mask : flow.bitmap[slot / 64] & ~mask;
+}
+
+void
+WanReorderAnalyzer::Advance(Flow& flow, int64_t next, Stats& stats)
+{
+    const int64_t window = m_window;
+    // Numbers that leave the window: holes among them are lost
+    int64_t leaveFrom = std::max(flow.first, flow.next - window);
+    int64_t leaveTo = std::min(flow.next, next - window);
+    for (int64_t s = leaveFrom; s < leaveTo; ++s)
+    {
+        stats.lost += !IsSet(flow, s);
+        SetBit(flow, s, false);
+    }
+    // Numbers that pass through the window in one jump were never received
+    stats.lost += std::max<int64_t>(0, next - window - flow.next);
+    // Numbers that enter the window start as holes
+    for (int64_t s = std::max(flow.next, next - window); s < next; ++s)
+    {
+        SetBit(flow, s, false);
+    }
+    flow.next = next;
+}
+
+void
+WanReorderAnalyzer::Receive(Flow& flow, int64_t sequence)
+{
+    Stats& stats = Current(flow);
+    ++stats.received;
+    if (!flow.started)
+    {
+        flow.started = true;
+        flow.first = sequence;
+        flow.next = sequence;
+    }
+
+    if (sequence >= flow.next)
+    {
+        if (sequence > flow.next)
+        {
+            ++stats.gaps;
+        }
+        Advance(flow, sequence + 1, stats);
+        SetBit(flow, sequence, true);
+        return;
+    }
+
+    uint64_t depth = flow.next - 1 - sequence;
+    if (sequence < flow.first || depth >= m_window)
+    {
+        // Too old to tell a late packet from a duplicate
+        ++stats.beyondWindow;
+        stats.maxDepth = std::max(stats.maxDepth, depth);
+        return;
+    }
+    if (IsSet(flow, sequence))
+    {
+        ++stats.duplicates;
+        return;
+    }
+    SetBit(flow, sequence, true);
+    uint64_t extent = 0;
+    for (int64_t s = sequence + 1; s < flow.next; ++s)
+    {
+        extent += IsSet(flow, s);
+    }
+    ++stats.reordered;
+    stats.maxDepth = std::max(stats.maxDepth, depth);
+    stats.maxExtent = std::max(stats.maxExtent, extent);
+}
+
+void
+WanReorderAnalyzer::Finish()
+{
+    for (Flow& flow : m_flows)
+    {
+        if (!flow.started)
+        {
+            continue;
+        }
+        Stats& stats = Current(flow);
+        for (int64_t s = std::max<int64_t>(flow.first, flow.next - m_window); s < flow.next; ++s)
+        {
+            stats.lost += !IsSet(flow, s);
+        }
+        // Nothing is pending any more: a second Finish counts nothing
+        flow.first = flow.next;
+    }
+}
+
+const WanReorderAnalyzer::Stats&
+WanReorderAnalyzer::GetStats(uint32_t flow, uint32_t window) const
+{
+    static const Stats none;
+    const Flow& f = m_flows.at(flow);
+    return window < f.windows.size() ? f.windows[window] : none;
+}
+
+uint32_t
+WanReorderAnalyzer::GetNWindows() const
+{
+    return m_events.size() + 1;
+}
+
+void
+WanReorderAnalyzer::AddMetrics(WanMetrics& metrics) const
+{
+    if (!m_tracing || !m_tracing->IsEnabled(WanTracingManager::STATS))
+    {
+        return;
+    }
+    for (uint32_t f = 0; f < m_flows.size(); ++f)
+    {
+        Stats total;
+        for (uint32_t w = 0; w < GetNWindows(); ++w)
+        {
+            const Stats& stats = GetStats(f, w);
+            total.reordered += stats.reordered + stats.beyondWindow;
+            total.duplicates += stats.duplicates;
+            total.gaps += stats.gaps;
+            total.lost += stats.lost;
+            total.maxDepth = std::max(total.maxDepth, stats.maxDepth);
+            total.maxExtent = std::max(total.maxExtent, stats.maxExtent);
+        }
+        const std::string prefix = "reorder." + m_flows[f].name;
+        metrics.Set(prefix + ".reordered", total.reordered);
+        metrics.Set(prefix + ".duplicates", total.duplicates);
+        metrics.Set(prefix + ".gaps", total.gaps);
+        metrics.Set(prefix + ".lost", total.lost);
+        metrics.Set(prefix + ".max_depth", total.maxDepth);
+        metrics.Set(prefix + ".max_extent", total.maxExtent);
+    }
+}
+
+void
+WanReorderAnalyzer::Print(std::ostream& os) const
+{
+    os << "\n========================================" << std::endl;
+    os << "Reordering per Failover Event (window " << m_window << ")" << std::endl;
+    os << "========================================" << std::endl;
+    for (uint32_t w = 0; w < GetNWindows(); ++w)
+    {
+        if (w == 0)
+        {
+            os << "Before the first event:" << std::endl;
+        }
+        else
+        {
+            os << "t=" << m_events[w - 1].at.GetSeconds() << "s " << m_events[w - 1].label << ":"
+               << std::endl;
+        }
+        for (uint32_t f = 0; f < m_flows.size(); ++f)
+        {
+            const Stats& stats = GetStats(f, w);
+            os << "  " << m_flows[f].name << ": " << stats.received << " received, "
+               << stats.reordered << " reordered (depth " << stats.maxDepth << ", extent "
+               << stats.maxExtent << ")";
+            if (stats.beyondWindow > 0)
+            {
+                os << ", " << stats.beyondWindow << " beyond the window";
+            }
+            os << ", " << stats.duplicates << " duplicates, " << stats.gaps << " gaps, "
+               << stats.lost << " lost" << std::endl;
+        }
+    }
+    os << "========================================" << std::endl;
+}
+
+} // namespace ns3
@@ -0,0 +1,189 @@
+/*
+ * Reordering, duplicate and gap analysis of sequence-tagged flows
+ *
+ * When traffic moves between paths of different length, packets in flight
+ * on the longer path arrive after later packets sent on the shorter one.
+ * Senders tag every packet of a flow with a sequence number
+ * (WanSequenceTag). The analyzer watches local delivery at the sink nodes
+ * and classifies every arrival per flow:
+ *
+ * - in order: the next expected sequence number;
+ * - gap: a sequence number beyond the next expected, opening a hole;
+ * - reordered: a number below the highest seen that fills a hole, with
+ *   its depth (how far behind the highest number seen it is, RFC 5236
+ *   displacement) and extent (how many later-sent packets arrived before
+ *   it, RFC 4737);
+ * - duplicate: a number already received.
+ *
+ * Memory per flow is a bitmap of the last Window sequence numbers, so
+ * holes that leave the window count as lost, and older arrivals count as
+ * reordered beyond the window (duplicate or not). Counters are kept per
+ * event window: from one failover event (MarkEvent) to the next, so the
+ * report states how much reordering each reroute caused.
+ */
+
+#ifndef WAN_REORDER_ANALYZER_H
+#define WAN_REORDER_ANALYZER_H
+
+#include "wan-metrics.h"
+#include "wan-tracing.h"
+
+#include "ns3/ipv4-header.h"
+#include "ns3/node.h"
+#include "ns3/nstime.h"
+#include "ns3/packet.h"
+#include "ns3/tag.h"
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Flow and sequence number of a packet, added by its sender.
+ */
+class WanSequenceTag : public Tag
+{
+  public:
+    /// Get the type ID
+    static TypeId GetTypeId();
+
+    WanSequenceTag();
+
+    /**
+     * \param flow flow index of the analyzer
+     * \param sequence sequence number within the flow
+     */
+    WanSequenceTag(uint32_t flow, uint64_t sequence);
+
+    /// \return the flow index
+    uint32_t GetFlow() const;
+
+    /// \return the sequence number
+    uint64_t GetSequence() const;
+
+    // Inherited from Tag
+    TypeId GetInstanceTypeId() const override;
+    uint32_t GetSerializedSize() const override;
+    void Serialize(TagBuffer buffer) const override;
+    void Deserialize(TagBuffer buffer) override;
+    void Print(std::ostream& os) const override;
+
+  private:
+    uint32_t m_flow{0};     //!< Flow index
+    uint64_t m_sequence{0}; //!< Sequence number
+};
+
+/**
+ * Per-flow arrival order analysis in bounded memory.
+ */
+class WanReorderAnalyzer
+{
+  public:
+    /// Counters of one flow in one event window
+    struct Stats
+    {
+        uint64_t received{0};     //!< Arrivals, duplicates included
+        uint64_t reordered{0};    //!< Late arrivals that filled a hole
+        uint64_t beyondWindow{0}; //!< Arrivals older than the window
+        uint64_t duplicates{0};   //!< Sequence numbers received again
+        uint64_t gaps{0};         //!< Holes opened
+        uint64_t lost{0};         //!< Holes never filled
+        uint64_t maxDepth{0};     //!< Largest reorder depth
+        uint64_t maxExtent{0};    //!< Largest reorder extent
+    };
+
+    /// \param window sequence numbers remembered per flow (default 1024)
+    explicit WanReorderAnalyzer(uint32_t window = 1024);
+
+    /**
+     * Register a flow.
+     * \param name label for reports and metrics, e.g. "HQ->DC"
+     * \return the flow index to tag its packets with
+     */
+    uint32_t AddFlow(const std::string& name);
+
+    /// Tag a packet with the next sequence number of a flow
+    void TagPacket(uint32_t flow, Ptr<Packet> packet);
+
+    /**
+     * Analyze the tagged packets delivered to a node.
+     * \param node the node
+     * \param tracing the tracing manager; the sink is a STATS sink
+     */
+    void Install(Ptr<Node> node, WanTracingManager& tracing);
+
+    /// Start a new event window now, e.g. on a failover
+    void MarkEvent(const std::string& label);
+
+    /// Start a new event window at a given time
+    void AddEvent(Time at, const std::string& label);
+
+    /// Count the holes left at the end of the run as lost
+    void Finish();
+
+    /// \return the counters of a flow in an event window (0: before the first event)
+    const Stats& GetStats(uint32_t flow, uint32_t window) const;
+
+    /// \return the number of event windows, including the one before the first event
+    uint32_t GetNWindows() const;
+
+    /// Add reorder.<flow>.{reordered, duplicates, gaps, lost, max_depth, max_extent} if STATS is on
+    void AddMetrics(WanMetrics& metrics) const;
+
+    /// Print the counters per flow and event window
+    void Print(std::ostream& os) const;
+
+  private:
+    /// Arrival state of one flow
+    struct Flow
+    {
+        std::string name;             //!< Label
+        uint64_t txNext{0};           //!< Next sequence number to tag
+        bool started{false};          //!< Something arrived
+        int64_t first{0};             //!< First sequence number that arrived
+        int64_t next{0};              //!< Highest sequence number seen, plus one
+        std::vector<uint64_t> bitmap; //!< Received bits, sequence number modulo window
+        std::vector<Stats> windows;   //!< Counters by event window
+    };
+
+    /// An event window start
+    struct Event
+    {
+        Time at;           //!< Start of the window
+        std::string label; //!< What happened
+    };
+
+    /// Ipv4L3Protocol LocalDeliver trace
+    static void LocalDeliver(WanReorderAnalyzer* analyzer,
+                             const Ipv4Header& header,
+                             Ptr<const Packet> packet,
+                             uint32_t interface);
+
+    /// Account for one arrival
+    void Receive(Flow& flow, int64_t sequence);
+
+    /// Slide the window of a flow so that it ends before next, counting lost holes
+    void Advance(Flow& flow, int64_t next, Stats& stats);
+
+    /// \return the counters of a flow in the current event window
+    Stats& Current(Flow& flow);
+
+    /// \return true if a sequence number inside the window was received
+    bool IsSet(const Flow& flow, int64_t sequence) const;
+
+    /// Record or clear a sequence number inside the window
+    void SetBit(Flow& flow, int64_t sequence, bool value);
+
+    uint32_t m_window;                     //!< Bitmap size, a multiple of 64
+    std::vector<Flow> m_flows;             //!< Flows by index
+    std::vector<Event> m_events;           //!< Event window starts
+    WanTracingManager* m_tracing{nullptr}; //!< Owner of the sinks
+};
+
+} // namespace ns3
+
+#endif /* WAN_REORDER_ANALYZER_H */
@@ -0,0 +1,361 @@
+/*
+ * Independent replications with confidence intervals
+ */
+
+#include "wan-replication.h"
+
+#include "ns3/abort.h"
+#include "ns3/log.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define WAN_REPLICATION_FORK 1
+#endif
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("WanReplication");
+
+namespace
+{
+
+/// Standard normal quantile (Acklam's rational approximation, |error| < 1.2e-9)
+double
+NormalQuantile(double p)
+{
+    static const double a[] = {-3.969683028665376e+01,
+                               2.209460984245205e+02,
+                               -2.759285104469687e+02,
+                               1.383577518672690e+02,
+                               -3.066479806614716e+01,
+                               2.506628277459239e+00};
+    static const double b[] = {-5.447609879822406e+01,
+                               1.615858368580409e+02,
+                               -1.556989798598866e+02,
+                               6.680131188771972e+01,
+                               -1.328068155288572e+01};
+    static const double c[] = {-7.784894002430293e-03,
+                               -3.223964580411365e-01,
+                               -2.400758277161838e+00,
+                               -2.549732539343734e+00,
+                               4.374664141464968e+00,
+                               2.938163982698783e+00};
+    static const double d[] = {7.784695709041462e-03,
+                               3.224671290700398e-01,
+                               2.445134137142996e+00,
+                               3.754408661907416e+00};
+    const double low = 0.02425;
+    if (p < low)
+    {
+        double q = std::sqrt(-2 * std::log(p));
+        return (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+               ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1);
+    }
+    if (p > 1 - low)
+    {
+        return -NormalQuantile(1 - p);
+    }
+    double q = p - 0.5;
+    double r = q * q;
+    return (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q /
+           (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1);
+}
+
+} // namespace
+
+double
+WanReplicationManager::StudentTQuantile(double p, double dof)
+{
+    NS_ABORT_MSG_IF(p <= 0 || p >= 1 || dof < 1, "Bad t quantile arguments");
+    // Closed forms for 1 and 2 degrees of freedom, Cornish-Fisher expansion
+    // around the normal quantile above (better than 0.1% from 3 on)
+    if (dof == 1)
+    {
+        return std::tan(M_PI * (p - 0.5));
+    }
+    if (dof == 2)
+    {
+        return (2 * p - 1) / std::sqrt(2 * p * (1 - p));
+    }
+    double z = NormalQuantile(p);
+    double z2 = z * z;
+    return z + z * (z2 + 1) / (4 * dof) + z * ((5 * z2 + 16) * z2 + 3) / (96 * dof * dof) +
+           z * (((3 * z2 + 19) * z2 + 17) * z2 - 15) / (384 * dof * dof * dof) +
+           z * ((((79 * z2 + 776) * z2 + 1482) * z2 - 1920) * z2 - 945) /
+               (92160 * dof * dof * dof * dof);
+}
+
+WanReplicationManager::WanReplicationManager()
+    : m_jobs(std::max(1U, std::thread::hardware_concurrency()))
+{
+}
+
+void
+WanReplicationManager::SetMaxReplications(uint32_t replications)
+{
+    NS_ABORT_MSG_IF(replications == 0, "Need at least one replication");
+    m_maxReplications = replications;
+}
+
+void
+WanReplicationManager::SetMinReplications(uint32_t replications)
+{
+    m_minReplications = std::max(2U, replications);
+}
+
+void
+WanReplicationManager::SetJobs(uint32_t jobs)
+{
+    m_jobs = std::max(1U, jobs);
+}
+
+void
+WanReplicationManager::SetPrecision(double precision)
+{
+    m_precision = precision;
+}
+
+void
+WanReplicationManager::SetConfidence(double confidence)
+{
+    NS_ABORT_MSG_IF(confidence <= 0 || confidence >= 1, "Confidence must be in (0, 1)");
+    m_confidence = confidence;
+}
+
+uint32_t
+WanReplicationManager::Run(Body body)
+{
+    m_results.assign(m_maxReplications, WanMetrics());
+    std::vector<bool> done(m_maxReplications, false);
+    uint32_t prefix = 0;
+    bool stop = false;
+
+#ifdef WAN_REPLICATION_FORK
+    /// A replication in flight
+    struct Child
+    {
+        pid_t pid;            //!< Its process
+        uint32_t replication; //!< Its replication
+        std::string text;     //!< Serialized metrics read so far
+    };
+
+    // Replications in flight by the read end of their pipe
+    std::map<int, Child> running;
+    uint32_t next = 0;
+    while (true)
+    {
+        while (!stop && next < m_maxReplications && running.size() < m_jobs)
+        {
+            int fds[2];
+            NS_ABORT_MSG_IF(pipe(fds) != 0, "pipe() failed");
+            // Do not let the children inherit unwritten output
+            std::cout.flush();
+            std::fflush(stdout);
+            pid_t pid = fork();
+            NS_ABORT_MSG_IF(pid < 0, "fork() failed");
+            if (pid == 0)
+            {
+                close(fds[0]);
+                int devNull = open("/dev/null", O_WRONLY);
+                dup2(devNull, STDOUT_FILENO);
+                std::string text = body(next).Serialize();
+                for (size_t written = 0; written < text.size();)
+                {
+                    ssize_t n = write(fds[1], text.data() + written, text.size() - written);
+                    if (n <= 0)
+                    {
+                        _exit(1);
+                    }
+                    written += n;
+                }
+                close(fds[1]);
+                // Skip static destructors and atexit handlers of the parent's state
+                _exit(0);
+            }
+            close(fds[1]);
+            running[fds[0]] = {pid, next, ""};
+            NS_LOG_INFO("Replication " << next << " started as process " << pid);
+            ++next;
+        }
+        if (running.empty())
+        {
+            break;
+        }
+
+        // Drain the pipes as data arrives: the metrics of a large topology
+        // exceed a pipe buffer, and a child blocks on write until it is read
+        std::vector<pollfd> polled;
+        for (const auto& [fd, child] : running)
+        {
+            polled.push_back({fd, POLLIN, 0});
+        }
+        if (poll(polled.data(), polled.size(), -1) < 0)
+        {
+            NS_ABORT_MSG_IF(errno != EINTR, "poll() failed");
+            continue;
+        }
+        for (const pollfd& p : polled)
+        {
+            if (p.revents == 0)
+            {
+                continue;
+            }
+            Child& child = running[p.fd];
+            char buffer[65536];
+            ssize_t n = read(p.fd, buffer, sizeof(buffer));
+            if (n > 0)
+            {
+                child.text.append(buffer, n);
+                continue;
+            }
+
+            // End of file: the child is done
+            close(p.fd);
+            int status;
+            waitpid(child.pid, &status, 0);
+            NS_ABORT_MSG_UNLESS(WIFEXITED(status) && WEXITSTATUS(status) == 0,
+                                "Replication " << child.replication << " failed");
+            m_results[child.replication] = WanMetrics::Deserialize(child.text);
+            done[child.replication] = true;
+            running.erase(p.fd);
+        }
+
+        // Test every prefix length in turn, as a serial run would: testing
+        // only the longest one after several completions at once could stop
+        // later than the serial run
+        while (!stop && prefix < m_maxReplications && done[prefix])
+        {
+            ++prefix;
+            stop = prefix >= m_minReplications && IsPrecise(prefix);
+        }
+    }
+#else
+    for (uint32_t replication = 0; replication < m_maxReplications && !stop; ++replication)
+    {
+        m_results[replication] = body(replication);
+        done[replication] = true;
+        prefix = replication + 1;
+        stop = prefix >= m_minReplications && IsPrecise(prefix);
+    }
+#endif
+
+    m_used = prefix;
+    m_results.resize(m_used);
+    return m_used;
+}
+
+const std::vector<WanMetrics>&
+WanReplicationManager::GetResults() const
+{
+    return m_results;
+}
+
+std::vector<WanReplicationManager::Summary>
+WanReplicationManager::Summarize(uint32_t n) const
+{
+    // Welford's update per metric; replications without a metric do not count
+    struct Moments
+    {
+        uint32_t n{0};
+        double mean{0};
+        double m2{0};
+    };
+
+    std::map<std::string, Moments> moments;
+    for (uint32_t r = 0; r < n; ++r)
+    {
+        for (const auto& [name, value] : m_results[r].GetValues())
+        {
+            Moments& m = moments[name];
+            ++m.n;
+            double delta = value - m.mean;
+            m.mean += delta / m.n;
+            m.m2 += delta * (value - m.mean);
+        }
+    }
+
+    std::vector<Summary> summaries;
+    summaries.reserve(moments.size());
+    for (const auto& [name, m] : moments)
+    {
+        Summary summary{name, m.n, m.mean, 0, std::numeric_limits<double>::infinity()};
+        if (m.n > 1)
+        {
+            summary.stddev = std::sqrt(m.m2 / (m.n - 1));
+            summary.halfWidth = StudentTQuantile((1 + m_confidence) / 2, m.n - 1) *
+                                summary.stddev / std::sqrt(m.n);
+        }
+        summaries.push_back(summary);
+    }
+    return summaries;
+}
+
+std::vector<WanReplicationManager::Summary>
+WanReplicationManager::Summarize() const
+{
+    return Summarize(m_used);
+}
+
+bool
+WanReplicationManager::IsPrecise(uint32_t n) const
+{
+    if (m_precision <= 0)
+    {
+        return false;
+    }
+    for (const auto& summary : Summarize(n))
+    {
+        if (summary.halfWidth > m_precision * std::abs(summary.mean) && summary.halfWidth > 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool
+WanReplicationManager::IsPrecise() const
+{
+    return IsPrecise(m_used);
+}
+
+void
+WanReplicationManager::Print(std::ostream& os) const
+{
+    os << "\n========================================" << std::endl;
+    os << "Replication Summary: " << m_used << " replications, " << m_confidence * 100
+       << "% confidence intervals" << std::endl;
+    os << "Target precision " << m_precision * 100 << "% of the mean: "
+       << (IsPrecise() ? "reached" : "NOT reached") << std::endl;
+    os << "========================================" << std::endl;
+    std::ios::fmtflags flags = os.flags();
+    os << std::left << std::setw(32) << "metric" << std::right << std::setw(4) << "n"
+       << std::setw(14) << "mean" << std::setw(14) << "+/-" << std::setw(10) << "rel"
+       << std::endl;
+    for (const auto& summary : Summarize())
+    {
+        os << std::left << std::setw(32) << summary.name << std::right << std::setw(4)
+           << summary.n << std::setw(14) << std::setprecision(6) << summary.mean
+           << std::setw(14) << summary.halfWidth << std::setw(9) << std::setprecision(3)
+           << (summary.mean != 0 ? 100 * summary.halfWidth / std::abs(summary.mean) : 0.0)
+           << "%" << std::endl;
+    }
+    os.flags(flags);
+    os << "========================================" << std::endl;
+}
+
+} // namespace ns3
@@ -0,0 +1,114 @@
+/*
+ * Independent replications with confidence intervals
+ *
+ * One run is one sample. The replication manager runs the scenario up to
+ * K times, several at a time; the scenario gives each replication its own
+ * random streams (e.g. RngRun = first run + replication). It reports mean
+ * and Student-t confidence interval of every metric the runs return, and
+ * stops launching replications once every metric's half-width is within
+ * Precision of its mean, so the CPU spent follows the precision needed.
+ *
+ * The ns-3 simulator is a process-wide singleton, so each replication
+ * runs in a forked child process that reports its metrics through a pipe
+ * (its standard output is discarded). Everything set up before Run() is
+ * shared copy-on-write. Stopping is decided on the completed prefix of
+ * replications 0..n-1, never on completion order, so fast runs cannot bias
+ * the result. Without fork() (non-POSIX hosts) replications run one after
+ * the other in-process.
+ */
+
+#ifndef WAN_REPLICATION_H
+#define WAN_REPLICATION_H
+
+#include "wan-metrics.h"
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Runs replications and summarizes their metrics.
+ */
+class WanReplicationManager
+{
+  public:
+    /// Runs one replication; must set up, run and destroy its own simulation
+    typedef std::function<WanMetrics(uint32_t replication)> Body;
+
+    /// Summary of one metric
+    struct Summary
+    {
+        std::string name; //!< Metric name
+        uint32_t n;       //!< Replications reporting it
+        double mean;      //!< Sample mean
+        double stddev;    //!< Sample standard deviation
+        double halfWidth; //!< Confidence interval half-width
+    };
+
+    WanReplicationManager();
+
+    /// \param replications upper bound on replications (default 10)
+    void SetMaxReplications(uint32_t replications);
+
+    /// \param replications replications before stopping is considered (default 3)
+    void SetMinReplications(uint32_t replications);
+
+    /// \param jobs replications running at the same time (default: hardware threads)
+    void SetJobs(uint32_t jobs);
+
+    /// \param precision target half-width relative to the mean; 0 runs all replications
+    void SetPrecision(double precision);
+
+    /// \param confidence confidence level of the intervals (default 0.95)
+    void SetConfidence(double confidence);
+
+    /**
+     * Run replications until the precision is reached or the upper bound.
+     * \param body the scenario
+     * \return the number of replications used
+     */
+    uint32_t Run(Body body);
+
+    /// \return the metrics of the replications used, in replication order
+    const std::vector<WanMetrics>& GetResults() const;
+
+    /// \return per-metric summaries over the replications used
+    std::vector<Summary> Summarize() const;
+
+    /// \return true if the last Run() reached the target precision
+    bool IsPrecise() const;
+
+    /// Print a summary table
+    void Print(std::ostream& os) const;
+
+    /**
+     * \param p probability
+     * \param dof degrees of freedom
+     * \return the p-quantile of Student's t distribution
+     */
+    static double StudentTQuantile(double p, double dof);
+
+  private:
+    /// \return summaries over replications 0..n-1
+    std::vector<Summary> Summarize(uint32_t n) const;
+
+    /// \return true if every metric over replications 0..n-1 is precise enough
+    bool IsPrecise(uint32_t n) const;
+
+    uint32_t m_maxReplications{10};    //!< Upper bound
+    uint32_t m_minReplications{3};     //!< Lower bound for stopping
+    uint32_t m_jobs;                   //!< Parallel replications
+    double m_precision{0.05};          //!< Relative half-width target
+    double m_confidence{0.95};         //!< Confidence level
+    std::vector<WanMetrics> m_results; //!< Metrics by replication
+    uint32_t m_used{0};                //!< Replications in the summary
+};
+
+} // namespace ns3
+
+#endif /* WAN_REPLICATION_H */
@@ -0,0 +1,246 @@
+/*
+ * Results store: every run's metadata and metrics in one file
+ */
+
+#include "wan-results-store.h"
+
+#include "wan-hash.h"
+
+#include "ns3/abort.h"
+#include "ns3/log.h"
+#include "ns3/rng-seed-manager.h"
+
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+#ifdef HAVE_SQLITE3
+#include <sqlite3.h>
+#endif
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("WanResultsStore");
+
+namespace
+{
+
+#ifdef HAVE_SQLITE3
+/// Run a statement without results, aborting with the database's message
+void
+Exec(sqlite3* db, const std::string& sql)
+{
+    char* error = nullptr;
+    int rc = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &error);
+    std::string message = error ? error : "";
+    sqlite3_free(error);
+    NS_ABORT_MSG_IF(rc != SQLITE_OK, "SQLite: " << message << " in '" << sql << "'");
+}
+
+/// Prepare a statement, aborting with the database's message
+sqlite3_stmt*
+Prepare(sqlite3* db, const std::string& sql)
+{
+    sqlite3_stmt* stmt = nullptr;
+    NS_ABORT_MSG_IF(sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK,
+                    "SQLite: " << sqlite3_errmsg(db) << " in '" << sql << "'");
+    return stmt;
+}
+
+/// Bind a string parameter (copied by SQLite)
+void
+BindText(sqlite3_stmt* stmt, int index, const std::string& value)
+{
+    sqlite3_bind_text(stmt, index, value.c_str(), -1, SQLITE_TRANSIENT);
+}
+
+/// Step a statement to completion and reset it for the next row
+void
+StepReset(sqlite3* db, sqlite3_stmt* stmt)
+{
+    NS_ABORT_MSG_IF(sqlite3_step(stmt) != SQLITE_DONE, "SQLite: " << sqlite3_errmsg(db));
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+}
+#endif
+
+/// Tabs and newlines would break a row of the text format
+std::string
+Field(const std::string& text)
+{
+    std::string field = text;
+    for (char& c : field)
+    {
+        if (c == '\t' || c == '\n' || c == '\r')
+        {
+            c = ' ';
+        }
+    }
+    return field;
+}
+
+} // namespace
+
+WanResultsStore::WanResultsStore(const std::string& path)
+    : m_path(path)
+{
+#ifdef HAVE_SQLITE3
+    NS_ABORT_MSG_IF(sqlite3_open(path.c_str(), &m_db) != SQLITE_OK,
+                    "Cannot open results database " << path);
+    // Parallel sweeps append to the same file: wait for the write lock
+    sqlite3_busy_timeout(m_db, 60000);
+    Exec(m_db,
+         "CREATE TABLE IF NOT EXISTS runs (run_id TEXT PRIMARY KEY, time TEXT, "
+         "config_hash TEXT, config TEXT, git_rev TEXT, seed INTEGER, run INTEGER, "
+         "output_dir TEXT);"
+         "CREATE TABLE IF NOT EXISTS metrics (run_id TEXT REFERENCES runs(run_id), "
+         "replication INTEGER, name TEXT, value REAL);"
+         "CREATE INDEX IF NOT EXISTS metrics_run ON metrics(run_id);"
+         "CREATE INDEX IF NOT EXISTS metrics_name ON metrics(name);");
+#else
+    std::ifstream existing(path);
+    if (!existing || existing.peek() == std::ifstream::traits_type::eof())
+    {
+        std::ofstream file(path, std::ios::app);
+        NS_ABORT_MSG_UNLESS(file, "Cannot open results file " << path);
+        file << "run_id\ttime\tconfig_hash\tconfig\tgit_rev\tseed\trun\toutput_dir\t"
+                "replication\tname\tvalue\n";
+    }
+#endif
+}
+
+WanResultsStore::~WanResultsStore()
+{
+#ifdef HAVE_SQLITE3
+    sqlite3_close(m_db);
+#endif
+}
+
+bool
+WanResultsStore::IsSqlite() const
+{
+    return m_db != nullptr;
+}
+
+void
+WanResultsStore::AddRun(const RunInfo& info, const std::vector<WanMetrics>& replications)
+{
+    NS_LOG_FUNCTION(this << info.runId << replications.size());
+#ifdef HAVE_SQLITE3
+    // One transaction per run: a run is either fully stored or not at all
+    Exec(m_db, "BEGIN IMMEDIATE");
+    sqlite3_stmt* run = Prepare(m_db, "INSERT INTO runs VALUES (?, ?, ?, ?, ?, ?, ?, ?)");
+    BindText(run, 1, info.runId);
+    BindText(run, 2, info.time);
+    BindText(run, 3, info.configHash);
+    BindText(run, 4, info.config);
+    BindText(run, 5, info.gitRev);
+    sqlite3_bind_int64(run, 6, info.seed);
+    sqlite3_bind_int64(run, 7, static_cast<sqlite3_int64>(info.run));
+    BindText(run, 8, info.outputDir);
+    StepReset(m_db, run);
+    sqlite3_finalize(run);
+
+    sqlite3_stmt* metric = Prepare(m_db, "INSERT INTO metrics VALUES (?, ?, ?, ?)");
+    for (uint32_t replication = 0; replication < replications.size(); ++replication)
+    {
+        for (const auto& [name, value] : replications[replication].GetValues())
+        {
+            BindText(metric, 1, info.runId);
+            sqlite3_bind_int(metric, 2, replication);
+            BindText(metric, 3, name);
+            sqlite3_bind_double(metric, 4, value);
+            StepReset(m_db, metric);
+        }
+    }
+    sqlite3_finalize(metric);
+    Exec(m_db, "COMMIT");
+#else
+    // Build the whole run first and append it with one write
+    std::ostringstream rows;
+    rows << std::setprecision(std::numeric_limits<double>::max_digits10);
+    std::ostringstream prefix;
+    prefix << Field(info.runId) << '\t' << Field(info.time) << '\t' << Field(info.configHash)
+           << '\t' << Field(info.config) << '\t' << Field(info.gitRev) << '\t' << info.seed
+           << '\t' << info.run << '\t' << Field(info.outputDir) << '\t';
+    for (uint32_t replication = 0; replication < replications.size(); ++replication)
+    {
+        for (const auto& [name, value] : replications[replication].GetValues())
+        {
+            rows << prefix.str() << replication << '\t' << Field(name) << '\t' << value << '\n';
+        }
+    }
+    std::ofstream file(m_path, std::ios::app);
+    NS_ABORT_MSG_UNLESS(file, "Cannot open results file " << m_path);
+    file << rows.str() << std::flush;
+#endif
+}
+
+WanResultsStore::RunInfo
+WanResultsStore::MakeRunInfo(const std::string& config, const std::string& sourceDir)
+{
+    RunInfo info;
+    auto now = std::chrono::system_clock::now();
+    std::time_t seconds = std::chrono::system_clock::to_time_t(now);
+    auto micros =
+        std::chrono::duration_cast<std::chrono::microseconds>(now.time_since_epoch()).count() %
+        1000000;
+    std::tm utc{};
+    gmtime_r(&seconds, &utc);
+
+    std::ostringstream time;
+    time << std::put_time(&utc, "%Y-%m-%dT%H:%M:%S") << '.' << std::setw(6)
+         << std::setfill('0') << micros << 'Z';
+    info.time = time.str();
+    info.config = config;
+    info.configHash = Hash(config);
+    info.gitRev = GetGitRevision(sourceDir);
+    info.seed = RngSeedManager::GetSeed();
+    info.run = RngSeedManager::GetRun();
+
+    // Sortable by time, readable as a directory name, unique down to the
+    // microsecond for the same configuration and run
+    std::ostringstream runId;
+    runId << std::put_time(&utc, "%Y%m%d-%H%M%S") << '-' << std::setw(6) << std::setfill('0')
+          << micros << '-' << info.configHash.substr(0, 8) << "-r" << info.run;
+    info.runId = runId.str();
+    return info;
+}
+
+std::string
+WanResultsStore::Hash(const std::string& text)
+{
+    std::ostringstream hex;
+    hex << std::hex << std::setw(16) << std::setfill('0') << Fnv1a(text);
+    return hex.str();
+}
+
+std::string
+WanResultsStore::GetGitRevision(const std::string& dir)
+{
+    std::string command = "git -C '" + dir + "' describe --always --dirty 2>/dev/null";
+    FILE* pipe = popen(command.c_str(), "r");
+    if (!pipe)
+    {
+        return "unknown";
+    }
+    std::string revision;
+    char buffer[128];
+    while (fgets(buffer, sizeof(buffer), pipe))
+    {
+        revision += buffer;
+    }
+    pclose(pipe);
+    while (!revision.empty() && (revision.back() == '\n' || revision.back() == '\r'))
+    {
+        revision.pop_back();
+    }
+    return revision.empty() ? "unknown" : revision;
+}
+
+} // namespace ns3
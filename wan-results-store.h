@@ -0,0 +1,99 @@
+/*
+ * Results store: every run's metadata and metrics in one file
+ *
+ * Each run (a single run or a set of replications) gets a run ID and is
+ * appended to one results file:
+ *
+ *   runs(run_id, time, config_hash, config, git_rev, seed, run, output_dir)
+ *   metrics(run_id, replication, name, value)
+ *
+ * With ns-3 built with SQLite (HAVE_SQLITE3) the file is an SQLite
+ * database with these two tables, so a sweep of thousands of runs is one
+ * query:
+ *
+ *   SELECT r.config, m.name, AVG(m.value) FROM metrics m
+ *       JOIN runs r USING (run_id) GROUP BY r.config, m.name;
+ *
+ * Without SQLite it is one tab-separated table with a header, one row per
+ * metric value carrying the run columns, which loads directly into any
+ * dataframe or columnar engine. Concurrent writers are safe in the SQLite
+ * case (SQLite locking, busy retries) and append whole lines otherwise.
+ */
+
+#ifndef WAN_RESULTS_STORE_H
+#define WAN_RESULTS_STORE_H
+
+#include "wan-metrics.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct sqlite3;
+
+namespace ns3
+{
+
+/**
+ * Appends runs to a results file.
+ */
+class WanResultsStore
+{
+  public:
+    /// Metadata of one run
+    struct RunInfo
+    {
+        std::string runId;      //!< Unique run ID
+        std::string time;       //!< Start time, UTC, ISO 8601
+        std::string config;     //!< Canonical configuration text
+        std::string configHash; //!< Hash of config
+        std::string gitRev;     //!< Source revision, "unknown" outside git
+        uint32_t seed{0};       //!< RngSeed
+        uint64_t run{0};        //!< RngRun of replication 0
+        std::string outputDir;  //!< Directory of the run's output files
+    };
+
+    /**
+     * Open or create a results file.
+     * \param path the file
+     */
+    explicit WanResultsStore(const std::string& path);
+
+    ~WanResultsStore();
+
+    WanResultsStore(const WanResultsStore&) = delete;
+    WanResultsStore& operator=(const WanResultsStore&) = delete;
+
+    /**
+     * Append a run.
+     * \param info run metadata
+     * \param replications metrics of each replication, in replication order
+     */
+    void AddRun(const RunInfo& info, const std::vector<WanMetrics>& replications);
+
+    /// \return true if the store is an SQLite database
+    bool IsSqlite() const;
+
+    /**
+     * Describe a run before it starts: time, config hash, git revision,
+     * seed and a run ID built from them.
+     * \param config canonical configuration text
+     * \param sourceDir directory whose git revision is recorded
+     * \return the run metadata; outputDir is left empty
+     */
+    static RunInfo MakeRunInfo(const std::string& config, const std::string& sourceDir);
+
+    /// \return a 64-bit FNV-1a hash of text, as 16 hex digits
+    static std::string Hash(const std::string& text);
+
+    /// \return "git describe --always --dirty" of a directory, or "unknown"
+    static std::string GetGitRevision(const std::string& dir);
+
+  private:
+    std::string m_path;     //!< Results file
+    sqlite3* m_db{nullptr}; //!< Database, if SQLite is available
+};
+
+} // namespace ns3
+
+#endif /* WAN_RESULTS_STORE_H */
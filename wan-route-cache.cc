@@ -0,0 +1,372 @@
+/*
+ * Per-destination route cache in front of a router's list routing
+ */
+
+#include "wan-route-cache.h"
+
+#include "wan-fib-routing.h"
+
+#include "ns3/abort.h"
+#include "ns3/boolean.h"
+#include "ns3/ipv4-global-routing-helper.h"
+#include "ns3/ipv4-global-routing.h"
+#include "ns3/ipv4-static-routing-helper.h"
+#include "ns3/ipv4-static-routing.h"
+#include "ns3/log.h"
+#include "ns3/node-container.h"
+#include "ns3/node.h"
+
+#include <chrono>
+#include <iomanip>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("WanRouteCache");
+
+NS_OBJECT_ENSURE_REGISTERED(WanRouteCache);
+
+namespace
+{
+
+/// One lookup in this many is timed
+const uint32_t TIMING_INTERVAL = 64;
+
+/// \return a monotonic time in nanoseconds
+int64_t
+NowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+} // namespace
+
+void
+WanRouteCache::Stats::Add(const Stats& other)
+{
+    hits += other.hits;
+    misses += other.misses;
+    bypassed += other.bypassed;
+    flushes += other.flushes;
+    hitSamples += other.hitSamples;
+    hitSeconds += other.hitSeconds;
+    missSamples += other.missSamples;
+    missSeconds += other.missSeconds;
+}
+
+void
+WanRouteCache::Stats::Print(std::ostream& os) const
+{
+    std::ios::fmtflags flags = os.flags();
+    std::streamsize precision = os.precision();
+    uint64_t lookups = hits + misses + bypassed;
+    os << "Route cache: " << lookups << " lookups, " << std::fixed << std::setprecision(1)
+       << (lookups > 0 ? 100.0 * hits / lookups : 0.0) << "% hits, " << bypassed
+       << " bypassed, " << flushes << " flushes";
+    if (hitSamples > 0 && missSamples > 0)
+    {
+        double hitNs = hitSeconds * 1e9 / hitSamples;
+        double missNs = missSeconds * 1e9 / missSamples;
+        os << "; " << std::setprecision(0) << hitNs << "ns per hit, " << missNs
+           << "ns per miss (" << (missNs > 0 ? 100 * (1 - hitNs / missNs) : 0.0)
+           << "% less per cached packet)";
+    }
+    os << std::endl;
+    os.flags(flags);
+    os.precision(precision);
+}
+
+TypeId
+WanRouteCache::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::WanRouteCache")
+                            .SetParent<Ipv4ListRouting>()
+                            .SetGroupName("Internet")
+                            .AddConstructor<WanRouteCache>();
+    return tid;
+}
+
+WanRouteCache::WanRouteCache()
+{
+    SetSlots(64);
+}
+
+void
+WanRouteCache::SetSlots(uint32_t slots)
+{
+    NS_ABORT_MSG_IF(slots == 0 || slots > (1U << 24), "Route cache of " << slots << " slots");
+    uint32_t bits = 1;
+    while ((1U << bits) < slots)
+    {
+        ++bits;
+    }
+    m_shift = 32 - bits;
+    m_slots.assign(1U << bits, Slot());
+}
+
+void
+WanRouteCache::Invalidate()
+{
+    ++m_stats.flushes;
+    if (++m_generation == 0)
+    {
+        // Generation 0 marks empty slots: empty them all once in 2^32 flushes
+        m_slots.assign(m_slots.size(), Slot());
+        m_generation = 1;
+    }
+}
+
+void
+WanRouteCache::Invalidate(Ptr<Ipv4> ipv4)
+{
+    Ptr<WanRouteCache> cache = DynamicCast<WanRouteCache>(ipv4->GetRoutingProtocol());
+    if (cache)
+    {
+        cache->Invalidate();
+    }
+}
+
+const WanRouteCache::Stats&
+WanRouteCache::GetStats() const
+{
+    return m_stats;
+}
+
+WanRouteCache::Stats
+WanRouteCache::GetStats(const NodeContainer& nodes)
+{
+    Stats stats;
+    for (uint32_t i = 0; i < nodes.GetN(); ++i)
+    {
+        Ptr<Ipv4> ipv4 = nodes.Get(i)->GetObject<Ipv4>();
+        Ptr<WanRouteCache> cache =
+            ipv4 ? DynamicCast<WanRouteCache>(ipv4->GetRoutingProtocol()) : nullptr;
+        if (cache)
+        {
+            stats.Add(cache->GetStats());
+        }
+    }
+    return stats;
+}
+
+WanRouteCache::Slot&
+WanRouteCache::GetSlot(Ipv4Address destination)
+{
+    // Fibonacci hashing: consecutive addresses spread over the slots
+    return m_slots[(destination.Get() * 2654435769U) >> m_shift];
+}
+
+bool
+WanRouteCache::IsCacheable(Ipv4Address destination) const
+{
+    return m_cacheable && !destination.IsMulticast() && !destination.IsBroadcast();
+}
+
+bool
+WanRouteCache::IsTimed()
+{
+    return ++m_lookups % TIMING_INTERVAL == 0;
+}
+
+void
+WanRouteCache::AddRoutingProtocol(Ptr<Ipv4RoutingProtocol> routingProtocol, int16_t priority)
+{
+    Ipv4ListRouting::AddRoutingProtocol(routingProtocol, priority);
+    // Global routing with random ECMP picks one of several routes per packet
+    bool randomEcmp = false;
+    if (DynamicCast<Ipv4GlobalRouting>(routingProtocol))
+    {
+        BooleanValue value;
+        routingProtocol->GetAttribute("RandomEcmpRouting", value);
+        randomEcmp = value.Get();
+    }
+    if ((!DynamicCast<Ipv4StaticRouting>(routingProtocol) &&
+         !DynamicCast<WanFibRouting>(routingProtocol) &&
+         !DynamicCast<Ipv4GlobalRouting>(routingProtocol)) ||
+        randomEcmp)
+    {
+        NS_LOG_INFO("Route cache off: " << routingProtocol->GetInstanceTypeId().GetName()
+                                        << " does not route by destination only");
+        m_cacheable = false;
+    }
+    Invalidate();
+}
+
+Ptr<Ipv4Route>
+WanRouteCache::RouteOutput(Ptr<Packet> p,
+                           const Ipv4Header& header,
+                           Ptr<NetDevice> oif,
+                           Socket::SocketErrno& sockerr)
+{
+    const Ipv4Address destination = header.GetDestination();
+    if (oif || !IsCacheable(destination))
+    {
+        ++m_stats.bypassed;
+        return Ipv4ListRouting::RouteOutput(p, header, oif, sockerr);
+    }
+    const int64_t start = IsTimed() ? NowNs() : -1;
+    Slot& slot = GetSlot(destination);
+    if (slot.generation == m_generation && slot.destination == destination.Get())
+    {
+        ++m_stats.hits;
+        sockerr = Socket::ERROR_NOTERROR;
+        if (start >= 0)
+        {
+            ++m_stats.hitSamples;
+            m_stats.hitSeconds += (NowNs() - start) * 1e-9;
+        }
+        return slot.route;
+    }
+    ++m_stats.misses;
+    Ptr<Ipv4Route> route = Ipv4ListRouting::RouteOutput(p, header, oif, sockerr);
+    if (route)
+    {
+        slot = {destination.Get(), m_generation, false, route};
+    }
+    if (start >= 0)
+    {
+        ++m_stats.missSamples;
+        m_stats.missSeconds += (NowNs() - start) * 1e-9;
+    }
+    return route;
+}
+
+bool
+WanRouteCache::RouteInput(Ptr<const Packet> p,
+                          const Ipv4Header& header,
+                          Ptr<const NetDevice> idev,
+                          const UnicastForwardCallback& ucb,
+                          const MulticastForwardCallback& mcb,
+                          const LocalDeliverCallback& lcb,
+                          const ErrorCallback& ecb)
+{
+    const Ipv4Address destination = header.GetDestination();
+    if (!IsCacheable(destination))
+    {
+        ++m_stats.bypassed;
+        return Ipv4ListRouting::RouteInput(p, header, idev, ucb, mcb, lcb, ecb);
+    }
+    const int64_t start = IsTimed() ? NowNs() : -1;
+    Slot& slot = GetSlot(destination);
+    // A forwarded destination is not local: address changes flush the cache
+    if (slot.generation == m_generation && slot.destination == destination.Get() &&
+        slot.forwarded && m_ipv4->IsForwarding(m_ipv4->GetInterfaceForDevice(idev)))
+    {
+        ++m_stats.hits;
+        if (start >= 0)
+        {
+            ++m_stats.hitSamples;
+            m_stats.hitSeconds += (NowNs() - start) * 1e-9;
+        }
+        ucb(slot.route, p, header);
+        return true;
+    }
+
+    // Local delivery, errors and forwarding as the list routing decides;
+    // a forwarded route is learned on its way to ucb
+    UnicastForwardCallback forward = m_forward;
+    Slot* learning = m_learning;
+    int64_t missStart = m_missStart;
+    m_forward = ucb;
+    m_learning = &slot;
+    m_missStart = start;
+    bool routed = Ipv4ListRouting::RouteInput(p,
+                                              header,
+                                              idev,
+                                              MakeCallback(&WanRouteCache::Learn, this),
+                                              mcb,
+                                              lcb,
+                                              ecb);
+    if (m_learning)
+    {
+        // Delivered locally or dropped: nothing a cache could answer
+        ++m_stats.bypassed;
+    }
+    m_forward = forward;
+    m_learning = learning;
+    m_missStart = missStart;
+    return routed;
+}
+
+void
+WanRouteCache::Learn(Ptr<Ipv4Route> route, Ptr<const Packet> p, const Ipv4Header& header)
+{
+    ++m_stats.misses;
+    *m_learning = {header.GetDestination().Get(), m_generation, true, route};
+    m_learning = nullptr;
+    if (m_missStart >= 0)
+    {
+        ++m_stats.missSamples;
+        m_stats.missSeconds += (NowNs() - m_missStart) * 1e-9;
+    }
+    m_forward(route, p, header);
+}
+
+void
+WanRouteCache::NotifyInterfaceUp(uint32_t interface)
+{
+    Ipv4ListRouting::NotifyInterfaceUp(interface);
+    Invalidate();
+}
+
+void
+WanRouteCache::NotifyInterfaceDown(uint32_t interface)
+{
+    Ipv4ListRouting::NotifyInterfaceDown(interface);
+    Invalidate();
+}
+
+void
+WanRouteCache::NotifyAddAddress(uint32_t interface, Ipv4InterfaceAddress address)
+{
+    Ipv4ListRouting::NotifyAddAddress(interface, address);
+    Invalidate();
+}
+
+void
+WanRouteCache::NotifyRemoveAddress(uint32_t interface, Ipv4InterfaceAddress address)
+{
+    Ipv4ListRouting::NotifyRemoveAddress(interface, address);
+    Invalidate();
+}
+
+void
+WanRouteCache::SetIpv4(Ptr<Ipv4> ipv4)
+{
+    m_ipv4 = ipv4;
+    Ipv4ListRouting::SetIpv4(ipv4);
+}
+
+void
+WanRouteCache::DoDispose()
+{
+    m_ipv4 = nullptr;
+    m_slots.clear();
+    m_forward = UnicastForwardCallback();
+    Ipv4ListRouting::DoDispose();
+}
+
+WanRouteCacheHelper::WanRouteCacheHelper(uint32_t slots)
+    : m_slots(slots)
+{
+}
+
+WanRouteCacheHelper*
+WanRouteCacheHelper::Copy() const
+{
+    return new WanRouteCacheHelper(*this);
+}
+
+Ptr<Ipv4RoutingProtocol>
+WanRouteCacheHelper::Create(Ptr<Node> node) const
+{
+    Ptr<WanRouteCache> cache = CreateObject<WanRouteCache>();
+    cache->SetSlots(m_slots);
+    cache->AddRoutingProtocol(Ipv4StaticRoutingHelper().Create(node), 0);
+    cache->AddRoutingProtocol(Ipv4GlobalRoutingHelper().Create(node), -10);
+    return cache;
+}
+
+} // namespace ns3
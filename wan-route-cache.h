@@ -0,0 +1,174 @@
+/*
+ * Per-destination route cache in front of a router's list routing
+ *
+ * Every packet a router sends or forwards asks the list routing for a
+ * route: the static routes scan their list for the longest prefix, the FIB
+ * (see wan-fib-routing.h) binary-searches it, and either allocates a new
+ * Ipv4Route. Most packets of a run go to a few destinations per router. A
+ * WanRouteCache is the router's list routing with a small direct-mapped
+ * cache in front: a destination hashes to one slot, and a slot holding the
+ * same destination returns its route without asking the protocols.
+ *
+ * The cache is flushed, by bumping a generation number, whenever an
+ * interface goes up or down, an address or routing protocol is added or
+ * removed, and when Invalidate() is called. Code that changes the routes of
+ * a running router calls it: failover (see wan-link-monitor.h), node
+ * failure (see wan-node-failure.h) and WanFibRouting::Load() do.
+ *
+ * Only destination-based protocols are cached: static, FIB and global
+ * routing without RandomEcmpRouting. A router with any other protocol, such as the policy routes of
+ * wan-redundancy.h, which share load per flow or per packet, passes every
+ * lookup through. So do multicast and broadcast destinations and sockets
+ * bound to a device.
+ *
+ * Routers get a cache only when asked for one (see
+ * WanTopologyHelper::SetRouteCache()).
+ *
+ * The report gives the hit rate and the time to a routing decision of hits
+ * and misses, timed on one lookup in 64 so the clock costs little.
+ */
+
+#ifndef WAN_ROUTE_CACHE_H
+#define WAN_ROUTE_CACHE_H
+
+#include "ns3/ipv4-list-routing.h"
+#include "ns3/ipv4-route.h"
+#include "ns3/ipv4-routing-helper.h"
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace ns3
+{
+
+class NodeContainer;
+
+/**
+ * List routing with a direct-mapped per-destination route cache.
+ */
+class WanRouteCache : public Ipv4ListRouting
+{
+  public:
+    /// Counters of one or more caches
+    struct Stats
+    {
+        uint64_t hits{0};        //!< Lookups answered by the cache
+        uint64_t misses{0};      //!< Cacheable lookups passed to the protocols
+        uint64_t bypassed{0};    //!< Lookups that could not be cached, local deliveries
+        uint64_t flushes{0};     //!< Invalidations
+        uint64_t hitSamples{0};  //!< Timed hits
+        double hitSeconds{0};    //!< Time of the timed hits
+        uint64_t missSamples{0}; //!< Timed misses
+        double missSeconds{0};   //!< Time of the timed misses
+
+        /// Add the counters of another cache
+        void Add(const Stats& other);
+
+        /// Print a one-line summary
+        void Print(std::ostream& os) const;
+    };
+
+    /// Get the type ID
+    static TypeId GetTypeId();
+
+    WanRouteCache();
+
+    /// \param slots cache size, rounded up to a power of two (default 64)
+    void SetSlots(uint32_t slots);
+
+    /// Flush the cache after a change of the routes
+    void Invalidate();
+
+    /**
+     * Flush the cache of a router, if it has one.
+     * \param ipv4 the router's IPv4
+     */
+    static void Invalidate(Ptr<Ipv4> ipv4);
+
+    /// \return the counters of this cache
+    const Stats& GetStats() const;
+
+    /**
+     * \param nodes routers
+     * \return the counters of their caches added up
+     */
+    static Stats GetStats(const NodeContainer& nodes);
+
+    // Inherited from Ipv4ListRouting
+    void AddRoutingProtocol(Ptr<Ipv4RoutingProtocol> routingProtocol, int16_t priority) override;
+    Ptr<Ipv4Route> RouteOutput(Ptr<Packet> p,
+                               const Ipv4Header& header,
+                               Ptr<NetDevice> oif,
+                               Socket::SocketErrno& sockerr) override;
+    bool RouteInput(Ptr<const Packet> p,
+                    const Ipv4Header& header,
+                    Ptr<const NetDevice> idev,
+                    const UnicastForwardCallback& ucb,
+                    const MulticastForwardCallback& mcb,
+                    const LocalDeliverCallback& lcb,
+                    const ErrorCallback& ecb) override;
+    void NotifyInterfaceUp(uint32_t interface) override;
+    void NotifyInterfaceDown(uint32_t interface) override;
+    void NotifyAddAddress(uint32_t interface, Ipv4InterfaceAddress address) override;
+    void NotifyRemoveAddress(uint32_t interface, Ipv4InterfaceAddress address) override;
+    void SetIpv4(Ptr<Ipv4> ipv4) override;
+
+  protected:
+    void DoDispose() override;
+
+  private:
+    /// A cached route
+    struct Slot
+    {
+        uint32_t destination{0}; //!< Destination address, host order
+        uint32_t generation{0};  //!< Generation it was cached in; 0: empty
+        bool forwarded{false};   //!< Learned by forwarding: not a local address
+        Ptr<Ipv4Route> route;    //!< The route
+    };
+
+    /// \return the slot of a destination
+    Slot& GetSlot(Ipv4Address destination);
+
+    /// \return true if lookups for a destination may be cached
+    bool IsCacheable(Ipv4Address destination) const;
+
+    /// \return true if this lookup is timed
+    bool IsTimed();
+
+    /// Unicast forward callback of a miss: learn the route, then forward
+    void Learn(Ptr<Ipv4Route> route, Ptr<const Packet> p, const Ipv4Header& header);
+
+    Ptr<Ipv4> m_ipv4;                 //!< IPv4 of the router
+    std::vector<Slot> m_slots;        //!< Direct-mapped slots
+    uint32_t m_shift{26};             //!< 32 - log2(slots)
+    uint32_t m_generation{1};         //!< Current generation
+    bool m_cacheable{true};           //!< All protocols route by destination only
+    uint32_t m_lookups{0};            //!< Lookups, to pick the timed ones
+    Stats m_stats;                    //!< Counters
+    UnicastForwardCallback m_forward; //!< Forward callback of the miss in progress
+    Slot* m_learning{nullptr};        //!< Slot of the miss in progress; nullptr once learned
+    int64_t m_missStart{-1};          //!< Start of the timed miss in progress, ns
+};
+
+/**
+ * Creates a WanRouteCache with static (priority 0) and global (-10)
+ * routing, the protocols InternetStackHelper installs by default.
+ */
+class WanRouteCacheHelper : public Ipv4RoutingHelper
+{
+  public:
+    /// \param slots cache size of every router
+    explicit WanRouteCacheHelper(uint32_t slots);
+
+    // Inherited from Ipv4RoutingHelper
+    WanRouteCacheHelper* Copy() const override;
+    Ptr<Ipv4RoutingProtocol> Create(Ptr<Node> node) const override;
+
+  private:
+    uint32_t m_slots; //!< Cache size
+};
+
+} // namespace ns3
+
+#endif /* WAN_ROUTE_CACHE_H */
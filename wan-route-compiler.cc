@@ -0,0 +1,216 @@
+/*
+ * Parallel all-sources shortest paths over a WanGraph
+ */
+
+#include "wan-route-compiler.h"
+
+#include "ns3/log.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <time.h>
+#define WAN_ROUTE_COMPILER_THREAD_CLOCK 1
+#endif
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("WanRouteCompiler");
+
+namespace
+{
+
+/// A worker's share of the sources: [head, tail) packed into one word
+using Share = std::atomic<uint64_t>;
+
+/**
+ * \return the CPU time of the calling thread in seconds; wall-clock time
+ *         where there is no per-thread clock
+ */
+double
+ThreadSeconds()
+{
+#ifdef WAN_ROUTE_COMPILER_THREAD_CLOCK
+    timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+#else
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+}
+
+uint64_t
+Pack(uint32_t head, uint32_t tail)
+{
+    return (static_cast<uint64_t>(head) << 32) | tail;
+}
+
+/**
+ * Take the source at the head of a share.
+ * \return false if the share is empty
+ */
+bool
+Take(Share& share, uint32_t& source)
+{
+    uint64_t bounds = share.load();
+    while (true)
+    {
+        uint32_t head = bounds >> 32;
+        uint32_t tail = bounds & 0xffffffff;
+        if (head >= tail)
+        {
+            return false;
+        }
+        if (share.compare_exchange_weak(bounds, Pack(head + 1, tail)))
+        {
+            source = head;
+            return true;
+        }
+    }
+}
+
+/**
+ * Move the upper half of the largest other share to a thief's share.
+ * \return false if every share is empty
+ */
+bool
+Steal(std::vector<Share>& shares, uint32_t thief)
+{
+    while (true)
+    {
+        uint32_t victim = thief;
+        uint64_t bounds = 0;
+        uint32_t largest = 0;
+        for (uint32_t w = 0; w < shares.size(); ++w)
+        {
+            uint64_t b = shares[w].load();
+            uint32_t left = (b & 0xffffffff) - (b >> 32);
+            if (w != thief && left > largest)
+            {
+                victim = w;
+                bounds = b;
+                largest = left;
+            }
+        }
+        if (largest == 0)
+        {
+            return false;
+        }
+        uint32_t head = bounds >> 32;
+        uint32_t tail = bounds & 0xffffffff;
+        uint32_t middle = head + (tail - head) / 2;
+        if (shares[victim].compare_exchange_strong(bounds, Pack(head, middle)))
+        {
+            // The thief's own share is empty, so no one else touches it
+            // until this store
+            shares[thief].store(Pack(middle, tail));
+            return true;
+        }
+    }
+}
+
+} // namespace
+
+WanRouteCompiler::WanRouteCompiler(const WanGraph& graph)
+    : m_graph(graph)
+{
+}
+
+void
+WanRouteCompiler::SetThreads(uint32_t threads)
+{
+    m_threads = threads;
+}
+
+void
+WanRouteCompiler::Run(const Visitor& visitor)
+{
+    const uint32_t nSites = m_graph.GetNSites();
+    uint32_t threads = m_threads > 0 ? m_threads : std::thread::hardware_concurrency();
+    threads = std::max(1U, std::min(threads, nSites));
+    m_stats = Stats();
+    m_stats.threads = threads;
+    m_stats.sources = nSites;
+
+    std::vector<Share> shares(threads);
+    for (uint32_t w = 0; w < threads; ++w)
+    {
+        shares[w].store(Pack(static_cast<uint64_t>(nSites) * w / threads,
+                             static_cast<uint64_t>(nSites) * (w + 1) / threads));
+    }
+    std::vector<double> cpu(threads, 0);
+    std::vector<uint32_t> steals(threads, 0);
+    auto work = [&](uint32_t w) {
+        double start = ThreadSeconds();
+        std::vector<double> distance;
+        std::vector<int32_t> firstArc;
+        uint32_t source;
+        while (true)
+        {
+            if (Take(shares[w], source))
+            {
+                m_graph.ShortestPaths(source, distance, firstArc);
+                visitor(source, distance, firstArc);
+            }
+            else if (Steal(shares, w))
+            {
+                ++steals[w];
+            }
+            else
+            {
+                break;
+            }
+        }
+        cpu[w] = ThreadSeconds() - start;
+    };
+
+    // Worker 0 is the calling thread, so a serial run starts no threads
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (uint32_t w = 1; w < threads; ++w)
+    {
+        pool.emplace_back(work, w);
+    }
+    work(0);
+    for (std::thread& thread : pool)
+    {
+        thread.join();
+    }
+    m_stats.wallSeconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for (uint32_t w = 0; w < threads; ++w)
+    {
+        m_stats.cpuSeconds += cpu[w];
+        m_stats.steals += steals[w];
+    }
+    NS_LOG_INFO(nSites << " trees on " << threads << " threads in " << m_stats.wallSeconds
+                       << "s, " << m_stats.steals << " steals");
+}
+
+const WanRouteCompiler::Stats&
+WanRouteCompiler::GetStats() const
+{
+    return m_stats;
+}
+
+void
+WanRouteCompiler::Stats::Print(std::ostream& os) const
+{
+    std::ios::fmtflags flags = os.flags();
+    std::streamsize precision = os.precision();
+    os << "Routes: " << sources << " shortest-path trees on " << threads << " threads in "
+       << std::fixed << std::setprecision(3) << wallSeconds << "s (cpu " << cpuSeconds
+       << "s, " << std::setprecision(1) << (wallSeconds > 0 ? cpuSeconds / wallSeconds : 1.0)
+       << "x parallelism, " << steals << " steals)" << std::endl;
+    os.flags(flags);
+    os.precision(precision);
+}
+
+} // namespace ns3
@@ -0,0 +1,90 @@
+/*
+ * Parallel all-sources shortest paths over a WanGraph
+ *
+ * Route installation runs one Dijkstra per source site. With thousands of
+ * sites that is most of the setup time of every run, and the runs are
+ * independent: a WanRouteCompiler spreads them over a pool of threads.
+ *
+ * Each worker starts with a contiguous share of the sources, held as a
+ * (head, tail) pair in one atomic word. It takes sources from the head of
+ * its own share; once that is empty it steals the upper half of the
+ * largest share left, so a worker that drew the expensive sources does not
+ * hold up the rest. Results go to per-source slots that only one worker
+ * ever writes, so nothing is locked or merged: the caller reads the slots
+ * after Run() and installs routes on the main thread, as ns-3 objects are
+ * not thread-safe.
+ *
+ * The report gives the wall-clock time, the CPU time of all workers and
+ * their ratio, the parallelism: how many workers were busy on average. It
+ * is not a speedup. Workers that share caches and memory bandwidth run
+ * each tree slower than one thread would, so the speedup over a serial
+ * run is lower; --routeThreads=1 measures the serial time.
+ */
+
+#ifndef WAN_ROUTE_COMPILER_H
+#define WAN_ROUTE_COMPILER_H
+
+#include "wan-graph.h"
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Shortest-path trees from every site, computed in parallel.
+ */
+class WanRouteCompiler
+{
+  public:
+    /**
+     * Called once per source on a worker thread. It may write only state
+     * of its own source and must not touch ns-3 objects.
+     * \param source the source site
+     * \param distance least cost to every site, infinity if unreachable
+     * \param firstArc arc leaving source toward every site, -1 if none
+     */
+    using Visitor = std::function<void(uint32_t source,
+                                       const std::vector<double>& distance,
+                                       const std::vector<int32_t>& firstArc)>;
+
+    /// Timing of the last run
+    struct Stats
+    {
+        uint32_t threads{0};   //!< Workers used
+        uint32_t sources{0};   //!< Shortest-path trees computed
+        uint32_t steals{0};    //!< Successful steals
+        double wallSeconds{0}; //!< Wall-clock time of the run
+        double cpuSeconds{0};  //!< CPU time of all workers
+
+        /// Print a one-line summary
+        void Print(std::ostream& os) const;
+    };
+
+    /// \param graph adjacency to route over; must outlive the compiler
+    explicit WanRouteCompiler(const WanGraph& graph);
+
+    /// \param threads workers; 0 for one per core (default), 1 to run serially
+    void SetThreads(uint32_t threads);
+
+    /**
+     * Compute the shortest-path tree of every site.
+     * \param visitor receives each tree
+     */
+    void Run(const Visitor& visitor);
+
+    /// \return the timing of the last run
+    const Stats& GetStats() const;
+
+  private:
+    const WanGraph& m_graph; //!< Adjacency
+    uint32_t m_threads{0};   //!< Workers, 0: one per core
+    Stats m_stats;           //!< Timing of the last run
+};
+
+} // namespace ns3
+
+#endif /* WAN_ROUTE_COMPILER_H */
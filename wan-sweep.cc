@@ -0,0 +1,116 @@
+/*
+ * Parameter sweeps with reproducible seeding and ordered results
+ */
+
+#include "wan-sweep.h"
+
+#include "wan-csv-reader.h"
+#include "wan-hash.h"
+
+#include "ns3/abort.h"
+#include "ns3/log.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("WanSweep");
+
+WanSweep::WanSweep(uint64_t masterSeed)
+    : m_masterSeed(masterSeed)
+{
+}
+
+void
+WanSweep::Load(const std::string& path, uint32_t replications)
+{
+    NS_ABORT_MSG_IF(replications == 0, "A sweep needs at least one replication per point");
+    std::ifstream in(path);
+    NS_ABORT_MSG_UNLESS(in.is_open(), "Cannot open sweep file " << path);
+    WanCsvReader reader(in, path);
+    NS_ABORT_MSG_UNLESS(reader.ReadHeader(), path << ": no header");
+
+    m_jobs.clear();
+    uint32_t point = 0;
+    while (reader.Next())
+    {
+        Job job;
+        job.point = point++;
+        for (int column = 0; column < reader.GetNColumns(); ++column)
+        {
+            // Empty fields keep the command-line value
+            if (reader.Get(column).empty())
+            {
+                continue;
+            }
+            job.options.emplace_back(reader.GetColumnName(column), reader.Get(column));
+        }
+        // The key, and so the seeding, must not depend on the column order
+        std::sort(job.options.begin(), job.options.end());
+        std::string options;
+        for (uint32_t i = 0; i < job.options.size(); ++i)
+        {
+            const auto& [name, value] = job.options[i];
+            NS_ABORT_MSG_IF(i > 0 && job.options[i - 1].first == name,
+                            path << ": option " << name << " given twice");
+            options += name + "=" + value + ";";
+        }
+        for (uint32_t r = 0; r < replications; ++r)
+        {
+            job.replication = r;
+            job.key = options + "replication=" + std::to_string(r);
+            DeriveSeed(m_masterSeed, job.key, job.seed, job.run);
+            m_jobs.push_back(job);
+        }
+    }
+    NS_LOG_INFO(path << ": " << point << " points, " << m_jobs.size() << " jobs");
+}
+
+uint32_t
+WanSweep::GetNJobs() const
+{
+    return m_jobs.size();
+}
+
+const WanSweep::Job&
+WanSweep::GetJob(uint32_t job) const
+{
+    return m_jobs.at(job);
+}
+
+void
+WanSweep::Write(const std::string& path, const std::vector<WanMetrics>& results) const
+{
+    NS_ABORT_MSG_UNLESS(results.size() == m_jobs.size(),
+                        "Sweep results: " << results.size() << " for " << m_jobs.size()
+                                          << " jobs");
+    std::ofstream out(path);
+    NS_ABORT_MSG_UNLESS(out.is_open(), "Cannot write sweep results " << path);
+    out << std::setprecision(std::numeric_limits<double>::max_digits10);
+    out << "job\tkey\tseed\trun\tmetric\tvalue\n";
+    for (uint32_t j = 0; j < m_jobs.size(); ++j)
+    {
+        const Job& job = m_jobs[j];
+        for (const auto& [name, value] : results[j].GetValues())
+        {
+            out << j << '\t' << job.key << '\t' << job.seed << '\t' << job.run << '\t' << name
+                << '\t' << value << '\n';
+        }
+    }
+    NS_ABORT_MSG_UNLESS(out.good(), "Error writing sweep results " << path);
+}
+
+void
+WanSweep::DeriveSeed(uint64_t masterSeed, const std::string& key, uint32_t& seed, uint64_t& run)
+{
+    // ns-3 uses the seed for all six MRG32k3a state words: it must be
+    // below m2 = 4294944443 and not zero
+    seed = 1 + SplitMix64(masterSeed) % 4294944442ULL;
+    run = SplitMix64(SplitMix64(masterSeed) ^ Fnv1a(key));
+}
+
+} // namespace ns3
@@ -0,0 +1,92 @@
+/*
+ * Parameter sweeps with reproducible seeding and ordered results
+ *
+ * A sweep file is a CSV table (see wan-csv-reader.h): the header names
+ * scenario options, every row is one sweep point, and every point runs a
+ * number of replications. Each (point, replication) is one job with a
+ * canonical key, "detection=bfd;failure=link;replication=0": the options
+ * with their names in lower case and sorted, so neither the order nor the
+ * case of the columns changes the seeding.
+ *
+ * The random streams of a job depend only on the master seed and its
+ * key, never on which worker ran it or when: RngSeed is derived from the
+ * master seed (shared by all jobs, as ns-3 intends) and RngRun from the
+ * master seed and the key. Results are written in job order, metrics in
+ * name order and at full precision, so a parallel sweep writes exactly
+ * the file a sequential one writes, only sooner.
+ */
+
+#ifndef WAN_SWEEP_H
+#define WAN_SWEEP_H
+
+#include "wan-metrics.h"
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * The jobs of a sweep and the writer of its results.
+ */
+class WanSweep
+{
+  public:
+    /// One replication of one sweep point
+    struct Job
+    {
+        uint32_t point;                                           //!< Sweep point (row of the file)
+        uint32_t replication;                                     //!< Replication of the point
+        std::vector<std::pair<std::string, std::string>> options; //!< Option name, value
+        std::string key;                                          //!< Canonical job key
+        uint32_t seed;                                            //!< RngSeed
+        uint64_t run;                                             //!< RngRun
+    };
+
+    /// \param masterSeed seed every job's random streams derive from
+    explicit WanSweep(uint64_t masterSeed);
+
+    /**
+     * Load the sweep points.
+     * \param path CSV file, one column per option, one row per point
+     * \param replications replications per point
+     */
+    void Load(const std::string& path, uint32_t replications);
+
+    /// \return the number of jobs
+    uint32_t GetNJobs() const;
+
+    /// \return a job, in point-major order
+    const Job& GetJob(uint32_t job) const;
+
+    /**
+     * Write the results, one "job key seed run metric value" row per
+     * metric, in job order.
+     * \param path output file (tab-separated, with a header)
+     * \param results metrics of each job, in job order
+     */
+    void Write(const std::string& path, const std::vector<WanMetrics>& results) const;
+
+    /**
+     * Derive the random streams of a job.
+     * \param masterSeed the master seed
+     * \param key the job key
+     * \param seed RngSeed, non-zero and below the MRG32k3a modulus m2
+     * \param run RngRun
+     */
+    static void DeriveSeed(uint64_t masterSeed,
+                           const std::string& key,
+                           uint32_t& seed,
+                           uint64_t& run);
+
+  private:
+    uint64_t m_masterSeed;   //!< Seed of all jobs
+    std::vector<Job> m_jobs; //!< Jobs in order
+};
+
+} // namespace ns3
+
+#endif /* WAN_SWEEP_H */
@@ -0,0 +1,424 @@
+/*
+ * Build an ns-3 network from a WanTopology
+ */
+
+#include "wan-topology-helper.h"
+
+#include "wan-point-to-point-channel.h"
+#include "wan-route-cache.h"
+
+#include "ns3/abort.h"
+#include "ns3/boolean.h"
+#include "ns3/double.h"
+#include "ns3/drop-tail-queue.h"
+#include "ns3/error-model.h"
+#include "ns3/internet-stack-helper.h"
+#include "ns3/ipv4-address-helper.h"
+#include "ns3/ipv4-list-routing.h"
+#include "ns3/ipv4-static-routing-helper.h"
+#include "ns3/ipv4.h"
+#include "ns3/log.h"
+#include "ns3/mac48-address.h"
+#include "ns3/mobility-helper.h"
+#include "ns3/mobility-model.h"
+#include "ns3/net-device-queue-interface.h"
+#include "ns3/point-to-point-net-device.h"
+#include "ns3/pointer.h"
+
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+#include <malloc.h>
+#define WAN_TOPOLOGY_HELPER_MALLINFO 1
+#endif
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("WanTopologyHelper");
+
+namespace
+{
+
+/// Extra delay per packet with mean link.jitter, in seconds
+Ptr<RandomVariableStream>
+MakeJitterVariable(const WanLink& link)
+{
+    double mean = link.jitter.GetSeconds();
+    if (link.jitterModel == "normal")
+    {
+        Ptr<NormalRandomVariable> normal = CreateObject<NormalRandomVariable>();
+        normal->SetAttribute("Mean", DoubleValue(mean));
+        normal->SetAttribute("Variance", DoubleValue(mean * mean));
+        return normal;
+    }
+    if (link.jitterModel == "pareto")
+    {
+        // Heavy tail, as seen on radio access; mean = shape * scale / (shape - 1)
+        const double shape = 3.0;
+        Ptr<ParetoRandomVariable> pareto = CreateObject<ParetoRandomVariable>();
+        pareto->SetAttribute("Shape", DoubleValue(shape));
+        pareto->SetAttribute("Scale", DoubleValue(mean * (shape - 1) / shape));
+        return pareto;
+    }
+    Ptr<UniformRandomVariable> uniform = CreateObject<UniformRandomVariable>();
+    uniform->SetAttribute("Min", DoubleValue(0.0));
+    uniform->SetAttribute("Max", DoubleValue(2 * mean));
+    return uniform;
+}
+
+/// Receive-side loss of one direction: independent or in bursts
+Ptr<ErrorModel>
+MakeLossModel(const WanLink& link)
+{
+    if (link.lossBurst <= 1.0)
+    {
+        Ptr<RateErrorModel> rate = CreateObject<RateErrorModel>();
+        rate->SetUnit(RateErrorModel::ERROR_UNIT_PACKET);
+        rate->SetRate(link.loss);
+        return rate;
+    }
+    // Bursts start with probability loss/burst and last burst packets on average
+    Ptr<UniformRandomVariable> size = CreateObject<UniformRandomVariable>();
+    size->SetAttribute("Min", DoubleValue(1.0));
+    size->SetAttribute("Max", DoubleValue(2 * link.lossBurst));
+    Ptr<BurstErrorModel> burst = CreateObject<BurstErrorModel>();
+    burst->SetAttribute("ErrorRate", DoubleValue(link.loss / link.lossBurst));
+    burst->SetAttribute("BurstSize", PointerValue(size));
+    return burst;
+}
+
+/// Random variable streams of one link: channel, then loss of each end
+const int64_t STREAMS_PER_LINK = 6;
+
+/// \return the heap bytes in use, or -1 where the allocator does not tell
+int64_t
+HeapBytes()
+{
+#ifdef WAN_TOPOLOGY_HELPER_MALLINFO
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+#else
+    return -1;
+#endif
+}
+
+} // namespace
+
+void
+WanRouteInstallStats::Print(std::ostream& os) const
+{
+    paths.Print(os);
+    std::ios::fmtflags flags = os.flags();
+    std::streamsize precision = os.precision();
+    os << "FIB: " << routes << " routes installed " << (bulk ? "in bulk" : "one by one") << " in "
+       << std::fixed << std::setprecision(3) << seconds << "s";
+    if (heapBytes >= 0)
+    {
+        os << ", " << std::setprecision(1) << heapBytes / 1e6 << "MB of heap";
+        if (routes > 0)
+        {
+            os << " (" << std::setprecision(0) << static_cast<double>(heapBytes) / routes
+               << " bytes per route)";
+        }
+    }
+    if (bulk)
+    {
+        os << ", " << tables << " distinct tables";
+    }
+    os << std::endl;
+    os.flags(flags);
+    os.precision(precision);
+}
+
+WanTopologyHelper::WanTopologyHelper()
+    : m_base("10.1.1.0"),
+      m_mask("255.255.255.252"),
+      m_step(256),
+      m_threads(0),
+      m_bulkFib(true),
+      m_routeCache(0)
+{
+}
+
+void
+WanTopologyHelper::SetAddressPlan(Ipv4Address base, Ipv4Mask mask, uint32_t step)
+{
+    m_base = base;
+    m_mask = mask;
+    m_step = step;
+}
+
+void
+WanTopologyHelper::SetRouteThreads(uint32_t threads)
+{
+    m_threads = threads;
+}
+
+void
+WanTopologyHelper::SetBulkFib(bool bulk)
+{
+    m_bulkFib = bulk;
+}
+
+void
+WanTopologyHelper::SetRouteCache(uint32_t slots)
+{
+    m_routeCache = slots;
+}
+
+Ipv4Address
+WanTopologyHelper::GetLinkNetwork(uint32_t l) const
+{
+    return Ipv4Address(m_base.Get() + l * m_step);
+}
+
+Ipv4Mask
+WanTopologyHelper::GetLinkMask() const
+{
+    return m_mask;
+}
+
+WanNetwork
+WanTopologyHelper::Install(const WanTopology& topology) const
+{
+    NS_LOG_FUNCTION(this << topology.GetNSites() << topology.GetNLinks());
+    WanNetwork network;
+    network.nodes.Create(topology.GetNSites());
+
+    // One point-to-point link per circuit, each with its own profile
+    network.linkDevices.reserve(topology.GetNLinks());
+    for (uint32_t l = 0; l < topology.GetNLinks(); ++l)
+    {
+        const WanLink& link = topology.GetLink(l);
+        network.linkDevices.push_back(
+            InstallLink(link, network.nodes.Get(link.a), network.nodes.Get(link.b)));
+    }
+
+    // Fixed positions; sites without coordinates are laid out on a circle
+    MobilityHelper mobility;
+    mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
+    mobility.Install(network.nodes);
+    for (uint32_t i = 0; i < topology.GetNSites(); ++i)
+    {
+        const WanSite& site = topology.GetSite(i);
+        Vector position(site.x, site.y, 0.0);
+        if (!site.hasPosition)
+        {
+            double angle = 2 * M_PI * i / topology.GetNSites();
+            position = Vector(50.0 + 40.0 * std::cos(angle), 50.0 + 40.0 * std::sin(angle), 0.0);
+        }
+        network.nodes.Get(i)->GetObject<MobilityModel>()->SetPosition(position);
+    }
+
+    InternetStackHelper stack;
+    if (m_routeCache > 0)
+    {
+        stack.SetRoutingHelper(WanRouteCacheHelper(m_routeCache));
+    }
+    stack.Install(network.nodes);
+
+    network.linkInterfaces.reserve(topology.GetNLinks());
+    for (uint32_t l = 0; l < topology.GetNLinks(); ++l)
+    {
+        Ipv4AddressHelper address;
+        address.SetBase(GetLinkNetwork(l), m_mask);
+        network.linkInterfaces.push_back(address.Assign(network.linkDevices[l]));
+    }
+    network.graph = WanGraph(topology);
+    network.graph.SetInterfaces(network.linkInterfaces);
+
+    // Every site is a router
+    for (uint32_t i = 0; i < network.nodes.GetN(); ++i)
+    {
+        network.nodes.Get(i)->GetObject<Ipv4>()->SetAttribute("IpForward", BooleanValue(true));
+    }
+
+    return network;
+}
+
+NetDeviceContainer
+WanTopologyHelper::InstallLink(const WanLink& link, Ptr<Node> a, Ptr<Node> b) const
+{
+    Ptr<WanPointToPointChannel> channel = CreateObject<WanPointToPointChannel>();
+    channel->SetAttribute("Delay", TimeValue(link.delay));
+    if (link.jitter.IsStrictlyPositive())
+    {
+        channel->SetJitter(MakeJitterVariable(link));
+    }
+
+    // Same device setup as PointToPointHelper::Install, plus per-direction loss
+    NetDeviceContainer devices;
+    for (Ptr<Node> node : {a, b})
+    {
+        Ptr<PointToPointNetDevice> device = CreateObject<PointToPointNetDevice>();
+        device->SetAddress(Mac48Address::Allocate());
+        device->SetDataRate(link.bandwidth);
+        node->AddDevice(device);
+
+        Ptr<Queue<Packet>> queue = CreateObject<DropTailQueue<Packet>>();
+        device->SetQueue(queue);
+        Ptr<NetDeviceQueueInterface> queueInterface = CreateObject<NetDeviceQueueInterface>();
+        queueInterface->GetTxQueue(0)->ConnectQueueTraces(queue);
+        device->AggregateObject(queueInterface);
+
+        if (link.loss > 0)
+        {
+            device->SetReceiveErrorModel(MakeLossModel(link));
+        }
+        device->Attach(channel);
+        devices.Add(device);
+    }
+    return devices;
+}
+
+int64_t
+WanTopologyHelper::AssignStreams(const WanNetwork& network, int64_t stream) const
+{
+    for (uint32_t l = 0; l < network.linkDevices.size(); ++l)
+    {
+        const NetDeviceContainer& devices = network.linkDevices[l];
+        const int64_t first = stream + l * STREAMS_PER_LINK;
+        Ptr<WanPointToPointChannel> channel =
+            DynamicCast<WanPointToPointChannel>(devices.Get(0)->GetChannel());
+        if (channel)
+        {
+            channel->AssignStreams(first);
+        }
+        for (uint32_t end = 0; end < devices.GetN(); ++end)
+        {
+            PointerValue model;
+            devices.Get(end)->GetAttribute("ReceiveErrorModel", model);
+            if (Ptr<RateErrorModel> rate = model.Get<RateErrorModel>())
+            {
+                rate->AssignStreams(first + 2 + 2 * end);
+            }
+            else if (Ptr<BurstErrorModel> burst = model.Get<BurstErrorModel>())
+            {
+                burst->AssignStreams(first + 2 + 2 * end);
+            }
+        }
+    }
+    return network.linkDevices.size() * STREAMS_PER_LINK;
+}
+
+WanRouteInstallStats
+WanTopologyHelper::InstallShortestPathRoutes(const WanTopology& topology,
+                                             const WanNetwork& network) const
+{
+    NS_LOG_FUNCTION(this);
+    const WanGraph& graph = network.graph;
+    NS_ABORT_MSG_UNLESS(graph.GetNLinks() == topology.GetNLinks(),
+                        "The network was not built from this topology");
+    const uint32_t nSites = graph.GetNSites();
+    const double infinity = std::numeric_limits<double>::infinity();
+
+    int64_t heap = HeapBytes();
+
+    // Next-hop address of every arc, read here: the workers must not touch
+    // ns-3 objects
+    std::vector<Ipv4Address> gateways(2 * graph.GetNLinks());
+    for (uint32_t arc = 0; arc < gateways.size(); ++arc)
+    {
+        gateways[arc] =
+            network.linkInterfaces[graph.GetLink(arc)].GetAddress(1 - graph.GetLocalEnd(arc));
+    }
+
+    // Per-site FIB build buffers, in link order and so sorted by network.
+    // Each worker fills only the buffers of the sources it computes.
+    std::vector<std::vector<WanFibRouting::Route>> fibs(nSites);
+    WanRouteCompiler compiler(graph);
+    compiler.SetThreads(m_threads);
+    compiler.Run([&](uint32_t source,
+                     const std::vector<double>& distance,
+                     const std::vector<int32_t>& firstArc) {
+        std::vector<WanFibRouting::Route>& fib = fibs[source];
+        for (uint32_t l = 0; l < graph.GetNLinks(); ++l)
+        {
+            uint32_t a = graph.GetLinkEnd(l, 0);
+            uint32_t b = graph.GetLinkEnd(l, 1);
+            int64_t out = -1;
+            if (a == source || b == source)
+            {
+                if (!m_bulkFib)
+                {
+                    continue; // connected route
+                }
+                // Shadowed by the connected route, but it makes the tables
+                // of routers in the same position, such as spokes, equal
+                for (uint32_t arc = graph.Begin(source); arc < graph.End(source); ++arc)
+                {
+                    if (graph.GetLink(arc) == l)
+                    {
+                        out = arc;
+                        break;
+                    }
+                }
+            }
+            else
+            {
+                uint32_t target = distance[a] <= distance[b] ? a : b;
+                if (distance[target] == infinity)
+                {
+                    continue; // different partition
+                }
+                out = firstArc[target];
+            }
+            fib.push_back({GetLinkNetwork(l), m_mask, gateways[out], graph.GetInterface(out)});
+        }
+    });
+
+    // Install on this thread: ns-3 objects are not thread-safe
+    WanRouteInstallStats stats;
+    stats.paths = compiler.GetStats();
+    stats.bulk = m_bulkFib;
+    auto start = std::chrono::steady_clock::now();
+    Ipv4StaticRoutingHelper staticRoutingHelper;
+    for (uint32_t source = 0; source < nSites; ++source)
+    {
+        Ptr<Ipv4> ipv4 = network.nodes.Get(source)->GetObject<Ipv4>();
+        if (m_bulkFib)
+        {
+            Ptr<Ipv4ListRouting> list = DynamicCast<Ipv4ListRouting>(ipv4->GetRoutingProtocol());
+            NS_ABORT_MSG_UNLESS(list, "A bulk FIB needs list routing on " << source);
+            Ptr<WanFibRouting> fib = CreateObject<WanFibRouting>();
+            list->AddRoutingProtocol(fib, WanFibRouting::PRIORITY);
+            fib->Load(fibs[source]);
+        }
+        else
+        {
+            Ptr<Ipv4StaticRouting> routing = staticRoutingHelper.GetStaticRouting(ipv4);
+            for (const WanFibRouting::Route& route : fibs[source])
+            {
+                routing->AddNetworkRouteTo(route.network,
+                                           route.mask,
+                                           route.gateway,
+                                           route.interface);
+            }
+        }
+        stats.routes += fibs[source].size();
+        // Release each buffer once installed
+        std::vector<WanFibRouting::Route>().swap(fibs[source]);
+    }
+    stats.seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (m_bulkFib)
+    {
+        stats.tables = WanFibRouting::GetNTables();
+    }
+    if (heap >= 0)
+    {
+        // The build buffers are freed by now: what is left is the FIBs
+        gateways.clear();
+        gateways.shrink_to_fit();
+        stats.heapBytes = HeapBytes() - heap;
+    }
+    NS_LOG_INFO("Installed " << stats.routes << " shortest-path routes on " << nSites
+                             << " sites");
+    return stats;
+}
+
+} // namespace ns3
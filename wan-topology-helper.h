@@ -0,0 +1,150 @@
+/*
+ * Build an ns-3 network from a WanTopology
+ *
+ * One node per site and one point-to-point link per circuit, with the
+ * circuit's bandwidth, delay, loss and jitter (see wan-link-profile.h).
+ * Link i gets its own /30 out of the address plan, by default
+ * 10.1.(i+1).0/30, which reproduces the addressing of the original
+ * triangle exactly.
+ */
+
+#ifndef WAN_TOPOLOGY_HELPER_H
+#define WAN_TOPOLOGY_HELPER_H
+
+#include "wan-fib-routing.h"
+#include "wan-graph.h"
+#include "wan-route-compiler.h"
+#include "wan-topology.h"
+
+#include "ns3/ipv4-address.h"
+#include "ns3/ipv4-interface-container.h"
+#include "ns3/net-device-container.h"
+#include "ns3/node-container.h"
+
+#include <ostream>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * The ns-3 objects created for a WanTopology. Indices match the topology:
+ * nodes.Get(i) is site i, linkDevices[l] and linkInterfaces[l] belong to
+ * link l with the a end first. graph is the flat adjacency of the same
+ * sites and links, with the interface index of every link end.
+ */
+struct WanNetwork
+{
+    NodeContainer nodes;                                //!< One node per site
+    std::vector<NetDeviceContainer> linkDevices;        //!< Devices per link (a, b)
+    std::vector<Ipv4InterfaceContainer> linkInterfaces; //!< Addresses per link (a, b)
+    WanGraph graph;                                     //!< Adjacency for graph algorithms
+};
+
+/**
+ * What WanTopologyHelper::InstallShortestPathRoutes did.
+ */
+struct WanRouteInstallStats
+{
+    WanRouteCompiler::Stats paths; //!< Shortest-path computation
+    bool bulk{true};               //!< Routes went to a WanFibRouting per node
+    uint64_t routes{0};            //!< Routes installed
+    double seconds{0};             //!< Wall-clock time of the installation
+    int64_t heapBytes{-1};         //!< Heap growth through both; -1 if unknown
+    uint32_t tables{0};            //!< Distinct FIB tables after a bulk installation
+
+    /// Print the path computation and the installation, one line each
+    void Print(std::ostream& os) const;
+};
+
+/**
+ * Creates nodes, links, mobility, the Internet stack and addresses for a
+ * WanTopology, and optionally shortest-path static routes.
+ */
+class WanTopologyHelper
+{
+  public:
+    WanTopologyHelper();
+
+    /**
+     * Set the address plan.
+     * \param base network address of link 0
+     * \param mask mask of every link subnet
+     * \param step distance between consecutive link subnets, in addresses
+     */
+    void SetAddressPlan(Ipv4Address base, Ipv4Mask mask, uint32_t step);
+
+    /**
+     * Build the network. All nodes get IP forwarding enabled, as every
+     * site is a router.
+     */
+    WanNetwork Install(const WanTopology& topology) const;
+
+    /**
+     * \param threads workers of the route computation; 0 for one per core
+     *        (default), 1 to compute serially
+     */
+    void SetRouteThreads(uint32_t threads);
+
+    /**
+     * \param bulk load each node's routes into a WanFibRouting in one call
+     *        (default); false adds them to Ipv4StaticRouting one by one
+     */
+    void SetBulkFib(bool bulk);
+
+    /**
+     * \param slots per-destination route cache of every node installed
+     *        afterwards (see wan-route-cache.h); 0 for none (default)
+     */
+    void SetRouteCache(uint32_t slots);
+
+    /**
+     * Install static routes to every link subnet along least-cost paths
+     * (link cost from the topology, ties broken deterministically by link
+     * order). Directly connected subnets are left to the connected routes;
+     * a bulk FIB lists them too, shadowed, so that routers in the same
+     * position get equal, shared tables. The paths are computed in parallel
+     * (see wan-route-compiler.h), the routes installed afterwards (see
+     * wan-fib-routing.h).
+     * \return the time and memory the computation and installation took
+     */
+    WanRouteInstallStats InstallShortestPathRoutes(const WanTopology& topology,
+                                                   const WanNetwork& network) const;
+
+    /**
+     * Assign fixed random variable streams to the jitter, gray failures and
+     * loss of every circuit. Each link gets its own block of streams, so a
+     * circuit's draws do not depend on the other circuits or their options.
+     * \param network the network built by Install()
+     * \param stream first stream index to use
+     * \return the number of stream indices assigned
+     */
+    int64_t AssignStreams(const WanNetwork& network, int64_t stream) const;
+
+    /**
+     * \return the subnet address of link l
+     */
+    Ipv4Address GetLinkNetwork(uint32_t l) const;
+
+    /**
+     * \return the mask of every link subnet
+     */
+    Ipv4Mask GetLinkMask() const;
+
+  private:
+    /**
+     * Create the two devices and the channel of one circuit.
+     */
+    NetDeviceContainer InstallLink(const WanLink& link, Ptr<Node> a, Ptr<Node> b) const;
+
+    Ipv4Address m_base;    //!< Network address of link 0
+    Ipv4Mask m_mask;       //!< Link subnet mask
+    uint32_t m_step;       //!< Address distance between link subnets
+    uint32_t m_threads;    //!< Route computation workers, 0: one per core
+    bool m_bulkFib;        //!< Routes go to a WanFibRouting
+    uint32_t m_routeCache; //!< Route cache slots per node, 0: none
+};
+
+} // namespace ns3
+
+#endif /* WAN_TOPOLOGY_HELPER_H */
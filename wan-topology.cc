@@ -0,0 +1,1090 @@
+/*
+ * WAN topology description and file loaders
+ */
+
+#include "wan-topology.h"
+
+#include "wan-csv-reader.h"
+
+#include "ns3/abort.h"
+#include "ns3/log.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <initializer_list>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("WanTopology");
+
+uint32_t
+WanTopology::AddSite(const std::string& name, const std::string& role)
+{
+    auto it = m_siteIndex.find(name);
+    if (it != m_siteIndex.end())
+    {
+        if (!role.empty())
+        {
+            m_sites[it->second].role = role;
+        }
+        return it->second;
+    }
+    uint32_t index = m_sites.size();
+    WanSite site;
+    site.name = name;
+    site.role = role;
+    m_sites.push_back(site);
+    m_siteIndex.emplace(name, index);
+    return index;
+}
+
+int64_t
+WanTopology::FindSite(const std::string& name) const
+{
+    auto it = m_siteIndex.find(name);
+    return it == m_siteIndex.end() ? -1 : static_cast<int64_t>(it->second);
+}
+
+bool
+WanTopology::FindLinks(const std::string& pair, std::vector<uint32_t>& links) const
+{
+    links.clear();
+    int64_t a = -1;
+    int64_t b = -1;
+    for (size_t dash = pair.find('-'); dash != std::string::npos && (a < 0 || b < 0);
+         dash = pair.find('-', dash + 1))
+    {
+        a = FindSite(pair.substr(0, dash));
+        b = FindSite(pair.substr(dash + 1));
+    }
+    if (a < 0 || b < 0)
+    {
+        return false;
+    }
+    for (uint32_t l = 0; l < m_links.size(); ++l)
+    {
+        const WanLink& link = m_links[l];
+        if ((link.a == a && link.b == b) || (link.a == b && link.b == a))
+        {
+            links.push_back(l);
+        }
+    }
+    return true;
+}
+
+uint32_t
+WanTopology::AddLink(uint32_t a, uint32_t b, DataRate bandwidth, Time delay, double cost)
+{
+    NS_ABORT_MSG_IF(a >= m_sites.size() || b >= m_sites.size(), "Link end point out of range");
+    NS_ABORT_MSG_IF(a == b, "Self-loop on site " << m_sites[a].name);
+    WanLink link;
+    link.a = a;
+    link.b = b;
+    link.bandwidth = bandwidth;
+    link.delay = delay;
+    link.cost = cost;
+    m_links.push_back(link);
+    return m_links.size() - 1;
+}
+
+uint32_t
+WanTopology::GetNSites() const
+{
+    return m_sites.size();
+}
+
+uint32_t
+WanTopology::GetNLinks() const
+{
+    return m_links.size();
+}
+
+const WanSite&
+WanTopology::GetSite(uint32_t i) const
+{
+    return m_sites.at(i);
+}
+
+WanSite&
+WanTopology::GetSite(uint32_t i)
+{
+    return m_sites.at(i);
+}
+
+const WanLink&
+WanTopology::GetLink(uint32_t i) const
+{
+    return m_links.at(i);
+}
+
+WanLink&
+WanTopology::GetLink(uint32_t i)
+{
+    return m_links.at(i);
+}
+
+void
+WanTopology::Reserve(uint32_t nSites, uint32_t nLinks)
+{
+    m_sites.reserve(nSites);
+    m_links.reserve(nLinks);
+    m_siteIndex.reserve(nSites);
+}
+
+WanTopology
+MakeTriangleTopology()
+{
+    WanTopology topology;
+    uint32_t hq = topology.AddSite("HQ", "hq");
+    uint32_t branch = topology.AddSite("Branch", "branch");
+    uint32_t dc = topology.AddSite("DC", "dc");
+
+    // Triangle layout: HQ at top, Branch bottom-left, DC bottom-right
+    const double positions[3][2] = {{10.0, 2.0}, {5.0, 15.0}, {15.0, 15.0}};
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        topology.GetSite(i).x = positions[i][0];
+        topology.GetSite(i).y = positions[i][1];
+        topology.GetSite(i).hasPosition = true;
+    }
+
+    // Link order fixes the 10.1.<link+1>.0/30 subnets and interface indices
+    topology.AddLink(hq, branch, DataRate("5Mbps"), MilliSeconds(2), 1.0); // Network 1
+    topology.AddLink(branch, dc, DataRate("5Mbps"), MilliSeconds(2), 1.0); // Network 2
+    topology.AddLink(hq, dc, DataRate("5Mbps"), MilliSeconds(2), 1.0);     // Network 3
+    return topology;
+}
+
+WanTopology
+MakeGridTopology(uint32_t rows, uint32_t columns)
+{
+    NS_ABORT_MSG_IF(rows == 0 || columns == 0, "A grid needs at least one row and column");
+    WanTopology topology;
+    topology.Reserve(rows * columns, 2 * rows * columns);
+    for (uint32_t r = 0; r < rows; ++r)
+    {
+        for (uint32_t c = 0; c < columns; ++c)
+        {
+            uint32_t site =
+                topology.AddSite("R" + std::to_string(r) + "C" + std::to_string(c), "branch");
+            topology.GetSite(site).x = 10.0 * c;
+            topology.GetSite(site).y = 10.0 * r;
+            topology.GetSite(site).hasPosition = true;
+        }
+    }
+    for (uint32_t r = 0; r < rows; ++r)
+    {
+        for (uint32_t c = 0; c < columns; ++c)
+        {
+            uint32_t site = r * columns + c;
+            if (c + 1 < columns)
+            {
+                topology.AddLink(site, site + 1, DataRate("10Mbps"), MilliSeconds(1), 1.0);
+            }
+            if (r + 1 < rows)
+            {
+                topology.AddLink(site, site + columns, DataRate("10Mbps"), MilliSeconds(1), 1.0);
+            }
+        }
+    }
+    return topology;
+}
+
+namespace
+{
+
+/// Circuit parameters used when the input does not specify them
+const char* const DEFAULT_BANDWIDTH = "5Mbps";
+const int64_t DEFAULT_DELAY_MS = 2;
+
+/// Propagation speed in fibre, used to derive delay from geography
+const double FIBRE_METERS_PER_SECOND = 2.0e8;
+
+DataRate
+ParseBandwidth(const std::string& s)
+{
+    return s.empty() ? DataRate(DEFAULT_BANDWIDTH) : WanCsvReader::ParseDataRate(s);
+}
+
+Time
+ParseDelay(const std::string& s)
+{
+    return s.empty() ? MilliSeconds(DEFAULT_DELAY_MS) : WanCsvReader::ParseTime(s);
+}
+
+double
+ParseCost(const std::string& s)
+{
+    if (s.empty())
+    {
+        return 1.0;
+    }
+    double cost;
+    NS_ABORT_MSG_UNLESS(WanCsvReader::ParseNumber(s, cost) && cost > 0, "Invalid link cost " << s);
+    return cost;
+}
+
+/// Great-circle distance between two (longitude, latitude) points, in meters
+double
+GeoDistance(double lon1, double lat1, double lon2, double lat2)
+{
+    const double radius = 6371.0e3;
+    const double rad = M_PI / 180.0;
+    double dLat = (lat2 - lat1) * rad;
+    double dLon = (lon2 - lon1) * rad;
+    double h = std::sin(dLat / 2) * std::sin(dLat / 2) +
+               std::cos(lat1 * rad) * std::cos(lat2 * rad) * std::sin(dLon / 2) *
+                   std::sin(dLon / 2);
+    return 2 * radius * std::asin(std::min(1.0, std::sqrt(h)));
+}
+
+/**
+ * Buffered character source shared by the XML and JSON readers.
+ */
+class CharReader
+{
+  public:
+    explicit CharReader(std::istream& in)
+        : m_in(in)
+    {
+    }
+
+    /// \return false at end of input
+    bool Get(char& c)
+    {
+        if (m_pos == m_len && !Fill())
+        {
+            return false;
+        }
+        c = m_buffer[m_pos++];
+        return true;
+    }
+
+    /// \return false at end of input
+    bool Peek(char& c)
+    {
+        if (m_pos == m_len && !Fill())
+        {
+            return false;
+        }
+        c = m_buffer[m_pos];
+        return true;
+    }
+
+  private:
+    bool Fill()
+    {
+        m_in.read(m_buffer, sizeof(m_buffer));
+        m_len = m_in.gcount();
+        m_pos = 0;
+        return m_len > 0;
+    }
+
+    std::istream& m_in;
+    char m_buffer[64 * 1024];
+    size_t m_pos{0};
+    size_t m_len{0};
+};
+
+/**
+ * Minimal pull parser for the XML subset used by GraphML. It reports
+ * element starts (with attributes), element ends and text content.
+ * Self-closing elements are reported as a start followed by an end.
+ */
+class XmlPullReader
+{
+  public:
+    enum Event
+    {
+        START,
+        END,
+        TEXT,
+        DONE
+    };
+
+    explicit XmlPullReader(std::istream& in)
+        : m_reader(in)
+    {
+    }
+
+    Event Next()
+    {
+        if (m_pendingEnd)
+        {
+            m_pendingEnd = false;
+            return END;
+        }
+        while (true)
+        {
+            char c;
+            if (!m_reader.Peek(c))
+            {
+                return DONE;
+            }
+            if (c != '<')
+            {
+                ReadText();
+                if (!WanCsvReader::Trim(m_text).empty())
+                {
+                    return TEXT;
+                }
+                continue;
+            }
+            m_reader.Get(c);
+            if (!m_reader.Get(c))
+            {
+                return DONE;
+            }
+            if (c == '?')
+            {
+                SkipPast("?>");
+            }
+            else if (c == '!')
+            {
+                if (ReadMarkup())
+                {
+                    return TEXT;
+                }
+            }
+            else if (c == '/')
+            {
+                ReadName(0);
+                SkipPast(">");
+                return END;
+            }
+            else
+            {
+                ReadName(c);
+                ReadAttributes();
+                return START;
+            }
+        }
+    }
+
+    /// \return the local name (namespace prefix stripped) of the current element
+    const std::string& GetName() const
+    {
+        return m_name;
+    }
+
+    /// \return the text of the last TEXT event
+    const std::string& GetText() const
+    {
+        return m_text;
+    }
+
+    /// \return the attribute value, or an empty string
+    std::string GetAttribute(const std::string& name) const
+    {
+        for (const auto& attribute : m_attributes)
+        {
+            if (attribute.first == name)
+            {
+                return attribute.second;
+            }
+        }
+        return "";
+    }
+
+  private:
+    void SkipPast(const std::string& terminator)
+    {
+        size_t matched = 0;
+        char c;
+        while (matched < terminator.size() && m_reader.Get(c))
+        {
+            matched = (c == terminator[matched]) ? matched + 1 : (c == terminator[0] ? 1 : 0);
+        }
+    }
+
+    /// Handle "<!...": comments and DOCTYPE are skipped, CDATA becomes text
+    bool ReadMarkup()
+    {
+        char c;
+        m_reader.Peek(c);
+        if (c == '-')
+        {
+            SkipPast("-->");
+            return false;
+        }
+        if (c == '[')
+        {
+            SkipPast("CDATA[");
+            m_text.clear();
+            size_t matched = 0;
+            while (matched < 3 && m_reader.Get(c))
+            {
+                m_text.push_back(c);
+                matched = (c == "]]>"[matched]) ? matched + 1 : (c == ']' ? 1 : 0);
+            }
+            m_text.resize(m_text.size() - matched);
+            return true;
+        }
+        SkipPast(">");
+        return false;
+    }
+
+    void ReadName(char first)
+    {
+        m_name.clear();
+        if (first != 0)
+        {
+            m_name.push_back(first);
+        }
+        char c;
+        while (m_reader.Peek(c) && !std::isspace(static_cast<unsigned char>(c)) && c != '>' &&
+               c != '/')
+        {
+            m_name.push_back(c);
+            m_reader.Get(c);
+        }
+        size_t colon = m_name.find(':');
+        if (colon != std::string::npos)
+        {
+            m_name.erase(0, colon + 1);
+        }
+    }
+
+    void ReadAttributes()
+    {
+        m_attributes.clear();
+        char c;
+        while (m_reader.Get(c))
+        {
+            if (c == '>')
+            {
+                return;
+            }
+            if (c == '/')
+            {
+                SkipPast(">");
+                m_pendingEnd = true;
+                return;
+            }
+            if (std::isspace(static_cast<unsigned char>(c)))
+            {
+                continue;
+            }
+            std::string key(1, c);
+            while (m_reader.Get(c) && c != '=')
+            {
+                if (!std::isspace(static_cast<unsigned char>(c)))
+                {
+                    key.push_back(c);
+                }
+            }
+            char quote = 0;
+            while (m_reader.Get(quote) && quote != '"' && quote != '\'')
+            {
+            }
+            std::string value;
+            while (m_reader.Get(c) && c != quote)
+            {
+                value.push_back(c);
+            }
+            m_attributes.emplace_back(key, Unescape(value));
+        }
+    }
+
+    void ReadText()
+    {
+        m_text.clear();
+        char c;
+        while (m_reader.Peek(c) && c != '<')
+        {
+            m_text.push_back(c);
+            m_reader.Get(c);
+        }
+        m_text = Unescape(m_text);
+    }
+
+    static std::string Unescape(const std::string& s)
+    {
+        if (s.find('&') == std::string::npos)
+        {
+            return s;
+        }
+        static const std::pair<const char*, char> entities[] = {{"&amp;", '&'},
+                                                                 {"&lt;", '<'},
+                                                                 {"&gt;", '>'},
+                                                                 {"&quot;", '"'},
+                                                                 {"&apos;", '\''}};
+        std::string out;
+        out.reserve(s.size());
+        for (size_t i = 0; i < s.size(); ++i)
+        {
+            bool replaced = false;
+            if (s[i] == '&')
+            {
+                for (const auto& entity : entities)
+                {
+                    if (s.compare(i, std::strlen(entity.first), entity.first) == 0)
+                    {
+                        out.push_back(entity.second);
+                        i += std::strlen(entity.first) - 1;
+                        replaced = true;
+                        break;
+                    }
+                }
+            }
+            if (!replaced)
+            {
+                out.push_back(s[i]);
+            }
+        }
+        return out;
+    }
+
+    CharReader m_reader;
+    std::string m_name;
+    std::string m_text;
+    std::vector<std::pair<std::string, std::string>> m_attributes;
+    bool m_pendingEnd{false};
+};
+
+/**
+ * Flat key/value view of one element (GraphML node/edge, JSON object).
+ * Keys are lower case.
+ */
+using Record = std::vector<std::pair<std::string, std::string>>;
+
+/// \return the value of the first key in the list that is present, or ""
+std::string
+Lookup(const Record& record, std::initializer_list<const char*> keys)
+{
+    for (const char* key : keys)
+    {
+        for (const auto& field : record)
+        {
+            if (field.first == key)
+            {
+                return field.second;
+            }
+        }
+    }
+    return "";
+}
+
+/**
+ * Add the sites of a record. Positions only count when both coordinates
+ * are present.
+ */
+void
+ApplySiteRecord(WanTopology& topology, uint32_t site, const Record& record)
+{
+    std::string role = Lookup(record, {"role", "site_role", "siterole"});
+    if (!role.empty())
+    {
+        topology.GetSite(site).role = role;
+    }
+    double x;
+    double y;
+    if (WanCsvReader::ParseNumber(Lookup(record, {"x", "longitude", "lon"}), x) &&
+        WanCsvReader::ParseNumber(Lookup(record, {"y", "latitude", "lat"}), y))
+    {
+        topology.GetSite(site).x = x;
+        topology.GetSite(site).y = y;
+        topology.GetSite(site).hasPosition = true;
+    }
+}
+
+/**
+ * Derive propagation delay from geography for links whose input gave none.
+ */
+void
+FillGeoDelays(WanTopology& topology, const std::vector<uint32_t>& linksWithoutDelay)
+{
+    for (uint32_t l : linksWithoutDelay)
+    {
+        WanLink& link = topology.GetLink(l);
+        const WanSite& a = topology.GetSite(link.a);
+        const WanSite& b = topology.GetSite(link.b);
+        if (a.hasPosition && b.hasPosition)
+        {
+            double meters = GeoDistance(a.x, a.y, b.x, b.y);
+            link.delay = Seconds(meters / FIBRE_METERS_PER_SECOND);
+        }
+    }
+}
+
+/**
+ * Pull tokenizer for JSON. Objects that are elements of a top-level array
+ * are returned as flat records; nested containers inside them are skipped.
+ */
+class JsonPullReader
+{
+  public:
+    explicit JsonPullReader(std::istream& in)
+        : m_reader(in)
+    {
+    }
+
+    /// \return the next structural character or '"' for a string, 'v' for a scalar, 0 at end
+    char NextToken()
+    {
+        char c;
+        while (m_reader.Get(c))
+        {
+            if (std::isspace(static_cast<unsigned char>(c)) || c == ',' || c == ':')
+            {
+                continue;
+            }
+            if (c == '"')
+            {
+                ReadString();
+                return '"';
+            }
+            if (c == '{' || c == '}' || c == '[' || c == ']')
+            {
+                return c;
+            }
+            ReadScalar(c);
+            return 'v';
+        }
+        return 0;
+    }
+
+    /// \return the value of the last string or scalar token
+    const std::string& GetValue() const
+    {
+        return m_value;
+    }
+
+    /// Skip the rest of a container whose opening token was just read
+    void SkipContainer()
+    {
+        int depth = 1;
+        while (depth > 0)
+        {
+            char token = NextToken();
+            NS_ABORT_MSG_IF(token == 0, "Unexpected end of JSON input");
+            if (token == '{' || token == '[')
+            {
+                ++depth;
+            }
+            else if (token == '}' || token == ']')
+            {
+                --depth;
+            }
+        }
+    }
+
+    /// Read an object whose '{' was just consumed into a flat record
+    void ReadRecord(Record& record)
+    {
+        record.clear();
+        while (true)
+        {
+            char token = NextToken();
+            if (token == '}')
+            {
+                return;
+            }
+            NS_ABORT_MSG_IF(token != '"', "Expected a key in JSON object");
+            std::string key = WanCsvReader::ToLower(m_value);
+            token = NextToken();
+            if (token == '{' || token == '[')
+            {
+                SkipContainer();
+            }
+            else
+            {
+                NS_ABORT_MSG_IF(token == 0 || token == '}' || token == ']',
+                                "Missing value for JSON key " << key);
+                record.emplace_back(key, m_value);
+            }
+        }
+    }
+
+  private:
+    void ReadString()
+    {
+        m_value.clear();
+        char c;
+        while (m_reader.Get(c) && c != '"')
+        {
+            if (c == '\\' && m_reader.Get(c))
+            {
+                switch (c)
+                {
+                case 'n':
+                    c = '\n';
+                    break;
+                case 't':
+                    c = '\t';
+                    break;
+                case 'u':
+                    // Non-ASCII escapes are not expected in names; keep a placeholder
+                    for (int i = 0; i < 4; ++i)
+                    {
+                        m_reader.Get(c);
+                    }
+                    c = '?';
+                    break;
+                default:
+                    break;
+                }
+            }
+            m_value.push_back(c);
+        }
+    }
+
+    void ReadScalar(char first)
+    {
+        m_value.assign(1, first);
+        char c;
+        while (m_reader.Peek(c) && !std::isspace(static_cast<unsigned char>(c)) && c != ',' &&
+               c != '}' && c != ']')
+        {
+            m_value.push_back(c);
+            m_reader.Get(c);
+        }
+        if (m_value == "null")
+        {
+            m_value.clear();
+        }
+    }
+
+    CharReader m_reader;
+    std::string m_value;
+};
+
+} // namespace
+
+WanTopology
+LoadGraphMlTopology(std::istream& in)
+{
+    NS_LOG_FUNCTION_NOARGS();
+    WanTopology topology;
+    XmlPullReader reader(in);
+
+    struct Key
+    {
+        std::string name;
+        std::string defaultValue;
+    };
+
+    std::unordered_map<std::string, Key> keys;        // GraphML key id -> attribute
+    std::unordered_map<std::string, uint32_t> nodeIds; // GraphML node id -> site
+    std::vector<uint32_t> linksWithoutDelay;
+
+    enum
+    {
+        NONE,
+        KEY,
+        NODE,
+        EDGE
+    } element = NONE;
+
+    std::string currentKey;   // key id of the enclosing <key>
+    std::string currentData;  // attribute name of the enclosing <data>
+    bool inDefault = false;
+    std::string nodeId;
+    std::string edgeSource;
+    std::string edgeTarget;
+    Record record;
+
+    auto siteFor = [&](const std::string& id) {
+        auto it = nodeIds.find(id);
+        if (it != nodeIds.end())
+        {
+            return it->second;
+        }
+        // AddSite() would merge this node into the one labelled with its id
+        NS_ABORT_MSG_IF(topology.FindSite(id) >= 0,
+                        "GraphML: node id '" << id << "' is the label of another node");
+        uint32_t site = topology.AddSite(id);
+        nodeIds.emplace(id, site);
+        return site;
+    };
+
+    // Data values not present on an element fall back to the key default of
+    // its domain, then to that of a for="all" key
+    auto withDefaults = [&](Record& r, const char* domain) {
+        for (const char* prefix : {domain, "all:"})
+        {
+            for (const auto& key : keys)
+            {
+                if (!key.second.defaultValue.empty() && key.first.rfind(prefix, 0) == 0)
+                {
+                    bool present = false;
+                    for (const auto& field : r)
+                    {
+                        present = present || field.first == key.second.name;
+                    }
+                    if (!present)
+                    {
+                        r.emplace_back(key.second.name, key.second.defaultValue);
+                    }
+                }
+            }
+        }
+    };
+
+    XmlPullReader::Event event;
+    while ((event = reader.Next()) != XmlPullReader::DONE)
+    {
+        const std::string& name = reader.GetName();
+        if (event == XmlPullReader::START)
+        {
+            if (name == "key")
+            {
+                element = KEY;
+                // Key ids are only unique per domain in some exports; qualify them
+                currentKey = reader.GetAttribute("for") + ":" + reader.GetAttribute("id");
+                keys[currentKey].name = WanCsvReader::ToLower(reader.GetAttribute("attr.name"));
+            }
+            else if (name == "default" && element == KEY)
+            {
+                inDefault = true;
+            }
+            else if (name == "node")
+            {
+                element = NODE;
+                nodeId = reader.GetAttribute("id");
+                record.clear();
+            }
+            else if (name == "edge")
+            {
+                element = EDGE;
+                edgeSource = reader.GetAttribute("source");
+                edgeTarget = reader.GetAttribute("target");
+                record.clear();
+            }
+            else if (name == "data" && (element == NODE || element == EDGE))
+            {
+                std::string id = reader.GetAttribute("key");
+                auto it = keys.find((element == NODE ? "node:" : "edge:") + id);
+                if (it == keys.end())
+                {
+                    it = keys.find("all:" + id);
+                }
+                currentData = it != keys.end() ? it->second.name : WanCsvReader::ToLower(id);
+                // Empty <data/> elements still count as present
+                record.emplace_back(currentData, "");
+            }
+        }
+        else if (event == XmlPullReader::TEXT)
+        {
+            if (inDefault)
+            {
+                keys[currentKey].defaultValue = WanCsvReader::Trim(reader.GetText());
+            }
+            else if (!currentData.empty() && !record.empty())
+            {
+                record.back().second = WanCsvReader::Trim(reader.GetText());
+            }
+        }
+        else if (event == XmlPullReader::END)
+        {
+            if (name == "default")
+            {
+                inDefault = false;
+            }
+            else if (name == "data")
+            {
+                currentData.clear();
+            }
+            else if (name == "key")
+            {
+                element = NONE;
+            }
+            else if (name == "node" && element == NODE)
+            {
+                withDefaults(record, "node:");
+                // Sites are named by label when it is unique; edges refer to the GraphML id
+                uint32_t site;
+                auto it = nodeIds.find(nodeId);
+                if (it != nodeIds.end())
+                {
+                    site = it->second; // placeholder created by an earlier edge
+                }
+                else
+                {
+                    std::string label = Lookup(record, {"label", "name"});
+                    std::string siteName =
+                        (!label.empty() && topology.FindSite(label) < 0) ? label : nodeId;
+                    NS_ABORT_MSG_IF(topology.FindSite(siteName) >= 0,
+                                    "GraphML: node '" << nodeId << "' is named '" << siteName
+                                                      << "' like another node");
+                    site = topology.AddSite(siteName);
+                    nodeIds.emplace(nodeId, site);
+                }
+                ApplySiteRecord(topology, site, record);
+                element = NONE;
+            }
+            else if (name == "edge" && element == EDGE)
+            {
+                withDefaults(record, "edge:");
+                std::string delay = Lookup(record, {"delay", "latency"});
+                uint32_t link =
+                    topology.AddLink(siteFor(edgeSource),
+                                     siteFor(edgeTarget),
+                                     ParseBandwidth(Lookup(
+                                         record,
+                                         {"bandwidth", "capacity", "linkspeedraw", "speed"})),
+                                     delay.empty() ? MilliSeconds(DEFAULT_DELAY_MS)
+                                                   : ParseDelay(delay),
+                                     ParseCost(Lookup(record, {"cost", "weight", "metric"})));
+                topology.GetLink(link).profile = Lookup(record, {"profile"});
+                if (delay.empty())
+                {
+                    linksWithoutDelay.push_back(link);
+                }
+                element = NONE;
+            }
+        }
+    }
+
+    FillGeoDelays(topology, linksWithoutDelay);
+    NS_LOG_INFO("GraphML: " << topology.GetNSites() << " sites, " << topology.GetNLinks()
+                            << " links");
+    return topology;
+}
+
+WanTopology
+LoadCsvTopology(std::istream& in)
+{
+    NS_LOG_FUNCTION_NOARGS();
+    WanTopology topology;
+    WanCsvReader reader(in, "CSV topology");
+    if (!reader.ReadHeader())
+    {
+        return topology;
+    }
+
+    int source = reader.RequireColumn({"source", "src", "a"});
+    int target = reader.RequireColumn({"target", "dst", "b", "z"});
+    int bandwidth = reader.FindColumn({"bandwidth", "capacity", "rate"});
+    int delay = reader.FindColumn({"delay", "latency"});
+    int cost = reader.FindColumn({"cost", "weight", "metric"});
+    int sourceRole = reader.FindColumn({"source_role", "src_role"});
+    int targetRole = reader.FindColumn({"target_role", "dst_role"});
+    int profile = reader.FindColumn({"profile", "circuit_type"});
+
+    while (reader.Next())
+    {
+        NS_ABORT_MSG_IF(reader.Get(source).empty() || reader.Get(target).empty(),
+                        "CSV topology line " << reader.GetLineNumber() << ": missing end point");
+        uint32_t a = topology.AddSite(reader.Get(source), reader.Get(sourceRole));
+        uint32_t b = topology.AddSite(reader.Get(target), reader.Get(targetRole));
+        uint32_t link = topology.AddLink(a,
+                                         b,
+                                         ParseBandwidth(reader.Get(bandwidth)),
+                                         ParseDelay(reader.Get(delay)),
+                                         ParseCost(reader.Get(cost)));
+        topology.GetLink(link).profile = reader.Get(profile);
+    }
+
+    NS_LOG_INFO("CSV: " << topology.GetNSites() << " sites, " << topology.GetNLinks()
+                        << " links");
+    return topology;
+}
+
+WanTopology
+LoadJsonTopology(std::istream& in)
+{
+    NS_LOG_FUNCTION_NOARGS();
+    WanTopology topology;
+    JsonPullReader reader(in);
+    Record record;
+
+    NS_ABORT_MSG_IF(reader.NextToken() != '{', "CMDB export must be a JSON object");
+    while (true)
+    {
+        char token = reader.NextToken();
+        if (token == '}' || token == 0)
+        {
+            break;
+        }
+        NS_ABORT_MSG_IF(token != '"', "Expected a key in the CMDB export");
+        std::string section = WanCsvReader::ToLower(reader.GetValue());
+        bool sites = section == "sites" || section == "nodes" || section == "devices";
+        bool links = section == "circuits" || section == "links" || section == "edges";
+
+        token = reader.NextToken();
+        if (token == '{')
+        {
+            reader.SkipContainer();
+            continue;
+        }
+        if (token != '[')
+        {
+            continue; // scalar metadata such as "exported_at"
+        }
+        if (!sites && !links)
+        {
+            reader.SkipContainer();
+            continue;
+        }
+
+        while ((token = reader.NextToken()) != ']')
+        {
+            NS_ABORT_MSG_IF(token != '{', "CMDB section " << section << " must hold objects");
+            reader.ReadRecord(record);
+            if (sites)
+            {
+                std::string name = Lookup(record, {"name", "hostname", "id", "site"});
+                NS_ABORT_MSG_IF(name.empty(), "CMDB site without a name");
+                uint32_t site = topology.AddSite(name);
+                ApplySiteRecord(topology, site, record);
+                continue;
+            }
+
+            std::string a = Lookup(record, {"a", "a_end", "source", "from"});
+            std::string b = Lookup(record, {"z", "z_end", "b", "target", "to"});
+            NS_ABORT_MSG_IF(a.empty() || b.empty(), "CMDB circuit without both end points");
+            std::string delay = Lookup(record, {"delay", "latency"});
+            std::string delayMs = Lookup(record, {"delay_ms", "latency_ms"});
+            Time linkDelay = !delay.empty()     ? ParseDelay(delay)
+                             : !delayMs.empty() ? ParseDelay(delayMs)
+                                                : MilliSeconds(DEFAULT_DELAY_MS);
+            uint32_t link = topology.AddLink(
+                topology.AddSite(a),
+                topology.AddSite(b),
+                ParseBandwidth(Lookup(record, {"bandwidth", "bandwidth_bps", "capacity", "speed"})),
+                linkDelay,
+                ParseCost(Lookup(record, {"cost", "metric", "weight"})));
+            topology.GetLink(link).profile = Lookup(record, {"profile", "circuit_type", "type"});
+        }
+    }
+
+    NS_LOG_INFO("JSON: " << topology.GetNSites() << " sites, " << topology.GetNLinks()
+                         << " links");
+    return topology;
+}
+
+WanTopology
+LoadTopology(const std::string& path, const std::string& format)
+{
+    std::ifstream in(path, std::ios::binary);
+    NS_ABORT_MSG_UNLESS(in.is_open(), "Cannot open topology file " << path);
+
+    std::string kind = WanCsvReader::ToLower(format);
+    if (kind == "auto")
+    {
+        std::string extension = WanCsvReader::ToLower(path.substr(path.find_last_of('.') + 1));
+        kind = (extension == "xml") ? "graphml" : extension;
+    }
+
+    if (kind == "graphml")
+    {
+        return LoadGraphMlTopology(in);
+    }
+    if (kind == "csv")
+    {
+        return LoadCsvTopology(in);
+    }
+    if (kind == "json")
+    {
+        return LoadJsonTopology(in);
+    }
+    NS_FATAL_ERROR("Unknown topology format '" << format << "' for " << path);
+}
+
+} // namespace ns3
@@ -0,0 +1,172 @@
+/*
+ * WAN topology description and file loaders
+ *
+ * A WanTopology is a plain list of sites and circuits. The scenario builds
+ * ns-3 nodes and point-to-point links from it (see wan-topology-helper.h),
+ * so the WAN no longer has to be described in C++.
+ *
+ * Supported inputs:
+ *   - GraphML, as published by the Internet Topology Zoo
+ *   - a CSV edge list with a header row
+ *   - the JSON export of our inventory system (CMDB)
+ *
+ * All loaders stream their input. Only the site-name index and the element
+ * currently being parsed are held in memory, never a document tree, so
+ * 100k-edge files load in a fraction of a second.
+ */
+
+#ifndef WAN_TOPOLOGY_H
+#define WAN_TOPOLOGY_H
+
+#include "ns3/data-rate.h"
+#include "ns3/nstime.h"
+
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * A site (router) of the WAN.
+ */
+struct WanSite
+{
+    std::string name;         //!< Unique site name, e.g. "HQ"
+    std::string role;         //!< Site role, e.g. "hq", "branch", "dc"
+    double x{0.0};            //!< Layout x coordinate (longitude for GraphML)
+    double y{0.0};            //!< Layout y coordinate (latitude for GraphML)
+    bool hasPosition{false};  //!< True if x/y came from the input
+};
+
+/**
+ * A circuit between two sites.
+ */
+struct WanLink
+{
+    uint32_t a{0};           //!< Index of the first site
+    uint32_t b{0};           //!< Index of the second site
+    DataRate bandwidth;      //!< Circuit bandwidth
+    Time delay;              //!< One-way propagation delay
+    double cost{1.0};        //!< Routing cost (IGP metric)
+    std::string profile;     //!< Circuit profile name, see wan-link-profile.h
+    double loss{0.0};        //!< Packet loss probability per direction
+    double lossBurst{1.0};   //!< Mean loss burst length in packets
+    Time jitter;             //!< Mean extra delay per packet (none if zero)
+    std::string jitterModel; //!< Jitter distribution: "uniform", "normal" or "pareto"
+    Time mtbf;               //!< Mean time between failures (zero: campaign default)
+    Time mttr;               //!< Mean time to repair
+};
+
+/**
+ * Sites and circuits of a WAN, independent of any ns-3 objects.
+ */
+class WanTopology
+{
+  public:
+    /**
+     * Add a site, or update the role of an existing site with that name.
+     * \param name site name
+     * \param role site role, ignored if empty
+     * \return the site index
+     */
+    uint32_t AddSite(const std::string& name, const std::string& role = "");
+
+    /**
+     * \param name site name
+     * \return the site index, or -1 if there is no such site
+     */
+    int64_t FindSite(const std::string& name) const;
+
+    /**
+     * Find the links named "SiteA-SiteB". Site names may themselves
+     * contain '-'; every split is tried until both halves are sites.
+     * \param pair the link name
+     * \param links receives the indices of all links between the two sites
+     * \return false if the name does not denote two sites
+     */
+    bool FindLinks(const std::string& pair, std::vector<uint32_t>& links) const;
+
+    /**
+     * Add a circuit between two existing sites.
+     * \return the link index
+     */
+    uint32_t AddLink(uint32_t a, uint32_t b, DataRate bandwidth, Time delay, double cost);
+
+    /// \return the number of sites
+    uint32_t GetNSites() const;
+    /// \return the number of links
+    uint32_t GetNLinks() const;
+    /// \return the site at index i
+    const WanSite& GetSite(uint32_t i) const;
+    /// \return the site at index i, for in-place updates
+    WanSite& GetSite(uint32_t i);
+    /// \return the link at index i
+    const WanLink& GetLink(uint32_t i) const;
+    /// \return the link at index i, for in-place updates
+    WanLink& GetLink(uint32_t i);
+
+    /**
+     * Reserve storage ahead of a bulk load.
+     */
+    void Reserve(uint32_t nSites, uint32_t nLinks);
+
+  private:
+    std::vector<WanSite> m_sites;                          //!< Sites by index
+    std::vector<WanLink> m_links;                          //!< Links by index
+    std::unordered_map<std::string, uint32_t> m_siteIndex; //!< Site name to index
+};
+
+/**
+ * The built-in three-site triangle (HQ, Branch, DC) with the historical
+ * 5Mbps/2ms circuits, in the link order the scenario has always used.
+ */
+WanTopology MakeTriangleTopology();
+
+/**
+ * A generated rows x columns grid of sites R<row>C<column>, each linked to
+ * its right and lower neighbour by a 10Mbps/1ms circuit of cost 1. With
+ * unit costs the shortest path between two sites has as many links as
+ * their Manhattan distance.
+ */
+WanTopology MakeGridTopology(uint32_t rows, uint32_t columns);
+
+/**
+ * Load a topology file.
+ * \param path file name
+ * \param format "graphml", "csv", "json" or "auto" (guess from the extension)
+ */
+WanTopology LoadTopology(const std::string& path, const std::string& format = "auto");
+
+/**
+ * Load GraphML. Node data keys "Label", "role", "Longitude"/"Latitude" and
+ * edge data keys "LinkSpeedRaw"/"bandwidth", "delay", "cost"/"weight",
+ * "profile" are understood; defaults of keys for="all" apply to both.
+ * Sites are named by label when it is unique, else by node id; a node id
+ * that is another node's label aborts rather than merging the two. Edges
+ * without a delay get the propagation delay of the great-circle distance
+ * between their end points when both are known.
+ */
+WanTopology LoadGraphMlTopology(std::istream& in);
+
+/**
+ * Load a CSV edge list. The first non-comment row names the columns:
+ * source, target, bandwidth, delay, cost, source_role, target_role, profile.
+ * Only source and target are mandatory; unknown columns are ignored.
+ */
+WanTopology LoadCsvTopology(std::istream& in);
+
+/**
+ * Load the CMDB JSON export: a top-level object with a "sites" array
+ * (name, role, x, y) and a "circuits" array (a, z, bandwidth, delay, cost,
+ * profile).
+ * Common aliases (nodes/links, source/target, ...) are accepted as well.
+ */
+WanTopology LoadJsonTopology(std::istream& in);
+
+} // namespace ns3
+
+#endif /* WAN_TOPOLOGY_H */
@@ -0,0 +1,212 @@
+/*
+ * Tracing manager: trace sinks only where and when an output wants them
+ */
+
+#include "wan-tracing.h"
+
+#include "ns3/abort.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/trace-helper.h"
+
+#include <algorithm>
+#include <iomanip>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("WanTracing");
+
+WanTracingManager::WanTracingManager()
+{
+    for (uint32_t o = 0; o < N_OUTPUTS; ++o)
+    {
+        m_callbacks[o] = 0;
+        m_connected[o] = false;
+    }
+}
+
+void
+WanTracingManager::Enable(Output output, Time start, Time stop)
+{
+    NS_ABORT_MSG_UNLESS(stop > start, GetOutputName(output) << " window ends before it starts");
+    for (const Window& window : m_windows[output])
+    {
+        NS_ABORT_MSG_IF(start < window.stop && window.start < stop,
+                        GetOutputName(output) << " windows overlap");
+    }
+    m_windows[output].push_back({start, stop});
+}
+
+bool
+WanTracingManager::IsEnabled(Output output) const
+{
+    return !m_windows[output].empty();
+}
+
+Time
+WanTracingManager::GetStart(Output output) const
+{
+    Time start = Time::Max();
+    for (const Window& window : m_windows[output])
+    {
+        start = std::min(start, window.start);
+    }
+    return start;
+}
+
+Time
+WanTracingManager::GetStop(Output output) const
+{
+    Time stop;
+    for (const Window& window : m_windows[output])
+    {
+        stop = std::max(stop, window.stop);
+    }
+    return stop;
+}
+
+void
+WanTracingManager::InstallPcap(const NetDeviceContainer& devices, const std::string& prefix)
+{
+    if (!IsEnabled(PCAP))
+    {
+        return;
+    }
+    PcapHelper pcapHelper;
+    for (uint32_t i = 0; i < devices.GetN(); ++i)
+    {
+        Ptr<NetDevice> device = devices.Get(i);
+        Ptr<PcapFileWrapper> file =
+            pcapHelper.CreateFile(pcapHelper.GetFilenameFromDevice(prefix, device),
+                                  std::ios::out,
+                                  PcapHelper::DLT_PPP);
+        Connect(PCAP,
+                device,
+                "PromiscSniffer",
+                MakeBoundCallback(&WanTracingManager::PcapSniff, this, file));
+    }
+}
+
+void
+WanTracingManager::Connect(Output output,
+                           Ptr<Object> object,
+                           const std::string& trace,
+                           const CallbackBase& callback)
+{
+    if (IsEnabled(output))
+    {
+        m_sinks.push_back({output, object, trace, callback});
+    }
+}
+
+void
+WanTracingManager::Start()
+{
+    for (uint32_t o = 0; o < N_OUTPUTS; ++o)
+    {
+        Output output = static_cast<Output>(o);
+        for (const Window& window : m_windows[o])
+        {
+            Simulator::Schedule(window.start, &WanTracingManager::SetConnected, this, output, true);
+            Simulator::Schedule(window.stop, &WanTracingManager::SetConnected, this, output, false);
+        }
+    }
+}
+
+void
+WanTracingManager::SetConnected(Output output, bool connected)
+{
+    NS_LOG_FUNCTION(this << GetOutputName(output) << connected);
+    if (m_connected[output] == connected)
+    {
+        return;
+    }
+    m_connected[output] = connected;
+    for (const Sink& sink : m_sinks)
+    {
+        if (sink.output != output)
+        {
+            continue;
+        }
+        bool done = connected ? sink.object->TraceConnectWithoutContext(sink.trace, sink.callback)
+                              : sink.object->TraceDisconnectWithoutContext(sink.trace,
+                                                                           sink.callback);
+        NS_ABORT_MSG_UNLESS(done, "No trace source " << sink.trace);
+    }
+}
+
+void
+WanTracingManager::Count(Output output)
+{
+    ++m_callbacks[output];
+}
+
+uint64_t
+WanTracingManager::GetCallbacks(Output output) const
+{
+    return m_callbacks[output];
+}
+
+void
+WanTracingManager::PcapSniff(WanTracingManager* manager,
+                             Ptr<PcapFileWrapper> file,
+                             Ptr<const Packet> packet)
+{
+    manager->Count(PCAP);
+    file->Write(Simulator::Now(), packet);
+}
+
+void
+WanTracingManager::Print(std::ostream& os) const
+{
+    os << "\n========================================" << std::endl;
+    os << "Tracing (sink callbacks on the packet path)" << std::endl;
+    os << "========================================" << std::endl;
+    for (uint32_t o = 0; o < N_OUTPUTS; ++o)
+    {
+        Output output = static_cast<Output>(o);
+        os << "  " << std::left << std::setw(6) << GetOutputName(output) << std::right;
+        if (!IsEnabled(output))
+        {
+            os << "disabled, no sinks" << std::endl;
+            continue;
+        }
+        uint32_t sinks = 0;
+        for (const Sink& sink : m_sinks)
+        {
+            sinks += sink.output == output;
+        }
+        for (const Window& window : m_windows[o])
+        {
+            os << window.start.GetSeconds() << "-" << window.stop.GetSeconds() << "s ";
+        }
+        if (output == ANIM)
+        {
+            os << "(NetAnim's own sinks, not counted)" << std::endl;
+        }
+        else
+        {
+            os << sinks << " sinks, " << m_callbacks[o] << " callbacks" << std::endl;
+        }
+    }
+    os << "========================================" << std::endl;
+}
+
+std::string
+WanTracingManager::GetOutputName(Output output)
+{
+    switch (output)
+    {
+    case PCAP:
+        return "pcap";
+    case ANIM:
+        return "anim";
+    case STATS:
+        return "stats";
+    default:
+        return "unknown";
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,142 @@
+/*
+ * Tracing manager: trace sinks only where and when an output wants them
+ *
+ * Every connected trace sink costs a callback per packet on the forwarding
+ * path, whether or not anybody reads the result. The tracing manager owns
+ * the sinks of the run's outputs (pcap captures, NetAnim, statistics
+ * collectors) and keeps each output's sinks connected only while one of
+ * its time windows is open: they are connected when a window opens and
+ * disconnected when it closes. A disabled output connects nothing, so it
+ * costs nothing per packet.
+ *
+ * The manager counts the sink callbacks of every output, which makes the
+ * per-packet cost of each output visible in the tracing report.
+ *
+ * NetAnim connects its own trace sinks for the whole run. The manager only
+ * creates the AnimationInterface when NetAnim is enabled and limits its
+ * recording to the windows; its callbacks are not counted.
+ */
+
+#ifndef WAN_TRACING_H
+#define WAN_TRACING_H
+
+#include "ns3/callback.h"
+#include "ns3/net-device-container.h"
+#include "ns3/nstime.h"
+#include "ns3/object.h"
+#include "ns3/packet.h"
+#include "ns3/pcap-file-wrapper.h"
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Windowed trace sinks of the run's outputs.
+ */
+class WanTracingManager
+{
+  public:
+    /// Outputs that attach trace sinks
+    enum Output
+    {
+        PCAP,     //!< Packet captures of the link devices
+        ANIM,     //!< NetAnim animation
+        STATS,    //!< Statistics collectors, e.g. link utilization
+        N_OUTPUTS //!< Number of outputs
+    };
+
+    WanTracingManager();
+
+    /**
+     * Enable an output for a time window. An output may have several
+     * windows; they must not overlap.
+     * \param output the output
+     * \param start window start
+     * \param stop window end
+     */
+    void Enable(Output output, Time start, Time stop);
+
+    /// \return true if the output has a window
+    bool IsEnabled(Output output) const;
+
+    /// \return the start of the output's first window
+    Time GetStart(Output output) const;
+
+    /// \return the end of the output's last window
+    Time GetStop(Output output) const;
+
+    /**
+     * Capture packets on devices (PromiscSniffer) while PCAP windows are
+     * open, one file per device named as PcapHelper names them.
+     * \param devices the point-to-point devices
+     * \param prefix file name prefix
+     */
+    void InstallPcap(const NetDeviceContainer& devices, const std::string& prefix);
+
+    /**
+     * Connect a trace sink (without context) while the output's windows
+     * are open. Does nothing if the output is disabled.
+     * \param output the output the sink belongs to
+     * \param object the object with the trace source
+     * \param trace trace source name
+     * \param callback the sink
+     */
+    void Connect(Output output,
+                 Ptr<Object> object,
+                 const std::string& trace,
+                 const CallbackBase& callback);
+
+    /// Schedule the window openings and closings; call once, before Simulator::Run
+    void Start();
+
+    /// Count one sink callback of an output
+    void Count(Output output);
+
+    /// \return the sink callbacks of an output so far
+    uint64_t GetCallbacks(Output output) const;
+
+    /// Print the windows, the connected sinks and the callback counts
+    void Print(std::ostream& os) const;
+
+    /// \return the name of an output: pcap, anim or stats
+    static std::string GetOutputName(Output output);
+
+  private:
+    /// A trace sink managed by the windows of its output
+    struct Sink
+    {
+        Output output;         //!< Owning output
+        Ptr<Object> object;    //!< Trace source owner
+        std::string trace;     //!< Trace source name
+        CallbackBase callback; //!< Connected sink
+    };
+
+    /// A time window of an output
+    struct Window
+    {
+        Time start; //!< Opening
+        Time stop;  //!< Closing
+    };
+
+    /// Connect (open) or disconnect (close) the sinks of an output
+    void SetConnected(Output output, bool connected);
+
+    /// PromiscSniffer sink writing to a capture file
+    static void PcapSniff(WanTracingManager* manager,
+                          Ptr<PcapFileWrapper> file,
+                          Ptr<const Packet> packet);
+
+    std::vector<Window> m_windows[N_OUTPUTS]; //!< Windows by output
+    std::vector<Sink> m_sinks;                //!< Managed sinks
+    uint64_t m_callbacks[N_OUTPUTS];          //!< Sink callbacks by output
+    bool m_connected[N_OUTPUTS];              //!< Sinks connected now
+};
+
+} // namespace ns3
+
+#endif /* WAN_TRACING_H */
@@ -0,0 +1,251 @@
+/*
+ * Scenario verification: forwarding, reachability, metric and runtime checks
+ */
+
+#include "wan-verifier.h"
+
+#include "ns3/abort.h"
+#include "ns3/ipv4-route.h"
+#include "ns3/ipv4-routing-protocol.h"
+#include "ns3/ipv4.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+
+#include <sstream>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("WanVerifier");
+
+void
+WanVerifier::BeginScenario(const std::string& name)
+{
+    Scenario scenario;
+    scenario.name = name;
+    m_scenarios.push_back(scenario);
+    m_topology = nullptr;
+    m_network = nullptr;
+    m_started = std::chrono::steady_clock::now();
+}
+
+void
+WanVerifier::EndScenario(double budget)
+{
+    Scenario& scenario = Current();
+    scenario.runtime =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - m_started).count();
+    scenario.budget = budget;
+    std::ostringstream detail;
+    detail << scenario.runtime << "s, budget " << budget << "s";
+    Check("runtime", scenario.runtime <= budget, detail.str());
+    m_topology = nullptr;
+    m_network = nullptr;
+}
+
+void
+WanVerifier::SetNetwork(const WanTopology& topology, const WanNetwork& network)
+{
+    m_topology = &topology;
+    m_network = &network;
+}
+
+void
+WanVerifier::Check(const std::string& what, bool passed, const std::string& detail)
+{
+    Scenario& scenario = Current();
+    ++scenario.checks;
+    if (!passed)
+    {
+        NS_LOG_WARN(scenario.name << ": " << what << " failed: " << detail);
+        scenario.failures.push_back(detail.empty() ? what : what + ": " + detail);
+    }
+}
+
+void
+WanVerifier::ExpectNextHopAt(Time at, uint32_t site, Ipv4Address destination, Ipv4Address gateway)
+{
+    Simulator::Schedule(at, &WanVerifier::CheckNextHop, this, site, destination, gateway);
+}
+
+void
+WanVerifier::ExpectReachableAt(Time at,
+                               uint32_t site,
+                               Ipv4Address destination,
+                               bool reachable,
+                               uint32_t hops)
+{
+    Simulator::Schedule(at,
+                        &WanVerifier::CheckReachable,
+                        this,
+                        site,
+                        destination,
+                        reachable,
+                        hops);
+}
+
+void
+WanVerifier::ExpectMetric(const WanMetrics& metrics,
+                          const std::string& name,
+                          double min,
+                          double max)
+{
+    std::ostringstream what;
+    what << name << " in [" << min << ", " << max << "]";
+    if (!metrics.Has(name))
+    {
+        Check(what.str(), false, "not reported");
+        return;
+    }
+    double value = metrics.Get(name);
+    std::ostringstream detail;
+    detail << value;
+    Check(what.str(), value >= min && value <= max, detail.str());
+}
+
+uint32_t
+WanVerifier::GetNChecks() const
+{
+    uint32_t checks = 0;
+    for (const Scenario& scenario : m_scenarios)
+    {
+        checks += scenario.checks;
+    }
+    return checks;
+}
+
+uint32_t
+WanVerifier::GetNFailed() const
+{
+    uint32_t failed = 0;
+    for (const Scenario& scenario : m_scenarios)
+    {
+        failed += scenario.failures.size();
+    }
+    return failed;
+}
+
+void
+WanVerifier::Print(std::ostream& os) const
+{
+    os << "\n========================================" << std::endl;
+    os << "Verification" << std::endl;
+    os << "========================================" << std::endl;
+    for (const Scenario& scenario : m_scenarios)
+    {
+        os << (scenario.failures.empty() ? "PASS " : "FAIL ") << scenario.name << ": "
+           << scenario.checks << " checks, " << scenario.failures.size() << " failed, "
+           << scenario.runtime << "s (budget " << scenario.budget << "s)" << std::endl;
+        for (const std::string& failure : scenario.failures)
+        {
+            os << "    " << failure << std::endl;
+        }
+    }
+    os << GetNChecks() << " checks, " << GetNFailed() << " failed" << std::endl;
+    os << "========================================" << std::endl;
+}
+
+int32_t
+WanVerifier::Walk(uint32_t site, Ipv4Address destination, std::string& path) const
+{
+    const uint32_t nSites = m_topology->GetNSites();
+    path = m_topology->GetSite(site).name;
+    for (uint32_t hops = 0; hops <= nSites; ++hops)
+    {
+        Ptr<Ipv4> ipv4 = m_network->nodes.Get(site)->GetObject<Ipv4>();
+        if (ipv4->GetInterfaceForAddress(destination) >= 0)
+        {
+            return hops;
+        }
+
+        // The route a packet to the destination would take from here
+        Ipv4Header header;
+        header.SetDestination(destination);
+        Socket::SocketErrno error;
+        Ptr<Ipv4Route> route =
+            ipv4->GetRoutingProtocol()->RouteOutput(nullptr, header, nullptr, error);
+        if (!route)
+        {
+            path += " (no route)";
+            return -1;
+        }
+        Ptr<NetDevice> device = route->GetOutputDevice();
+        int32_t interface = ipv4->GetInterfaceForDevice(device);
+        // Failed circuits have their MTU set to zero
+        if (interface < 0 || !ipv4->IsUp(interface) || !device->IsLinkUp() ||
+            device->GetMtu() == 0)
+        {
+            path += " (link down)";
+            return -1;
+        }
+
+        // The site at the other end of the circuit
+        int64_t arc = m_network->graph.FindArc(site, interface);
+        if (arc < 0)
+        {
+            path += " (no peer)";
+            return -1;
+        }
+        site = m_network->graph.GetTarget(arc);
+        path += " > " + m_topology->GetSite(site).name;
+    }
+    path += " (loop)";
+    return -1;
+}
+
+void
+WanVerifier::CheckNextHop(uint32_t site, Ipv4Address destination, Ipv4Address gateway)
+{
+    NS_ABORT_MSG_UNLESS(m_network, "Forwarding checks need SetNetwork");
+    std::ostringstream what;
+    what << "t=" << Simulator::Now().GetSeconds() << "s " << m_topology->GetSite(site).name
+         << " next hop to " << destination << " is " << gateway;
+
+    Ptr<Ipv4> ipv4 = m_network->nodes.Get(site)->GetObject<Ipv4>();
+    Ipv4Header header;
+    header.SetDestination(destination);
+    Socket::SocketErrno error;
+    Ptr<Ipv4Route> route =
+        ipv4->GetRoutingProtocol()->RouteOutput(nullptr, header, nullptr, error);
+    std::ostringstream found;
+    if (route)
+    {
+        found << route->GetGateway();
+    }
+    else
+    {
+        found << "no route";
+    }
+    Check(what.str(), route && route->GetGateway() == gateway, found.str());
+}
+
+void
+WanVerifier::CheckReachable(uint32_t site,
+                            Ipv4Address destination,
+                            bool reachable,
+                            uint32_t hops)
+{
+    NS_ABORT_MSG_UNLESS(m_network, "Forwarding checks need SetNetwork");
+    std::ostringstream what;
+    what << "t=" << Simulator::Now().GetSeconds() << "s " << m_topology->GetSite(site).name
+         << (reachable ? " reaches " : " does not reach ") << destination;
+    if (reachable && hops > 0)
+    {
+        what << " in " << hops << " hops";
+    }
+
+    std::string path;
+    int32_t found = Walk(site, destination, path);
+    bool passed = reachable ? found >= 0 && (hops == 0 || found == static_cast<int32_t>(hops))
+                            : found < 0;
+    Check(what.str(), passed, path);
+}
+
+WanVerifier::Scenario&
+WanVerifier::Current()
+{
+    NS_ABORT_MSG_IF(m_scenarios.empty(), "Checks need BeginScenario");
+    return m_scenarios.back();
+}
+
+} // namespace ns3
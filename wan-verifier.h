@@ -0,0 +1,149 @@
+/*
+ * Scenario verification: forwarding, reachability, metric and runtime checks
+ *
+ * --verify runs a fixed set of scenarios and checks them instead of
+ * leaving the console output and the .routes file to be read by eye. A
+ * WanVerifier collects named pass/fail checks per scenario:
+ *
+ * - next hops: the route a node's routing protocol (static, failover or
+ *   policy routes alike) selects for a destination, at a given time;
+ * - reachability: the path a packet takes, hop by hop through the routing
+ *   lookups of every node on the way, must reach the node that owns the
+ *   destination address over links that are up, optionally in a given
+ *   number of hops;
+ * - golden metrics: a metric of the finished run must lie within bounds;
+ * - runtime: the wall-clock time of a scenario must stay within a budget.
+ *
+ * Forwarding checks are scheduled in simulated time, so the same scenario
+ * is checked before, during and after its failure.
+ */
+
+#ifndef WAN_VERIFIER_H
+#define WAN_VERIFIER_H
+
+#include "wan-metrics.h"
+#include "wan-topology-helper.h"
+#include "wan-topology.h"
+
+#include "ns3/ipv4-address.h"
+#include "ns3/nstime.h"
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Named checks of the verification scenarios.
+ */
+class WanVerifier
+{
+  public:
+    /**
+     * Start the checks of a scenario and its runtime measurement.
+     * \param name scenario name for the report
+     */
+    void BeginScenario(const std::string& name);
+
+    /**
+     * End the current scenario and check its runtime.
+     * \param budget wall-clock seconds the scenario may take
+     */
+    void EndScenario(double budget);
+
+    /**
+     * Set the network the forwarding checks of the current scenario run
+     * on. Both must outlive the scheduled checks.
+     */
+    void SetNetwork(const WanTopology& topology, const WanNetwork& network);
+
+    /**
+     * Record a check.
+     * \param what what was checked
+     * \param passed the outcome
+     * \param detail what was found, reported on failure
+     */
+    void Check(const std::string& what, bool passed, const std::string& detail = "");
+
+    /**
+     * Check at a time that a site forwards a destination to a gateway.
+     * \param at simulated time
+     * \param site the forwarding site
+     * \param destination the destination address
+     * \param gateway the expected next hop address
+     */
+    void ExpectNextHopAt(Time at, uint32_t site, Ipv4Address destination, Ipv4Address gateway);
+
+    /**
+     * Check at a time whether a site reaches a destination address.
+     * \param at simulated time
+     * \param site the source site
+     * \param destination the destination address
+     * \param reachable whether it must be reached
+     * \param hops links on the way if reachable; 0 for any number
+     */
+    void ExpectReachableAt(Time at,
+                           uint32_t site,
+                           Ipv4Address destination,
+                           bool reachable,
+                           uint32_t hops = 0);
+
+    /**
+     * Check that a metric of a finished run lies in [min, max]. A metric
+     * the run did not report fails.
+     */
+    void ExpectMetric(const WanMetrics& metrics, const std::string& name, double min, double max);
+
+    /// \return the checks recorded so far
+    uint32_t GetNChecks() const;
+
+    /// \return the failed checks so far
+    uint32_t GetNFailed() const;
+
+    /// Print every failed check and a summary per scenario
+    void Print(std::ostream& os) const;
+
+  private:
+    /// Checks and runtime of one scenario
+    struct Scenario
+    {
+        std::string name;                  //!< Scenario name
+        uint32_t checks{0};                //!< Checks recorded
+        std::vector<std::string> failures; //!< Failed checks with details
+        double runtime{0};                 //!< Wall-clock seconds
+        double budget{0};                  //!< Runtime budget in seconds
+    };
+
+    /**
+     * Follow a destination from a site through the routing lookups of
+     * every node on the way.
+     * \param site the source site
+     * \param destination the destination address
+     * \param path the sites on the way and where the walk ended
+     * \return the links to the owner of the destination, or -1 if it is
+     *         not reached
+     */
+    int32_t Walk(uint32_t site, Ipv4Address destination, std::string& path) const;
+
+    /// Check a next hop now
+    void CheckNextHop(uint32_t site, Ipv4Address destination, Ipv4Address gateway);
+
+    /// Check reachability now
+    void CheckReachable(uint32_t site, Ipv4Address destination, bool reachable, uint32_t hops);
+
+    /// \return the current scenario
+    Scenario& Current();
+
+    std::vector<Scenario> m_scenarios;               //!< Scenarios in order
+    std::chrono::steady_clock::time_point m_started; //!< Start of the current scenario
+    const WanTopology* m_topology{nullptr};          //!< Network of the forwarding checks
+    const WanNetwork* m_network{nullptr};            //!< Nodes and devices of the network
+};
+
+} // namespace ns3
+
+#endif /* WAN_VERIFIER_H */
@@ -0,0 +1,628 @@
+/*
+ * Tenant VPNs: VRF routing instances per router, bound per interface
+ */
+
+#include "wan-vrf.h"
+
+#include "wan-csv-reader.h"
+
+#include "ns3/abort.h"
+#include "ns3/internet-stack-helper.h"
+#include "ns3/ipv4-list-routing.h"
+#include "ns3/ipv4-route.h"
+#include "ns3/ipv4-static-routing-helper.h"
+#include "ns3/ipv4-static-routing.h"
+#include "ns3/log.h"
+#include "ns3/mobility-helper.h"
+#include "ns3/mobility-model.h"
+#include "ns3/net-device-container.h"
+#include "ns3/node.h"
+#include "ns3/output-stream-wrapper.h"
+#include "ns3/point-to-point-helper.h"
+#include "ns3/simulator.h"
+
+#include <algorithm>
+#include <sstream>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("WanVrf");
+
+NS_OBJECT_ENSURE_REGISTERED(WanVrfTag);
+NS_OBJECT_ENSURE_REGISTERED(WanVrfRouting);
+
+namespace
+{
+
+/// First address of the tenant site subnets
+const uint32_t TENANT_BASE = 0xac100000; // 172.16.0.0
+
+/// Tenant site subnets: one /30 per site
+const uint32_t TENANT_MASK = 0xfffffffc;
+
+/// \return the subnet of a site, the same in every tenant
+Ipv4Address
+SiteNetwork(uint32_t site)
+{
+    return Ipv4Address(TENANT_BASE + 4 * site);
+}
+
+} // namespace
+
+/*
+ * WanVrfTag
+ */
+
+TypeId
+WanVrfTag::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::WanVrfTag")
+                            .SetParent<Tag>()
+                            .SetGroupName("Internet")
+                            .AddConstructor<WanVrfTag>();
+    return tid;
+}
+
+WanVrfTag::WanVrfTag()
+{
+}
+
+WanVrfTag::WanVrfTag(uint32_t vrf, Ipv4Address egress)
+    : m_vrf(vrf),
+      m_egress(egress)
+{
+}
+
+uint32_t
+WanVrfTag::GetVrf() const
+{
+    return m_vrf;
+}
+
+Ipv4Address
+WanVrfTag::GetEgress() const
+{
+    return m_egress;
+}
+
+TypeId
+WanVrfTag::GetInstanceTypeId() const
+{
+    return GetTypeId();
+}
+
+uint32_t
+WanVrfTag::GetSerializedSize() const
+{
+    return 8;
+}
+
+void
+WanVrfTag::Serialize(TagBuffer buffer) const
+{
+    buffer.WriteU32(m_vrf);
+    buffer.WriteU32(m_egress.Get());
+}
+
+void
+WanVrfTag::Deserialize(TagBuffer buffer)
+{
+    m_vrf = buffer.ReadU32();
+    m_egress = Ipv4Address(buffer.ReadU32());
+}
+
+void
+WanVrfTag::Print(std::ostream& os) const
+{
+    os << "vrf=" << m_vrf << " egress=" << m_egress;
+}
+
+/*
+ * WanVrfRouting
+ */
+
+void
+WanVrfRouting::Counters::Add(const Counters& other)
+{
+    toCore += other.toCore;
+    fromCore += other.fromCore;
+    local += other.local;
+    transit += other.transit;
+    dropped += other.dropped;
+}
+
+TypeId
+WanVrfRouting::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::WanVrfRouting")
+                            .SetParent<Ipv4RoutingProtocol>()
+                            .SetGroupName("Internet")
+                            .AddConstructor<WanVrfRouting>();
+    return tid;
+}
+
+WanVrfRouting::WanVrfRouting()
+{
+}
+
+void
+WanVrfRouting::Bind(uint32_t interface, uint32_t vrf)
+{
+    NS_LOG_FUNCTION(this << interface << vrf);
+    NS_ABORT_MSG_IF(vrf == 0, "VRF 0 means unbound");
+    if (interface >= m_bindings.size())
+    {
+        m_bindings.resize(interface + 1, 0);
+    }
+    m_bindings[interface] = vrf;
+}
+
+uint32_t
+WanVrfRouting::GetVrf(uint32_t interface) const
+{
+    return interface < m_bindings.size() ? m_bindings[interface] : 0;
+}
+
+bool
+WanVrfRouting::HasBindings() const
+{
+    return std::any_of(m_bindings.begin(), m_bindings.end(), [](uint32_t vrf) {
+        return vrf != 0;
+    });
+}
+
+void
+WanVrfRouting::AddAttachedRoute(uint32_t vrf,
+                                Ipv4Address network,
+                                Ipv4Mask mask,
+                                Ipv4Address gateway,
+                                uint32_t interface)
+{
+    AddRoute(vrf, {network.CombineMask(mask), mask, gateway, interface, Ipv4Address(), false});
+}
+
+void
+WanVrfRouting::AddRemoteRoute(uint32_t vrf, Ipv4Address network, Ipv4Mask mask, Ipv4Address egress)
+{
+    AddRoute(vrf, {network.CombineMask(mask), mask, Ipv4Address(), 0, egress, true});
+}
+
+void
+WanVrfRouting::AddRoute(uint32_t vrf, const Route& route)
+{
+    std::vector<Route>& routes = m_routes[vrf];
+    auto it = std::find_if(routes.begin(), routes.end(), [&route](const Route& other) {
+        return other.mask.GetPrefixLength() < route.mask.GetPrefixLength();
+    });
+    routes.insert(it, route);
+}
+
+const WanVrfRouting::Route*
+WanVrfRouting::Lookup(uint32_t vrf, Ipv4Address destination) const
+{
+    auto it = m_routes.find(vrf);
+    if (it == m_routes.end())
+    {
+        return nullptr;
+    }
+    for (const Route& route : it->second)
+    {
+        if (route.mask.IsMatch(destination, route.network))
+        {
+            return &route;
+        }
+    }
+    return nullptr;
+}
+
+WanVrfRouting::Counters
+WanVrfRouting::GetCounters(uint32_t vrf) const
+{
+    auto it = m_counters.find(vrf);
+    return it != m_counters.end() ? it->second : Counters();
+}
+
+Ptr<WanVrfRouting>
+WanVrfRouting::Find(Ptr<Ipv4> ipv4)
+{
+    Ptr<Ipv4RoutingProtocol> protocol = ipv4->GetRoutingProtocol();
+    Ptr<WanVrfRouting> vrf = DynamicCast<WanVrfRouting>(protocol);
+    if (vrf)
+    {
+        return vrf;
+    }
+    Ptr<Ipv4ListRouting> list = DynamicCast<Ipv4ListRouting>(protocol);
+    for (uint32_t i = 0; list && i < list->GetNRoutingProtocols(); ++i)
+    {
+        int16_t priority;
+        vrf = DynamicCast<WanVrfRouting>(list->GetRoutingProtocol(i, priority));
+        if (vrf)
+        {
+            return vrf;
+        }
+    }
+    return nullptr;
+}
+
+Ptr<Ipv4Route>
+WanVrfRouting::MakeRoute(const Route& route, Ipv4Address destination) const
+{
+    Ptr<Ipv4Route> ceRoute = Create<Ipv4Route>();
+    ceRoute->SetDestination(destination);
+    ceRoute->SetSource(m_ipv4->GetAddress(route.interface, 0).GetLocal());
+    ceRoute->SetGateway(route.gateway);
+    ceRoute->SetOutputDevice(m_ipv4->GetNetDevice(route.interface));
+    return ceRoute;
+}
+
+Ptr<Ipv4Route>
+WanVrfRouting::CoreRoute(const Ipv4Header& header, Ipv4Address egress) const
+{
+    // The router's own protocols, as for a packet it sends to the egress PE;
+    // the tenant's source keeps flows apart for load sharing
+    Ipv4Header core = header;
+    core.SetDestination(egress);
+    Socket::SocketErrno sockerr;
+    return m_ipv4->GetRoutingProtocol()->RouteOutput(nullptr, core, nullptr, sockerr);
+}
+
+Ptr<Ipv4Route>
+WanVrfRouting::RouteOutput(Ptr<Packet> /* p */,
+                           const Ipv4Header& /* header */,
+                           Ptr<NetDevice> /* oif */,
+                           Socket::SocketErrno& sockerr)
+{
+    // The router itself sends in the core only
+    sockerr = Socket::ERROR_NOROUTETOHOST;
+    return nullptr;
+}
+
+bool
+WanVrfRouting::RouteInput(Ptr<const Packet> p,
+                          const Ipv4Header& header,
+                          Ptr<const NetDevice> idev,
+                          const UnicastForwardCallback& ucb,
+                          const MulticastForwardCallback& /* mcb */,
+                          const LocalDeliverCallback& /* lcb */,
+                          const ErrorCallback& ecb)
+{
+    const Ipv4Address destination = header.GetDestination();
+    WanVrfTag tag;
+    if (p->PeekPacketTag(tag))
+    {
+        Counters& counters = m_counters[tag.GetVrf()];
+        if (m_ipv4->GetInterfaceForAddress(tag.GetEgress()) < 0)
+        {
+            // Transit: on towards the egress PE
+            Ptr<Ipv4Route> route = CoreRoute(header, tag.GetEgress());
+            if (!route)
+            {
+                ++counters.dropped;
+                ecb(p, header, Socket::ERROR_NOROUTETOHOST);
+                return true;
+            }
+            ++counters.transit;
+            ucb(route, p, header);
+            return true;
+        }
+
+        // Egress: out of the core, to the CE of the VRF
+        const Route* route = Lookup(tag.GetVrf(), destination);
+        if (!route || route->remote)
+        {
+            ++counters.dropped;
+            ecb(p, header, Socket::ERROR_NOROUTETOHOST);
+            return true;
+        }
+        Ptr<Packet> packet = p->Copy();
+        packet->RemovePacketTag(tag);
+        ++counters.fromCore;
+        ucb(MakeRoute(*route, destination), packet, header);
+        return true;
+    }
+
+    const uint32_t vrf = GetVrf(m_ipv4->GetInterfaceForDevice(idev));
+    if (vrf == 0)
+    {
+        return false; // a core packet
+    }
+    Counters& counters = m_counters[vrf];
+    const Route* route = Lookup(vrf, destination);
+    if (!route)
+    {
+        ++counters.dropped;
+        ecb(p, header, Socket::ERROR_NOROUTETOHOST);
+        return true;
+    }
+    if (!route->remote)
+    {
+        // Between two CEs of this router
+        ++counters.local;
+        ucb(MakeRoute(*route, destination), p, header);
+        return true;
+    }
+
+    // Ingress: into the core, tagged with the VRF and egress PE
+    Ptr<Ipv4Route> coreRoute = CoreRoute(header, route->egress);
+    if (!coreRoute)
+    {
+        ++counters.dropped;
+        ecb(p, header, Socket::ERROR_NOROUTETOHOST);
+        return true;
+    }
+    Ptr<Packet> packet = p->Copy();
+    packet->AddPacketTag(WanVrfTag(vrf, route->egress));
+    ++counters.toCore;
+    ucb(coreRoute, packet, header);
+    return true;
+}
+
+void
+WanVrfRouting::NotifyInterfaceUp(uint32_t /* interface */)
+{
+}
+
+void
+WanVrfRouting::NotifyInterfaceDown(uint32_t /* interface */)
+{
+}
+
+void
+WanVrfRouting::NotifyAddAddress(uint32_t /* interface */, Ipv4InterfaceAddress /* address */)
+{
+}
+
+void
+WanVrfRouting::NotifyRemoveAddress(uint32_t /* interface */, Ipv4InterfaceAddress /* address */)
+{
+}
+
+void
+WanVrfRouting::SetIpv4(Ptr<Ipv4> ipv4)
+{
+    m_ipv4 = ipv4;
+}
+
+void
+WanVrfRouting::PrintRoutingTable(Ptr<OutputStreamWrapper> stream, Time::Unit unit) const
+{
+    std::ostream& os = *stream->GetStream();
+    os << "Node: " << m_ipv4->GetObject<Node>()->GetId() << ", Time: " << Simulator::Now().As(unit)
+       << ", WanVrfRouting" << std::endl;
+    for (const auto& [vrf, routes] : m_routes)
+    {
+        os << "  VRF " << vrf << ":";
+        for (uint32_t i = 0; i < m_bindings.size(); ++i)
+        {
+            if (m_bindings[i] == vrf)
+            {
+                os << " if" << i;
+            }
+        }
+        os << std::endl;
+        for (const Route& route : routes)
+        {
+            os << "    " << route.network << "/" << route.mask.GetPrefixLength();
+            if (route.remote)
+            {
+                os << " via PE " << route.egress << std::endl;
+            }
+            else
+            {
+                os << " via " << route.gateway << " if" << route.interface << std::endl;
+            }
+        }
+    }
+}
+
+void
+WanVrfRouting::DoDispose()
+{
+    m_ipv4 = nullptr;
+    m_routes.clear();
+    Ipv4RoutingProtocol::DoDispose();
+}
+
+/*
+ * WanVrfEngine
+ */
+
+WanVrfEngine::WanVrfEngine(const WanTopology& topology, const WanNetwork& network)
+    : m_topology(topology),
+      m_network(network),
+      m_accessBandwidth("1Gbps"),
+      m_accessDelay(MilliSeconds(1))
+{
+}
+
+void
+WanVrfEngine::Add(const std::string& tenants)
+{
+    std::istringstream list(tenants);
+    std::string entry;
+    while (std::getline(list, entry, ','))
+    {
+        entry = WanCsvReader::Trim(entry);
+        if (entry.empty())
+        {
+            continue;
+        }
+        WanTenant tenant;
+        size_t equals = entry.find('=');
+        tenant.name = WanCsvReader::Trim(entry.substr(0, equals));
+        NS_ABORT_MSG_IF(tenant.name.empty(), "Tenant '" << entry << "' has no name");
+        for (const WanTenant& other : m_tenants)
+        {
+            NS_ABORT_MSG_IF(other.name == tenant.name, "Tenant " << tenant.name << " twice");
+        }
+        if (equals == std::string::npos)
+        {
+            for (uint32_t s = 0; s < m_topology.GetNSites(); ++s)
+            {
+                tenant.sites.push_back(s);
+            }
+        }
+        else
+        {
+            std::istringstream sites(entry.substr(equals + 1));
+            std::string name;
+            while (std::getline(sites, name, '+'))
+            {
+                int64_t site = m_topology.FindSite(WanCsvReader::Trim(name));
+                NS_ABORT_MSG_IF(site < 0, "Tenant " << tenant.name << ": no site " << name);
+                NS_ABORT_MSG_IF(std::count(tenant.sites.begin(), tenant.sites.end(), site),
+                                "Tenant " << tenant.name << ": site " << name << " twice");
+                tenant.sites.push_back(site);
+            }
+        }
+        NS_ABORT_MSG_IF(tenant.sites.empty(), "Tenant " << tenant.name << " has no sites");
+        tenant.vrf = m_tenants.size() + 1;
+        m_tenants.push_back(tenant);
+    }
+}
+
+void
+WanVrfEngine::SetAccessLink(DataRate bandwidth, Time delay)
+{
+    m_accessBandwidth = bandwidth;
+    m_accessDelay = delay;
+}
+
+Ipv4Address
+WanVrfEngine::GetRouterId(uint32_t site) const
+{
+    const WanGraph& graph = m_network.graph;
+    NS_ABORT_MSG_IF(graph.Begin(site) == graph.End(site),
+                    "Site " << m_topology.GetSite(site).name << " has no circuit");
+    uint32_t arc = graph.Begin(site);
+    return m_network.linkInterfaces[graph.GetLink(arc)].GetAddress(graph.GetLocalEnd(arc));
+}
+
+void
+WanVrfEngine::Install()
+{
+    NS_LOG_FUNCTION(this);
+    const uint32_t nSites = m_topology.GetNSites();
+    NS_ABORT_MSG_IF(uint64_t{4} * nSites > (1U << 20), "Too many sites for 172.16.0.0/12");
+
+    // VRF routing on every router: PEs bind interfaces, all forward tagged packets
+    m_routing.clear();
+    for (uint32_t s = 0; s < nSites; ++s)
+    {
+        Ptr<Ipv4> ipv4 = m_network.nodes.Get(s)->GetObject<Ipv4>();
+        Ptr<Ipv4ListRouting> list = DynamicCast<Ipv4ListRouting>(ipv4->GetRoutingProtocol());
+        NS_ABORT_MSG_UNLESS(list, "Tenant VRFs need list routing on " << s);
+        Ptr<WanVrfRouting> routing = CreateObject<WanVrfRouting>();
+        list->AddRoutingProtocol(routing, WanVrfRouting::PRIORITY);
+        m_routing.push_back(routing);
+    }
+
+    PointToPointHelper access;
+    access.SetDeviceAttribute("DataRate", DataRateValue(m_accessBandwidth));
+    access.SetChannelAttribute("Delay", TimeValue(m_accessDelay));
+    InternetStackHelper stack;
+    MobilityHelper mobility;
+    mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
+    Ipv4StaticRoutingHelper staticRoutingHelper;
+    const Ipv4Mask mask(TENANT_MASK);
+    for (WanTenant& tenant : m_tenants)
+    {
+        tenant.ces.Create(tenant.sites.size());
+        stack.Install(tenant.ces);
+        mobility.Install(tenant.ces);
+        tenant.addresses.clear();
+        for (uint32_t i = 0; i < tenant.sites.size(); ++i)
+        {
+            const uint32_t s = tenant.sites[i];
+            Ptr<Node> pe = m_network.nodes.Get(s);
+            Ptr<Node> ce = tenant.ces.Get(i);
+            Vector position = pe->GetObject<MobilityModel>()->GetPosition();
+            position.y += 5.0 * tenant.vrf;
+            ce->GetObject<MobilityModel>()->SetPosition(position);
+
+            // Addresses by hand: every tenant reuses them, which the
+            // address helper would reject as a collision
+            NetDeviceContainer devices = access.Install(pe, ce);
+            const Ipv4Address network = SiteNetwork(s);
+            const Ipv4Address peAddress(network.Get() + 1);
+            const Ipv4Address ceAddress(network.Get() + 2);
+            Ptr<Ipv4> peIpv4 = pe->GetObject<Ipv4>();
+            Ptr<Ipv4> ceIpv4 = ce->GetObject<Ipv4>();
+            uint32_t peInterface = peIpv4->AddInterface(devices.Get(0));
+            peIpv4->AddAddress(peInterface, Ipv4InterfaceAddress(peAddress, mask));
+            peIpv4->SetUp(peInterface);
+            uint32_t ceInterface = ceIpv4->AddInterface(devices.Get(1));
+            ceIpv4->AddAddress(ceInterface, Ipv4InterfaceAddress(ceAddress, mask));
+            ceIpv4->SetUp(ceInterface);
+            staticRoutingHelper.GetStaticRouting(ceIpv4)->SetDefaultRoute(peAddress, ceInterface);
+            tenant.addresses.push_back(ceAddress);
+
+            m_routing[s]->Bind(peInterface, tenant.vrf);
+            m_routing[s]->AddAttachedRoute(tenant.vrf, network, mask, ceAddress, peInterface);
+        }
+        for (uint32_t s : tenant.sites)
+        {
+            for (uint32_t other : tenant.sites)
+            {
+                if (other != s)
+                {
+                    m_routing[s]->AddRemoteRoute(tenant.vrf,
+                                                 SiteNetwork(other),
+                                                 mask,
+                                                 GetRouterId(other));
+                }
+            }
+        }
+    }
+}
+
+const std::vector<WanTenant>&
+WanVrfEngine::GetTenants() const
+{
+    return m_tenants;
+}
+
+WanVrfRouting::Counters
+WanVrfEngine::GetCounters(uint32_t tenant) const
+{
+    WanVrfRouting::Counters counters;
+    for (const Ptr<WanVrfRouting>& routing : m_routing)
+    {
+        counters.Add(routing->GetCounters(m_tenants.at(tenant).vrf));
+    }
+    return counters;
+}
+
+void
+WanVrfEngine::Print(std::ostream& os) const
+{
+    os << "\nTenants: " << m_tenants.size() << " VRFs, site subnets "
+       << Ipv4Address(TENANT_BASE) << " + 4 x site/30 in every VRF" << std::endl;
+    for (const WanTenant& tenant : m_tenants)
+    {
+        os << "  " << tenant.name << " (VRF " << tenant.vrf << "):";
+        for (uint32_t i = 0; i < tenant.sites.size(); ++i)
+        {
+            const uint32_t s = tenant.sites[i];
+            os << (i == 0 ? " " : ", ") << m_topology.GetSite(s).name << " CE "
+               << tenant.addresses[i] << " via PE " << GetRouterId(s);
+        }
+        os << std::endl;
+    }
+}
+
+void
+WanVrfEngine::PrintCounters(std::ostream& os) const
+{
+    for (uint32_t t = 0; t < m_tenants.size(); ++t)
+    {
+        WanVrfRouting::Counters counters = GetCounters(t);
+        os << "Tenant " << m_tenants[t].name << ": " << counters.toCore
+           << " packets into the core, " << counters.fromCore << " out, " << counters.transit
+           << " in transit, " << counters.local << " local, " << counters.dropped << " dropped"
+           << std::endl;
+    }
+}
+
+} // namespace ns3
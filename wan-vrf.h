@@ -0,0 +1,282 @@
+/*
+ * Tenant VPNs: VRF routing instances per router, bound per interface
+ *
+ * Business units run separate VPNs over the same physical WAN. Simulating
+ * each tenant in its own process repeats the whole core, and hides how the
+ * tenants load each other's circuits when one fails. The VRF engine puts
+ * them in one run. Every tenant gets one customer edge (CE) node per site,
+ * attached to the site's router (the provider edge, PE) by an access
+ * circuit. The PE binds that interface to the tenant's VRF: a routing
+ * instance of its own, so tenants may use the same addresses. Here they
+ * all do: site i of every tenant is 172.16.0.0 + 4i/30, the PE at .1.
+ *
+ * A packet from a CE is routed in the VRF of its interface. A route to
+ * another site of the tenant names the PE there (its router ID, the
+ * address on its first circuit). The packet keeps its header, gets a
+ * WanVrfTag with the VRF and that egress PE, and follows the core's own
+ * routes to the egress PE, so tenants fail over with the core. The egress
+ * PE removes the tag and routes in the VRF to its CE. The tag plays the
+ * part of an MPLS VPN label without its 4 bytes per packet.
+ *
+ * The VRF routing (WanVrfRouting) sits on top of every router's list
+ * routing, so a core router in transit forwards tagged packets too.
+ * Untagged packets from core interfaces fall through to the other
+ * protocols: a tenant address means nothing in the core. Routing by
+ * interface and tag is not by destination only, so the route cache (see
+ * wan-route-cache.h) passes every lookup through.
+ */
+
+#ifndef WAN_VRF_H
+#define WAN_VRF_H
+
+#include "wan-topology-helper.h"
+#include "wan-topology.h"
+
+#include "ns3/data-rate.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/ipv4-routing-protocol.h"
+#include "ns3/ipv4.h"
+#include "ns3/node-container.h"
+#include "ns3/nstime.h"
+#include "ns3/tag.h"
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * VRF and egress PE of a tenant packet crossing the core.
+ */
+class WanVrfTag : public Tag
+{
+  public:
+    /// Get the type ID
+    static TypeId GetTypeId();
+
+    WanVrfTag();
+
+    /**
+     * \param vrf VRF of the tenant
+     * \param egress router ID of the egress PE
+     */
+    WanVrfTag(uint32_t vrf, Ipv4Address egress);
+
+    /// \return the VRF
+    uint32_t GetVrf() const;
+
+    /// \return the router ID of the egress PE
+    Ipv4Address GetEgress() const;
+
+    // Inherited from Tag
+    TypeId GetInstanceTypeId() const override;
+    uint32_t GetSerializedSize() const override;
+    void Serialize(TagBuffer buffer) const override;
+    void Deserialize(TagBuffer buffer) override;
+    void Print(std::ostream& os) const override;
+
+  private:
+    uint32_t m_vrf{0};    //!< VRF
+    Ipv4Address m_egress; //!< Egress PE
+};
+
+/**
+ * VRF routing instances of one router, consulted before its other protocols.
+ */
+class WanVrfRouting : public Ipv4RoutingProtocol
+{
+  public:
+    /// Packets of one VRF through this router
+    struct Counters
+    {
+        uint64_t toCore{0};   //!< From a CE, tagged towards a remote PE
+        uint64_t fromCore{0}; //!< Tagged, delivered to a CE here
+        uint64_t local{0};    //!< From a CE to another CE of this router
+        uint64_t transit{0};  //!< Tagged, forwarded towards another PE
+        uint64_t dropped{0};  //!< No VRF or core route
+
+        /// Add the counters of another router
+        void Add(const Counters& other);
+    };
+
+    /// Priority in the list routing: above policy routes (10)
+    static const int16_t PRIORITY = 20;
+
+    /// Get the type ID
+    static TypeId GetTypeId();
+
+    WanVrfRouting();
+
+    /**
+     * Bind an interface to a VRF: packets received on it are routed in the VRF.
+     * \param interface the interface
+     * \param vrf the VRF, not 0
+     */
+    void Bind(uint32_t interface, uint32_t vrf);
+
+    /// \return the VRF of an interface, 0 if it is not bound
+    uint32_t GetVrf(uint32_t interface) const;
+
+    /// \return true if some interface is bound to a VRF: the router is a PE of a tenant
+    bool HasBindings() const;
+
+    /**
+     * Add a route to a CE of this router.
+     * \param vrf the VRF
+     * \param network destination network
+     * \param mask destination mask
+     * \param gateway the CE
+     * \param interface interface to the CE
+     */
+    void AddAttachedRoute(uint32_t vrf,
+                          Ipv4Address network,
+                          Ipv4Mask mask,
+                          Ipv4Address gateway,
+                          uint32_t interface);
+
+    /**
+     * Add a route to a CE of another router.
+     * \param vrf the VRF
+     * \param network destination network
+     * \param mask destination mask
+     * \param egress router ID of the other router
+     */
+    void AddRemoteRoute(uint32_t vrf, Ipv4Address network, Ipv4Mask mask, Ipv4Address egress);
+
+    /// \return the counters of a VRF
+    Counters GetCounters(uint32_t vrf) const;
+
+    /**
+     * \param ipv4 a router's IPv4
+     * \return its VRF routing, or nullptr if it has none
+     */
+    static Ptr<WanVrfRouting> Find(Ptr<Ipv4> ipv4);
+
+    // Inherited from Ipv4RoutingProtocol
+    Ptr<Ipv4Route> RouteOutput(Ptr<Packet> p,
+                               const Ipv4Header& header,
+                               Ptr<NetDevice> oif,
+                               Socket::SocketErrno& sockerr) override;
+    bool RouteInput(Ptr<const Packet> p,
+                    const Ipv4Header& header,
+                    Ptr<const NetDevice> idev,
+                    const UnicastForwardCallback& ucb,
+                    const MulticastForwardCallback& mcb,
+                    const LocalDeliverCallback& lcb,
+                    const ErrorCallback& ecb) override;
+    void NotifyInterfaceUp(uint32_t interface) override;
+    void NotifyInterfaceDown(uint32_t interface) override;
+    void NotifyAddAddress(uint32_t interface, Ipv4InterfaceAddress address) override;
+    void NotifyRemoveAddress(uint32_t interface, Ipv4InterfaceAddress address) override;
+    void SetIpv4(Ptr<Ipv4> ipv4) override;
+    void PrintRoutingTable(Ptr<OutputStreamWrapper> stream,
+                           Time::Unit unit = Time::S) const override;
+
+  protected:
+    void DoDispose() override;
+
+  private:
+    /// A route of a VRF
+    struct Route
+    {
+        Ipv4Address network; //!< Destination network
+        Ipv4Mask mask;       //!< Destination mask
+        Ipv4Address gateway; //!< CE of an attached route
+        uint32_t interface;  //!< Interface of an attached route
+        Ipv4Address egress;  //!< Egress PE of a remote route
+        bool remote;         //!< Remote: over the core to egress
+    };
+
+    /// Add a route, keeping the VRF's routes longest prefix first
+    void AddRoute(uint32_t vrf, const Route& route);
+
+    /// \return the longest-prefix route of a VRF, or nullptr
+    const Route* Lookup(uint32_t vrf, Ipv4Address destination) const;
+
+    /// \return an ns-3 route to the CE of an attached route
+    Ptr<Ipv4Route> MakeRoute(const Route& route, Ipv4Address destination) const;
+
+    /**
+     * \param header header of the tenant packet
+     * \param egress the egress PE
+     * \return the core's route towards the egress PE, or nullptr
+     */
+    Ptr<Ipv4Route> CoreRoute(const Ipv4Header& header, Ipv4Address egress) const;
+
+    Ptr<Ipv4> m_ipv4;                                //!< IPv4 of the router
+    std::vector<uint32_t> m_bindings;                //!< VRF by interface, 0: none
+    std::map<uint32_t, std::vector<Route>> m_routes; //!< Routes by VRF
+    std::map<uint32_t, Counters> m_counters;         //!< Counters by VRF
+};
+
+/**
+ * A tenant VPN: one VRF, one CE per site.
+ */
+struct WanTenant
+{
+    std::string name;                   //!< Tenant name, e.g. "Sales"
+    uint32_t vrf{0};                    //!< VRF on every PE
+    std::vector<uint32_t> sites;        //!< Sites, in the order given
+    NodeContainer ces;                  //!< CE per site
+    std::vector<Ipv4Address> addresses; //!< CE address per site
+};
+
+/**
+ * Builds tenant VPNs over a network.
+ */
+class WanVrfEngine
+{
+  public:
+    /**
+     * \param topology the topology the network was built from
+     * \param network the network
+     */
+    WanVrfEngine(const WanTopology& topology, const WanNetwork& network);
+
+    /**
+     * Add tenants.
+     * \param tenants e.g. "Sales,Ops=HQ+DC": names, each optionally with
+     *        its sites; a tenant without sites has every site
+     */
+    void Add(const std::string& tenants);
+
+    /**
+     * \param bandwidth bandwidth of every access circuit (default 1Gbps)
+     * \param delay delay of every access circuit (default 1ms)
+     */
+    void SetAccessLink(DataRate bandwidth, Time delay);
+
+    /// Create the CEs and access circuits, and the VRF routes of every router
+    void Install();
+
+    /// \return the tenants
+    const std::vector<WanTenant>& GetTenants() const;
+
+    /// \return the counters of a tenant's VRF, added up over all routers
+    WanVrfRouting::Counters GetCounters(uint32_t tenant) const;
+
+    /// \return the router ID of a site: the address on its first circuit
+    Ipv4Address GetRouterId(uint32_t site) const;
+
+    /// Print the tenants and their sites
+    void Print(std::ostream& os) const;
+
+    /// Print the packet counters of every tenant
+    void PrintCounters(std::ostream& os) const;
+
+  private:
+    const WanTopology& m_topology;             //!< Topology
+    const WanNetwork& m_network;               //!< Network
+    DataRate m_accessBandwidth;                //!< Access circuit bandwidth
+    Time m_accessDelay;                        //!< Access circuit delay
+    std::vector<WanTenant> m_tenants;          //!< Tenants
+    std::vector<Ptr<WanVrfRouting>> m_routing; //!< VRF routing by site
+};
+
+} // namespace ns3
+
+#endif /* WAN_VRF_H */